@@ -11,9 +11,13 @@
 #include <exception>
 #include <variant>
 #include <unordered_map>
+#include <unordered_set>
+#include <functional>
 #include "CacheErrorCodes.h"
+#include "IFlushCallback.h"
 #include "ErrorCodes.h"
 #include "VariadicNthType.h"
+#include "WriteAheadLog.hpp"
 #include <tuple>
 #include <vector>
 #include <stdexcept>
@@ -25,6 +29,16 @@
 
 using namespace std::chrono_literals;
 
+#define COMPACTION_INTERVAL 100ms
+#define COMPACTION_TICKS_PER_SECOND 10
+
+// The leaves to the right of the current one are read ahead once this many operations in a row have gone for ascending keys (see readAhead).
+#define READAHEAD_SEQUENTIAL_RUN 8
+#define READAHEAD_DEFAULT_LEAVES 4
+
+// The number of readers that refill the cache from the warm-up list on open (see enableWarmUp).
+#define WARMUP_DEFAULT_THREADS 4
+
 #ifdef __TREE_WITH_CACHE__
 template <typename ICallback, typename KeyType, typename ValueType, typename CacheType>
 class BPlusStore : public ICallback
@@ -40,26 +54,96 @@ class BPlusStore
     using DataNodeType = typename std::tuple_element<0, typename ObjectType::ValueCoreTypesTuple>::type;
     using IndexNodeType = typename std::tuple_element<1, typename ObjectType::ValueCoreTypesTuple>::type;
 
+    // The index nodes buffer the updates for their subtrees, i.e. the tree is a Bε-tree (see IndexNode and write).
+    static constexpr bool BUFFERED_INDEX_NODES = requires { requires IndexNodeType::BUFFER_CAPACITY > 0; };
+
+public:
+    // Combines the current value of a key (std::nullopt if there is none) with an operand into its new value (see merge).
+    typedef std::function<ValueType(const std::optional<ValueType>&, const ValueType&)> MergeOperatorType;
+
 private:
     uint32_t m_nDegree;
     std::shared_ptr<CacheType> m_ptrCache;
     std::optional<ObjectUIDType> m_uidRootNode;
 
+    MergeOperatorType m_fnMergeOperator;
+
 #ifdef __CONCURRENT__
     mutable std::shared_mutex m_mutex;
 #endif //__CONCURRENT__
 
+#ifdef __TREE_WITH_CACHE__
+    // The reference to the root node, alike the ones the index nodes keep for their children (see IndexNode::getSwizzledChildAt).
+    std::weak_ptr<void> m_wptrRootNode;
+
+    typedef WriteAheadLog<KeyType, ValueType> WALType;
+
+    std::unique_ptr<WALType> m_ptrWAL;
+
+    // The sidecar file the resident nodes are listed in at each checkpoint and read back from on open (see enableWarmUp).
+    std::optional<std::string> m_stWarmUpFilename;
+    size_t m_nWarmUpThreads;
+#endif //__TREE_WITH_CACHE__
+
+#if defined(__TREE_WITH_CACHE__) && defined(__CONCURRENT__)
+    bool m_bStopCompaction;
+    size_t m_nCompactionIOBudget;
+    std::thread m_threadCompaction;
+
+    bool m_bStopDemotion;
+    size_t m_nDemotionIOBudget;
+    std::thread m_threadDemotion;
+
+    // The last key accessed, the number of operations in a row that went for ascending keys, and the leaf the last read-ahead was issued from.
+    std::mutex m_mtxReadAhead;
+    std::optional<KeyType> m_keyLastAccessed;
+    size_t m_nSequentialRun;
+    std::optional<ObjectUIDType> m_uidLastReadAheadLeaf;
+    size_t m_nReadAheadLeaves;
+#endif //__TREE_WITH_CACHE__ && __CONCURRENT__
+
 public:
     ~BPlusStore()
     {
+#if defined(__TREE_WITH_CACHE__) && defined(__CONCURRENT__)
+        stopCompaction();
+        stopDemotion();
+#endif //__TREE_WITH_CACHE__ && __CONCURRENT__
     }
 
     template<typename... CacheArgs>
     BPlusStore(uint32_t nDegree, CacheArgs... args)
         : m_nDegree(nDegree)
         , m_uidRootNode(std::nullopt)
+#ifdef __TREE_WITH_CACHE__
+        , m_stWarmUpFilename(std::nullopt)
+        , m_nWarmUpThreads(WARMUP_DEFAULT_THREADS)
+#endif //__TREE_WITH_CACHE__
+#if defined(__TREE_WITH_CACHE__) && defined(__CONCURRENT__)
+        , m_bStopCompaction(true)
+        , m_nCompactionIOBudget(0)
+        , m_bStopDemotion(true)
+        , m_nDemotionIOBudget(0)
+        , m_keyLastAccessed(std::nullopt)
+        , m_nSequentialRun(0)
+        , m_uidLastReadAheadLeaf(std::nullopt)
+        , m_nReadAheadLeaves(READAHEAD_DEFAULT_LEAVES)
+#endif //__TREE_WITH_CACHE__ && __CONCURRENT__
     {
         m_ptrCache = std::make_shared<CacheType>(args...);
+
+#if defined(__TREE_WITH_CACHE__) && defined(__TRACK_CACHE_FOOTPRINT__)
+        // The nodes that are promoted to DRAM on the read path are not accounted by the cache, hence the budget.
+        if constexpr (requires { typename DataNodeType::PromotionPolicyType; })
+        {
+            DataNodeType::PromotionPolicyType::setCacheCapacity(m_ptrCache->getCapacity());
+        }
+
+        if constexpr (requires { typename IndexNodeType::PromotionPolicyType; })
+        {
+            IndexNodeType::PromotionPolicyType::setCacheCapacity(m_ptrCache->getCapacity());
+        }
+#endif //__TREE_WITH_CACHE__ && __TRACK_CACHE_FOOTPRINT__
     }
 
     template <typename DefaultNodeType>
@@ -70,9 +154,63 @@ public:
 #endif //__TREE_WITH_CACHE__
 
         m_ptrCache->template createObjectOfType<DefaultNodeType>(m_uidRootNode);
+
+#ifdef __TREE_WITH_CACHE__
+        // The records left by a previous store have nothing to be applied to.
+        if (m_ptrWAL != nullptr)
+        {
+            m_ptrWAL->truncate(m_ptrWAL->getLastLSN());
+        }
+#endif //__TREE_WITH_CACHE__
     }
 
     ErrorCode insert(const KeyType& key, const ValueType& value, bool print = false)
+    {
+        if constexpr (BUFFERED_INDEX_NODES)
+        {
+            return write(key, value, IndexNodeType::Insert);
+        }
+
+        return insertOrUpdate(key, value, nullptr);
+    }
+
+    // Sets the value of the key to what fnUpdate returns for its current one (std::nullopt if there is none), the read, the update and the
+    // write take a single descent, e.g. a counter is not to be searched for, removed and then inserted again.
+    template <typename UpdateFn>
+    ErrorCode upsert(const KeyType& key, UpdateFn fnUpdate)
+    {
+        if constexpr (BUFFERED_INDEX_NODES)
+        {
+            return write(key, ValueType(), IndexNodeType::Insert, fnUpdate);
+        }
+
+        return insertOrUpdate(key, ValueType(), fnUpdate);
+    }
+
+    void setMergeOperator(MergeOperatorType fnMergeOperator)
+    {
+        m_fnMergeOperator = fnMergeOperator;
+    }
+
+    // An upsert by the operator registered with setMergeOperator, e.g. one that adds the operand to a counter.
+    ErrorCode merge(const KeyType& key, const ValueType& operand)
+    {
+        if (!m_fnMergeOperator)
+        {
+            std::cout << "Critical State: No merge operator is registered." << std::endl;
+            throw new std::logic_error(".....");   // TODO: critical log.
+        }
+
+        return upsert(key, [this, &operand](const std::optional<ValueType>& value)
+            {
+                return m_fnMergeOperator(value, operand);
+            });
+    }
+
+private:
+    // Inserts the value, or with fnUpdate (see upsert) sets the key to what it returns.
+    template <typename UpdateFn>
+    ErrorCode insertOrUpdate(const KeyType& key, const ValueType& value, UpdateFn fnUpdate)
     {
         ErrorCode ecResult = ErrorCode::Error;
 
@@ -93,6 +231,18 @@ public:
 
         std::vector<std::pair<ObjectUIDType, ObjectTypePtr>> vtNodes;
 
+#ifdef __TREE_WITH_CACHE__
+        uint64_t nLSN = 0;
+#endif //__TREE_WITH_CACHE__
+
+#if defined(__TREE_WITH_CACHE__) && defined(__CONCURRENT__)
+        // The writers are paced before they take any lock, the eviction they wait for needs the nodes they would hold (see LRUCache::throttle).
+        if constexpr (requires { m_ptrCache->throttle(); })
+        {
+            m_ptrCache->throttle();
+        }
+#endif //__TREE_WITH_CACHE__ && __CONCURRENT__
+
 #ifdef __CONCURRENT__
         std::vector<std::unique_lock<std::shared_mutex>> vtLocks;
         vtLocks.emplace_back(std::unique_lock<std::shared_mutex>(m_mutex));
@@ -167,11 +317,58 @@ public:
             {
                 std::shared_ptr<DataNodeType> ptrDataNode = std::get<std::shared_ptr<DataNodeType>>(ptrCurrentNode->getInnerData());
 
+#if defined(__TREE_WITH_CACHE__) && defined(__CONCURRENT__)
+                readAhead(key, ptrLastNode, uidCurrentNode);
+#endif //__TREE_WITH_CACHE__ && __CONCURRENT__
+
+                if constexpr (std::is_null_pointer_v<UpdateFn>)
+                {
+#ifdef __TRACK_CACHE_FOOTPRINT__
+                    ecResult = ptrDataNode->insert(key, value, nMemoryFootprint);
+#else //__TRACK_CACHE_FOOTPRINT__
+                    ecResult = ptrDataNode->insert(key, value);
+#endif //__TRACK_CACHE_FOOTPRINT__
+                }
+                else
+                {
+                    ValueType valueExisting;
+                    bool bExists = ptrDataNode->getValue(key, valueExisting) == ErrorCode::Success;
+
+                    ValueType valueUpdated = fnUpdate(bExists ? std::optional<ValueType>(valueExisting) : std::nullopt);
+
+                    if (!bExists)
+                    {
+#ifdef __TRACK_CACHE_FOOTPRINT__
+                        ecResult = ptrDataNode->insert(key, valueUpdated, nMemoryFootprint);
+#else //__TRACK_CACHE_FOOTPRINT__
+                        ecResult = ptrDataNode->insert(key, valueUpdated);
+#endif //__TRACK_CACHE_FOOTPRINT__
+                    }
+                    else if constexpr (requires { ptrDataNode->update(key, valueUpdated); })
+                    {
+                        ecResult = ptrDataNode->update(key, valueUpdated);
+                    }
+                    else
+                    {
 #ifdef __TRACK_CACHE_FOOTPRINT__
-                if (ptrDataNode->insert(key, value, nMemoryFootprint) != ErrorCode::Success)
+                        ptrDataNode->remove(key, nMemoryFootprint);
+                        ecResult = ptrDataNode->insert(key, valueUpdated, nMemoryFootprint);
 #else //__TRACK_CACHE_FOOTPRINT__
-                if (ptrDataNode->insert(key, value) != ErrorCode::Success)
+                        ptrDataNode->remove(key);
+                        ecResult = ptrDataNode->insert(key, valueUpdated);
 #endif //__TRACK_CACHE_FOOTPRINT__
+                    }
+
+#ifdef __TREE_WITH_CACHE__
+                    // Logged while the leaf is held, the updates of a key are to be replayed in the order they were applied.
+                    if (ecResult == ErrorCode::Success && m_ptrWAL != nullptr)
+                    {
+                        nLSN = m_ptrWAL->append(WALType::Update, key, valueUpdated);
+                    }
+#endif //__TREE_WITH_CACHE__
+                }
+
+                if (ecResult != ErrorCode::Success)
                 {
 #ifdef __CONCURRENT__
                     vtLocks.clear();
@@ -181,10 +378,6 @@ public:
                     ecResult = ErrorCode::InsertFailed;
                     break;
                 }
-                else
-                {
-                    ecResult = ErrorCode::Success;
-                }
 
 #ifdef __TREE_WITH_CACHE__
                 ptrCurrentNode->setDirtyFlag(true);
@@ -350,10 +543,31 @@ public:
             m_ptrCache->updateMemoryFootprint(nMemoryFootprint);
         }
 #endif //__TRACK_CACHE_FOOTPRINT__
+
+#ifdef __TREE_WITH_CACHE__
+        if (ecResult == ErrorCode::Success && m_ptrWAL != nullptr)
+        {
+            if constexpr (std::is_null_pointer_v<UpdateFn>)
+            {
+                nLSN = m_ptrWAL->append(WALType::Insert, key, value);
+            }
+
+            m_ptrWAL->waitForCommit(nLSN);
+        }
+#endif //__TREE_WITH_CACHE__
+
         return ecResult;
     }
 
+public:
     ErrorCode search(const KeyType& key, ValueType& value)
+    {
+        return search(key, value, false);
+    }
+
+private:
+    // bTreeLocked is set by the callers that already hold m_mutex (see write).
+    ErrorCode search(const KeyType& key, ValueType& value, bool bTreeLocked)
     {
         ErrorCode ecResult = ErrorCode::Error;
 
@@ -367,17 +581,36 @@ public:
 
 #ifdef __CONCURRENT__
         std::vector<std::unique_lock<std::shared_mutex>> vtLocks;
-        vtLocks.emplace_back(std::unique_lock<std::shared_mutex>(m_mutex));
+        if (bTreeLocked)
+        {
+            vtLocks.emplace_back();     // Takes the place of the tree's lock in the coupling below.
+        }
+        else
+        {
+            vtLocks.emplace_back(std::unique_lock<std::shared_mutex>(m_mutex));
+        }
 #endif //__CONCURRENT__
 
         ObjectTypePtr ptrCurrentNode = nullptr;
         ObjectUIDType uidCurrentNode = *m_uidRootNode;
 
+#ifdef __TREE_WITH_CACHE__
+        // The slot (the parent's, or the root's) that refers to the current node, the parent is still locked when it is used.
+        std::weak_ptr<void>* ptrSwizzledNode = &m_wptrRootNode;
+#endif //__TREE_WITH_CACHE__
+
         do
         {
 #ifdef __TREE_WITH_CACHE__
             std::optional<ObjectUIDType> uidUpdated = std::nullopt;
-            m_ptrCache->getObject(uidCurrentNode, ptrCurrentNode, uidUpdated);
+            if (ptrSwizzledNode != nullptr)
+            {
+                m_ptrCache->getObject(uidCurrentNode, *ptrSwizzledNode, ptrCurrentNode, uidUpdated);
+            }
+            else
+            {
+                m_ptrCache->getObject(uidCurrentNode, ptrCurrentNode, uidUpdated);
+            }
 #else //__TREE_WITH_CACHE__
             m_ptrCache->getObject(uidCurrentNode, ptrCurrentNode);
 #endif //__TREE_WITH_CACHE__
@@ -430,7 +663,42 @@ public:
             {
                 std::shared_ptr<IndexNodeType> ptrIndexNode = std::get<std::shared_ptr<IndexNodeType>>(ptrCurrentNode->getInnerData());
 
+                // A message pending on the way down is more recent than whatever is below it.
+                if constexpr (BUFFERED_INDEX_NODES)
+                {
+                    typename IndexNodeType::Message message;
+                    if (ptrIndexNode->getMessage(key, message))
+                    {
+                        if (message.m_nOperation == IndexNodeType::Insert)
+                        {
+                            value = message.m_value;
+                            ecResult = ErrorCode::Success;
+                        }
+                        else
+                        {
+                            ecResult = ErrorCode::KeyDoesNotExist;
+                        }
+
+                        break;
+                    }
+                }
+
+#ifdef __TREE_WITH_CACHE__
+                if constexpr (requires { ptrIndexNode->getSwizzledChildAt(0); })
+                {
+                    size_t nChildIdx = ptrIndexNode->getChildNodeIdx(key);
+
+                    uidCurrentNode = ptrIndexNode->getChildAt(nChildIdx);
+                    ptrSwizzledNode = &ptrIndexNode->getSwizzledChildAt(nChildIdx);
+                }
+                else
+                {
+                    uidCurrentNode = ptrIndexNode->getChild(key);
+                    ptrSwizzledNode = nullptr;
+                }
+#else //__TREE_WITH_CACHE__
                 uidCurrentNode = ptrIndexNode->getChild(key);
+#endif //__TREE_WITH_CACHE__
             }
             else //if (std::holds_alternative<std::shared_ptr<DataNodeType>>(ptrCurrentNode->getInnerData()))
             {
@@ -438,6 +706,10 @@ public:
 
                 ecResult = ptrDataNode->getValue(key, value);
 
+#if defined(__TREE_WITH_CACHE__) && defined(__CONCURRENT__)
+                readAhead(key, vtAccessedNodes.size() > 1 ? vtAccessedNodes[vtAccessedNodes.size() - 2].second : nullptr, uidCurrentNode);
+#endif //__TREE_WITH_CACHE__ && __CONCURRENT__
+
                 break;
             }
 
@@ -462,8 +734,14 @@ public:
         return ecResult;
     }
 
+public:
     ErrorCode remove(const KeyType& key)
     {
+        if constexpr (BUFFERED_INDEX_NODES)
+        {
+            return write(key, ValueType(), IndexNodeType::Remove);
+        }
+
         ErrorCode ecResult = ErrorCode::Success;
 
 #ifdef __TRACK_CACHE_FOOTPRINT__
@@ -479,6 +757,14 @@ public:
         std::vector<std::pair<ObjectUIDType, ObjectTypePtr>> vtAccessedNodes;
 #endif //__TREE_WITH_CACHE__
 
+#if defined(__TREE_WITH_CACHE__) && defined(__CONCURRENT__)
+        // The writers are paced before they take any lock, the eviction they wait for needs the nodes they would hold (see LRUCache::throttle).
+        if constexpr (requires { m_ptrCache->throttle(); })
+        {
+            m_ptrCache->throttle();
+        }
+#endif //__TREE_WITH_CACHE__ && __CONCURRENT__
+
 #ifdef __CONCURRENT__
         std::vector<std::unique_lock<std::shared_mutex>> vtLocks;
         vtLocks.emplace_back(std::unique_lock<std::shared_mutex>(m_mutex));
@@ -767,174 +1053,1596 @@ public:
         }
 #endif //__TRACK_CACHE_FOOTPRINT__
 
+#ifdef __TREE_WITH_CACHE__
+        if (ecResult == ErrorCode::Success && m_ptrWAL != nullptr)
+        {
+            m_ptrWAL->waitForCommit(m_ptrWAL->append(WALType::Remove, key, ValueType()));
+        }
+#endif //__TREE_WITH_CACHE__
+
         return ecResult;
     }
 
-    void print(std::ofstream & os)
+    // Removes the keys in [keyBegin, keyEnd). The subtrees that hold no other keys are detached from their parents whole and their nodes are
+    // released in a batch, only the nodes on the paths to both ends of the range are visited, and are then rebalanced top-down.
+    ErrorCode removeRange(const KeyType& keyBegin, const KeyType& keyEnd)
     {
-        int nSpace = 7;
+        if (!(keyBegin < keyEnd))
+        {
+            return ErrorCode::Success;
+        }
 
-        std::string prefix;
+#ifdef __TRACK_CACHE_FOOTPRINT__
+        int32_t nMemoryFootprint = 0;
+#endif //__TRACK_CACHE_FOOTPRINT__
 
-        os << prefix << "|" << std::endl;
-        os << prefix << "|" << std::string(nSpace, '-').c_str() << "(root)";
+        std::vector<std::pair<ObjectUIDType, ObjectTypePtr>> vtAccessedNodes;
+        std::vector<std::pair<ObjectUIDType, size_t>> vtDetachedNodes;
 
-        os << std::endl;
+#if defined(__TREE_WITH_CACHE__) && defined(__CONCURRENT__)
+        // The writers are paced before they take any lock, the eviction they wait for needs the nodes they would hold (see LRUCache::throttle).
+        if constexpr (requires { m_ptrCache->throttle(); })
+        {
+            m_ptrCache->throttle();
+        }
+#endif //__TREE_WITH_CACHE__ && __CONCURRENT__
 
-        ObjectTypePtr ptrRootNode = nullptr;
+#ifdef __CONCURRENT__
+        // The range may span any part of the tree, hence the tree is held and the operations already past the root are let finish (see
+        // checkpoint), the nodes need not be locked then.
+        std::vector<std::unique_lock<std::shared_mutex>> vtLocks;
+        vtLocks.emplace_back(std::unique_lock<std::shared_mutex>(m_mutex));
 
-#ifdef __TREE_WITH_CACHE__
-        std::optional<ObjectUIDType> uidUpdated = std::nullopt;
-        m_ptrCache->getObject(m_uidRootNode.value(), ptrRootNode, uidUpdated);
+        m_ptrCache->waitUntilReleased();
+#endif //__CONCURRENT__
 
-        if (uidUpdated != std::nullopt)
+        ObjectTypePtr ptrRootNode = getRootNode();
+        vtAccessedNodes.push_back(std::make_pair(*m_uidRootNode, ptrRootNode));
+
+#ifdef __TRACK_CACHE_FOOTPRINT__
+        trimNode(ptrRootNode, keyBegin, keyEnd, std::nullopt, std::nullopt, 0, vtDetachedNodes, vtAccessedNodes, nMemoryFootprint);
+
+        if (vtDetachedNodes.size() > 0)
         {
-            m_uidRootNode = uidUpdated;
+            releaseDetachedNodes(ptrRootNode, keyBegin, vtDetachedNodes, vtAccessedNodes, nMemoryFootprint);
         }
-#else //__TREE_WITH_CACHE__
-        m_ptrCache->getObject(m_uidRootNode.value(), ptrRootNode);
-#endif //__TREE_WITH_CACHE__
+#else //__TRACK_CACHE_FOOTPRINT__
+        trimNode(ptrRootNode, keyBegin, keyEnd, std::nullopt, std::nullopt, 0, vtDetachedNodes, vtAccessedNodes);
 
-        if (std::holds_alternative<std::shared_ptr<IndexNodeType>>(ptrRootNode->getInnerData()))
+        if (vtDetachedNodes.size() > 0)
         {
-            std::shared_ptr<IndexNodeType> ptrIndexNode = std::get<std::shared_ptr<IndexNodeType>>(ptrRootNode->getInnerData());
-
-            ptrIndexNode->template print<CacheType, ObjectTypePtr>(os, m_ptrCache, 0, prefix);
+            releaseDetachedNodes(ptrRootNode, keyBegin, vtDetachedNodes, vtAccessedNodes);
         }
-        else if (std::holds_alternative<std::shared_ptr<DataNodeType>>(ptrRootNode->getInnerData()))
-        {
-            std::shared_ptr<DataNodeType> ptrDataNode = std::get<std::shared_ptr<DataNodeType>>(ptrRootNode->getInnerData());
+#endif //__TRACK_CACHE_FOOTPRINT__
 
-            ptrDataNode->print(os, 0, prefix);
-        }
-    }
+        bool bRepaired = false;
+        do
+        {
+#if defined(__CONCURRENT__) && defined(__TRACK_CACHE_FOOTPRINT__)
+            settleRootNode(ptrRootNode, vtAccessedNodes, vtLocks, nMemoryFootprint);
+            bRepaired = repairRangeEnds(ptrRootNode, keyBegin, keyEnd, vtAccessedNodes, nMemoryFootprint);
+#elif defined(__CONCURRENT__)
+            settleRootNode(ptrRootNode, vtAccessedNodes, vtLocks);
+            bRepaired = repairRangeEnds(ptrRootNode, keyBegin, keyEnd, vtAccessedNodes);
+#elif defined(__TRACK_CACHE_FOOTPRINT__)
+            settleRootNode(ptrRootNode, vtAccessedNodes, nMemoryFootprint);
+            bRepaired = repairRangeEnds(ptrRootNode, keyBegin, keyEnd, vtAccessedNodes, nMemoryFootprint);
+#else //__CONCURRENT__ && __TRACK_CACHE_FOOTPRINT__
+            settleRootNode(ptrRootNode, vtAccessedNodes);
+            bRepaired = repairRangeEnds(ptrRootNode, keyBegin, keyEnd, vtAccessedNodes);
+#endif //__CONCURRENT__ && __TRACK_CACHE_FOOTPRINT__
+        } while (!bRepaired);
+
+#if defined(__CONCURRENT__) && defined(__TRACK_CACHE_FOOTPRINT__)
+        settleRootNode(ptrRootNode, vtAccessedNodes, vtLocks, nMemoryFootprint);
+#elif defined(__CONCURRENT__)
+        settleRootNode(ptrRootNode, vtAccessedNodes, vtLocks);
+#elif defined(__TRACK_CACHE_FOOTPRINT__)
+        settleRootNode(ptrRootNode, vtAccessedNodes, nMemoryFootprint);
+#else //__CONCURRENT__ && __TRACK_CACHE_FOOTPRINT__
+        settleRootNode(ptrRootNode, vtAccessedNodes);
+#endif //__CONCURRENT__ && __TRACK_CACHE_FOOTPRINT__
 
 #ifdef __TREE_WITH_CACHE__
-    void getCacheState(size_t& nObjectsLinkedList, size_t& nObjectsInMap)
-    {
-        return m_ptrCache->getCacheState(nObjectsLinkedList, nObjectsInMap);
-    }
+        m_ptrCache->reorder(vtAccessedNodes, false, false);
+        vtAccessedNodes.clear();
+
+        uint64_t nLSN = 0;
+        if (m_ptrWAL != nullptr)
+        {
+            nLSN = m_ptrWAL->appendRange(keyBegin, keyEnd);
+        }
 #endif //__TREE_WITH_CACHE__
 
+#ifdef __CONCURRENT__
+        vtLocks.clear();
+#endif //__CONCURRENT__
+
+#ifdef __TRACK_CACHE_FOOTPRINT__
+        if (nMemoryFootprint != 0)
+        {
+            m_ptrCache->updateMemoryFootprint(nMemoryFootprint);
+        }
+#endif //__TRACK_CACHE_FOOTPRINT__
+
 #ifdef __TREE_WITH_CACHE__
-public:
-    ErrorCode flush()
-    {
-        m_ptrCache->flush();
+        if (m_ptrWAL != nullptr)
+        {
+            m_ptrWAL->waitForCommit(nLSN);
+        }
+#endif //__TREE_WITH_CACHE__
 
         return ErrorCode::Success;
     }
 
-    void applyExistingUpdates(std::shared_ptr<ObjectType> ptrObject
-        , std::unordered_map<ObjectUIDType, std::pair<std::optional<ObjectUIDType>, std::shared_ptr<ObjectType>>>& mpUIDUpdates)
+private:
+    // Takes the keys in [keyBegin, keyEnd) out of the subtree, whose keys lie within the bounds (std::nullopt for a side that is not bounded).
+    // The children that hold no other keys are detached and are appended to vtDetachedNodes along with their depth, the ones that straddle
+    // an end of the range are trimmed in turn.
+#ifdef __TRACK_CACHE_FOOTPRINT__
+    void trimNode(const ObjectTypePtr& ptrNode, const KeyType& keyBegin, const KeyType& keyEnd, const std::optional<KeyType>& keyLower, const std::optional<KeyType>& keyUpper, size_t nDepth, std::vector<std::pair<ObjectUIDType, size_t>>& vtDetachedNodes, std::vector<std::pair<ObjectUIDType, ObjectTypePtr>>& vtAccessedNodes, int32_t& nMemoryFootprint)
+#else //__TRACK_CACHE_FOOTPRINT__
+    void trimNode(const ObjectTypePtr& ptrNode, const KeyType& keyBegin, const KeyType& keyEnd, const std::optional<KeyType>& keyLower, const std::optional<KeyType>& keyUpper, size_t nDepth, std::vector<std::pair<ObjectUIDType, size_t>>& vtDetachedNodes, std::vector<std::pair<ObjectUIDType, ObjectTypePtr>>& vtAccessedNodes)
+#endif //__TRACK_CACHE_FOOTPRINT__
     {
-        if (std::holds_alternative<std::shared_ptr<IndexNodeType>>(ptrObject->getInnerData()))
+        if (std::holds_alternative<std::shared_ptr<DataNodeType>>(ptrNode->getInnerData()))
         {
-            std::shared_ptr<IndexNodeType> ptrIndexNode = std::get<std::shared_ptr<IndexNodeType>>(ptrObject->getInnerData());
+            std::shared_ptr<DataNodeType> ptrDataNode = std::get<std::shared_ptr<DataNodeType>>(ptrNode->getInnerData());
 
-            bool bDirty = ptrIndexNode->updateChildrenUIDs(mpUIDUpdates);
-
-            if (bDirty)
+#ifdef __TRACK_CACHE_FOOTPRINT__
+            if (ptrDataNode->removeRange(keyBegin, keyEnd, nMemoryFootprint) > 0)
+#else //__TRACK_CACHE_FOOTPRINT__
+            if (ptrDataNode->removeRange(keyBegin, keyEnd) > 0)
+#endif //__TRACK_CACHE_FOOTPRINT__
             {
-                ptrObject->setDirtyFlag(true);
+#ifdef __TREE_WITH_CACHE__
+                ptrNode->setDirtyFlag(true);
+#endif //__TREE_WITH_CACHE__
             }
+
+            return;
         }
-    }
 
-    void applyExistingUpdates(std::vector<std::pair<ObjectUIDType, std::pair<std::optional<ObjectUIDType>, std::shared_ptr<ObjectType>>>>& vtNodes
-        , std::unordered_map<ObjectUIDType, std::pair<std::optional<ObjectUIDType>, std::shared_ptr<ObjectType>>>& mpUIDUpdates)
-    {
-        for (auto it = vtNodes.begin(), itend = vtNodes.end(); it != itend; it++)
-        {
-            if (std::holds_alternative<std::shared_ptr<IndexNodeType>>((*it).second.second->getInnerData()))
-            {
-                std::shared_ptr<IndexNodeType> ptrIndexNode = std::get<std::shared_ptr<IndexNodeType>>((*it).second.second->getInnerData());
+        std::shared_ptr<IndexNodeType> ptrIndexNode = std::get<std::shared_ptr<IndexNodeType>>(ptrNode->getInnerData());
 
-                bool bDirty = ptrIndexNode->updateChildrenUIDs(mpUIDUpdates);
+        std::vector<ObjectUIDType> vtChildren;
+        std::vector<size_t> vtStraddling;
+        ptrIndexNode->removeRange(keyBegin, keyEnd, keyLower, keyUpper, vtChildren, vtStraddling);
 
-                if (bDirty)
-                {
-                    (*it).second.second->setDirtyFlag(true);
-                }
-            }
+        for (const ObjectUIDType& uidChildNode : vtChildren)
+        {
+            vtDetachedNodes.push_back(std::make_pair(uidChildNode, nDepth + 1));
         }
-    }
 
-    void prepareFlush(std::vector<std::pair<ObjectUIDType, std::pair<std::optional<ObjectUIDType>, std::shared_ptr<ObjectType>>>>& vtNodes
-        , size_t nOffset, size_t& nNewOffset, size_t nBlockSize, ObjectUIDType::StorageMedia nMediaType)
-    {
-        nNewOffset = nOffset;
+#ifdef __TREE_WITH_CACHE__
+        ptrNode->setDirtyFlag(true);
+#endif //__TREE_WITH_CACHE__
 
-        std::unordered_map<ObjectUIDType, std::pair<std::optional<ObjectUIDType>, std::shared_ptr<ObjectType>>> mpUIDUpdates;
+        for (size_t nChildIdx : vtStraddling)
+        {
+            std::optional<KeyType> keyChildLower, keyChildUpper;
+            ptrIndexNode->getChildBounds(nChildIdx, keyLower, keyUpper, keyChildLower, keyChildUpper);
 
-        for (size_t idx = 0; idx < vtNodes.size(); idx++)
+            ObjectUIDType uidChildNode;
+
+#ifdef __TRACK_CACHE_FOOTPRINT__
+            ObjectTypePtr ptrChildNode = getChildNode(ptrNode, nChildIdx, uidChildNode, vtAccessedNodes, nMemoryFootprint);
+            trimNode(ptrChildNode, keyBegin, keyEnd, keyChildLower, keyChildUpper, nDepth + 1, vtDetachedNodes, vtAccessedNodes, nMemoryFootprint);
+#else //__TRACK_CACHE_FOOTPRINT__
+            ObjectTypePtr ptrChildNode = getChildNode(ptrNode, nChildIdx, uidChildNode, vtAccessedNodes);
+            trimNode(ptrChildNode, keyBegin, keyEnd, keyChildLower, keyChildUpper, nDepth + 1, vtDetachedNodes, vtAccessedNodes);
+#endif //__TRACK_CACHE_FOOTPRINT__
+        }
+    }
+
+    // Releases the nodes of the detached subtrees in a batch. The leaves are not loaded, the depth they are at is taken from the path to the
+    // beginning of the range, which has been walked already.
+#ifdef __TRACK_CACHE_FOOTPRINT__
+    void releaseDetachedNodes(const ObjectTypePtr& ptrRootNode, const KeyType& keyBegin, std::vector<std::pair<ObjectUIDType, size_t>>& vtDetachedNodes, std::vector<std::pair<ObjectUIDType, ObjectTypePtr>>& vtAccessedNodes, int32_t& nMemoryFootprint)
+#else //__TRACK_CACHE_FOOTPRINT__
+    void releaseDetachedNodes(const ObjectTypePtr& ptrRootNode, const KeyType& keyBegin, std::vector<std::pair<ObjectUIDType, size_t>>& vtDetachedNodes, std::vector<std::pair<ObjectUIDType, ObjectTypePtr>>& vtAccessedNodes)
+#endif //__TRACK_CACHE_FOOTPRINT__
+    {
+        size_t nLeafDepth = 0;
+
+        ObjectUIDType uidNode = *m_uidRootNode;
+        ObjectTypePtr ptrNode = ptrRootNode;
+        while (std::holds_alternative<std::shared_ptr<IndexNodeType>>(ptrNode->getInnerData()))
+        {
+            std::shared_ptr<IndexNodeType> ptrIndexNode = std::get<std::shared_ptr<IndexNodeType>>(ptrNode->getInnerData());
+
+#ifdef __TRACK_CACHE_FOOTPRINT__
+            ptrNode = getChildNode(ptrNode, ptrIndexNode->getChildNodeIdx(keyBegin), uidNode, vtAccessedNodes, nMemoryFootprint);
+#else //__TRACK_CACHE_FOOTPRINT__
+            ptrNode = getChildNode(ptrNode, ptrIndexNode->getChildNodeIdx(keyBegin), uidNode, vtAccessedNodes);
+#endif //__TRACK_CACHE_FOOTPRINT__
+
+            nLeafDepth++;
+        }
+
+        std::vector<ObjectUIDType> vtNodes;
+
+        while (vtDetachedNodes.size() > 0)
+        {
+            auto [uidDetachedNode, nDepth] = vtDetachedNodes.back();
+            vtDetachedNodes.pop_back();
+
+            // An index node is loaded for its children only.
+            if (nDepth < nLeafDepth)
+            {
+                ObjectTypePtr ptrDetachedNode = nullptr;
+
+#ifdef __TREE_WITH_CACHE__
+                std::optional<ObjectUIDType> uidUpdated = std::nullopt;
+                m_ptrCache->getObject(uidDetachedNode, ptrDetachedNode, uidUpdated);
+
+                if (uidUpdated != std::nullopt)
+                {
+                    uidDetachedNode = *uidUpdated;
+                }
+#else //__TREE_WITH_CACHE__
+                m_ptrCache->getObject(uidDetachedNode, ptrDetachedNode);
+#endif //__TREE_WITH_CACHE__
+
+                if (ptrDetachedNode == nullptr)
+                {
+                    std::cout << "Critical State: While removing the range the cache returned NULL object." << std::endl;
+                    throw new std::logic_error(".....");   // TODO: critical log.
+                }
+
+                std::shared_ptr<IndexNodeType> ptrIndexNode = std::get<std::shared_ptr<IndexNodeType>>(ptrDetachedNode->getInnerData());
+                for (size_t nIdx = 0; nIdx <= ptrIndexNode->getKeysCount(); nIdx++)
+                {
+                    vtDetachedNodes.push_back(std::make_pair(ptrIndexNode->getChildAt(nIdx), nDepth + 1));
+                }
+            }
+
+            vtNodes.push_back(uidDetachedNode);
+        }
+
+        if constexpr (requires (std::vector<ObjectUIDType> vtUIDs) { m_ptrCache->remove(vtUIDs); })
+        {
+            m_ptrCache->remove(vtNodes);
+        }
+        else
+        {
+            for (const ObjectUIDType& uidDetachedNode : vtNodes)
+            {
+                m_ptrCache->remove(uidDetachedNode);
+            }
+        }
+    }
+
+    // Rebalances the nodes on the paths to both ends of the removed range top-down, the children on a level are seen to before the level
+    // below is. A parent that is left with a single child by that is caught on the way, it returns false then and is to be called again
+    // once the root is settled (see settleRootNode).
+#ifdef __TRACK_CACHE_FOOTPRINT__
+    bool repairRangeEnds(const ObjectTypePtr& ptrRootNode, const KeyType& keyBegin, const KeyType& keyEnd, std::vector<std::pair<ObjectUIDType, ObjectTypePtr>>& vtAccessedNodes, int32_t& nMemoryFootprint)
+#else //__TRACK_CACHE_FOOTPRINT__
+    bool repairRangeEnds(const ObjectTypePtr& ptrRootNode, const KeyType& keyBegin, const KeyType& keyEnd, std::vector<std::pair<ObjectUIDType, ObjectTypePtr>>& vtAccessedNodes)
+#endif //__TRACK_CACHE_FOOTPRINT__
+    {
+        ObjectUIDType uidLHSNode = *m_uidRootNode, uidRHSNode = *m_uidRootNode;
+        ObjectTypePtr ptrLHSNode = ptrRootNode, ptrRHSNode = ptrRootNode;
+
+        // Both paths are at the same depth.
+        while (std::holds_alternative<std::shared_ptr<IndexNodeType>>(ptrLHSNode->getInnerData()))
+        {
+            std::shared_ptr<IndexNodeType> ptrLHSIndexNode = std::get<std::shared_ptr<IndexNodeType>>(ptrLHSNode->getInnerData());
+            std::shared_ptr<IndexNodeType> ptrRHSIndexNode = std::get<std::shared_ptr<IndexNodeType>>(ptrRHSNode->getInnerData());
+
+#ifdef __TRACK_CACHE_FOOTPRINT__
+            repairChildNode(uidLHSNode, ptrLHSNode, keyBegin, vtAccessedNodes, nMemoryFootprint);
+            repairChildNode(uidRHSNode, ptrRHSNode, keyEnd, vtAccessedNodes, nMemoryFootprint);
+#else //__TRACK_CACHE_FOOTPRINT__
+            repairChildNode(uidLHSNode, ptrLHSNode, keyBegin, vtAccessedNodes);
+            repairChildNode(uidRHSNode, ptrRHSNode, keyEnd, vtAccessedNodes);
+#endif //__TRACK_CACHE_FOOTPRINT__
+
+            if (uidLHSNode != *m_uidRootNode && (ptrLHSIndexNode->getKeysCount() == 0 || ptrRHSIndexNode->getKeysCount() == 0))
+            {
+                return false;
+            }
+
+#ifdef __TRACK_CACHE_FOOTPRINT__
+            ptrLHSNode = getChildNode(ptrLHSNode, ptrLHSIndexNode->getChildNodeIdx(keyBegin), uidLHSNode, vtAccessedNodes, nMemoryFootprint);
+            ptrRHSNode = getChildNode(ptrRHSNode, ptrRHSIndexNode->getChildNodeIdx(keyEnd), uidRHSNode, vtAccessedNodes, nMemoryFootprint);
+#else //__TRACK_CACHE_FOOTPRINT__
+            ptrLHSNode = getChildNode(ptrLHSNode, ptrLHSIndexNode->getChildNodeIdx(keyBegin), uidLHSNode, vtAccessedNodes);
+            ptrRHSNode = getChildNode(ptrRHSNode, ptrRHSIndexNode->getChildNodeIdx(keyEnd), uidRHSNode, vtAccessedNodes);
+#endif //__TRACK_CACHE_FOOTPRINT__
+        }
+
+        return true;
+    }
+
+    // Has the child the key leads to borrow from its siblings while it requires a merge and they can lend, or merges it with one of them.
+#ifdef __TRACK_CACHE_FOOTPRINT__
+    void repairChildNode(const ObjectUIDType& uidNode, const ObjectTypePtr& ptrNode, const KeyType& key, std::vector<std::pair<ObjectUIDType, ObjectTypePtr>>& vtAccessedNodes, int32_t& nMemoryFootprint)
+#else //__TRACK_CACHE_FOOTPRINT__
+    void repairChildNode(const ObjectUIDType& uidNode, const ObjectTypePtr& ptrNode, const KeyType& key, std::vector<std::pair<ObjectUIDType, ObjectTypePtr>>& vtAccessedNodes)
+#endif //__TRACK_CACHE_FOOTPRINT__
+    {
+        std::shared_ptr<IndexNodeType> ptrIndexNode = std::get<std::shared_ptr<IndexNodeType>>(ptrNode->getInnerData());
+
+        ObjectUIDType uidChildNode;
+
+#ifdef __TRACK_CACHE_FOOTPRINT__
+        ObjectTypePtr ptrChildNode = getChildNode(ptrNode, ptrIndexNode->getChildNodeIdx(key), uidChildNode, vtAccessedNodes, nMemoryFootprint);
+#else //__TRACK_CACHE_FOOTPRINT__
+        ObjectTypePtr ptrChildNode = getChildNode(ptrNode, ptrIndexNode->getChildNodeIdx(key), uidChildNode, vtAccessedNodes);
+#endif //__TRACK_CACHE_FOOTPRINT__
+
+        bool bMerged = false;
+        while (!bMerged && ptrIndexNode->getKeysCount() > 0)
+        {
+            if (std::holds_alternative<std::shared_ptr<IndexNodeType>>(ptrChildNode->getInnerData()))
+            {
+                if (!std::get<std::shared_ptr<IndexNodeType>>(ptrChildNode->getInnerData())->requireMerge(m_nDegree))
+                {
+                    break;
+                }
+
+#ifdef __TRACK_CACHE_FOOTPRINT__
+                bMerged = rebalanceChildNode<IndexNodeType>(uidNode, ptrNode, uidChildNode, ptrChildNode, key, vtAccessedNodes, nMemoryFootprint);
+#else //__TRACK_CACHE_FOOTPRINT__
+                bMerged = rebalanceChildNode<IndexNodeType>(uidNode, ptrNode, uidChildNode, ptrChildNode, key, vtAccessedNodes);
+#endif //__TRACK_CACHE_FOOTPRINT__
+            }
+            else //if (std::holds_alternative<std::shared_ptr<DataNodeType>>(ptrChildNode->getInnerData()))
+            {
+                if (!std::get<std::shared_ptr<DataNodeType>>(ptrChildNode->getInnerData())->requireMerge(m_nDegree))
+                {
+                    break;
+                }
+
+#ifdef __TRACK_CACHE_FOOTPRINT__
+                bMerged = rebalanceChildNode<DataNodeType>(uidNode, ptrNode, uidChildNode, ptrChildNode, key, vtAccessedNodes, nMemoryFootprint);
+#else //__TRACK_CACHE_FOOTPRINT__
+                bMerged = rebalanceChildNode<DataNodeType>(uidNode, ptrNode, uidChildNode, ptrChildNode, key, vtAccessedNodes);
+#endif //__TRACK_CACHE_FOOTPRINT__
+            }
+        }
+    }
+
+    // Loads the child at the given index, the node is made to refer to it by its current UID if it has moved since.
+#ifdef __TRACK_CACHE_FOOTPRINT__
+    ObjectTypePtr getChildNode(const ObjectTypePtr& ptrNode, size_t nChildIdx, ObjectUIDType& uidChildNode, std::vector<std::pair<ObjectUIDType, ObjectTypePtr>>& vtAccessedNodes, int32_t& nMemoryFootprint)
+#else //__TRACK_CACHE_FOOTPRINT__
+    ObjectTypePtr getChildNode(const ObjectTypePtr& ptrNode, size_t nChildIdx, ObjectUIDType& uidChildNode, std::vector<std::pair<ObjectUIDType, ObjectTypePtr>>& vtAccessedNodes)
+#endif //__TRACK_CACHE_FOOTPRINT__
+    {
+        std::shared_ptr<IndexNodeType> ptrIndexNode = std::get<std::shared_ptr<IndexNodeType>>(ptrNode->getInnerData());
+
+        uidChildNode = ptrIndexNode->getChildAt(nChildIdx);
+        ObjectTypePtr ptrChildNode = nullptr;
+
+#ifdef __TREE_WITH_CACHE__
+        std::optional<ObjectUIDType> uidUpdated = std::nullopt;
+        m_ptrCache->getObject(uidChildNode, ptrChildNode, uidUpdated);
+#else //__TREE_WITH_CACHE__
+        m_ptrCache->getObject(uidChildNode, ptrChildNode);
+#endif //__TREE_WITH_CACHE__
+
+        if (ptrChildNode == nullptr)
+        {
+            std::cout << "Critical State: While removing the range the cache returned NULL object." << std::endl;
+            throw new std::logic_error(".....");   // TODO: critical log.
+        }
+
+#ifdef __TREE_WITH_CACHE__
+        if (uidUpdated != std::nullopt)
+        {
+#ifdef __TRACK_CACHE_FOOTPRINT__
+            nMemoryFootprint += ptrIndexNode->template updateChildUID<ObjectType>(ptrChildNode, uidChildNode, *uidUpdated);
+#else //__TRACK_CACHE_FOOTPRINT__
+            ptrIndexNode->template updateChildUID<ObjectType>(ptrChildNode, uidChildNode, *uidUpdated);
+#endif //__TRACK_CACHE_FOOTPRINT__
+
+            ptrNode->setDirtyFlag(true);
+
+            uidChildNode = *uidUpdated;
+        }
+#endif //__TREE_WITH_CACHE__
+
+        vtAccessedNodes.push_back(std::make_pair(uidChildNode, ptrChildNode));
+
+        return ptrChildNode;
+    }
+
+    // The write of a Bε-tree, the update is added to the buffer of the root as a message and is handed down in a batch along with the other
+    // ones pending for the same child once the buffer overflows (see flushMessages). It is blind, i.e. an insert replaces the value of the key
+    // if it exists and a remove succeeds whether or not it does. An upsert (see fnUpdate) is resolved against the current value of the key and
+    // is then buffered as an insert.
+    template <typename UpdateFn = std::nullptr_t>
+    ErrorCode write(const KeyType& key, const ValueType& value, uint8_t nOperation, UpdateFn fnUpdate = nullptr)
+    {
+#ifdef __TRACK_CACHE_FOOTPRINT__
+        int32_t nMemoryFootprint = 0;
+#endif //__TRACK_CACHE_FOOTPRINT__
+
+        std::vector<std::pair<ObjectUIDType, ObjectTypePtr>> vtAccessedNodes;
+
+        typename IndexNodeType::Message message{};
+        message.m_key = key;
+        message.m_value = value;
+        message.m_nOperation = nOperation;
+
+#if defined(__TREE_WITH_CACHE__) && defined(__CONCURRENT__)
+        // The writers are paced before they take any lock, the eviction they wait for needs the nodes they would hold (see LRUCache::throttle).
+        if constexpr (requires { m_ptrCache->throttle(); })
+        {
+            m_ptrCache->throttle();
+        }
+#endif //__TREE_WITH_CACHE__ && __CONCURRENT__
+
+#ifdef __CONCURRENT__
+        // The root takes every write, hence the tree is held for the whole of it.
+        std::vector<std::unique_lock<std::shared_mutex>> vtLocks;
+        vtLocks.emplace_back(std::unique_lock<std::shared_mutex>(m_mutex));
+#endif //__CONCURRENT__
+
+        if constexpr (!std::is_null_pointer_v<UpdateFn>)
+        {
+            // Nothing can come in between the lookup and the write, the tree is held.
+            ValueType valueExisting;
+            bool bExists = search(key, valueExisting, true) == ErrorCode::Success;
+
+            message.m_value = fnUpdate(bExists ? std::optional<ValueType>(valueExisting) : std::nullopt);
+        }
+
+        ObjectTypePtr ptrRootNode = getRootNode();
+
+#ifdef __CONCURRENT__
+        vtLocks.emplace_back(std::unique_lock<std::shared_mutex>(ptrRootNode->getMutex()));
+#endif //__CONCURRENT__
+
+        vtAccessedNodes.push_back(std::make_pair(*m_uidRootNode, ptrRootNode));
+
+        if (std::holds_alternative<std::shared_ptr<IndexNodeType>>(ptrRootNode->getInnerData()))
+        {
+            std::shared_ptr<IndexNodeType> ptrIndexNode = std::get<std::shared_ptr<IndexNodeType>>(ptrRootNode->getInnerData());
+
+#ifdef __TRACK_CACHE_FOOTPRINT__
+            ptrIndexNode->addMessage(message, nMemoryFootprint);
+            flushMessages(*m_uidRootNode, ptrRootNode, vtAccessedNodes, nMemoryFootprint);
+#else //__TRACK_CACHE_FOOTPRINT__
+            ptrIndexNode->addMessage(message);
+            flushMessages(*m_uidRootNode, ptrRootNode, vtAccessedNodes);
+#endif //__TRACK_CACHE_FOOTPRINT__
+
+#ifdef __TREE_WITH_CACHE__
+            ptrRootNode->setDirtyFlag(true);
+#endif //__TREE_WITH_CACHE__
+        }
+        else //if (std::holds_alternative<std::shared_ptr<DataNodeType>>(ptrRootNode->getInnerData()))
+        {
+            std::shared_ptr<DataNodeType> ptrDataNode = std::get<std::shared_ptr<DataNodeType>>(ptrRootNode->getInnerData());
+
+#ifdef __TRACK_CACHE_FOOTPRINT__
+            applyMessages(ptrDataNode, std::vector<typename IndexNodeType::Message>(1, message), nMemoryFootprint);
+#else //__TRACK_CACHE_FOOTPRINT__
+            applyMessages(ptrDataNode, std::vector<typename IndexNodeType::Message>(1, message));
+#endif //__TRACK_CACHE_FOOTPRINT__
+
+#ifdef __TREE_WITH_CACHE__
+            ptrRootNode->setDirtyFlag(true);
+#endif //__TREE_WITH_CACHE__
+        }
+
+        // The flush may have left the root over the degree, or with a single child.
+#if defined(__CONCURRENT__) && defined(__TRACK_CACHE_FOOTPRINT__)
+        settleRootNode(ptrRootNode, vtAccessedNodes, vtLocks, nMemoryFootprint);
+#elif defined(__CONCURRENT__)
+        settleRootNode(ptrRootNode, vtAccessedNodes, vtLocks);
+#elif defined(__TRACK_CACHE_FOOTPRINT__)
+        settleRootNode(ptrRootNode, vtAccessedNodes, nMemoryFootprint);
+#else //__CONCURRENT__ && __TRACK_CACHE_FOOTPRINT__
+        settleRootNode(ptrRootNode, vtAccessedNodes);
+#endif //__CONCURRENT__ && __TRACK_CACHE_FOOTPRINT__
+
+#ifdef __TREE_WITH_CACHE__
+        // The flush walks more than a single path and may drop nodes on the way.
+        m_ptrCache->reorder(vtAccessedNodes, false, false);
+        vtAccessedNodes.clear();
+
+        // Logged while the tree is held, the writes are to be replayed in the order they were applied.
+        uint64_t nLSN = 0;
+        if (m_ptrWAL != nullptr)
+        {
+            if constexpr (!std::is_null_pointer_v<UpdateFn>)
+            {
+                nLSN = m_ptrWAL->append(WALType::Update, key, message.m_value);
+            }
+            else
+            {
+                nLSN = m_ptrWAL->append(nOperation == IndexNodeType::Insert ? WALType::Insert : WALType::Remove, key, value);
+            }
+        }
+#endif //__TREE_WITH_CACHE__
+
+#ifdef __CONCURRENT__
+        vtLocks.clear();
+#endif //__CONCURRENT__
+
+#ifdef __TRACK_CACHE_FOOTPRINT__
+        if (nMemoryFootprint != 0)
+        {
+            m_ptrCache->updateMemoryFootprint(nMemoryFootprint);
+        }
+#endif //__TRACK_CACHE_FOOTPRINT__
+
+#ifdef __TREE_WITH_CACHE__
+        if (m_ptrWAL != nullptr)
+        {
+            m_ptrWAL->waitForCommit(nLSN);
+        }
+#endif //__TREE_WITH_CACHE__
+
+        return ErrorCode::Success;
+    }
+
+    // Expects m_mutex to be held.
+    ObjectTypePtr getRootNode()
+    {
+        ObjectTypePtr ptrRootNode = nullptr;
+
+#ifdef __TREE_WITH_CACHE__
+        std::optional<ObjectUIDType> uidUpdated = std::nullopt;
+        m_ptrCache->getObject(*m_uidRootNode, ptrRootNode, uidUpdated);
+
+        if (uidUpdated != std::nullopt)
+        {
+            m_uidRootNode = uidUpdated;
+        }
+#else //__TREE_WITH_CACHE__
+        m_ptrCache->getObject(*m_uidRootNode, ptrRootNode);
+#endif //__TREE_WITH_CACHE__
+
+        if (ptrRootNode == nullptr)
+        {
+            std::cout << "Critical State: While doing write the cache returned NULL object." << std::endl;
+            throw new std::logic_error(".....");   // TODO: critical log.
+        }
+
+        return ptrRootNode;
+    }
+
+    // Grows the root while it is over the degree and drops it while it has a single child. Expects m_mutex to be held.
+#if defined(__CONCURRENT__) && defined(__TRACK_CACHE_FOOTPRINT__)
+    void settleRootNode(ObjectTypePtr& ptrRootNode, std::vector<std::pair<ObjectUIDType, ObjectTypePtr>>& vtAccessedNodes, std::vector<std::unique_lock<std::shared_mutex>>& vtLocks, int32_t& nMemoryFootprint)
+#elif defined(__CONCURRENT__)
+    void settleRootNode(ObjectTypePtr& ptrRootNode, std::vector<std::pair<ObjectUIDType, ObjectTypePtr>>& vtAccessedNodes, std::vector<std::unique_lock<std::shared_mutex>>& vtLocks)
+#elif defined(__TRACK_CACHE_FOOTPRINT__)
+    void settleRootNode(ObjectTypePtr& ptrRootNode, std::vector<std::pair<ObjectUIDType, ObjectTypePtr>>& vtAccessedNodes, int32_t& nMemoryFootprint)
+#else //__CONCURRENT__ && __TRACK_CACHE_FOOTPRINT__
+    void settleRootNode(ObjectTypePtr& ptrRootNode, std::vector<std::pair<ObjectUIDType, ObjectTypePtr>>& vtAccessedNodes)
+#endif //__CONCURRENT__ && __TRACK_CACHE_FOOTPRINT__
+    {
+        do
+        {
+            if (std::holds_alternative<std::shared_ptr<DataNodeType>>(ptrRootNode->getInnerData()))
+            {
+                if (std::get<std::shared_ptr<DataNodeType>>(ptrRootNode->getInnerData())->requireSplit(m_nDegree))
+                {
+                    ObjectUIDType uidOldRootNode = *m_uidRootNode;
+                    ObjectTypePtr ptrOldRootNode = ptrRootNode;
+
+                    growRootNode(ptrRootNode, vtAccessedNodes);
+
+#ifdef __TRACK_CACHE_FOOTPRINT__
+                    splitChildNode<DataNodeType>(ptrRootNode, uidOldRootNode, ptrOldRootNode, vtAccessedNodes, nMemoryFootprint);
+#else //__TRACK_CACHE_FOOTPRINT__
+                    splitChildNode<DataNodeType>(ptrRootNode, uidOldRootNode, ptrOldRootNode, vtAccessedNodes);
+#endif //__TRACK_CACHE_FOOTPRINT__
+                    continue;
+                }
+
+                break;
+            }
+
+            std::shared_ptr<IndexNodeType> ptrIndexNode = std::get<std::shared_ptr<IndexNodeType>>(ptrRootNode->getInnerData());
+
+            if (ptrIndexNode->requireSplit(m_nDegree))
+            {
+                ObjectUIDType uidOldRootNode = *m_uidRootNode;
+                ObjectTypePtr ptrOldRootNode = ptrRootNode;
+
+                growRootNode(ptrRootNode, vtAccessedNodes);
+
+#ifdef __TRACK_CACHE_FOOTPRINT__
+                splitChildNode<IndexNodeType>(ptrRootNode, uidOldRootNode, ptrOldRootNode, vtAccessedNodes, nMemoryFootprint);
+#else //__TRACK_CACHE_FOOTPRINT__
+                splitChildNode<IndexNodeType>(ptrRootNode, uidOldRootNode, ptrOldRootNode, vtAccessedNodes);
+#endif //__TRACK_CACHE_FOOTPRINT__
+                continue;
+            }
+
+            if (ptrIndexNode->getKeysCount() > 0)
+            {
+                break;
+            }
+
+            // The messages go down to the only child first, the root is dropped once it has none left.
+            if constexpr (BUFFERED_INDEX_NODES)
+            {
+                if (ptrIndexNode->getMessagesCount() > 0)
+                {
+#ifdef __TRACK_CACHE_FOOTPRINT__
+                    flushChildNode(*m_uidRootNode, ptrRootNode, 0, vtAccessedNodes, nMemoryFootprint);
+#else //__TRACK_CACHE_FOOTPRINT__
+                    flushChildNode(*m_uidRootNode, ptrRootNode, 0, vtAccessedNodes);
+#endif //__TRACK_CACHE_FOOTPRINT__
+                    continue;
+                }
+            }
+
+            ObjectUIDType uidNewRootNode = ptrIndexNode->getChildAt(0);
+            m_ptrCache->remove(*m_uidRootNode);
+            m_uidRootNode = uidNewRootNode;
+
+            ptrRootNode = getRootNode();
+
+#ifdef __CONCURRENT__
+            vtLocks.emplace_back(std::unique_lock<std::shared_mutex>(ptrRootNode->getMutex()));
+#endif //__CONCURRENT__
+
+            vtAccessedNodes.push_back(std::make_pair(*m_uidRootNode, ptrRootNode));
+        } while (true);
+    }
+
+    // Puts an index node with no pivots over the root, the old root is then split under it as any other child. Expects m_mutex to be held.
+    void growRootNode(ObjectTypePtr& ptrRootNode, std::vector<std::pair<ObjectUIDType, ObjectTypePtr>>& vtAccessedNodes)
+    {
+        std::vector<KeyType> vtPivots;
+        std::vector<ObjectUIDType> vtChildren(1, *m_uidRootNode);
+
+        m_uidRootNode = std::nullopt;
+        m_ptrCache->template createObjectOfType<IndexNodeType>(m_uidRootNode, ptrRootNode, vtPivots.cbegin(), vtPivots.cend(), vtChildren.cbegin(), vtChildren.cend());
+
+        vtAccessedNodes.insert(vtAccessedNodes.begin(), std::make_pair(*m_uidRootNode, ptrRootNode));
+    }
+
+    // Hands the messages of the index node down while there are more than it can buffer, each time to the child the most of them are for.
+#ifdef __TRACK_CACHE_FOOTPRINT__
+    void flushMessages(const ObjectUIDType& uidNode, const ObjectTypePtr& ptrNode, std::vector<std::pair<ObjectUIDType, ObjectTypePtr>>& vtAccessedNodes, int32_t& nMemoryFootprint)
+#else //__TRACK_CACHE_FOOTPRINT__
+    void flushMessages(const ObjectUIDType& uidNode, const ObjectTypePtr& ptrNode, std::vector<std::pair<ObjectUIDType, ObjectTypePtr>>& vtAccessedNodes)
+#endif //__TRACK_CACHE_FOOTPRINT__
+    {
+        std::shared_ptr<IndexNodeType> ptrIndexNode = std::get<std::shared_ptr<IndexNodeType>>(ptrNode->getInnerData());
+
+        while (ptrIndexNode->requireFlush())
+        {
+#ifdef __TRACK_CACHE_FOOTPRINT__
+            flushChildNode(uidNode, ptrNode, ptrIndexNode->getChildIdxWithMostMessages(), vtAccessedNodes, nMemoryFootprint);
+#else //__TRACK_CACHE_FOOTPRINT__
+            flushChildNode(uidNode, ptrNode, ptrIndexNode->getChildIdxWithMostMessages(), vtAccessedNodes);
+#endif //__TRACK_CACHE_FOOTPRINT__
+        }
+    }
+
+    // Moves the messages pending for the child down to it, an index child takes them into its buffer (and flushes its own if it overflows),
+    // a leaf has them applied. The child is then split, or rebalanced with a sibling, as it requires. Expects the node to be locked.
+#ifdef __TRACK_CACHE_FOOTPRINT__
+    void flushChildNode(const ObjectUIDType& uidNode, const ObjectTypePtr& ptrNode, size_t nChildIdx, std::vector<std::pair<ObjectUIDType, ObjectTypePtr>>& vtAccessedNodes, int32_t& nMemoryFootprint)
+#else //__TRACK_CACHE_FOOTPRINT__
+    void flushChildNode(const ObjectUIDType& uidNode, const ObjectTypePtr& ptrNode, size_t nChildIdx, std::vector<std::pair<ObjectUIDType, ObjectTypePtr>>& vtAccessedNodes)
+#endif //__TRACK_CACHE_FOOTPRINT__
+    {
+        std::shared_ptr<IndexNodeType> ptrIndexNode = std::get<std::shared_ptr<IndexNodeType>>(ptrNode->getInnerData());
+
+        std::vector<typename IndexNodeType::Message> vtMessages;
+
+#ifdef __TRACK_CACHE_FOOTPRINT__
+        ptrIndexNode->takeMessages(nChildIdx, vtMessages, nMemoryFootprint);
+#else //__TRACK_CACHE_FOOTPRINT__
+        ptrIndexNode->takeMessages(nChildIdx, vtMessages);
+#endif //__TRACK_CACHE_FOOTPRINT__
+
+        if (vtMessages.size() == 0)
+        {
+            return;
+        }
+
+        ObjectUIDType uidChildNode = ptrIndexNode->getChildAt(nChildIdx);
+        ObjectTypePtr ptrChildNode = nullptr;
+
+#ifdef __TREE_WITH_CACHE__
+        ptrNode->setDirtyFlag(true);
+
+        std::optional<ObjectUIDType> uidUpdated = std::nullopt;
+        m_ptrCache->getObject(uidChildNode, ptrChildNode, uidUpdated);
+#else //__TREE_WITH_CACHE__
+        m_ptrCache->getObject(uidChildNode, ptrChildNode);
+#endif //__TREE_WITH_CACHE__
+
+        if (ptrChildNode == nullptr)
+        {
+            std::cout << "Critical State: While flushing the messages the cache returned NULL object." << std::endl;
+            throw new std::logic_error(".....");   // TODO: critical log.
+        }
+
+#ifdef __CONCURRENT__
+        std::unique_lock<std::shared_mutex> lock(ptrChildNode->getMutex());
+#endif //__CONCURRENT__
+
+#ifdef __TREE_WITH_CACHE__
+        if (uidUpdated != std::nullopt)
+        {
+#ifdef __TRACK_CACHE_FOOTPRINT__
+            nMemoryFootprint += ptrIndexNode->template updateChildUID<ObjectType>(ptrChildNode, uidChildNode, *uidUpdated);
+#else //__TRACK_CACHE_FOOTPRINT__
+            ptrIndexNode->template updateChildUID<ObjectType>(ptrChildNode, uidChildNode, *uidUpdated);
+#endif //__TRACK_CACHE_FOOTPRINT__
+
+            uidChildNode = *uidUpdated;
+        }
+
+        ptrChildNode->setDirtyFlag(true);
+#endif //__TREE_WITH_CACHE__
+
+        vtAccessedNodes.push_back(std::make_pair(uidChildNode, ptrChildNode));
+
+        if (std::holds_alternative<std::shared_ptr<IndexNodeType>>(ptrChildNode->getInnerData()))
+        {
+            std::shared_ptr<IndexNodeType> ptrChildIndexNode = std::get<std::shared_ptr<IndexNodeType>>(ptrChildNode->getInnerData());
+
+#ifdef __TRACK_CACHE_FOOTPRINT__
+            ptrChildIndexNode->addMessages(vtMessages, nMemoryFootprint);
+            flushMessages(uidChildNode, ptrChildNode, vtAccessedNodes, nMemoryFootprint);
+#else //__TRACK_CACHE_FOOTPRINT__
+            ptrChildIndexNode->addMessages(vtMessages);
+            flushMessages(uidChildNode, ptrChildNode, vtAccessedNodes);
+#endif //__TRACK_CACHE_FOOTPRINT__
+
+            if (ptrChildIndexNode->requireSplit(m_nDegree))
+            {
+#ifdef __TRACK_CACHE_FOOTPRINT__
+                splitChildNode<IndexNodeType>(ptrNode, uidChildNode, ptrChildNode, vtAccessedNodes, nMemoryFootprint);
+#else //__TRACK_CACHE_FOOTPRINT__
+                splitChildNode<IndexNodeType>(ptrNode, uidChildNode, ptrChildNode, vtAccessedNodes);
+#endif //__TRACK_CACHE_FOOTPRINT__
+            }
+            else if (ptrChildIndexNode->requireMerge(m_nDegree) && ptrIndexNode->getKeysCount() > 0)
+            {
+#ifdef __TRACK_CACHE_FOOTPRINT__
+                rebalanceChildNode<IndexNodeType>(uidNode, ptrNode, uidChildNode, ptrChildNode, vtMessages.front().m_key, vtAccessedNodes, nMemoryFootprint);
+#else //__TRACK_CACHE_FOOTPRINT__
+                rebalanceChildNode<IndexNodeType>(uidNode, ptrNode, uidChildNode, ptrChildNode, vtMessages.front().m_key, vtAccessedNodes);
+#endif //__TRACK_CACHE_FOOTPRINT__
+            }
+        }
+        else //if (std::holds_alternative<std::shared_ptr<DataNodeType>>(ptrChildNode->getInnerData()))
         {
-            if (std::holds_alternative<std::shared_ptr<IndexNodeType>>(vtNodes[idx].second.second->getInnerData()))
+            std::shared_ptr<DataNodeType> ptrDataNode = std::get<std::shared_ptr<DataNodeType>>(ptrChildNode->getInnerData());
+
+#ifdef __TRACK_CACHE_FOOTPRINT__
+            applyMessages(ptrDataNode, vtMessages, nMemoryFootprint);
+#else //__TRACK_CACHE_FOOTPRINT__
+            applyMessages(ptrDataNode, vtMessages);
+#endif //__TRACK_CACHE_FOOTPRINT__
+
+            if (ptrDataNode->requireSplit(m_nDegree))
+            {
+#ifdef __TRACK_CACHE_FOOTPRINT__
+                splitChildNode<DataNodeType>(ptrNode, uidChildNode, ptrChildNode, vtAccessedNodes, nMemoryFootprint);
+#else //__TRACK_CACHE_FOOTPRINT__
+                splitChildNode<DataNodeType>(ptrNode, uidChildNode, ptrChildNode, vtAccessedNodes);
+#endif //__TRACK_CACHE_FOOTPRINT__
+            }
+            else if (ptrDataNode->requireMerge(m_nDegree) && ptrIndexNode->getKeysCount() > 0)
+            {
+#ifdef __TRACK_CACHE_FOOTPRINT__
+                rebalanceChildNode<DataNodeType>(uidNode, ptrNode, uidChildNode, ptrChildNode, vtMessages.front().m_key, vtAccessedNodes, nMemoryFootprint);
+#else //__TRACK_CACHE_FOOTPRINT__
+                rebalanceChildNode<DataNodeType>(uidNode, ptrNode, uidChildNode, ptrChildNode, vtMessages.front().m_key, vtAccessedNodes);
+#endif //__TRACK_CACHE_FOOTPRINT__
+            }
+        }
+    }
+
+    // The messages are in the order of their keys, the leaf is let grow past the degree and is split afterwards.
+#ifdef __TRACK_CACHE_FOOTPRINT__
+    void applyMessages(std::shared_ptr<DataNodeType>& ptrDataNode, const std::vector<typename IndexNodeType::Message>& vtMessages, int32_t& nMemoryFootprint)
+#else //__TRACK_CACHE_FOOTPRINT__
+    void applyMessages(std::shared_ptr<DataNodeType>& ptrDataNode, const std::vector<typename IndexNodeType::Message>& vtMessages)
+#endif //__TRACK_CACHE_FOOTPRINT__
+    {
+        for (const typename IndexNodeType::Message& message : vtMessages)
+        {
+#ifdef __TRACK_CACHE_FOOTPRINT__
+            ptrDataNode->remove(message.m_key, nMemoryFootprint);
+
+            if (message.m_nOperation == IndexNodeType::Insert)
+            {
+                ptrDataNode->insert(message.m_key, message.m_value, nMemoryFootprint);
+            }
+#else //__TRACK_CACHE_FOOTPRINT__
+            ptrDataNode->remove(message.m_key);
+
+            if (message.m_nOperation == IndexNodeType::Insert)
+            {
+                ptrDataNode->insert(message.m_key, message.m_value);
+            }
+#endif //__TRACK_CACHE_FOOTPRINT__
+        }
+    }
+
+    // Splits the child until none of the parts is over the degree, the pivots for the parts go to the parent.
+    template <typename NodeType>
+#ifdef __TRACK_CACHE_FOOTPRINT__
+    void splitChildNode(const ObjectTypePtr& ptrNode, const ObjectUIDType& uidChildNode, const ObjectTypePtr& ptrChildNode, std::vector<std::pair<ObjectUIDType, ObjectTypePtr>>& vtAccessedNodes, int32_t& nMemoryFootprint)
+#else //__TRACK_CACHE_FOOTPRINT__
+    void splitChildNode(const ObjectTypePtr& ptrNode, const ObjectUIDType& uidChildNode, const ObjectTypePtr& ptrChildNode, std::vector<std::pair<ObjectUIDType, ObjectTypePtr>>& vtAccessedNodes)
+#endif //__TRACK_CACHE_FOOTPRINT__
+    {
+        std::shared_ptr<IndexNodeType> ptrIndexNode = std::get<std::shared_ptr<IndexNodeType>>(ptrNode->getInnerData());
+
+        // The siblings are reachable through the parent only, which is locked, therefore, they need not be.
+        std::vector<std::pair<ObjectUIDType, ObjectTypePtr>> vtNodes;
+        vtNodes.push_back(std::make_pair(uidChildNode, ptrChildNode));
+
+        while (vtNodes.size() > 0)
+        {
+            std::pair<ObjectUIDType, ObjectTypePtr> prNode = vtNodes.back();
+
+            std::shared_ptr<NodeType> ptrSplitNode = std::get<std::shared_ptr<NodeType>>(prNode.second->getInnerData());
+
+            if (!ptrSplitNode->requireSplit(m_nDegree))
+            {
+                vtNodes.pop_back();
+                continue;
+            }
+
+            KeyType pivotKey;
+            std::optional<ObjectUIDType> uidSibling = std::nullopt;
+            ObjectTypePtr ptrSibling = nullptr;
+
+#ifdef __TRACK_CACHE_FOOTPRINT__
+            ErrorCode errCode = ptrSplitNode->template split<CacheType>(m_ptrCache, uidSibling, ptrSibling, pivotKey, nMemoryFootprint);
+#else //__TRACK_CACHE_FOOTPRINT__
+            ErrorCode errCode = ptrSplitNode->template split<CacheType>(m_ptrCache, uidSibling, ptrSibling, pivotKey);
+#endif //__TRACK_CACHE_FOOTPRINT__
+
+            if (errCode != ErrorCode::Success)
+            {
+                std::cout << "Critical State: Failed to split the node while flushing the messages." << std::endl;
+                throw new std::logic_error(".....");   // TODO: critical log.
+            }
+
+#ifdef __TRACK_CACHE_FOOTPRINT__
+            errCode = ptrIndexNode->insert(pivotKey, *uidSibling, nMemoryFootprint);
+#else //__TRACK_CACHE_FOOTPRINT__
+            errCode = ptrIndexNode->insert(pivotKey, *uidSibling);
+#endif //__TRACK_CACHE_FOOTPRINT__
+
+            if (errCode != ErrorCode::Success)
+            {
+                std::cout << "Critical State: Failed to perform insert operation to the IndexNode." << std::endl;
+                throw new std::logic_error(".....");   // TODO: critical log.
+            }
+
+#ifdef __TREE_WITH_CACHE__
+            trackSibling(vtAccessedNodes, prNode.first, *uidSibling);
+#endif //__TREE_WITH_CACHE__
+
+            vtNodes.push_back(std::make_pair(*uidSibling, ptrSibling));
+        }
+
+#ifdef __TREE_WITH_CACHE__
+        ptrNode->setDirtyFlag(true);
+#endif //__TREE_WITH_CACHE__
+    }
+
+    // The key is one of the child's, it picks the child out in the parent. Returns true if the child has been merged with a sibling.
+    template <typename NodeType>
+#ifdef __TRACK_CACHE_FOOTPRINT__
+    bool rebalanceChildNode(const ObjectUIDType& uidNode, const ObjectTypePtr& ptrNode, const ObjectUIDType& uidChildNode, const ObjectTypePtr& ptrChildNode, const KeyType& key, std::vector<std::pair<ObjectUIDType, ObjectTypePtr>>& vtAccessedNodes, int32_t& nMemoryFootprint)
+#else //__TRACK_CACHE_FOOTPRINT__
+    bool rebalanceChildNode(const ObjectUIDType& uidNode, const ObjectTypePtr& ptrNode, const ObjectUIDType& uidChildNode, const ObjectTypePtr& ptrChildNode, const KeyType& key, std::vector<std::pair<ObjectUIDType, ObjectTypePtr>>& vtAccessedNodes)
+#endif //__TRACK_CACHE_FOOTPRINT__
+    {
+        std::shared_ptr<IndexNodeType> ptrIndexNode = std::get<std::shared_ptr<IndexNodeType>>(ptrNode->getInnerData());
+        std::shared_ptr<NodeType> ptrRebalanceNode = std::get<std::shared_ptr<NodeType>>(ptrChildNode->getInnerData());
+
+        std::optional<ObjectUIDType> uidToDelete = std::nullopt;
+
+#ifdef __TREE_WITH_CACHE__
+        std::optional<ObjectUIDType> uidAffectedNode = std::nullopt;
+        ObjectTypePtr ptrAffectedNode = nullptr;
+
+        if constexpr (std::is_same<NodeType, IndexNodeType>::value)
+        {
+#ifdef __TRACK_CACHE_FOOTPRINT__
+            ptrIndexNode->template rebalanceIndexNode<CacheType>(m_ptrCache, uidChildNode, ptrRebalanceNode, key, m_nDegree, uidToDelete, uidAffectedNode, ptrAffectedNode, nMemoryFootprint);
+#else //__TRACK_CACHE_FOOTPRINT__
+            ptrIndexNode->template rebalanceIndexNode<CacheType>(m_ptrCache, uidChildNode, ptrRebalanceNode, key, m_nDegree, uidToDelete, uidAffectedNode, ptrAffectedNode);
+#endif //__TRACK_CACHE_FOOTPRINT__
+        }
+        else
+        {
+#ifdef __TRACK_CACHE_FOOTPRINT__
+            ptrIndexNode->template rebalanceDataNode<CacheType>(m_ptrCache, uidChildNode, ptrRebalanceNode, key, m_nDegree, uidToDelete, uidAffectedNode, ptrAffectedNode, nMemoryFootprint);
+#else //__TRACK_CACHE_FOOTPRINT__
+            ptrIndexNode->template rebalanceDataNode<CacheType>(m_ptrCache, uidChildNode, ptrRebalanceNode, key, m_nDegree, uidToDelete, uidAffectedNode, ptrAffectedNode);
+#endif //__TRACK_CACHE_FOOTPRINT__
+        }
+
+        ptrNode->setDirtyFlag(true);
+
+        if (uidAffectedNode)
+        {
+            trackSibling(vtAccessedNodes, uidNode, *uidAffectedNode);
+        }
+#else //__TREE_WITH_CACHE__
+        if constexpr (std::is_same<NodeType, IndexNodeType>::value)
+        {
+            ptrIndexNode->template rebalanceIndexNode<CacheType>(m_ptrCache, uidChildNode, ptrRebalanceNode, key, m_nDegree, uidToDelete);
+        }
+        else
+        {
+            ptrIndexNode->template rebalanceDataNode<CacheType>(m_ptrCache, uidChildNode, ptrRebalanceNode, key, m_nDegree, uidToDelete);
+        }
+#endif //__TREE_WITH_CACHE__
+
+        if (uidToDelete)
+        {
+            m_ptrCache->remove(*uidToDelete);
+        }
+
+        return uidToDelete != std::nullopt;
+    }
+
+#ifdef __TREE_WITH_CACHE__
+    // Puts the sibling right after its counterpart, to keep the nodes' order in the cache (see LRUCache::reorder).
+    void trackSibling(std::vector<std::pair<ObjectUIDType, ObjectTypePtr>>& vtAccessedNodes, const ObjectUIDType& uidNode, const ObjectUIDType& uidSibling)
+    {
+        for (auto itCurrent = vtAccessedNodes.cbegin(), itEnd = vtAccessedNodes.cend(); itCurrent != itEnd; itCurrent++)
+        {
+            if ((*itCurrent).first == uidNode)
+            {
+                vtAccessedNodes.insert(itCurrent + 1, std::make_pair(uidSibling, nullptr));
+                return;
+            }
+        }
+
+        std::cout << "Critical State: Failed to push the sibling (i.e. created due to the flush of the messages) to the list to ensure Nodes' order in the Cache." << std::endl;
+        throw new std::logic_error(".....");   // TODO: critical log.
+    }
+#endif //__TREE_WITH_CACHE__
+
+public:
+    void print(std::ofstream & os)
+    {
+        int nSpace = 7;
+
+        std::string prefix;
+
+        os << prefix << "|" << std::endl;
+        os << prefix << "|" << std::string(nSpace, '-').c_str() << "(root)";
+
+        os << std::endl;
+
+        ObjectTypePtr ptrRootNode = nullptr;
+
+#ifdef __TREE_WITH_CACHE__
+        std::optional<ObjectUIDType> uidUpdated = std::nullopt;
+        m_ptrCache->getObject(m_uidRootNode.value(), ptrRootNode, uidUpdated);
+
+        if (uidUpdated != std::nullopt)
+        {
+            m_uidRootNode = uidUpdated;
+        }
+#else //__TREE_WITH_CACHE__
+        m_ptrCache->getObject(m_uidRootNode.value(), ptrRootNode);
+#endif //__TREE_WITH_CACHE__
+
+        if (std::holds_alternative<std::shared_ptr<IndexNodeType>>(ptrRootNode->getInnerData()))
+        {
+            std::shared_ptr<IndexNodeType> ptrIndexNode = std::get<std::shared_ptr<IndexNodeType>>(ptrRootNode->getInnerData());
+
+            ptrIndexNode->template print<CacheType, ObjectTypePtr>(os, m_ptrCache, 0, prefix);
+        }
+        else if (std::holds_alternative<std::shared_ptr<DataNodeType>>(ptrRootNode->getInnerData()))
+        {
+            std::shared_ptr<DataNodeType> ptrDataNode = std::get<std::shared_ptr<DataNodeType>>(ptrRootNode->getInnerData());
+
+            ptrDataNode->print(os, 0, prefix);
+        }
+    }
+
+#ifdef __TREE_WITH_CACHE__
+    void getCacheState(size_t& nObjectsLinkedList, size_t& nObjectsInMap)
+    {
+        return m_ptrCache->getCacheState(nObjectsLinkedList, nObjectsInMap);
+    }
+
+    void getDirtyState(size_t& nDirtyObjects, size_t& nDirtyFootprint)
+    {
+        return m_ptrCache->getDirtyState(nDirtyObjects, nDirtyFootprint);
+    }
+#endif //__TREE_WITH_CACHE__
+
+#ifdef __TREE_WITH_CACHE__
+public:
+    ErrorCode flush()
+    {
+        m_ptrCache->flush();
+
+        return ErrorCode::Success;
+    }
+
+    // Relocates live nodes out of the sparsest storage region, reads and writes at most nIOBudget bytes.
+    // The index levels are walked beforehand so that the pending relocations get applied to the parents.
+    size_t compact(size_t nIOBudget)
+    {
+#ifdef __CONCURRENT__
+        std::unique_lock<std::shared_mutex> lock(m_mutex);
+#endif //__CONCURRENT__
+
+        relinkIndexNodes();
+
+#ifdef __CONCURRENT__
+        lock.unlock();
+#endif //__CONCURRENT__
+
+        return m_ptrCache->compact(nIOBudget);
+    }
+
+    // Moves the coldest leaves from the fast tier to the slow tier of a TieredStorage, reads and writes at most nIOBudget bytes.
+    // Unlike the compaction there are no blocks to be held back for the parents, they pick up the new UIDs when they are accessed.
+    size_t demote(size_t nIOBudget)
+    {
+        return m_ptrCache->demote(nIOBudget);
+    }
+
+    // Keeps the index nodes of the top nLevels levels resident and out of the cache's LRU list, within dBudgetRatio of its capacity.
+    void setPinningPolicy(uint8_t nLevels, double dBudgetRatio)
+    {
+        m_ptrCache->setPinningPolicy(nLevels, dBudgetRatio);
+    }
+
+#ifdef __CONCURRENT__
+    // Sets the number of leaves read ahead on a sequential access, zero turns the read-ahead off.
+    void setReadAhead(size_t nLeaves)
+    {
+        std::unique_lock<std::mutex> lock_readahead(m_mtxReadAhead);
+        m_nReadAheadLeaves = nLeaves;
+    }
+#endif //__CONCURRENT__
+
+    // Logs the inserts and removes to stFilename before acknowledging them, the records are synced in groups.
+    // A group is committed every tsCommitInterval or as soon as nCommitBytes are pending, whichever comes first.
+    // It is to be called before init or open, open replays the records that are not part of the last checkpoint.
+    void enableWAL(const std::string& stFilename, std::chrono::microseconds tsCommitInterval = WAL_DEFAULT_COMMIT_INTERVAL, size_t nCommitBytes = WAL_DEFAULT_COMMIT_BYTES)
+    {
+        m_ptrWAL = std::make_unique<WALType>(stFilename, tsCommitInterval, nCommitBytes);
+    }
+
+    // Lists the resident nodes, the most recently used first, in stFilename at each checkpoint, open then reads them back with nThreads readers
+    // before it returns, so that the store does not start with a cold cache. It is to be called before init or open.
+    void enableWarmUp(const std::string& stFilename, size_t nThreads = WARMUP_DEFAULT_THREADS)
+    {
+        m_stWarmUpFilename = stFilename;
+        m_nWarmUpThreads = nThreads;
+    }
+
+    // Writes the dirty nodes to new locations and then swaps in the superblock that refers to them, the store can be reopened from this state (see open).
+    // The bulk of the nodes is written while the writers carry on, the tree is held only to write the ones modified in the meantime.
+    ErrorCode checkpoint()
+    {
+        m_ptrCache->writeBackDirtyItems();
+
+#ifdef __CONCURRENT__
+        std::unique_lock<std::shared_mutex> lock(m_mutex);
+
+        // The lock only keeps the new operations out, the ones that have already released it are let through.
+        m_ptrCache->waitUntilReleased();
+#endif //__CONCURRENT__
+
+        // The records are appended after the mutations are applied, therefore, the ones logged so far are part of this state.
+        uint64_t nCheckpointLSN = m_ptrWAL != nullptr ? m_ptrWAL->getLastLSN() : 0;
+
+        CacheErrorCode ecResult = CacheErrorCode::Error;
+        do
+        {
+            ObjectUIDType uidRootNode = *m_uidRootNode;
+            ecResult = m_ptrCache->checkpoint(uidRootNode, m_nDegree, nCheckpointLSN);
+
+            m_uidRootNode = uidRootNode;
+
+            // The parents of the nodes written (or relocated) earlier may not have picked up the new UIDs yet, hence the retry.
+            if (ecResult == CacheErrorCode::KeyDoesNotExist)
+            {
+                relinkIndexNodes();
+            }
+
+        } while (ecResult == CacheErrorCode::KeyDoesNotExist);
+
+        if (ecResult != CacheErrorCode::Success)
+        {
+            return ErrorCode::Error;
+        }
+
+        // The resident nodes are clean and stored where the superblock refers to them, i.e. the list matches the state the store reopens in.
+        if (m_stWarmUpFilename)
+        {
+            m_ptrCache->saveWarmUpList(*m_stWarmUpFilename, *m_uidRootNode);
+        }
+
+        if (m_ptrWAL != nullptr)
+        {
+            m_ptrWAL->truncate(nCheckpointLSN);
+        }
+
+        return ErrorCode::Success;
+    }
+
+    // Restores the store from the superblock of an existing file, it is to be called instead of init.
+    // The nodes are not read here, they are faulted in as they are accessed. The log records that came after the checkpoint are reapplied.
+    ErrorCode open(const std::string& stFilename)
+    {
+        uint64_t nCheckpointLSN = 0;
+
+        {
+#ifdef __CONCURRENT__
+            std::unique_lock<std::shared_mutex> lock(m_mutex);
+#endif //__CONCURRENT__
+
+            m_ptrCache->init(this);
+
+            ObjectUIDType uidRootNode;
+            uint32_t nDegree = 0;
+
+            if (m_ptrCache->open(stFilename, uidRootNode, nDegree, nCheckpointLSN) != CacheErrorCode::Success)
             {
-                std::shared_ptr<IndexNodeType> ptrIndexNode = std::get<std::shared_ptr<IndexNodeType>>(vtNodes[idx].second.second->getInnerData());
+                return ErrorCode::Error;
+            }
 
-                bool bDirty = ptrIndexNode->updateChildrenUIDs(mpUIDUpdates);
+            if (nDegree != m_nDegree)
+            {
+                return ErrorCode::Error;
+            }
 
-                if (bDirty)
+            m_uidRootNode = uidRootNode;
+
+            // The list is ignored unless it was saved along the checkpoint that has just been opened.
+            if (m_stWarmUpFilename)
+            {
+                m_ptrCache->warmUp(*m_stWarmUpFilename, uidRootNode, m_nWarmUpThreads);
+            }
+        }
+
+        if (m_ptrWAL == nullptr)
+        {
+            return ErrorCode::Success;
+        }
+
+        // The log is detached while its records are being reapplied, so that they are not logged again.
+        std::unique_ptr<WALType> ptrWAL = std::move(m_ptrWAL);
+
+        // A record may have been applied before the checkpoint and logged after it, hence the replay has to be idempotent.
+        ErrorCode ecResult = ptrWAL->replay(nCheckpointLSN, [this](typename WALType::Operation nOperation, const KeyType& key, const ValueType& value, const KeyType& keyEnd)
+            {
+                ValueType valueExisting;
+                ErrorCode ecResult = ErrorCode::Error;
+
+                switch (nOperation)
                 {
-                    vtNodes[idx].second.second->setDirtyFlag(true);
+                case WALType::Insert:
+                    ecResult = search(key, valueExisting) == ErrorCode::KeyDoesNotExist ? insert(key, value) : ErrorCode::Success;
+                    break;
+                case WALType::Remove:
+                    ecResult = remove(key);
+                    ecResult = ecResult == ErrorCode::KeyDoesNotExist ? ErrorCode::Success : ecResult;
+                    break;
+                case WALType::Update:
+                    ecResult = upsert(key, [&value](const std::optional<ValueType>&) { return value; });
+                    break;
+                case WALType::RemoveRange:
+                    ecResult = removeRange(key, keyEnd);
+                    break;
                 }
 
-                if (!vtNodes[idx].second.second->getDirtyFlag())
+                return ecResult;
+            });
+
+        m_ptrWAL = std::move(ptrWAL);
+
+        return ecResult;
+    }
+
+    void getStorageState(size_t& nUsedBlocks, size_t& nLiveBlocks)
+    {
+        m_ptrCache->getStorageState(nUsedBlocks, nLiveBlocks);
+    }
+
+#ifdef __CONCURRENT__
+    void startCompaction(size_t nIOBudgetPerSecond)
+    {
+        stopCompaction();
+
+        m_nCompactionIOBudget = nIOBudgetPerSecond;
+        m_bStopCompaction = false;
+        m_threadCompaction = std::thread(handlerCompaction, this);
+    }
+
+    void stopCompaction()
+    {
+        m_bStopCompaction = true;
+
+        if (m_threadCompaction.joinable())
+        {
+            m_threadCompaction.join();
+        }
+    }
+
+    void startDemotion(size_t nIOBudgetPerSecond)
+    {
+        stopDemotion();
+
+        m_nDemotionIOBudget = nIOBudgetPerSecond;
+        m_bStopDemotion = false;
+        m_threadDemotion = std::thread(handlerDemotion, this);
+    }
+
+    void stopDemotion()
+    {
+        m_bStopDemotion = true;
+
+        if (m_threadDemotion.joinable())
+        {
+            m_threadDemotion.join();
+        }
+    }
+#endif //__CONCURRENT__
+
+private:
+    // Expects m_mutex to be held exclusively.
+    void relinkIndexNodes()
+    {
+#ifdef __TRACK_CACHE_FOOTPRINT__
+        int32_t nMemoryFootprint = 0;
+#endif //__TRACK_CACHE_FOOTPRINT__
+
+        std::vector<std::pair<ObjectUIDType, ObjectTypePtr>> vtAccessedNodes;
+
+        if (m_uidRootNode == std::nullopt)
+        {
+            return;
+        }
+
+        ObjectTypePtr ptrRootNode = nullptr;
+        std::optional<ObjectUIDType> uidUpdated = std::nullopt;
+        m_ptrCache->getObject(*m_uidRootNode, ptrRootNode, uidUpdated);
+
+        if (uidUpdated != std::nullopt)
+        {
+            m_uidRootNode = uidUpdated;
+        }
+
+        vtAccessedNodes.push_back(std::make_pair(*m_uidRootNode, ptrRootNode));
+
+        // Level order, so that the reorder keeps the parents ahead of their children in the LRU list.
+        for (size_t idx = 0; idx < vtAccessedNodes.size(); idx++)
+        {
+            if (!std::holds_alternative<std::shared_ptr<IndexNodeType>>(vtAccessedNodes[idx].second->getInnerData()))
+            {
+                continue;
+            }
+
+            std::shared_ptr<IndexNodeType> ptrIndexNode = std::get<std::shared_ptr<IndexNodeType>>(vtAccessedNodes[idx].second->getInnerData());
+
+#ifdef __CONCURRENT__
+            std::unique_lock<std::shared_mutex> lock_node(vtAccessedNodes[idx].second->getMutex());
+#endif //__CONCURRENT__
+
+            m_ptrCache->applyExistingUpdates(vtAccessedNodes[idx].second);
+
+            for (size_t nChildIdx = 0; nChildIdx <= ptrIndexNode->getKeysCount(); nChildIdx++)
+            {
+                ObjectUIDType uidChildNode = ptrIndexNode->getChildAt(nChildIdx);
+
+                if (uidChildNode.getObjectType() != IndexNodeType::UID)
                 {
-                    vtNodes.erase(vtNodes.begin() + idx); idx--;
                     continue;
                 }
 
-                size_t nNodeSize = ptrIndexNode->getSize();
+                ObjectTypePtr ptrChildNode = nullptr;
+                uidUpdated = std::nullopt;
+                m_ptrCache->getObject(uidChildNode, ptrChildNode, uidUpdated);
 
-                ObjectUIDType uidUpdated;
-                ObjectUIDType::createAddressFromArgs(uidUpdated, nMediaType, IndexNodeType::UID, nNewOffset * nBlockSize, nNodeSize);
+                if (uidUpdated != std::nullopt)
+                {
+#ifdef __TRACK_CACHE_FOOTPRINT__
+                    nMemoryFootprint += ptrIndexNode->template updateChildUID<ObjectType>(ptrChildNode, uidChildNode, *uidUpdated);
+#else //__TRACK_CACHE_FOOTPRINT__
+                    ptrIndexNode->template updateChildUID<ObjectType>(ptrChildNode, uidChildNode, *uidUpdated);
+#endif //__TRACK_CACHE_FOOTPRINT__
+
+                    vtAccessedNodes[idx].second->setDirtyFlag(true);
+
+                    uidChildNode = *uidUpdated;
+                }
+
+                vtAccessedNodes.push_back(std::make_pair(uidChildNode, ptrChildNode));
+            }
+        }
+
+        m_ptrCache->reorder(vtAccessedNodes, true, false);
+
+#ifdef __TRACK_CACHE_FOOTPRINT__
+        if (nMemoryFootprint != 0)
+        {
+            m_ptrCache->updateMemoryFootprint(nMemoryFootprint);
+        }
+#endif //__TRACK_CACHE_FOOTPRINT__
+    }
+
+#ifdef __CONCURRENT__
+    static void handlerCompaction(BPlusStore* ptrSelf)
+    {
+        size_t nBudget = 0;
+
+        do
+        {
+            // Unused budget is carried over for a second at most, so that an idle period doesn't allow a burst later.
+            nBudget = std::min(nBudget + ptrSelf->m_nCompactionIOBudget / COMPACTION_TICKS_PER_SECOND, ptrSelf->m_nCompactionIOBudget);
+
+            nBudget -= std::min(nBudget, ptrSelf->compact(nBudget));
+
+            std::this_thread::sleep_for(COMPACTION_INTERVAL);
+
+        } while (!ptrSelf->m_bStopCompaction);
+    }
+
+    static void handlerDemotion(BPlusStore* ptrSelf)
+    {
+        size_t nBudget = 0;
+
+        do
+        {
+            nBudget = std::min(nBudget + ptrSelf->m_nDemotionIOBudget / COMPACTION_TICKS_PER_SECOND, ptrSelf->m_nDemotionIOBudget);
+
+            nBudget -= std::min(nBudget, ptrSelf->demote(nBudget));
+
+            std::this_thread::sleep_for(COMPACTION_INTERVAL);
+
+        } while (!ptrSelf->m_bStopDemotion);
+    }
+
+    // Tracks whether the operations go for ascending keys and, once they do, has the cache read the next leaves under the same parent
+    // in the background, the first time the operations reach a leaf. Only the leaves that are on a persistent storage are worth the reads.
+    // It is called with the leaf and its parent (null for the root) locked, therefore, the parent's children can be read as they are.
+    void readAhead(const KeyType& key, const ObjectTypePtr& ptrParentNode, const ObjectUIDType& uidLeafNode)
+    {
+        if constexpr (requires (std::vector<ObjectUIDType> vtUIDs) { m_ptrCache->prefetch(vtUIDs); })
+        {
+            // Tracking the pattern is not worth waiting for, an operation that finds another one at it simply leaves it out.
+            std::unique_lock<std::mutex> lock_readahead(m_mtxReadAhead, std::try_to_lock);
+            if (!lock_readahead.owns_lock() || m_nReadAheadLeaves == 0)
+            {
+                return;
+            }
+
+            m_nSequentialRun = m_keyLastAccessed != std::nullopt && *m_keyLastAccessed < key ? m_nSequentialRun + 1 : 0;
+            m_keyLastAccessed = key;
 
-                vtNodes[idx].second.first = uidUpdated;
+            if (m_nSequentialRun < READAHEAD_SEQUENTIAL_RUN || ptrParentNode == nullptr || m_uidLastReadAheadLeaf == uidLeafNode)
+            {
+                return;
+            }
+
+            m_uidLastReadAheadLeaf = uidLeafNode;
+
+            size_t nLeaves = m_nReadAheadLeaves;
 
-                nNewOffset += (nNodeSize + nBlockSize - 1) / nBlockSize; //std::ceil(nNodeSize / (float)nBlockSize);
+            lock_readahead.unlock();
 
-                if (mpUIDUpdates.find(vtNodes[idx].first) != mpUIDUpdates.end())
+            std::shared_ptr<IndexNodeType> ptrIndexNode = std::get<std::shared_ptr<IndexNodeType>>(ptrParentNode->getInnerData());
+
+            std::vector<ObjectUIDType> vtUIDs;
+
+            size_t nChildIdx = ptrIndexNode->getChildNodeIdx(key);
+            size_t nLastChildIdx = std::min(nChildIdx + nLeaves, ptrIndexNode->getKeysCount());
+
+            for (size_t nIdx = nChildIdx + 1; nIdx <= nLastChildIdx; nIdx++)
+            {
+                const ObjectUIDType& uidChildNode = ptrIndexNode->getChildAt(nIdx);
+                if (uidChildNode.getMediaType() >= ObjectUIDType::PMem)
                 {
-                    std::cout << "Critical State: The key (IndexNode) alreast exists in the Updates' list." << std::endl;
-                    throw new std::logic_error(".....");   // TODO: critical log.
+                    vtUIDs.push_back(uidChildNode);
                 }
-                else
+            }
+
+            if (vtUIDs.size() > 0)
+            {
+                m_ptrCache->prefetch(vtUIDs);
+            }
+        }
+    }
+#endif //__CONCURRENT__
+
+public:
+
+    void applyExistingUpdates(std::shared_ptr<ObjectType> ptrObject
+        , UIDUpdatesMap<ObjectUIDType, ObjectType>& mpUIDUpdates)
+    {
+        if (std::holds_alternative<std::shared_ptr<IndexNodeType>>(ptrObject->getInnerData()))
+        {
+            std::shared_ptr<IndexNodeType> ptrIndexNode = std::get<std::shared_ptr<IndexNodeType>>(ptrObject->getInnerData());
+
+            bool bDirty = ptrIndexNode->updateChildrenUIDs(mpUIDUpdates);
+
+            if (bDirty)
+            {
+                ptrObject->setDirtyFlag(true);
+            }
+        }
+    }
+
+    void applyExistingUpdates(std::vector<std::pair<ObjectUIDType, std::pair<std::optional<ObjectUIDType>, std::shared_ptr<ObjectType>>>>& vtNodes
+        , UIDUpdatesMap<ObjectUIDType, ObjectType>& mpUIDUpdates)
+    {
+        for (auto it = vtNodes.begin(), itend = vtNodes.end(); it != itend; it++)
+        {
+            if (std::holds_alternative<std::shared_ptr<IndexNodeType>>((*it).second.second->getInnerData()))
+            {
+                std::shared_ptr<IndexNodeType> ptrIndexNode = std::get<std::shared_ptr<IndexNodeType>>((*it).second.second->getInnerData());
+
+                bool bDirty = ptrIndexNode->updateChildrenUIDs(mpUIDUpdates);
+
+                if (bDirty)
                 {
-                    mpUIDUpdates[vtNodes[idx].first] = std::make_pair(uidUpdated, vtNodes[idx].second.second);
+                    (*it).second.second->setDirtyFlag(true);
                 }
             }
-            else //if (std::holds_alternative<std::shared_ptr<DataNodeType>>(vtNodes[idx].second.second->getInnerData()))
+        }
+    }
+
+    // Removes the index nodes that refer to a child which neither has a persistent UID nor is part of the batch.
+    // The removal cascades to the parents in the batch for as long as the removed nodes do not have a persistent UID either.
+    void excludeUnflushableObjects(std::vector<std::pair<ObjectUIDType, std::pair<std::optional<ObjectUIDType>, std::shared_ptr<ObjectType>>>>& vtNodes)
+    {
+        std::unordered_set<ObjectUIDType> stNodes;
+        for (auto it = vtNodes.begin(); it != vtNodes.end(); it++)
+        {
+            stNodes.insert((*it).first);
+        }
+
+        bool bChanged = true;
+        while (bChanged)
+        {
+            bChanged = false;
+
+            for (size_t idx = 0; idx < vtNodes.size(); idx++)
             {
-                if (!vtNodes[idx].second.second->getDirtyFlag())
+                if (!std::holds_alternative<std::shared_ptr<IndexNodeType>>(vtNodes[idx].second.second->getInnerData()))
                 {
-                    vtNodes.erase(vtNodes.begin() + idx); idx--;
                     continue;
                 }
 
-                std::shared_ptr<DataNodeType> ptrDataNode = std::get<std::shared_ptr<DataNodeType>>(vtNodes[idx].second.second->getInnerData());
+                std::shared_ptr<IndexNodeType> ptrIndexNode = std::get<std::shared_ptr<IndexNodeType>>(vtNodes[idx].second.second->getInnerData());
 
-                size_t nNodeSize = ptrDataNode->getSize();
+                for (size_t nChildIdx = 0; nChildIdx <= ptrIndexNode->getKeysCount(); nChildIdx++)
+                {
+                    ObjectUIDType uidChildNode = ptrIndexNode->getChildAt(nChildIdx);
 
-                ObjectUIDType uidUpdated;
-                ObjectUIDType::createAddressFromArgs(uidUpdated, nMediaType, DataNodeType::UID, nNewOffset * nBlockSize, nNodeSize);
+                    if (uidChildNode.getMediaType() < ObjectUIDType::DRAM && stNodes.find(uidChildNode) == stNodes.end())
+                    {
+                        stNodes.erase(vtNodes[idx].first);
+                        vtNodes.erase(vtNodes.begin() + idx); idx--;
+
+                        bChanged = true;
+                        break;
+                    }
+                }
+            }
+        }
+    }
+
+    void prepareFlush(std::vector<std::pair<ObjectUIDType, std::pair<std::optional<ObjectUIDType>, std::shared_ptr<ObjectType>>>>& vtNodes
+        , size_t nOffset, size_t& nNewOffset, size_t nBlockSize, ObjectUIDType::StorageMedia nMediaType, std::unordered_set<ObjectUIDType>& stRelinkedUIDs)
+    {
+        nNewOffset = nOffset;
 
-                vtNodes[idx].second.first = uidUpdated;
+        // The LRU order is not strict when the tree is accessed concurrently, i.e. a parent may precede its children in the batch.
+        // Therefore, the nodes to be written are determined first and the children are relinked once all the new UIDs are known.
+        std::unordered_set<ObjectUIDType> stNodesToWrite;
+        for (auto it = vtNodes.begin(); it != vtNodes.end(); it++)
+        {
+            if ((*it).second.second->getDirtyFlag())
+            {
+                stNodesToWrite.insert((*it).first);
+            }
+        }
 
-                nNewOffset += (nNodeSize + nBlockSize - 1) / nBlockSize;
+        // A clean parent has to be written as well if any of its children is.
+        bool bChanged = true;
+        while (bChanged)
+        {
+            bChanged = false;
 
-                if (mpUIDUpdates.find(vtNodes[idx].first) != mpUIDUpdates.end())
+            for (auto it = vtNodes.begin(); it != vtNodes.end(); it++)
+            {
+                if (stNodesToWrite.find((*it).first) != stNodesToWrite.end() || !std::holds_alternative<std::shared_ptr<IndexNodeType>>((*it).second.second->getInnerData()))
                 {
-                    std::cout << "Critical State: The key (DataNode) alreast exists in the Updates' list." << std::endl;
-                    throw new std::logic_error(".....");   // TODO: critical log.
+                    continue;
                 }
-                else
+
+                std::shared_ptr<IndexNodeType> ptrIndexNode = std::get<std::shared_ptr<IndexNodeType>>((*it).second.second->getInnerData());
+
+                for (size_t nChildIdx = 0; nChildIdx <= ptrIndexNode->getKeysCount(); nChildIdx++)
+                {
+                    if (stNodesToWrite.find(ptrIndexNode->getChildAt(nChildIdx)) != stNodesToWrite.end())
+                    {
+                        stNodesToWrite.insert((*it).first);
+                        bChanged = true;
+                        break;
+                    }
+                }
+            }
+        }
+
+        UIDUpdatesMap<ObjectUIDType, ObjectType> mpUIDUpdates;
+
+        for (size_t idx = 0; idx < vtNodes.size(); idx++)
+        {
+            if (stNodesToWrite.find(vtNodes[idx].first) == stNodesToWrite.end())
+            {
+                vtNodes.erase(vtNodes.begin() + idx); idx--;
+                continue;
+            }
+
+            size_t nNodeSize = 0;
+            ObjectUIDType uidUpdated;
+
+            if (std::holds_alternative<std::shared_ptr<IndexNodeType>>(vtNodes[idx].second.second->getInnerData()))
+            {
+                nNodeSize = std::get<std::shared_ptr<IndexNodeType>>(vtNodes[idx].second.second->getInnerData())->getSize();
+                ObjectUIDType::createAddressFromArgs(uidUpdated, nMediaType, IndexNodeType::UID, nNewOffset * nBlockSize, nNodeSize);
+            }
+            else //if (std::holds_alternative<std::shared_ptr<DataNodeType>>(vtNodes[idx].second.second->getInnerData()))
+            {
+                nNodeSize = std::get<std::shared_ptr<DataNodeType>>(vtNodes[idx].second.second->getInnerData())->getSize();
+                ObjectUIDType::createAddressFromArgs(uidUpdated, nMediaType, DataNodeType::UID, nNewOffset * nBlockSize, nNodeSize);
+            }
+
+            vtNodes[idx].second.first = uidUpdated;
+
+            nNewOffset += (nNodeSize + nBlockSize - 1) / nBlockSize; //std::ceil(nNodeSize / (float)nBlockSize);
+
+            if (mpUIDUpdates.find(vtNodes[idx].first) != mpUIDUpdates.end())
+            {
+                std::cout << "Critical State: The key alreast exists in the Updates' list." << std::endl;
+                throw new std::logic_error(".....");   // TODO: critical log.
+            }
+
+            mpUIDUpdates[vtNodes[idx].first] = std::make_pair(uidUpdated, vtNodes[idx].second.second);
+        }
+
+        for (size_t idx = 0; idx < vtNodes.size(); idx++)
+        {
+            if (std::holds_alternative<std::shared_ptr<IndexNodeType>>(vtNodes[idx].second.second->getInnerData()))
+            {
+                std::shared_ptr<IndexNodeType> ptrIndexNode = std::get<std::shared_ptr<IndexNodeType>>(vtNodes[idx].second.second->getInnerData());
+
+                if (ptrIndexNode->updateChildrenUIDs(mpUIDUpdates))
                 {
-                    mpUIDUpdates[vtNodes[idx].first] = std::make_pair(uidUpdated, vtNodes[idx].second.second);
+                    vtNodes[idx].second.second->setDirtyFlag(true);
                 }
             }
         }
+
+        // The nodes whose parents are part of the same batch are already relinked, therefore, their old UIDs need not be published.
+        for (auto it = vtNodes.begin(); it != vtNodes.end(); it++)
+        {
+            if (mpUIDUpdates.find((*it).first) == mpUIDUpdates.end())
+            {
+                stRelinkedUIDs.insert((*it).first);
+            }
+        }
     }
 #endif //__TREE_WITH_CACHE__
 };
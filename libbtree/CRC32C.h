@@ -0,0 +1,106 @@
+#pragma once
+#include <cstdint>
+#include <cstring>
+#include <cstddef>
+#include <array>
+
+#if defined(__x86_64__) || defined(_M_X64)
+#define CRC32C_HARDWARE
+#ifdef _MSC_VER
+#include <intrin.h>
+#else //_MSC_VER
+#include <nmmintrin.h>
+#include <cpuid.h>
+#endif //_MSC_VER
+#endif //__x86_64__ || _M_X64
+
+#ifdef _MSC_VER
+#define CRC32C_TARGET_SSE42
+#else //_MSC_VER
+#define CRC32C_TARGET_SSE42 __attribute__((target("sse4.2")))
+#endif //_MSC_VER
+
+// CRC32C (Castagnoli), on SSE4.2 by its crc32 instruction eight bytes at a time, elsewhere by a table a byte at a time.
+// The instruction set is probed once at runtime, the build does not have to target SSE4.2.
+class CRC32C
+{
+public:
+	// A running checksum is passed back in to carry it on over a further range.
+	static inline uint32_t compute(const char* szData, size_t nLength, uint32_t nCRC = 0)
+	{
+#ifdef CRC32C_HARDWARE
+		static const bool bHardware = hasHardwareSupport();
+		if (bHardware)
+		{
+			return ~computeHardware(szData, nLength, ~nCRC);
+		}
+#endif //CRC32C_HARDWARE
+
+		return ~computeSoftware(szData, nLength, ~nCRC);
+	}
+
+private:
+	static constexpr uint32_t POLYNOMIAL = 0x82F63B78;	// Reflected.
+
+	static constexpr std::array<uint32_t, 256> getTable()
+	{
+		std::array<uint32_t, 256> arrTable{};
+		for (uint32_t idx = 0; idx < 256; idx++)
+		{
+			uint32_t nCRC = idx;
+			for (int nBit = 0; nBit < 8; nBit++)
+			{
+				nCRC = (nCRC >> 1) ^ ((nCRC & 1) ? POLYNOMIAL : 0);
+			}
+			arrTable[idx] = nCRC;
+		}
+		return arrTable;
+	}
+
+	static inline uint32_t computeSoftware(const char* szData, size_t nLength, uint32_t nCRC)
+	{
+		static constexpr std::array<uint32_t, 256> arrTable = getTable();
+
+		for (size_t idx = 0; idx < nLength; idx++)
+		{
+			nCRC = (nCRC >> 8) ^ arrTable[(nCRC ^ static_cast<uint8_t>(szData[idx])) & 0xFF];
+		}
+
+		return nCRC;
+	}
+
+#ifdef CRC32C_HARDWARE
+	static inline bool hasHardwareSupport()
+	{
+#ifdef _MSC_VER
+		int arrInfo[4];
+		__cpuid(arrInfo, 1);
+		return (arrInfo[2] & (1 << 20)) != 0;
+#else //_MSC_VER
+		unsigned int nEAX, nEBX, nECX, nEDX;
+		return __get_cpuid(1, &nEAX, &nEBX, &nECX, &nEDX) && (nECX & bit_SSE4_2) != 0;
+#endif //_MSC_VER
+	}
+
+	CRC32C_TARGET_SSE42 static uint32_t computeHardware(const char* szData, size_t nLength, uint32_t nCRC)
+	{
+		uint64_t nCRC64 = nCRC;
+
+		for (; nLength >= sizeof(uint64_t); szData += sizeof(uint64_t), nLength -= sizeof(uint64_t))
+		{
+			uint64_t nWord;
+			memcpy(&nWord, szData, sizeof(uint64_t));
+			nCRC64 = _mm_crc32_u64(nCRC64, nWord);
+		}
+
+		nCRC = static_cast<uint32_t>(nCRC64);
+
+		for (; nLength > 0; szData++, nLength--)
+		{
+			nCRC = _mm_crc32_u8(nCRC, static_cast<uint8_t>(*szData));
+		}
+
+		return nCRC;
+	}
+#endif //CRC32C_HARDWARE
+};
@@ -4,13 +4,17 @@
 #include <string>
 #include <map>
 #include <cmath>
+#include <algorithm>
 #include <optional>
 #include <iostream>
 #include <fstream>
 #include <assert.h>
 #include "ErrorCodes.h"
+#include "FrameOfReference.hpp"
+#include "NodeHeader.h"
 
-template <typename KeyType, typename ValueType, typename ObjectUIDType, uint8_t TYPE_UID>
+// PACK_ON_STORAGE keeps the integer keys and values frame-of-reference encoded on storage, see FrameOfReference, the node is unpacked on load.
+template <typename KeyType, typename ValueType, typename ObjectUIDType, uint8_t TYPE_UID, bool PACK_ON_STORAGE = false>
 class DataNode
 {
 public:
@@ -18,7 +22,10 @@ public:
 	static const uint8_t UID = TYPE_UID;
 
 private:
-	typedef DataNode<KeyType, ValueType, ObjectUIDType, TYPE_UID> SelfType;
+	typedef DataNode<KeyType, ValueType, ObjectUIDType, TYPE_UID, PACK_ON_STORAGE> SelfType;
+
+	static_assert(!PACK_ON_STORAGE || (std::is_integral<KeyType>::value && std::is_integral<ValueType>::value),
+		"Only the nodes of integer keys and values can be packed on storage.");
 
 	// Aliases for iterators over key and value vectors
 	typedef std::vector<KeyType>::const_iterator KeyTypeIterator;
@@ -56,22 +63,25 @@ public:
 			std::is_trivial<ValueType>::value &&
 			std::is_standard_layout<ValueType>::value)
 		{
-			uint16_t nTotalEntries = 0;
-
-			uint32_t nOffset = sizeof(uint8_t);
+			uint32_t nTotalEntries = NodeHeader::read(szData);
 
-			memcpy(&nTotalEntries, szData + nOffset, sizeof(uint16_t));
-			nOffset += sizeof(uint16_t);
+			size_t nOffset = sizeof(NodeHeader);
 
 			m_vtKeys.resize(nTotalEntries);
 			m_vtValues.resize(nTotalEntries);
 
-			uint32_t nKeysSize = nTotalEntries * sizeof(KeyType);
+			if constexpr (PACK_ON_STORAGE)
+			{
+				readPacked(szData + nOffset);
+				return;
+			}
+
+			size_t nKeysSize = nTotalEntries * sizeof(KeyType);
 			memcpy(m_vtKeys.data(), szData + nOffset, nKeysSize);
 
 			nOffset += nKeysSize;
 
-			uint32_t nValuesSize = nTotalEntries * sizeof(ValueType);
+			size_t nValuesSize = nTotalEntries * sizeof(ValueType);
 			memcpy(m_vtValues.data(), szData + nOffset, nValuesSize);
 		}
 		else
@@ -93,13 +103,29 @@ public:
 			std::is_trivial<ValueType>::value &&
 			std::is_standard_layout<ValueType>::value)
 		{
-			uint16_t nTotalEntries = 0;
-
-			fs.read(reinterpret_cast<char*>(&nTotalEntries), sizeof(uint16_t));
+			uint32_t nTotalEntries = NodeHeader::read(fs);
 
 			m_vtKeys.resize(nTotalEntries);
 			m_vtValues.resize(nTotalEntries);
 
+			if constexpr (PACK_ON_STORAGE)
+			{
+				std::vector<char> vtPacked(getPackedHeaderSize());
+				fs.read(vtPacked.data(), getPackedHeaderSize());
+
+				uint8_t nKeysBitWidth = vtPacked[sizeof(KeyType)];
+				uint8_t nValuesBitWidth = vtPacked[getPackedHeaderSize() - 1];
+
+				size_t nPackedSize = FrameOfReference<KeyType>::getPackedSize(nTotalEntries, nKeysBitWidth)
+					+ FrameOfReference<ValueType>::getPackedSize(nTotalEntries, nValuesBitWidth);
+
+				vtPacked.resize(getPackedHeaderSize() + nPackedSize);
+				fs.read(vtPacked.data() + getPackedHeaderSize(), nPackedSize);
+
+				readPacked(vtPacked.data());
+				return;
+			}
+
 			fs.read(reinterpret_cast<char*>(m_vtKeys.data()), nTotalEntries * sizeof(KeyType));
 			fs.read(reinterpret_cast<char*>(m_vtValues.data()), nTotalEntries * sizeof(ValueType));
 		}
@@ -129,6 +155,15 @@ public:
 public:
 	// Serializes the node's data into a char buffer
 	inline void serialize(char*& szBuffer, uint8_t& uidObjectType, uint32_t& nBufferSize) const
+	{
+		szBuffer = new char[getSize() + 1];
+		memset(szBuffer, 0, getSize() + 1);
+
+		writeToBuffer(szBuffer, uidObjectType, nBufferSize);
+	}
+
+	// Writes the node's data into a buffer of getSize() bytes, e.g. straight into a mapped region
+	inline void writeToBuffer(char* szBuffer, uint8_t& uidObjectType, uint32_t& nBufferSize) const
 	{
 		if constexpr (std::is_trivial<KeyType>::value &&
 			std::is_standard_layout<KeyType>::value &&
@@ -137,28 +172,27 @@ public:
 		{
 			uidObjectType = UID;
 
-			uint16_t nTotalEntries = m_vtKeys.size();
+			uint32_t nTotalEntries = m_vtKeys.size();
 
-			nBufferSize = sizeof(uint8_t)				// UID
-				+ sizeof(uint16_t)						// Total entries
+			nBufferSize = sizeof(NodeHeader)			// UID, version and total entries
 				+ (nTotalEntries * sizeof(KeyType))		// Size of all keys
 				+ (nTotalEntries * sizeof(ValueType));	// Size of all values
 
-			szBuffer = new char[nBufferSize + 1];
-			memset(szBuffer, 0, nBufferSize + 1);
+			size_t nOffset = 0;
+			NodeHeader::write(szBuffer, UID, nTotalEntries);
+			nOffset += sizeof(NodeHeader);
 
-			uint16_t nOffset = 0;
-			memcpy(szBuffer, &UID, sizeof(uint8_t));
-			nOffset += sizeof(uint8_t);
-
-			memcpy(szBuffer + nOffset, &nTotalEntries, sizeof(uint16_t));
-			nOffset += sizeof(uint16_t);
+			if constexpr (PACK_ON_STORAGE)
+			{
+				nBufferSize = nOffset + writePacked(szBuffer + nOffset);
+				return;
+			}
 
-			uint16_t nKeysSize = nTotalEntries * sizeof(KeyType);
+			size_t nKeysSize = nTotalEntries * sizeof(KeyType);
 			memcpy(szBuffer + nOffset, m_vtKeys.data(), nKeysSize);
 			nOffset += nKeysSize;
 
-			uint16_t nValuesSize = nTotalEntries * sizeof(ValueType);
+			size_t nValuesSize = nTotalEntries * sizeof(ValueType);
 			memcpy(szBuffer + nOffset, m_vtValues.data(), nValuesSize);
 			nOffset += nValuesSize;
 		}
@@ -181,17 +215,24 @@ public:
 			std::is_trivial<ValueType>::value &&
 			std::is_standard_layout<ValueType>::value)
 		{
+			if constexpr (PACK_ON_STORAGE)
+			{
+				std::vector<char> vtBuffer(getSize());
+				writeToBuffer(vtBuffer.data(), uidObjectType, nDataSize);
+
+				os.write(vtBuffer.data(), nDataSize);
+				return;
+			}
+
 			uidObjectType = SelfType::UID;
 
-			uint16_t nTotalEntries = m_vtKeys.size();
+			uint32_t nTotalEntries = m_vtKeys.size();
 
-			nDataSize = sizeof(uint8_t)					// UID
-				+ sizeof(uint16_t)						// Total entries
+			nDataSize = sizeof(NodeHeader)				// UID, version and total entries
 				+ (nTotalEntries * sizeof(KeyType))		// Size of all keys
 				+ (nTotalEntries * sizeof(ValueType));	// Size of all values
 
-			os.write(reinterpret_cast<const char*>(&uidObjectType), sizeof(uint8_t));
-			os.write(reinterpret_cast<const char*>(&nTotalEntries), sizeof(uint16_t));
+			NodeHeader::write(os, uidObjectType, nTotalEntries);
 			os.write(reinterpret_cast<const char*>(m_vtKeys.data()), nTotalEntries * sizeof(KeyType));
 			os.write(reinterpret_cast<const char*>(m_vtValues.data()), nTotalEntries * sizeof(ValueType));
 		}
@@ -246,6 +287,47 @@ public:
 		return ErrorCode::KeyDoesNotExist;
 	}
 
+	// Replaces the value of an existing key in place, the containers are left as they are.
+	inline ErrorCode update(const KeyType& key, const ValueType& value)
+	{
+		KeyTypeIterator it = std::lower_bound(m_vtKeys.begin(), m_vtKeys.end(), key);
+		if (it != m_vtKeys.end() && *it == key)
+		{
+			m_vtValues[it - m_vtKeys.begin()] = value;
+
+			return ErrorCode::Success;
+		}
+
+		return ErrorCode::KeyDoesNotExist;
+	}
+
+	// Removes the keys in [keyBegin, keyEnd) and returns how many there were
+#ifdef __TRACK_CACHE_FOOTPRINT__
+	inline size_t removeRange(const KeyType& keyBegin, const KeyType& keyEnd, int32_t& nMemoryFootprint)
+#else //__TRACK_CACHE_FOOTPRINT__
+	inline size_t removeRange(const KeyType& keyBegin, const KeyType& keyEnd)
+#endif //__TRACK_CACHE_FOOTPRINT__
+	{
+#ifdef __TRACK_CACHE_FOOTPRINT__
+		int32_t nFootprint = getMemoryFootprint();
+#endif //__TRACK_CACHE_FOOTPRINT__
+
+		KeyTypeIterator itBegin = std::lower_bound(m_vtKeys.begin(), m_vtKeys.end(), keyBegin);
+		KeyTypeIterator itEnd = std::lower_bound(itBegin, m_vtKeys.cend(), keyEnd);
+
+		size_t nBeginIdx = itBegin - m_vtKeys.begin();
+		size_t nEndIdx = itEnd - m_vtKeys.begin();
+
+		m_vtKeys.erase(itBegin, itEnd);
+		m_vtValues.erase(m_vtValues.begin() + nBeginIdx, m_vtValues.begin() + nEndIdx);
+
+#ifdef __TRACK_CACHE_FOOTPRINT__
+		nMemoryFootprint += (int32_t)getMemoryFootprint() - nFootprint;
+#endif //__TRACK_CACHE_FOOTPRINT__
+
+		return nEndIdx - nBeginIdx;
+	}
+
 	// Returns the size of the serialized node
 	inline size_t getSize() const
 	{
@@ -254,8 +336,18 @@ public:
 			std::is_trivial<ValueType>::value &&
 			std::is_standard_layout<ValueType>::value)
 		{
-			return sizeof(uint8_t)
-				+ sizeof(uint16_t)
+			if constexpr (PACK_ON_STORAGE)
+			{
+				ValueType nValuesBase, nValuesMax;
+				getValuesRange(nValuesBase, nValuesMax);
+
+				return sizeof(NodeHeader)
+					+ getPackedHeaderSize()
+					+ FrameOfReference<KeyType>::getPackedSize(m_vtKeys.size(), getKeysBitWidth())
+					+ FrameOfReference<ValueType>::getPackedSize(m_vtValues.size(), FrameOfReference<ValueType>::getBitWidth(nValuesBase, nValuesMax));
+			}
+
+			return sizeof(NodeHeader)
 				+ (m_vtKeys.size() * sizeof(KeyType))
 				+ (m_vtValues.size() * sizeof(ValueType));
 		}
@@ -654,6 +746,84 @@ public:
 #endif //__TRACK_CACHE_FOOTPRINT__
 	}
 
+private:
+	// The packed node is laid out as [keys' base][keys' bit width][values' base][values' bit width][packed keys][packed values].
+	static constexpr size_t getPackedHeaderSize()
+	{
+		return sizeof(KeyType) + sizeof(uint8_t) + sizeof(ValueType) + sizeof(uint8_t);
+	}
+
+	// The keys are sorted, the first one is the base and the last one the farthest from it.
+	inline uint8_t getKeysBitWidth() const
+	{
+		return m_vtKeys.size() > 0 ? FrameOfReference<KeyType>::getBitWidth(m_vtKeys.front(), m_vtKeys.back()) : 0;
+	}
+
+	inline void getValuesRange(ValueType& nMin, ValueType& nMax) const
+	{
+		nMin = nMax = ValueType();
+
+		if (m_vtValues.size() > 0)
+		{
+			auto prMinMax = std::minmax_element(m_vtValues.begin(), m_vtValues.end());
+			nMin = *prMinMax.first;
+			nMax = *prMinMax.second;
+		}
+	}
+
+	// Returns the number of bytes written.
+	inline size_t writePacked(char* szBuffer) const
+	{
+		KeyType nKeysBase = m_vtKeys.size() > 0 ? m_vtKeys.front() : KeyType();
+		uint8_t nKeysBitWidth = getKeysBitWidth();
+
+		ValueType nValuesBase, nValuesMax;
+		getValuesRange(nValuesBase, nValuesMax);
+		uint8_t nValuesBitWidth = FrameOfReference<ValueType>::getBitWidth(nValuesBase, nValuesMax);
+
+		size_t nOffset = 0;
+		memcpy(szBuffer + nOffset, &nKeysBase, sizeof(KeyType));
+		nOffset += sizeof(KeyType);
+		memcpy(szBuffer + nOffset, &nKeysBitWidth, sizeof(uint8_t));
+		nOffset += sizeof(uint8_t);
+		memcpy(szBuffer + nOffset, &nValuesBase, sizeof(ValueType));
+		nOffset += sizeof(ValueType);
+		memcpy(szBuffer + nOffset, &nValuesBitWidth, sizeof(uint8_t));
+		nOffset += sizeof(uint8_t);
+
+		FrameOfReference<KeyType>::pack(m_vtKeys.data(), m_vtKeys.size(), nKeysBase, nKeysBitWidth, szBuffer + nOffset);
+		nOffset += FrameOfReference<KeyType>::getPackedSize(m_vtKeys.size(), nKeysBitWidth);
+
+		FrameOfReference<ValueType>::pack(m_vtValues.data(), m_vtValues.size(), nValuesBase, nValuesBitWidth, szBuffer + nOffset);
+		nOffset += FrameOfReference<ValueType>::getPackedSize(m_vtValues.size(), nValuesBitWidth);
+
+		return nOffset;
+	}
+
+	// The keys and the values are expected to be sized already.
+	inline void readPacked(const char* szBuffer)
+	{
+		KeyType nKeysBase;
+		uint8_t nKeysBitWidth;
+		ValueType nValuesBase;
+		uint8_t nValuesBitWidth;
+
+		size_t nOffset = 0;
+		memcpy(&nKeysBase, szBuffer + nOffset, sizeof(KeyType));
+		nOffset += sizeof(KeyType);
+		memcpy(&nKeysBitWidth, szBuffer + nOffset, sizeof(uint8_t));
+		nOffset += sizeof(uint8_t);
+		memcpy(&nValuesBase, szBuffer + nOffset, sizeof(ValueType));
+		nOffset += sizeof(ValueType);
+		memcpy(&nValuesBitWidth, szBuffer + nOffset, sizeof(uint8_t));
+		nOffset += sizeof(uint8_t);
+
+		FrameOfReference<KeyType>::unpack(szBuffer + nOffset, m_vtKeys.size(), nKeysBase, nKeysBitWidth, m_vtKeys.data());
+		nOffset += FrameOfReference<KeyType>::getPackedSize(m_vtKeys.size(), nKeysBitWidth);
+
+		FrameOfReference<ValueType>::unpack(szBuffer + nOffset, m_vtValues.size(), nValuesBase, nValuesBitWidth, m_vtValues.data());
+	}
+
 public:
 	// Prints the node's keys and values to an output file stream
 	void print(std::ofstream& os, size_t nLevel, std::string stPrefix)
@@ -9,6 +9,7 @@
 #include <fstream>
 #include <assert.h>
 #include "ErrorCodes.h"
+#include "NodeHeader.h"
 #include <chrono>
 #include <atomic>
 
@@ -20,10 +21,9 @@
 #define END_PACKED_STRUCT _Pragma("pack(pop)")
 #endif
 
-#define MICROSEC_CHECK_FOR_FREQUENT_REQUESTS_TO_MEMORY 100
-#define ACCESSED_FREQUENCY_AS_PER_THE_TIME_CHECK 10
+#include "PromotionPolicy.hpp"
 
-template <typename KeyType, typename ValueType, typename ObjectUIDType, uint8_t TYPE_UID>
+template <typename KeyType, typename ValueType, typename ObjectUIDType, uint8_t TYPE_UID, typename PromotionPolicy = FrequencyPromotionPolicy>
 class DataNodeROpt
 {
 private:
@@ -32,17 +32,11 @@ PACKED_STRUCT
 	struct RAWDATA
 	{
 		uint8_t nUID;
-		uint16_t nTotalEntries;
+		uint32_t nTotalEntries;
 		const KeyType* ptrKeys;
 		const ValueType* ptrValues;
 
-		uint8_t nCounter;
-
-#ifdef _MSC_VER
-		std::chrono::time_point<std::chrono::steady_clock> tLastAccessTime;
-#else
-		std::chrono::time_point<std::chrono::system_clock> tLastAccessTime;
-#endif
+		typename PromotionPolicy::AccessState oAccess;
 
 		~RAWDATA()
 		{
@@ -53,12 +47,9 @@ PACKED_STRUCT
 		RAWDATA(const char* szData)
 		{
 			nUID = szData[0];
-			nTotalEntries = *reinterpret_cast<const uint16_t*>(&szData[1]);
-			ptrKeys = reinterpret_cast<const KeyType*>(szData + sizeof(uint8_t) + sizeof(uint16_t));
-			ptrValues = reinterpret_cast<const ValueType*>(szData + sizeof(uint8_t) + sizeof(uint16_t) + (nTotalEntries * sizeof(KeyType)));
-
-			nCounter = 0;
-			tLastAccessTime = std::chrono::high_resolution_clock::now();
+			nTotalEntries = NodeHeader::read(szData);
+			ptrKeys = reinterpret_cast<const KeyType*>(szData + sizeof(NodeHeader));
+			ptrValues = reinterpret_cast<const ValueType*>(szData + sizeof(NodeHeader) + (nTotalEntries * sizeof(KeyType)));
 		}
 	};
 END_PACKED_STRUCT
@@ -67,8 +58,10 @@ public:
 	// Unique identifier for the type of this node
 	static const uint8_t UID = TYPE_UID;
 
+	typedef PromotionPolicy PromotionPolicyType;
+
 private:
-	typedef DataNodeROpt<KeyType, ValueType, ObjectUIDType, TYPE_UID> SelfType;
+	typedef DataNodeROpt<KeyType, ValueType, ObjectUIDType, TYPE_UID, PromotionPolicy> SelfType;
 
 	// Aliases for iterators over key and value vectors
 	typedef std::vector<KeyType>::const_iterator KeyTypeIterator;
@@ -80,6 +73,14 @@ private:
 
 public:
 	RAWDATA* m_ptrRawData = nullptr;
+
+	// The bytes reserved in the promotion budget, once promoted on the read path.
+	uint32_t m_nPromotedBytes = 0;
+
+#ifdef __TRACK_CACHE_FOOTPRINT__
+	// The footprint gained by a promotion on the read path, yet to be reported to the cache.
+	std::atomic<int32_t> m_nUnreportedFootprint = 0;
+#endif //__TRACK_CACHE_FOOTPRINT__
 public:
 	// Destructor: Clears the keys and values vectors
 	~DataNodeROpt()
@@ -91,6 +92,11 @@ public:
 		{
 			delete m_ptrRawData;
 		}
+
+		if (m_nPromotedBytes > 0)
+		{
+			PromotionPolicy::onDemote(m_nPromotedBytes);
+		}
 	}
 
 	// Default constructor
@@ -145,9 +151,7 @@ public:
 			std::is_trivial<ValueType>::value &&
 			std::is_standard_layout<ValueType>::value)
 		{
-			uint16_t nTotalEntries = 0;
-
-			fs.read(reinterpret_cast<char*>(&nTotalEntries), sizeof(uint16_t));
+			uint32_t nTotalEntries = NodeHeader::read(fs);
 
 			m_vtKeys.resize(nTotalEntries);
 			m_vtValues.resize(nTotalEntries);
@@ -220,6 +224,15 @@ public:
 
 	// Serializes the node's data into a char buffer
 	inline void serialize(char*& szBuffer, uint8_t& uidObjectType, uint32_t& nBufferSize) const
+	{
+		szBuffer = new char[getSize() + 1];
+		memset(szBuffer, 0, getSize() + 1);
+
+		writeToBuffer(szBuffer, uidObjectType, nBufferSize);
+	}
+
+	// Writes the node's data into a buffer of getSize() bytes, e.g. straight into a mapped region
+	inline void writeToBuffer(char* szBuffer, uint8_t& uidObjectType, uint32_t& nBufferSize) const
 	{
 		assert(m_ptrRawData == nullptr);
 
@@ -230,29 +243,22 @@ public:
 		{
 			uidObjectType = UID;
 
-			uint16_t nTotalEntries = m_vtKeys.size();
+			uint32_t nTotalEntries = m_vtKeys.size();
 
 			nBufferSize 
-				= sizeof(uint8_t)						// UID
-				+ sizeof(uint16_t)						// Total entries
+				= sizeof(NodeHeader)					// UID, version and total entries
 				+ (nTotalEntries * sizeof(KeyType))		// Size of all keys
 				+ (nTotalEntries * sizeof(ValueType));	// Size of all values
 
-			szBuffer = new char[nBufferSize + 1];
-			memset(szBuffer, 0, nBufferSize + 1);
-
-			uint16_t nOffset = 0;
-			memcpy(szBuffer, &UID, sizeof(uint8_t));
-			nOffset += sizeof(uint8_t);
-
-			memcpy(szBuffer + nOffset, &nTotalEntries, sizeof(uint16_t));
-			nOffset += sizeof(uint16_t);
+			size_t nOffset = 0;
+			NodeHeader::write(szBuffer, UID, nTotalEntries);
+			nOffset += sizeof(NodeHeader);
 
-			uint16_t nKeysSize = nTotalEntries * sizeof(KeyType);
+			size_t nKeysSize = nTotalEntries * sizeof(KeyType);
 			memcpy(szBuffer + nOffset, m_vtKeys.data(), nKeysSize);
 			nOffset += nKeysSize;
 
-			uint16_t nValuesSize = nTotalEntries * sizeof(ValueType);
+			size_t nValuesSize = nTotalEntries * sizeof(ValueType);
 			memcpy(szBuffer + nOffset, m_vtValues.data(), nValuesSize);
 			nOffset += nValuesSize;
 
@@ -291,16 +297,14 @@ public:
 		{
 			uidObjectType = SelfType::UID;
 
-			uint16_t nTotalEntries = m_vtKeys.size();
+			uint32_t nTotalEntries = m_vtKeys.size();
 
 			nDataSize 
-				= sizeof(uint8_t)						// UID
-				+ sizeof(uint16_t)						// Total entries
+				= sizeof(NodeHeader)					// UID, version and total entries
 				+ (nTotalEntries * sizeof(KeyType))		// Size of all keys
 				+ (nTotalEntries * sizeof(ValueType));	// Size of all values
 
-			os.write(reinterpret_cast<const char*>(&uidObjectType), sizeof(uint8_t));
-			os.write(reinterpret_cast<const char*>(&nTotalEntries), sizeof(uint16_t));
+			NodeHeader::write(os, uidObjectType, nTotalEntries);
 			os.write(reinterpret_cast<const char*>(m_vtKeys.data()), nTotalEntries * sizeof(KeyType));
 			os.write(reinterpret_cast<const char*>(m_vtValues.data()), nTotalEntries * sizeof(ValueType));
 		}
@@ -322,25 +326,32 @@ public:
 		if (m_ptrRawData == nullptr)
 			return false;
 
-		auto now = std::chrono::high_resolution_clock::now();
-		auto duration = now - m_ptrRawData->tLastAccessTime;
-
-		if(std::chrono::duration_cast<std::chrono::microseconds>(duration).count() < MICROSEC_CHECK_FOR_FREQUENT_REQUESTS_TO_MEMORY)
+		if (PromotionPolicy::onAccess(m_ptrRawData->oAccess))
 		{
-			m_ptrRawData->nCounter++;
-
-			if (m_ptrRawData->nCounter >= ACCESSED_FREQUENCY_AS_PER_THE_TIME_CHECK)
+			uint32_t nBytes = m_ptrRawData->nTotalEntries * (sizeof(KeyType) + sizeof(ValueType));
+			if (PromotionPolicy::tryPromote(m_ptrRawData->oAccess, nBytes))
 			{
+				m_nPromotedBytes = nBytes;
+
+#ifdef __TRACK_CACHE_FOOTPRINT__
+				m_nUnreportedFootprint += moveDataToDRAM();
+#else //__TRACK_CACHE_FOOTPRINT__
 				moveDataToDRAM();
+#endif //__TRACK_CACHE_FOOTPRINT__
 				return false;
 			}
 		}
 
-		m_ptrRawData->nCounter = 0; // reset counter if more than 100 nanoseconds have passed		
-		m_ptrRawData->tLastAccessTime = now;
 		return true;
 	}	
 
+#ifdef __TRACK_CACHE_FOOTPRINT__
+	inline int32_t takeUnreportedFootprint()
+	{
+		return m_nUnreportedFootprint.exchange(0);
+	}
+#endif //__TRACK_CACHE_FOOTPRINT__
+
 	// Determines if the node requires a split based on the given degree
 	inline bool requireSplit(size_t nDegree) const
 	{
@@ -421,8 +432,7 @@ public:
 			std::is_trivial<ValueType>::value &&
 			std::is_standard_layout<ValueType>::value)
 		{
-			return sizeof(uint8_t)
-				+ sizeof(uint16_t)
+			return sizeof(NodeHeader)
 				+ (m_vtKeys.size() * sizeof(KeyType))
 				+ (m_vtValues.size() * sizeof(ValueType));
 		}
@@ -0,0 +1,744 @@
+#pragma once
+#include <memory>
+#include <vector>
+#include <string>
+#include <cmath>
+#include <numeric>
+#include <optional>
+#include <iostream>
+#include <fstream>
+#include <algorithm>
+#include <assert.h>
+#include "ErrorCodes.h"
+#include "SlottedField.hpp"
+#include "NodeHeader.h"
+
+// The dead bytes are reclaimed once they make up this share of the heap.
+#define SLOTTED_PAGE_COMPACTION_RATIO 0.5
+
+// A leaf for variable-length keys and values (see SlottedField) laid out as a slotted page. The slots hold the offsets and the lengths
+// of the entries in the order of their keys, the entries are appended to the heap in the order they arrive. A lookup is a binary search
+// over the slots, a removal only drops the slot and the dead bytes are compacted in place once they outweigh the rest of the heap.
+// The serialized node is the page itself less the dead bytes, hence, loading it takes two copies and no parsing.
+//
+// The byte-string keys are stored without the prefix they all share, the prefix is kept once per page. It is extended whenever the
+// page is compacted and cut back only for a key that does not start with it. The separators a split or a rebalance hands to the parent
+// are truncated to the shortest one that still tells the two sides apart (see SlottedField::getSeparator).
+template <typename KeyType, typename ValueType, typename ObjectUIDType, uint8_t TYPE_UID>
+class DataNodeSlotted
+{
+public:
+	// Unique identifier for the type of this node
+	static const uint8_t UID = TYPE_UID;
+
+private:
+	typedef DataNodeSlotted<KeyType, ValueType, ObjectUIDType, TYPE_UID> SelfType;
+
+	typedef SlottedField<KeyType> KeyField;
+	typedef SlottedField<ValueType> ValueField;
+
+	// An entry is its key (less the prefix) followed by its value.
+	struct Slot
+	{
+		uint32_t m_nOffset;
+		uint32_t m_nKeySize;
+		uint32_t m_nValueSize;
+	};
+
+	std::vector<Slot> m_vtSlots;
+	std::vector<char> m_vtHeap;
+
+	// The prefix the keys share, it stays empty unless the keys are byte strings.
+	std::vector<char> m_vtPrefix;
+
+	uint32_t m_nDeadBytes;
+
+public:
+	~DataNodeSlotted()
+	{
+		m_vtSlots.clear();
+		m_vtHeap.clear();
+	}
+
+	DataNodeSlotted()
+		: m_nDeadBytes(0)
+	{
+	}
+
+	DataNodeSlotted(const DataNodeSlotted& source)
+		: m_vtSlots(source.m_vtSlots)
+		, m_vtHeap(source.m_vtHeap)
+		, m_vtPrefix(source.m_vtPrefix)
+		, m_nDeadBytes(source.m_nDeadBytes)
+	{
+	}
+
+	// Constructor that deserializes the page from a char array
+	DataNodeSlotted(const char* szData)
+		: m_nDeadBytes(0)
+	{
+		uint32_t nTotalEntries = NodeHeader::read(szData);
+		uint32_t nHeapSize = 0;
+		uint32_t nPrefixSize = 0;
+
+		size_t nOffset = sizeof(NodeHeader);
+
+		memcpy(&nHeapSize, szData + nOffset, sizeof(uint32_t));
+		nOffset += sizeof(uint32_t);
+
+		memcpy(&nPrefixSize, szData + nOffset, sizeof(uint32_t));
+		nOffset += sizeof(uint32_t);
+
+		m_vtPrefix.assign(szData + nOffset, szData + nOffset + nPrefixSize);
+		nOffset += nPrefixSize;
+
+		m_vtSlots.resize(nTotalEntries);
+		m_vtHeap.resize(nHeapSize);
+
+		memcpy(m_vtSlots.data(), szData + nOffset, nTotalEntries * sizeof(Slot));
+		nOffset += nTotalEntries * sizeof(Slot);
+
+		memcpy(m_vtHeap.data(), szData + nOffset, nHeapSize);
+	}
+
+	// Constructor that deserializes the page from a file stream
+	DataNodeSlotted(std::fstream& fs)
+		: m_nDeadBytes(0)
+	{
+		uint32_t nTotalEntries = NodeHeader::read(fs);
+		uint32_t nHeapSize = 0;
+		uint32_t nPrefixSize = 0;
+
+		fs.read(reinterpret_cast<char*>(&nHeapSize), sizeof(uint32_t));
+		fs.read(reinterpret_cast<char*>(&nPrefixSize), sizeof(uint32_t));
+
+		m_vtPrefix.resize(nPrefixSize);
+		m_vtSlots.resize(nTotalEntries);
+		m_vtHeap.resize(nHeapSize);
+
+		fs.read(m_vtPrefix.data(), nPrefixSize);
+		fs.read(reinterpret_cast<char*>(m_vtSlots.data()), nTotalEntries * sizeof(Slot));
+		fs.read(m_vtHeap.data(), nHeapSize);
+	}
+
+	// Constructor that takes over the entries [nBegin, nEnd) of another node, the split uses it to build the sibling
+	DataNodeSlotted(const SelfType* ptrSource, size_t nBegin, size_t nEnd)
+		: m_nDeadBytes(0)
+	{
+		if constexpr (IS_BYTE_STRING<KeyType>)
+		{
+			// The entries are in order, so the prefix of the first and the last one is shared by all of them.
+			std::vector<char> vtFirstKey, vtLastKey;
+			ptrSource->getKeyBytesAt(nBegin, vtFirstKey);
+			ptrSource->getKeyBytesAt(nEnd - 1, vtLastKey);
+
+			size_t nPrefixSize = KeyField::getCommonPrefixSize(vtFirstKey.data(), vtFirstKey.size(), vtLastKey.data(), vtLastKey.size());
+			m_vtPrefix.assign(vtFirstKey.begin(), vtFirstKey.begin() + nPrefixSize);
+		}
+
+		m_vtSlots.reserve(nEnd - nBegin);
+
+		for (size_t nIdx = nBegin; nIdx < nEnd; nIdx++)
+		{
+			m_vtSlots.push_back(appendEntryOf(*ptrSource, nIdx));
+		}
+	}
+
+public:
+	// Serializes the node's data into a char buffer
+	inline void serialize(char*& szBuffer, uint8_t& uidObjectType, uint32_t& nBufferSize) const
+	{
+		szBuffer = new char[getSize() + 1];
+		memset(szBuffer, 0, getSize() + 1);
+
+		writeToBuffer(szBuffer, uidObjectType, nBufferSize);
+	}
+
+	// Writes the page into a buffer of getSize() bytes, the entries are laid out in the order of their keys
+	inline void writeToBuffer(char* szBuffer, uint8_t& uidObjectType, uint32_t& nBufferSize) const
+	{
+		uidObjectType = UID;
+
+		uint32_t nTotalEntries = m_vtSlots.size();
+		uint32_t nHeapSize = m_vtHeap.size() - m_nDeadBytes;
+		uint32_t nPrefixSize = m_vtPrefix.size();
+
+		nBufferSize = getSize();
+
+		size_t nOffset = 0;
+		NodeHeader::write(szBuffer, uidObjectType, nTotalEntries);
+		nOffset += sizeof(NodeHeader);
+
+		memcpy(szBuffer + nOffset, &nHeapSize, sizeof(uint32_t));
+		nOffset += sizeof(uint32_t);
+
+		memcpy(szBuffer + nOffset, &nPrefixSize, sizeof(uint32_t));
+		nOffset += sizeof(uint32_t);
+
+		if (nPrefixSize > 0)
+		{
+			memcpy(szBuffer + nOffset, m_vtPrefix.data(), nPrefixSize);
+			nOffset += nPrefixSize;
+		}
+
+		char* szSlots = szBuffer + nOffset;
+		char* szHeap = szSlots + nTotalEntries * sizeof(Slot);
+
+		uint32_t nHeapOffset = 0;
+		for (size_t nIdx = 0; nIdx < nTotalEntries; nIdx++)
+		{
+			const Slot& slot = m_vtSlots[nIdx];
+			Slot slotPacked = { nHeapOffset, slot.m_nKeySize, slot.m_nValueSize };
+
+			memcpy(szSlots + nIdx * sizeof(Slot), &slotPacked, sizeof(Slot));
+			memcpy(szHeap + nHeapOffset, m_vtHeap.data() + slot.m_nOffset, slot.m_nKeySize + slot.m_nValueSize);
+
+			nHeapOffset += slot.m_nKeySize + slot.m_nValueSize;
+		}
+
+		assert(nHeapOffset == nHeapSize);
+	}
+
+	// Writes the page to a file stream
+	inline void writeToStream(std::fstream& fs, uint8_t& uidObjectType, uint32_t& nDataSize) const
+	{
+		std::vector<char> vtBuffer(getSize());
+		writeToBuffer(vtBuffer.data(), uidObjectType, nDataSize);
+
+		fs.write(vtBuffer.data(), nDataSize);
+	}
+
+public:
+	inline bool requireSplit(size_t nDegree) const
+	{
+		return m_vtSlots.size() > nDegree;
+	}
+
+	inline bool requireMerge(size_t nDegree) const
+	{
+		return m_vtSlots.size() <= std::ceil(nDegree / 2.0f);
+	}
+
+	// Returns a copy of the first key, the key is not kept as a KeyType in the page
+	inline KeyType getFirstChild() const
+	{
+		return getKeyAt(0);
+	}
+
+	inline size_t getKeysCount() const
+	{
+		return m_vtSlots.size();
+	}
+
+	inline ErrorCode getValue(const KeyType& key, ValueType& value) const
+	{
+		size_t nIdx = lowerBound(key);
+		if (nIdx < m_vtSlots.size() && compareKeyAt(nIdx, key) == 0)
+		{
+			const Slot& slot = m_vtSlots[nIdx];
+			value = ValueField::read(m_vtHeap.data() + slot.m_nOffset + slot.m_nKeySize, slot.m_nValueSize);
+
+			return ErrorCode::Success;
+		}
+
+		return ErrorCode::KeyDoesNotExist;
+	}
+
+	inline size_t getSize() const
+	{
+		return sizeof(NodeHeader)				// UID, version and total entries
+			+ sizeof(uint32_t)						// Size of the heap
+			+ sizeof(uint32_t)						// Size of the prefix
+			+ m_vtPrefix.size()
+			+ (m_vtSlots.size() * sizeof(Slot))
+			+ (m_vtHeap.size() - m_nDeadBytes);
+	}
+
+	inline size_t getMemoryFootprint() const
+	{
+		return
+			sizeof(*this)
+			+ (m_vtSlots.capacity() * sizeof(Slot))
+			+ m_vtHeap.capacity()
+			+ m_vtPrefix.capacity();
+	}
+
+public:
+#ifdef __TRACK_CACHE_FOOTPRINT__
+	inline ErrorCode remove(const KeyType& key, int32_t& nMemoryFootprint)
+#else //__TRACK_CACHE_FOOTPRINT__
+	inline ErrorCode remove(const KeyType& key)
+#endif //__TRACK_CACHE_FOOTPRINT__
+	{
+		size_t nIdx = lowerBound(key);
+		if (nIdx < m_vtSlots.size() && compareKeyAt(nIdx, key) == 0)
+		{
+#ifdef __TRACK_CACHE_FOOTPRINT__
+			int32_t nFootprint = getMemoryFootprint();
+#endif //__TRACK_CACHE_FOOTPRINT__
+
+			releaseEntry(nIdx);
+
+#ifdef __TRACK_CACHE_FOOTPRINT__
+			nMemoryFootprint += (int32_t)getMemoryFootprint() - nFootprint;
+#endif //__TRACK_CACHE_FOOTPRINT__
+
+			return ErrorCode::Success;
+		}
+
+		return ErrorCode::KeyDoesNotExist;
+	}
+
+	// Removes the keys in [keyBegin, keyEnd) and returns how many there were, the heap is compacted once at most.
+#ifdef __TRACK_CACHE_FOOTPRINT__
+	inline size_t removeRange(const KeyType& keyBegin, const KeyType& keyEnd, int32_t& nMemoryFootprint)
+#else //__TRACK_CACHE_FOOTPRINT__
+	inline size_t removeRange(const KeyType& keyBegin, const KeyType& keyEnd)
+#endif //__TRACK_CACHE_FOOTPRINT__
+	{
+#ifdef __TRACK_CACHE_FOOTPRINT__
+		int32_t nFootprint = getMemoryFootprint();
+#endif //__TRACK_CACHE_FOOTPRINT__
+
+		size_t nBeginIdx = lowerBound(keyBegin);
+		size_t nEndIdx = std::max(nBeginIdx, lowerBound(keyEnd));
+
+		for (size_t nIdx = nBeginIdx; nIdx < nEndIdx; nIdx++)
+		{
+			m_nDeadBytes += m_vtSlots[nIdx].m_nKeySize + m_vtSlots[nIdx].m_nValueSize;
+		}
+
+		m_vtSlots.erase(m_vtSlots.begin() + nBeginIdx, m_vtSlots.begin() + nEndIdx);
+
+		if (m_nDeadBytes > m_vtHeap.size() * SLOTTED_PAGE_COMPACTION_RATIO)
+		{
+			compact();
+		}
+
+#ifdef __TRACK_CACHE_FOOTPRINT__
+		nMemoryFootprint += (int32_t)getMemoryFootprint() - nFootprint;
+#endif //__TRACK_CACHE_FOOTPRINT__
+
+		return nEndIdx - nBeginIdx;
+	}
+
+#ifdef __TRACK_CACHE_FOOTPRINT__
+	inline ErrorCode insert(const KeyType& key, const ValueType& value, int32_t& nMemoryFootprint)
+#else //__TRACK_CACHE_FOOTPRINT__
+	inline ErrorCode insert(const KeyType& key, const ValueType& value)
+#endif //__TRACK_CACHE_FOOTPRINT__
+	{
+#ifdef __TRACK_CACHE_FOOTPRINT__
+		int32_t nFootprint = getMemoryFootprint();
+#endif //__TRACK_CACHE_FOOTPRINT__
+
+		Slot slot = appendEntry(KeyField::getBytes(key), KeyField::getSize(key), ValueField::getBytes(value), ValueField::getSize(value));
+
+		m_vtSlots.insert(m_vtSlots.begin() + upperBound(key), slot);
+
+#ifdef __TRACK_CACHE_FOOTPRINT__
+		nMemoryFootprint += (int32_t)getMemoryFootprint() - nFootprint;
+#endif //__TRACK_CACHE_FOOTPRINT__
+
+		return ErrorCode::Success;
+	}
+
+	template <typename CacheType, typename CacheObjectTypePtr>
+#ifdef __TRACK_CACHE_FOOTPRINT__
+	inline ErrorCode split(std::shared_ptr<CacheType>& ptrCache, std::optional<ObjectUIDType>& uidSibling, CacheObjectTypePtr& ptrSibling, KeyType& pivotKeyForParent, int32_t& nMemoryFootprint)
+#else //__TRACK_CACHE_FOOTPRINT__
+	inline ErrorCode split(std::shared_ptr<CacheType>& ptrCache, std::optional<ObjectUIDType>& uidSibling, CacheObjectTypePtr& ptrSibling, KeyType& pivotKeyForParent)
+#endif //__TRACK_CACHE_FOOTPRINT__
+	{
+#ifdef __TRACK_CACHE_FOOTPRINT__
+		int32_t nFootprint = getMemoryFootprint();
+#endif //__TRACK_CACHE_FOOTPRINT__
+
+		size_t nMid = m_vtSlots.size() / 2;
+
+		ptrCache->template createObjectOfType<SelfType>(uidSibling, ptrSibling, this, nMid, m_vtSlots.size());
+
+		if (!uidSibling)
+		{
+			return ErrorCode::Error;
+		}
+
+		pivotKeyForParent = KeyField::getSeparator(getKeyAt(nMid - 1), getKeyAt(nMid));
+
+		for (size_t nIdx = nMid; nIdx < m_vtSlots.size(); nIdx++)
+		{
+			m_nDeadBytes += m_vtSlots[nIdx].m_nKeySize + m_vtSlots[nIdx].m_nValueSize;
+		}
+
+		m_vtSlots.resize(nMid);
+
+		compact();
+
+#ifdef __TRACK_CACHE_FOOTPRINT__
+		nMemoryFootprint += (int32_t)getMemoryFootprint() - nFootprint;
+#endif //__TRACK_CACHE_FOOTPRINT__
+
+		return ErrorCode::Success;
+	}
+
+#ifdef __TRACK_CACHE_FOOTPRINT__
+	inline void moveAnEntityFromLHSSibling(std::shared_ptr<SelfType> ptrLHSSibling, KeyType& pivotKeyForParent, int32_t& nMemoryFootprint)
+#else //__TRACK_CACHE_FOOTPRINT__
+	inline void moveAnEntityFromLHSSibling(std::shared_ptr<SelfType> ptrLHSSibling, KeyType& pivotKeyForParent)
+#endif //__TRACK_CACHE_FOOTPRINT__
+	{
+#ifdef __TRACK_CACHE_FOOTPRINT__
+		int32_t nFootprint = getMemoryFootprint() + ptrLHSSibling->getMemoryFootprint();
+#endif //__TRACK_CACHE_FOOTPRINT__
+
+		size_t nLast = ptrLHSSibling->m_vtSlots.size() - 1;
+
+		Slot slot = appendEntryOf(*ptrLHSSibling, nLast);
+		m_vtSlots.insert(m_vtSlots.begin(), slot);
+
+		ptrLHSSibling->releaseEntry(nLast);
+
+		assert(ptrLHSSibling->m_vtSlots.size() > 0);
+
+		pivotKeyForParent = KeyField::getSeparator(ptrLHSSibling->getKeyAt(nLast - 1), getKeyAt(0));
+
+#ifdef __TRACK_CACHE_FOOTPRINT__
+		nMemoryFootprint += (int32_t)(getMemoryFootprint() + ptrLHSSibling->getMemoryFootprint()) - nFootprint;
+#endif //__TRACK_CACHE_FOOTPRINT__
+	}
+
+#ifdef __TRACK_CACHE_FOOTPRINT__
+	inline void mergeNode(std::shared_ptr<SelfType> ptrSibling, int32_t& nMemoryFootprint)
+#else //__TRACK_CACHE_FOOTPRINT__
+	inline void mergeNode(std::shared_ptr<SelfType> ptrSibling)
+#endif //__TRACK_CACHE_FOOTPRINT__
+	{
+#ifdef __TRACK_CACHE_FOOTPRINT__
+		int32_t nFootprint = getMemoryFootprint();
+#endif //__TRACK_CACHE_FOOTPRINT__
+
+		m_vtSlots.reserve(m_vtSlots.size() + ptrSibling->m_vtSlots.size());
+		m_vtHeap.reserve(m_vtHeap.size() + ptrSibling->m_vtHeap.size() - ptrSibling->m_nDeadBytes);
+
+		for (size_t nIdx = 0; nIdx < ptrSibling->m_vtSlots.size(); nIdx++)
+		{
+			Slot slot = appendEntryOf(*ptrSibling, nIdx);
+			m_vtSlots.push_back(slot);
+		}
+
+#ifdef __TRACK_CACHE_FOOTPRINT__
+		nMemoryFootprint += (int32_t)getMemoryFootprint() - nFootprint;
+#endif //__TRACK_CACHE_FOOTPRINT__
+	}
+
+#ifdef __TRACK_CACHE_FOOTPRINT__
+	inline void moveAnEntityFromRHSSibling(std::shared_ptr<SelfType> ptrRHSSibling, KeyType& pivotKeyForParent, int32_t& nMemoryFootprint)
+#else //__TRACK_CACHE_FOOTPRINT__
+	inline void moveAnEntityFromRHSSibling(std::shared_ptr<SelfType> ptrRHSSibling, KeyType& pivotKeyForParent)
+#endif //__TRACK_CACHE_FOOTPRINT__
+	{
+#ifdef __TRACK_CACHE_FOOTPRINT__
+		int32_t nFootprint = getMemoryFootprint() + ptrRHSSibling->getMemoryFootprint();
+#endif //__TRACK_CACHE_FOOTPRINT__
+
+		Slot slot = appendEntryOf(*ptrRHSSibling, 0);
+		m_vtSlots.push_back(slot);
+
+		ptrRHSSibling->releaseEntry(0);
+
+		assert(ptrRHSSibling->m_vtSlots.size() > 0);
+
+		pivotKeyForParent = KeyField::getSeparator(getKeyAt(m_vtSlots.size() - 1), ptrRHSSibling->getKeyAt(0));
+
+#ifdef __TRACK_CACHE_FOOTPRINT__
+		nMemoryFootprint += (int32_t)(getMemoryFootprint() + ptrRHSSibling->getMemoryFootprint()) - nFootprint;
+#endif //__TRACK_CACHE_FOOTPRINT__
+	}
+
+private:
+	// Puts the whole key of the slot, the prefix included, into vtKey
+	inline void getKeyBytesAt(size_t nIdx, std::vector<char>& vtKey) const
+	{
+		const char* szKey = m_vtHeap.data() + m_vtSlots[nIdx].m_nOffset;
+
+		vtKey.assign(m_vtPrefix.begin(), m_vtPrefix.end());
+		vtKey.insert(vtKey.end(), szKey, szKey + m_vtSlots[nIdx].m_nKeySize);
+	}
+
+	inline KeyType getKeyAt(size_t nIdx) const
+	{
+		if (m_vtPrefix.empty())
+		{
+			return KeyField::read(m_vtHeap.data() + m_vtSlots[nIdx].m_nOffset, m_vtSlots[nIdx].m_nKeySize);
+		}
+
+		std::vector<char> vtKey;
+		getKeyBytesAt(nIdx, vtKey);
+
+		return KeyField::read(vtKey.data(), vtKey.size());
+	}
+
+	// Tells how the keys compare to the given one by the prefix alone, i.e. positive if all of them are greater, negative if all of them
+	// are less and zero if the given key starts with the prefix.
+	inline int compareWithPrefix(const char* szKey, size_t nKeySize) const
+	{
+		size_t nCommon = std::min(m_vtPrefix.size(), nKeySize);
+
+		int nResult = nCommon > 0 ? memcmp(m_vtPrefix.data(), szKey, nCommon) : 0;
+		if (nResult != 0)
+		{
+			return nResult;
+		}
+
+		return nKeySize < m_vtPrefix.size() ? 1 : 0;
+	}
+
+	inline int compareKeyAt(size_t nIdx, const KeyType& key) const
+	{
+		const Slot& slot = m_vtSlots[nIdx];
+
+		if constexpr (IS_BYTE_STRING<KeyType>)
+		{
+			int nResult = compareWithPrefix(KeyField::getBytes(key), key.size());
+			if (nResult != 0)
+			{
+				return nResult;
+			}
+
+			return KeyField::compare(m_vtHeap.data() + slot.m_nOffset, slot.m_nKeySize, KeyField::getBytes(key) + m_vtPrefix.size(), key.size() - m_vtPrefix.size());
+		}
+		else
+		{
+			return KeyField::compare(m_vtHeap.data() + slot.m_nOffset, slot.m_nKeySize, key);
+		}
+	}
+
+	// Returns the index of the first slot whose key is not less than the given one
+	inline size_t lowerBound(const KeyType& key) const
+	{
+		if constexpr (IS_BYTE_STRING<KeyType>)
+		{
+			int nResult = compareWithPrefix(KeyField::getBytes(key), key.size());
+			if (nResult != 0)
+			{
+				return nResult > 0 ? 0 : m_vtSlots.size();
+			}
+
+			// The prefix is compared once, the search goes over the rest of the keys.
+			const char* szSuffix = KeyField::getBytes(key) + m_vtPrefix.size();
+			size_t nSuffixSize = key.size() - m_vtPrefix.size();
+
+			auto it = std::lower_bound(m_vtSlots.begin(), m_vtSlots.end(), key, [this, szSuffix, nSuffixSize](const Slot& slot, const KeyType&)
+				{
+					return KeyField::compare(m_vtHeap.data() + slot.m_nOffset, slot.m_nKeySize, szSuffix, nSuffixSize) < 0;
+				});
+
+			return std::distance(m_vtSlots.begin(), it);
+		}
+		else
+		{
+			auto it = std::lower_bound(m_vtSlots.begin(), m_vtSlots.end(), key, [this](const Slot& slot, const KeyType& key)
+				{
+					return KeyField::compare(m_vtHeap.data() + slot.m_nOffset, slot.m_nKeySize, key) < 0;
+				});
+
+			return std::distance(m_vtSlots.begin(), it);
+		}
+	}
+
+	// Returns the index of the first slot whose key is greater than the given one
+	inline size_t upperBound(const KeyType& key) const
+	{
+		if constexpr (IS_BYTE_STRING<KeyType>)
+		{
+			int nResult = compareWithPrefix(KeyField::getBytes(key), key.size());
+			if (nResult != 0)
+			{
+				return nResult > 0 ? 0 : m_vtSlots.size();
+			}
+
+			const char* szSuffix = KeyField::getBytes(key) + m_vtPrefix.size();
+			size_t nSuffixSize = key.size() - m_vtPrefix.size();
+
+			auto it = std::upper_bound(m_vtSlots.begin(), m_vtSlots.end(), key, [this, szSuffix, nSuffixSize](const KeyType&, const Slot& slot)
+				{
+					return KeyField::compare(m_vtHeap.data() + slot.m_nOffset, slot.m_nKeySize, szSuffix, nSuffixSize) > 0;
+				});
+
+			return std::distance(m_vtSlots.begin(), it);
+		}
+		else
+		{
+			auto it = std::upper_bound(m_vtSlots.begin(), m_vtSlots.end(), key, [this](const KeyType& key, const Slot& slot)
+				{
+					return KeyField::compare(m_vtHeap.data() + slot.m_nOffset, slot.m_nKeySize, key) > 0;
+				});
+
+			return std::distance(m_vtSlots.begin(), it);
+		}
+	}
+
+	// Appends an entry to the heap and returns its slot, the prefix is cut back first if the key does not start with it.
+	// The key and the value are not to point into this page's heap.
+	inline Slot appendEntry(const char* szKey, uint32_t nKeySize, const char* szValue, uint32_t nValueSize)
+	{
+		if constexpr (IS_BYTE_STRING<KeyType>)
+		{
+			size_t nCommon = KeyField::getCommonPrefixSize(m_vtPrefix.data(), m_vtPrefix.size(), szKey, nKeySize);
+			if (nCommon < m_vtPrefix.size())
+			{
+				shrinkPrefix(nCommon);
+			}
+		}
+
+		uint32_t nPrefixSize = m_vtPrefix.size();
+
+		Slot slot = { (uint32_t)m_vtHeap.size(), nKeySize - nPrefixSize, nValueSize };
+
+		m_vtHeap.resize(m_vtHeap.size() + slot.m_nKeySize + slot.m_nValueSize);
+
+		if (slot.m_nKeySize > 0)
+		{
+			memcpy(m_vtHeap.data() + slot.m_nOffset, szKey + nPrefixSize, slot.m_nKeySize);
+		}
+
+		if (slot.m_nValueSize > 0)
+		{
+			memcpy(m_vtHeap.data() + slot.m_nOffset + slot.m_nKeySize, szValue, slot.m_nValueSize);
+		}
+
+		return slot;
+	}
+
+	// Copies an entry of another page to the end of the heap and returns its slot
+	inline Slot appendEntryOf(const SelfType& source, size_t nIdx)
+	{
+		const Slot& slotSource = source.m_vtSlots[nIdx];
+		const char* szEntry = source.m_vtHeap.data() + slotSource.m_nOffset;
+
+		if (source.m_vtPrefix.empty())
+		{
+			return appendEntry(szEntry, slotSource.m_nKeySize, szEntry + slotSource.m_nKeySize, slotSource.m_nValueSize);
+		}
+
+		std::vector<char> vtKey;
+		source.getKeyBytesAt(nIdx, vtKey);
+
+		return appendEntry(vtKey.data(), vtKey.size(), szEntry + slotSource.m_nKeySize, slotSource.m_nValueSize);
+	}
+
+	inline void releaseEntry(size_t nIdx)
+	{
+		m_nDeadBytes += m_vtSlots[nIdx].m_nKeySize + m_vtSlots[nIdx].m_nValueSize;
+		m_vtSlots.erase(m_vtSlots.begin() + nIdx);
+
+		if (m_nDeadBytes > m_vtHeap.size() * SLOTTED_PAGE_COMPACTION_RATIO)
+		{
+			compact();
+		}
+	}
+
+	// Slides the live entries down over the dead bytes, in the order of their offsets so that no entry is overwritten before it is moved.
+	// The entries only shrink on the way, therefore, the prefix is extended to whatever the first and the last key (and all in between) share.
+	inline void compact()
+	{
+		uint32_t nExtension = 0;
+
+		if constexpr (IS_BYTE_STRING<KeyType>)
+		{
+			if (m_vtSlots.size() > 1)
+			{
+				const Slot& slotFirst = m_vtSlots.front();
+				const Slot& slotLast = m_vtSlots.back();
+
+				nExtension = KeyField::getCommonPrefixSize(
+					m_vtHeap.data() + slotFirst.m_nOffset, slotFirst.m_nKeySize,
+					m_vtHeap.data() + slotLast.m_nOffset, slotLast.m_nKeySize);
+
+				m_vtPrefix.insert(m_vtPrefix.end(), m_vtHeap.data() + slotFirst.m_nOffset, m_vtHeap.data() + slotFirst.m_nOffset + nExtension);
+			}
+		}
+
+		std::vector<uint32_t> vtOrder(m_vtSlots.size());
+		std::iota(vtOrder.begin(), vtOrder.end(), 0);
+		std::sort(vtOrder.begin(), vtOrder.end(), [this](uint32_t nLHS, uint32_t nRHS)
+			{
+				return m_vtSlots[nLHS].m_nOffset < m_vtSlots[nRHS].m_nOffset;
+			});
+
+		uint32_t nHeapOffset = 0;
+		for (uint32_t nIdx : vtOrder)
+		{
+			Slot& slot = m_vtSlots[nIdx];
+			uint32_t nEntrySize = slot.m_nKeySize + slot.m_nValueSize - nExtension;
+
+			if (slot.m_nOffset + nExtension != nHeapOffset)
+			{
+				memmove(m_vtHeap.data() + nHeapOffset, m_vtHeap.data() + slot.m_nOffset + nExtension, nEntrySize);
+			}
+
+			slot.m_nOffset = nHeapOffset;
+			slot.m_nKeySize -= nExtension;
+
+			nHeapOffset += nEntrySize;
+		}
+
+		m_vtHeap.resize(nHeapOffset);
+		m_nDeadBytes = 0;
+	}
+
+	// Cuts the prefix back to nPrefixSize bytes, the keys grow by the bytes given back, hence, the heap is rebuilt rather than compacted.
+	inline void shrinkPrefix(size_t nPrefixSize)
+	{
+		size_t nGrowth = m_vtPrefix.size() - nPrefixSize;
+
+		std::vector<char> vtHeap;
+		vtHeap.reserve(m_vtHeap.size() - m_nDeadBytes + m_vtSlots.size() * nGrowth);
+
+		for (Slot& slot : m_vtSlots)
+		{
+			const char* szEntry = m_vtHeap.data() + slot.m_nOffset;
+
+			uint32_t nOffset = vtHeap.size();
+			vtHeap.insert(vtHeap.end(), m_vtPrefix.begin() + nPrefixSize, m_vtPrefix.end());
+			vtHeap.insert(vtHeap.end(), szEntry, szEntry + slot.m_nKeySize + slot.m_nValueSize);
+
+			slot.m_nOffset = nOffset;
+			slot.m_nKeySize += nGrowth;
+		}
+
+		m_vtHeap.swap(vtHeap);
+		m_vtPrefix.resize(nPrefixSize);
+		m_nDeadBytes = 0;
+	}
+
+public:
+	void print(std::ofstream& os, size_t nLevel, std::string stPrefix)
+	{
+		uint8_t nSpaceCount = 7;
+
+		stPrefix.append(std::string(nSpaceCount - 1, ' '));
+		stPrefix.append("|");
+
+		for (size_t nIndex = 0; nIndex < m_vtSlots.size(); nIndex++)
+		{
+			const Slot& slot = m_vtSlots[nIndex];
+
+			os
+				<< " "
+				<< stPrefix
+				<< std::string(nSpaceCount, '-').c_str()
+				<< "(K: "
+				<< getKeyAt(nIndex)
+				<< ", V: "
+				<< ValueField::read(m_vtHeap.data() + slot.m_nOffset + slot.m_nKeySize, slot.m_nValueSize)
+				<< ")"
+				<< std::endl;
+		}
+	}
+
+	void wieHiestDu()
+	{
+		printf("ich heisse DataNodeSlotted :).\n");
+	}
+};
@@ -0,0 +1,94 @@
+#pragma once
+#include <cstdint>
+#include <cstring>
+#include <bit>
+#include <algorithm>
+#include <type_traits>
+
+// Frame-of-reference encoding of integers, each one is kept as its distance from a base (the smallest one) in as many bits as the
+// largest distance takes. The bits are packed back to back into little-endian 64-bit words.
+template <typename T>
+struct FrameOfReference
+{
+	static_assert(std::is_integral<T>::value && sizeof(T) <= sizeof(uint64_t), "Only the integers of up to 64 bits can be packed.");
+
+	typedef std::make_unsigned_t<T> UnsignedType;
+
+	static inline uint64_t getDistance(T nBase, T nValue)
+	{
+		return static_cast<UnsignedType>(static_cast<UnsignedType>(nValue) - static_cast<UnsignedType>(nBase));
+	}
+
+	static inline uint8_t getBitWidth(T nBase, T nMax)
+	{
+		return std::bit_width(getDistance(nBase, nMax));
+	}
+
+	// The run is rounded up to whole words, the decoder reads a word at a time and is never to step past it.
+	static inline size_t getPackedSize(size_t nCount, uint8_t nBitWidth)
+	{
+		return ((nCount * nBitWidth + 63) / 64) * sizeof(uint64_t);
+	}
+
+	static inline void pack(const T* ptrValues, size_t nCount, T nBase, uint8_t nBitWidth, char* szBuffer)
+	{
+		memset(szBuffer, 0, getPackedSize(nCount, nBitWidth));
+
+		for (size_t idx = 0; nBitWidth > 0 && idx < nCount; idx++)
+		{
+			uint64_t nDistance = getDistance(nBase, ptrValues[idx]);
+
+			size_t nBit = idx * nBitWidth;
+			size_t nWord = nBit / 64;
+			uint32_t nShift = nBit % 64;
+
+			storeWord(szBuffer, nWord, loadWord(szBuffer, nWord) | (nDistance << nShift));
+
+			if (nShift + nBitWidth > 64)
+			{
+				storeWord(szBuffer, nWord + 1, loadWord(szBuffer, nWord + 1) | (nDistance >> (64 - nShift)));
+			}
+		}
+	}
+
+	// Each value is decoded on its own from at most two words, there is no dependency between the iterations for the compiler to respect.
+	static inline void unpack(const char* szBuffer, size_t nCount, T nBase, uint8_t nBitWidth, T* ptrValues)
+	{
+		if (nBitWidth == 0)
+		{
+			std::fill(ptrValues, ptrValues + nCount, nBase);
+			return;
+		}
+
+		uint64_t nMask = nBitWidth == 64 ? ~0ULL : (1ULL << nBitWidth) - 1;
+
+		for (size_t idx = 0; idx < nCount; idx++)
+		{
+			size_t nBit = idx * nBitWidth;
+			size_t nWord = nBit / 64;
+			uint32_t nShift = nBit % 64;
+
+			uint64_t nDistance = loadWord(szBuffer, nWord) >> nShift;
+
+			if (nShift + nBitWidth > 64)
+			{
+				nDistance |= loadWord(szBuffer, nWord + 1) << (64 - nShift);
+			}
+
+			ptrValues[idx] = static_cast<T>(static_cast<UnsignedType>(static_cast<UnsignedType>(nBase) + static_cast<UnsignedType>(nDistance & nMask)));
+		}
+	}
+
+private:
+	static inline uint64_t loadWord(const char* szBuffer, size_t nWord)
+	{
+		uint64_t nValue;
+		memcpy(&nValue, szBuffer + nWord * sizeof(uint64_t), sizeof(uint64_t));
+		return nValue;
+	}
+
+	static inline void storeWord(char* szBuffer, size_t nWord, uint64_t nValue)
+	{
+		memcpy(szBuffer + nWord * sizeof(uint64_t), &nValue, sizeof(uint64_t));
+	}
+};
@@ -10,29 +10,74 @@
 #include <optional>
 #include <iostream>
 #include <fstream>
+#include <atomic>
 #include <assert.h>
 #include "ErrorCodes.h"
+#include "SlottedField.hpp"
+#include "NodeHeader.h"
 
 using namespace std;
 
-template <typename KeyType, typename ValueType, typename ObjectUIDType, typename DataNodeType, uint8_t TYPE_UID>
+// MESSAGE_BUFFER_CAPACITY makes the node that of a Bε-tree, i.e. the inserts and removes for its subtree are buffered in the node as messages
+// and are handed down to the child the most of them are pending for once there are more than the capacity (see BPlusStore::write).
+template <typename KeyType, typename ValueType, typename ObjectUIDType, typename DataNodeType, uint8_t TYPE_UID, size_t MESSAGE_BUFFER_CAPACITY = 0>
 class IndexNode
 {
 public:
 	// Static UID to identify the type of the node
 	static const uint8_t UID = TYPE_UID;
 
+	static const size_t BUFFER_CAPACITY = MESSAGE_BUFFER_CAPACITY;
+
+	enum MessageOperation : uint8_t
+	{
+		Insert = 0,
+		Remove
+	};
+
+	// An update that is pending for a key in the subtree, the one nearer the root is the more recent.
+	struct Message
+	{
+		KeyType m_key;
+		ValueType m_value;
+		uint8_t m_nOperation;
+	};
+
 private:
-	typedef IndexNode<KeyType, ValueType, ObjectUIDType, DataNodeType, UID> SelfType;
+	typedef IndexNode<KeyType, ValueType, ObjectUIDType, DataNodeType, UID, MESSAGE_BUFFER_CAPACITY> SelfType;
 
 	typedef std::vector<KeyType>::const_iterator KeyTypeIterator;
 	typedef std::vector<ObjectUIDType>::const_iterator CacheKeyTypeIterator;
+	typedef std::vector<Message>::iterator MessageIterator;
+
+	// The pivots are serialized as they are, or, if they are byte strings, as their shared prefix, an array of the end offsets of the rest
+	// of them and then the bytes of the rest of them.
+	static constexpr bool POD_PIVOTS = std::is_trivial<KeyType>::value && std::is_standard_layout<KeyType>::value;
+	static constexpr bool SLOTTED_PIVOTS = !POD_PIVOTS && IS_BYTE_STRING<KeyType>;
+
+	// The messages are serialized as they are, after the children.
+	static_assert(MESSAGE_BUFFER_CAPACITY == 0 || (POD_PIVOTS && std::is_trivial<ValueType>::value && std::is_standard_layout<ValueType>::value),
+		"The message buffer is supported for POD keys and values only.");
 
 private:
 	// Vector to store pivot keys and child node UIDs
 	std::vector<KeyType> m_vtPivots;
 	std::vector<ObjectUIDType> m_vtChildren;
 
+	// In the order of their keys, one per key at most (see MESSAGE_BUFFER_CAPACITY).
+	std::vector<Message> m_vtMessages;
+
+#ifdef __TREE_WITH_CACHE__
+	// The references to the children that are resident in the cache, kept next to their UIDs (see LRUCache::getObject).
+	// An entry is trusted only while the cache holds the object under the UID in the same slot, therefore, the entries
+	// need not follow the children on splits and merges, a stale one merely costs a regular lookup.
+	std::vector<std::weak_ptr<void>> m_vtSwizzledChildren;
+
+#ifdef __TRACK_CACHE_FOOTPRINT__
+	std::atomic<int32_t> m_nUnreportedFootprint = 0;
+#endif //__TRACK_CACHE_FOOTPRINT__
+#endif //__TREE_WITH_CACHE__
+
 public:
 	// Destructor: Clears pivot and child vectors
 	~IndexNode()
@@ -51,6 +96,7 @@ public:
 	{
 		m_vtPivots.assign(source.m_vtPivots.begin(), source.m_vtPivots.end());
 		m_vtChildren.assign(source.m_vtChildren.begin(), source.m_vtChildren.end());
+		m_vtMessages.assign(source.m_vtMessages.begin(), source.m_vtMessages.end());
 	}
 
 	// Constructor that deserializes the node from raw data
@@ -61,22 +107,46 @@ public:
 			std::is_trivial<typename ObjectUIDType::NodeUID>::value &&
 			std::is_standard_layout<typename ObjectUIDType::NodeUID>::value)
 		{
-			uint16_t nKeyCount = 0;
+			uint32_t nKeyCount = NodeHeader::read(szData);
 
-			uint32_t nOffset = sizeof(uint8_t);
-
-			memcpy(&nKeyCount, szData + nOffset, sizeof(uint16_t));
-			nOffset += sizeof(uint16_t);
+			size_t nOffset = sizeof(NodeHeader);
 
 			m_vtPivots.resize(nKeyCount);
 			m_vtChildren.resize(nKeyCount + 1);
 
-			uint32_t nKeysSize = nKeyCount * sizeof(KeyType);
+			size_t nKeysSize = nKeyCount * sizeof(KeyType);
 			memcpy(m_vtPivots.data(), szData + nOffset, nKeysSize);
 			nOffset += nKeysSize;
 
-			uint32_t nValuesSize = (nKeyCount + 1) * sizeof(typename ObjectUIDType::NodeUID);
+			size_t nValuesSize = (nKeyCount + 1) * sizeof(typename ObjectUIDType::NodeUID);
 			memcpy(m_vtChildren.data(), szData + nOffset, nValuesSize);
+			nOffset += nValuesSize;
+
+			if constexpr (MESSAGE_BUFFER_CAPACITY > 0)
+			{
+				uint32_t nMessageCount = 0;
+				memcpy(&nMessageCount, szData + nOffset, sizeof(uint32_t));
+				nOffset += sizeof(uint32_t);
+
+				if (nMessageCount > 0)
+				{
+					m_vtMessages.resize(nMessageCount);
+					memcpy(m_vtMessages.data(), szData + nOffset, nMessageCount * sizeof(Message));
+				}
+			}
+		}
+		else if constexpr (SLOTTED_PIVOTS &&
+			std::is_trivial<typename ObjectUIDType::NodeUID>::value &&
+			std::is_standard_layout<typename ObjectUIDType::NodeUID>::value)
+		{
+			uint32_t nKeyCount = NodeHeader::read(szData);
+
+			size_t nOffset = sizeof(NodeHeader);
+
+			nOffset += readPivots(szData + nOffset, nKeyCount);
+
+			m_vtChildren.resize(nKeyCount + 1);
+			memcpy(m_vtChildren.data(), szData + nOffset, (nKeyCount + 1) * sizeof(typename ObjectUIDType::NodeUID));
 		}
 		else
 		{
@@ -97,14 +167,51 @@ public:
 			std::is_trivial<typename ObjectUIDType::NodeUID>::value &&
 			std::is_standard_layout<typename ObjectUIDType::NodeUID>::value)
 		{
-			uint16_t nPivotCount;
-			fs.read(reinterpret_cast<char*>(&nPivotCount), sizeof(uint16_t));
+			uint32_t nPivotCount = NodeHeader::read(fs);
 
 			m_vtPivots.resize(nPivotCount);
 			m_vtChildren.resize(nPivotCount + 1);
 
 			fs.read(reinterpret_cast<char*>(m_vtPivots.data()), nPivotCount * sizeof(KeyType));
 			fs.read(reinterpret_cast<char*>(m_vtChildren.data()), (nPivotCount + 1) * sizeof(typename ObjectUIDType::NodeUID));
+
+			if constexpr (MESSAGE_BUFFER_CAPACITY > 0)
+			{
+				uint32_t nMessageCount = 0;
+				fs.read(reinterpret_cast<char*>(&nMessageCount), sizeof(uint32_t));
+
+				m_vtMessages.resize(nMessageCount);
+				fs.read(reinterpret_cast<char*>(m_vtMessages.data()), nMessageCount * sizeof(Message));
+			}
+		}
+		else if constexpr (SLOTTED_PIVOTS &&
+			std::is_trivial<typename ObjectUIDType::NodeUID>::value &&
+			std::is_standard_layout<typename ObjectUIDType::NodeUID>::value)
+		{
+			uint32_t nPivotCount = NodeHeader::read(fs);
+
+			uint32_t nPrefixSize = 0;
+			fs.read(reinterpret_cast<char*>(&nPrefixSize), sizeof(uint32_t));
+
+			// The pivots are read back in the layout writePivots produces, the last end offset is the size of the bytes after the offsets.
+			std::vector<char> vtPivots(sizeof(uint32_t) + nPrefixSize + nPivotCount * sizeof(uint32_t));
+			memcpy(vtPivots.data(), &nPrefixSize, sizeof(uint32_t));
+			fs.read(vtPivots.data() + sizeof(uint32_t), vtPivots.size() - sizeof(uint32_t));
+
+			uint32_t nBytes = 0;
+			if (nPivotCount > 0)
+			{
+				memcpy(&nBytes, vtPivots.data() + vtPivots.size() - sizeof(uint32_t), sizeof(uint32_t));
+			}
+
+			size_t nHeaderSize = vtPivots.size();
+			vtPivots.resize(nHeaderSize + nBytes);
+			fs.read(vtPivots.data() + nHeaderSize, nBytes);
+
+			readPivots(vtPivots.data(), nPivotCount);
+
+			m_vtChildren.resize(nPivotCount + 1);
+			fs.read(reinterpret_cast<char*>(m_vtChildren.data()), (nPivotCount + 1) * sizeof(typename ObjectUIDType::NodeUID));
 		}
 		else
 		{
@@ -143,20 +250,26 @@ public:
 		{
 			uidObjectType = SelfType::UID;
 
-			uint16_t nKeyCount = m_vtPivots.size();
-			uint16_t nValueCount = m_vtChildren.size();
+			uint32_t nKeyCount = m_vtPivots.size();
+			uint32_t nValueCount = m_vtChildren.size();
 
 			nDataSize 
-				= sizeof(uint8_t)					// UID
-				+ sizeof(uint16_t)						// Total keys
+				= sizeof(NodeHeader)					// UID, version and total keys
 				+ (nKeyCount * sizeof(KeyType))			// Size of all keys
-				+ (nValueCount * sizeof(typename ObjectUIDType::NodeUID));	// Size of all values
+				+ (nValueCount * sizeof(typename ObjectUIDType::NodeUID))	// Size of all values
+				+ getMessagesSize();
 
-			fs.write(reinterpret_cast<const char*>(&uidObjectType), sizeof(uint8_t));
-			fs.write(reinterpret_cast<const char*>(&nKeyCount), sizeof(uint16_t));
+			NodeHeader::write(fs, uidObjectType, nKeyCount);
 			fs.write(reinterpret_cast<const char*>(m_vtPivots.data()), nKeyCount * sizeof(KeyType));
 			fs.write(reinterpret_cast<const char*>(m_vtChildren.data()), (nKeyCount + 1) * sizeof(typename ObjectUIDType::NodeUID));	// fix it!
 
+			if constexpr (MESSAGE_BUFFER_CAPACITY > 0)
+			{
+				uint32_t nMessageCount = m_vtMessages.size();
+				fs.write(reinterpret_cast<const char*>(&nMessageCount), sizeof(uint32_t));
+				fs.write(reinterpret_cast<const char*>(m_vtMessages.data()), nMessageCount * sizeof(Message));
+			}
+
 #ifdef __VALIDITY_CHECK__
 			for (auto it = m_vtChildren.begin(); it != m_vtChildren.end(); it++)
 			{
@@ -164,19 +277,37 @@ public:
 			}
 #endif //__VALIDITY_CHECK__
 		}
+		else if constexpr (SLOTTED_PIVOTS &&
+			std::is_trivial<typename ObjectUIDType::NodeUID>::value &&
+			std::is_standard_layout<typename ObjectUIDType::NodeUID>::value)
+		{
+			std::vector<char> vtBuffer(getSize());
+			writeToBuffer(vtBuffer.data(), uidObjectType, nDataSize);
+
+			fs.write(vtBuffer.data(), nDataSize);
+		}
 		else
 		{
 			static_assert(
 				std::is_trivial<KeyType>::value &&
 				std::is_standard_layout<KeyType>::value &&
-				std::is_trivial<ValueType>::value &&
-				std::is_standard_layout<ValueType>::value,
+				std::is_trivial<typename ObjectUIDType::NodeUID>::value &&
+				std::is_standard_layout<typename ObjectUIDType::NodeUID>::value,
 				"Non-POD type is provided. Kindly implement custome de/serializer.");
 		}
 	}
 
 	// Serializes the node's data into a char buffer
 	inline void serialize(char*& szBuffer, uint8_t& uidObjectType, uint32_t& nBufferSize) const
+	{
+		szBuffer = new char[getSize() + 1];
+		memset(szBuffer, 0, getSize() + 1);
+
+		writeToBuffer(szBuffer, uidObjectType, nBufferSize);
+	}
+
+	// Writes the node's data into a buffer of getSize() bytes, e.g. straight into a mapped region
+	inline void writeToBuffer(char* szBuffer, uint8_t& uidObjectType, uint32_t& nBufferSize) const
 	{
 		if constexpr (std::is_trivial<KeyType>::value &&
 			std::is_standard_layout<KeyType>::value &&
@@ -185,24 +316,18 @@ public:
 		{
 			uidObjectType = UID;
 
-			uint16_t nKeyCount = m_vtPivots.size();
-			uint16_t nValueCount = m_vtChildren.size();
+			uint32_t nKeyCount = m_vtPivots.size();
+			uint32_t nValueCount = m_vtChildren.size();
 
 			nBufferSize 
-				= sizeof(uint8_t)					// UID
-				+ sizeof(uint16_t)						// Total keys
+				= sizeof(NodeHeader)					// UID, version and total keys
 				+ (nKeyCount * sizeof(KeyType))			// Size of all keys
-				+ (nValueCount * sizeof(typename ObjectUIDType::NodeUID));	// Size of all values
-
-			szBuffer = new char[nBufferSize + 1];
-			memset(szBuffer, 0, nBufferSize + 1);
+				+ (nValueCount * sizeof(typename ObjectUIDType::NodeUID))	// Size of all values
+				+ getMessagesSize();
 
 			size_t nOffset = 0;
-			memcpy(szBuffer, &uidObjectType, sizeof(uint8_t));
-			nOffset += sizeof(uint8_t);
-
-			memcpy(szBuffer + nOffset, &nKeyCount, sizeof(uint16_t));
-			nOffset += sizeof(uint16_t);
+			NodeHeader::write(szBuffer, uidObjectType, nKeyCount);
+			nOffset += sizeof(NodeHeader);
 
 			size_t nKeysSize = nKeyCount * sizeof(KeyType);
 			memcpy(szBuffer + nOffset, m_vtPivots.data(), nKeysSize);
@@ -212,6 +337,44 @@ public:
 			memcpy(szBuffer + nOffset, m_vtChildren.data(), nValuesSize);
 			nOffset += nValuesSize;
 
+			if constexpr (MESSAGE_BUFFER_CAPACITY > 0)
+			{
+				uint32_t nMessageCount = m_vtMessages.size();
+				memcpy(szBuffer + nOffset, &nMessageCount, sizeof(uint32_t));
+				nOffset += sizeof(uint32_t);
+
+				if (nMessageCount > 0)
+				{
+					memcpy(szBuffer + nOffset, m_vtMessages.data(), nMessageCount * sizeof(Message));
+					nOffset += nMessageCount * sizeof(Message);
+				}
+			}
+
+#ifdef __VALIDITY_CHECK__
+			for (auto it = m_vtChildren.begin(); it != m_vtChildren.end(); it++)
+			{
+				assert((*it).getMediaType() >= 2);
+			}
+#endif //__VALIDITY_CHECK__
+		}
+		else if constexpr (SLOTTED_PIVOTS &&
+			std::is_trivial<typename ObjectUIDType::NodeUID>::value &&
+			std::is_standard_layout<typename ObjectUIDType::NodeUID>::value)
+		{
+			uidObjectType = UID;
+
+			uint32_t nKeyCount = m_vtPivots.size();
+
+			nBufferSize = getSize();
+
+			size_t nOffset = 0;
+			NodeHeader::write(szBuffer, uidObjectType, nKeyCount);
+			nOffset += sizeof(NodeHeader);
+
+			nOffset += writePivots(szBuffer + nOffset);
+
+			memcpy(szBuffer + nOffset, m_vtChildren.data(), (nKeyCount + 1) * sizeof(typename ObjectUIDType::NodeUID));
+
 #ifdef __VALIDITY_CHECK__
 			for (auto it = m_vtChildren.begin(); it != m_vtChildren.end(); it++)
 			{
@@ -230,6 +393,107 @@ public:
 		}
 	}
 
+private:
+	// The prefix all the pivots share, i.e. the one of the first and the last pivot as they are in order
+	inline size_t getPivotsPrefixSize() const
+	{
+		if (m_vtPivots.size() < 2)
+		{
+			return 0;
+		}
+
+		return SlottedField<KeyType>::getCommonPrefixSize(
+			SlottedField<KeyType>::getBytes(m_vtPivots.front()), SlottedField<KeyType>::getSize(m_vtPivots.front()),
+			SlottedField<KeyType>::getBytes(m_vtPivots.back()), SlottedField<KeyType>::getSize(m_vtPivots.back()));
+	}
+
+	// Size of the byte-string pivots once serialized, i.e. their shared prefix, the end offsets of the rest of them and then their bytes
+	inline size_t getPivotsSize() const
+	{
+		size_t nPrefixSize = getPivotsPrefixSize();
+
+		size_t nSize = sizeof(uint32_t) + nPrefixSize + m_vtPivots.size() * sizeof(uint32_t);
+		for (const KeyType& key : m_vtPivots)
+		{
+			nSize += SlottedField<KeyType>::getSize(key) - nPrefixSize;
+		}
+
+		return nSize;
+	}
+
+	// The size of the messages once serialized, their count included
+	inline size_t getMessagesSize() const
+	{
+		if constexpr (MESSAGE_BUFFER_CAPACITY > 0)
+		{
+			return sizeof(uint32_t) + (m_vtMessages.size() * sizeof(Message));
+		}
+
+		return 0;
+	}
+
+	static inline bool compareMessageKey(const Message& message, const KeyType& key)
+	{
+		return message.m_key < key;
+	}
+
+	inline size_t writePivots(char* szBuffer) const
+	{
+		uint32_t nPrefixSize = getPivotsPrefixSize();
+
+		memcpy(szBuffer, &nPrefixSize, sizeof(uint32_t));
+		if (nPrefixSize > 0)
+		{
+			memcpy(szBuffer + sizeof(uint32_t), SlottedField<KeyType>::getBytes(m_vtPivots.front()), nPrefixSize);
+		}
+
+		char* szOffsets = szBuffer + sizeof(uint32_t) + nPrefixSize;
+		char* szBytes = szOffsets + m_vtPivots.size() * sizeof(uint32_t);
+
+		uint32_t nEndOffset = 0;
+		for (size_t nIdx = 0; nIdx < m_vtPivots.size(); nIdx++)
+		{
+			uint32_t nSuffixSize = SlottedField<KeyType>::getSize(m_vtPivots[nIdx]) - nPrefixSize;
+			if (nSuffixSize > 0)
+			{
+				memcpy(szBytes + nEndOffset, SlottedField<KeyType>::getBytes(m_vtPivots[nIdx]) + nPrefixSize, nSuffixSize);
+			}
+
+			nEndOffset += nSuffixSize;
+			memcpy(szOffsets + nIdx * sizeof(uint32_t), &nEndOffset, sizeof(uint32_t));
+		}
+
+		return (szBytes - szBuffer) + nEndOffset;
+	}
+
+	inline size_t readPivots(const char* szBuffer, uint32_t nKeyCount)
+	{
+		uint32_t nPrefixSize = 0;
+		memcpy(&nPrefixSize, szBuffer, sizeof(uint32_t));
+
+		const char* szOffsets = szBuffer + sizeof(uint32_t) + nPrefixSize;
+		const char* szBytes = szOffsets + nKeyCount * sizeof(uint32_t);
+
+		m_vtPivots.reserve(nKeyCount);
+
+		std::vector<char> vtKey(szBuffer + sizeof(uint32_t), szOffsets);
+
+		uint32_t nBeginOffset = 0;
+		for (size_t nIdx = 0; nIdx < nKeyCount; nIdx++)
+		{
+			uint32_t nEndOffset = 0;
+			memcpy(&nEndOffset, szOffsets + nIdx * sizeof(uint32_t), sizeof(uint32_t));
+
+			vtKey.resize(nPrefixSize);
+			vtKey.insert(vtKey.end(), szBytes + nBeginOffset, szBytes + nEndOffset);
+
+			m_vtPivots.push_back(SlottedField<KeyType>::read(vtKey.data(), vtKey.size()));
+			nBeginOffset = nEndOffset;
+		}
+
+		return (szBytes - szBuffer) + nBeginOffset;
+	}
+
 public:
 	// Returns the number of keys (pivots) in the node
 	inline size_t getKeysCount() const
@@ -256,6 +520,34 @@ public:
 		return m_vtChildren[getChildNodeIdx(key)];
 	}
 
+#ifdef __TREE_WITH_CACHE__
+	// Gets the reference to the child at the given index, the slot is to be accessed under the node's lock.
+	inline std::weak_ptr<void>& getSwizzledChildAt(size_t nIdx)
+	{
+		if (m_vtSwizzledChildren.size() != m_vtChildren.size())
+		{
+#ifdef __TRACK_CACHE_FOOTPRINT__
+			size_t nCapacity = m_vtSwizzledChildren.capacity();
+#endif //__TRACK_CACHE_FOOTPRINT__
+
+			m_vtSwizzledChildren.resize(m_vtChildren.size());
+
+#ifdef __TRACK_CACHE_FOOTPRINT__
+			m_nUnreportedFootprint += (m_vtSwizzledChildren.capacity() - nCapacity) * sizeof(std::weak_ptr<void>);
+#endif //__TRACK_CACHE_FOOTPRINT__
+		}
+
+		return m_vtSwizzledChildren[nIdx];
+	}
+
+#ifdef __TRACK_CACHE_FOOTPRINT__
+	inline int32_t takeUnreportedFootprint()
+	{
+		return m_nUnreportedFootprint.exchange(0);
+	}
+#endif //__TRACK_CACHE_FOOTPRINT__
+#endif //__TREE_WITH_CACHE__
+
 	// Returns the first pivot key
 	inline const KeyType& getFirstChild() const
 	{
@@ -285,24 +577,22 @@ public:
 
 	inline size_t getSize() const
 	{
-		if constexpr (std::is_trivial<KeyType>::value &&
-			std::is_standard_layout<KeyType>::value &&
-			std::is_trivial<ValueType>::value &&
-			std::is_standard_layout<ValueType>::value)
+		if constexpr (POD_PIVOTS)
 		{
-			return sizeof(uint8_t)
-				+ sizeof(uint16_t)
+			return sizeof(NodeHeader)
 				+ (m_vtPivots.size() * sizeof(KeyType))
+				+ (m_vtChildren.size() * sizeof(typename ObjectUIDType::NodeUID))
+				+ getMessagesSize();
+		}
+		else if constexpr (SLOTTED_PIVOTS)
+		{
+			return sizeof(NodeHeader)
+				+ getPivotsSize()
 				+ (m_vtChildren.size() * sizeof(typename ObjectUIDType::NodeUID));
 		}
 		else
 		{
-			static_assert(
-				std::is_trivial<KeyType>::value &&
-				std::is_standard_layout<KeyType>::value &&
-				std::is_trivial<ValueType>::value &&
-				std::is_standard_layout<ValueType>::value,
-				"Non-POD type is provided. Kindly provide functionality to calculate size.");
+			static_assert(POD_PIVOTS || SLOTTED_PIVOTS, "Non-POD type is provided. Kindly provide functionality to calculate size.");
 		}
 	}
 
@@ -313,19 +603,20 @@ public:
 	void updateChildUID(std::shared_ptr<CacheObjectType> ptrChildNode, const ObjectUIDType& uidOld, const ObjectUIDType& uidNew)
 #endif //__TRACK_CACHE_FOOTPRINT__
 	{
-		const KeyType* key = nullptr;
+		// A copy, as a slotted leaf does not keep its keys as KeyTypes (see DataNodeSlotted::getFirstChild).
+		KeyType key;
 		if (std::holds_alternative<std::shared_ptr<SelfType>>(ptrChildNode->getInnerData()))
 		{
 			std::shared_ptr<SelfType> ptrIndexNode = std::get<std::shared_ptr<SelfType>>(ptrChildNode->getInnerData());
-			key = &ptrIndexNode->getFirstChild();
+			key = ptrIndexNode->getFirstChild();
 		}
 		else //if (std::holds_alternative<std::shared_ptr<DataNodeType>>(ptrChildNode->getInnerData()))
 		{
 			std::shared_ptr<DataNodeType> ptrDataNode = std::get<std::shared_ptr<DataNodeType>>(ptrChildNode->getInnerData());
-			key = &ptrDataNode->getFirstChild();
+			key = ptrDataNode->getFirstChild();
 		}
 
-		auto it = std::upper_bound(m_vtPivots.begin(), m_vtPivots.end(), *key);
+		auto it = std::upper_bound(m_vtPivots.begin(), m_vtPivots.end(), key);
 		auto index = std::distance(m_vtPivots.begin(), it);
 
 		assert(m_vtChildren[index] == uidOld);
@@ -339,18 +630,20 @@ public:
 #endif //__TRACK_CACHE_FOOTPRINT__
 	}
 
-	template <typename CacheObjectType>
-	bool updateChildrenUIDs(std::unordered_map<ObjectUIDType, std::pair<std::optional<ObjectUIDType>, std::shared_ptr<CacheObjectType>>>& mpUIDUpdates)
+	template <typename UIDUpdatesMapType>
+	bool updateChildrenUIDs(UIDUpdatesMapType& mpUIDUpdates)
 	{
 		bool bDirty = false;
 
 		for (auto it = m_vtChildren.begin(), itend = m_vtChildren.end(); it != itend; it++)
 		{
-			if (mpUIDUpdates.find(*it) != mpUIDUpdates.end())
+			// Skip the entries whose flush (or relocation) is still in progress.
+			auto itUpdate = mpUIDUpdates.find(*it);
+			if (itUpdate != mpUIDUpdates.end() && (*itUpdate).second.first != std::nullopt)
 			{
 				ObjectUIDType uidTemp = *it;
 
-				*it = *(mpUIDUpdates[*it].first);
+				*it = *((*itUpdate).second.first);
 
 				mpUIDUpdates.erase(uidTemp);
 
@@ -361,29 +654,261 @@ public:
 		return bDirty;
 	}
 
+	// The bytes the byte-string pivots hold outside of the vector are left out, as the footprint is tracked through the capacity of the vectors.
 	inline size_t getMemoryFootprint() const
 	{
-		if constexpr (std::is_trivial<KeyType>::value &&
-			std::is_standard_layout<KeyType>::value &&
-			std::is_trivial<ValueType>::value &&
-			std::is_standard_layout<ValueType>::value)
+		if constexpr (POD_PIVOTS || SLOTTED_PIVOTS)
 		{
 			return
 				sizeof(*this)
 				+ (m_vtPivots.capacity() * sizeof(KeyType))
-				+ (m_vtChildren.capacity() * sizeof(ObjectUIDType));
+				+ (m_vtChildren.capacity() * sizeof(ObjectUIDType))
+				+ (m_vtMessages.capacity() * sizeof(Message))
+#ifdef __TREE_WITH_CACHE__
+				+ (m_vtSwizzledChildren.capacity() * sizeof(std::weak_ptr<void>))
+#endif //__TREE_WITH_CACHE__
+				;
 		}
 		else
 		{
-			static_assert(
-				std::is_trivial<KeyType>::value &&
-				std::is_standard_layout<KeyType>::value &&
-				std::is_trivial<ValueType>::value &&
-				std::is_standard_layout<ValueType>::value,
-				"Non-POD type is provided. Kindly provide functionality to calculate size.");
+			static_assert(POD_PIVOTS || SLOTTED_PIVOTS, "Non-POD type is provided. Kindly provide functionality to calculate size.");
 		}
 	}
 
+	inline size_t getMessagesCount() const
+	{
+		return m_vtMessages.size();
+	}
+
+	// Checks if the buffer has overflowed, i.e. the messages for one of the children are to be flushed to it
+	inline bool requireFlush() const
+	{
+		return m_vtMessages.size() > MESSAGE_BUFFER_CAPACITY;
+	}
+
+	// Gets the message pending for the key, if any
+	inline bool getMessage(const KeyType& key, Message& message) const
+	{
+		auto it = std::lower_bound(m_vtMessages.begin(), m_vtMessages.end(), key, compareMessageKey);
+		if (it != m_vtMessages.end() && (*it).m_key == key)
+		{
+			message = *it;
+			return true;
+		}
+
+		return false;
+	}
+
+	// Adds the message to the buffer, it supersedes the one pending for the same key
+#ifdef __TRACK_CACHE_FOOTPRINT__
+	inline void addMessage(const Message& message, int32_t& nMemoryFootprint)
+#else //__TRACK_CACHE_FOOTPRINT__
+	inline void addMessage(const Message& message)
+#endif //__TRACK_CACHE_FOOTPRINT__
+	{
+#ifdef __TRACK_CACHE_FOOTPRINT__
+		uint32_t nMessageContainerCapacity = m_vtMessages.capacity();
+#endif //__TRACK_CACHE_FOOTPRINT__
+
+		auto it = std::lower_bound(m_vtMessages.begin(), m_vtMessages.end(), message.m_key, compareMessageKey);
+		if (it != m_vtMessages.end() && (*it).m_key == message.m_key)
+		{
+			*it = message;
+		}
+		else
+		{
+			m_vtMessages.insert(it, message);
+		}
+
+#ifdef __TRACK_CACHE_FOOTPRINT__
+		if (nMessageContainerCapacity != m_vtMessages.capacity())
+		{
+			nMemoryFootprint -= nMessageContainerCapacity * sizeof(Message);
+			nMemoryFootprint += m_vtMessages.capacity() * sizeof(Message);
+		}
+#endif //__TRACK_CACHE_FOOTPRINT__
+	}
+
+	// Adds the messages flushed from the parent, they are in the order of their keys and supersede the ones pending here for the same keys
+#ifdef __TRACK_CACHE_FOOTPRINT__
+	inline void addMessages(const std::vector<Message>& vtMessages, int32_t& nMemoryFootprint)
+#else //__TRACK_CACHE_FOOTPRINT__
+	inline void addMessages(const std::vector<Message>& vtMessages)
+#endif //__TRACK_CACHE_FOOTPRINT__
+	{
+#ifdef __TRACK_CACHE_FOOTPRINT__
+		uint32_t nMessageContainerCapacity = m_vtMessages.capacity();
+#endif //__TRACK_CACHE_FOOTPRINT__
+
+		std::vector<Message> vtMerged;
+		vtMerged.reserve(m_vtMessages.size() + vtMessages.size());
+
+		auto itOwn = m_vtMessages.begin();
+		for (const Message& message : vtMessages)
+		{
+			while (itOwn != m_vtMessages.end() && (*itOwn).m_key < message.m_key)
+			{
+				vtMerged.push_back(*itOwn++);
+			}
+
+			if (itOwn != m_vtMessages.end() && (*itOwn).m_key == message.m_key)
+			{
+				itOwn++;
+			}
+
+			vtMerged.push_back(message);
+		}
+
+		vtMerged.insert(vtMerged.end(), itOwn, m_vtMessages.end());
+
+		m_vtMessages.swap(vtMerged);
+
+#ifdef __TRACK_CACHE_FOOTPRINT__
+		if (nMessageContainerCapacity != m_vtMessages.capacity())
+		{
+			nMemoryFootprint -= nMessageContainerCapacity * sizeof(Message);
+			nMemoryFootprint += m_vtMessages.capacity() * sizeof(Message);
+		}
+#endif //__TRACK_CACHE_FOOTPRINT__
+	}
+
+	// Finds the child the most messages are pending for
+	inline size_t getChildIdxWithMostMessages() const
+	{
+		size_t nChildIdx = 0;
+		size_t nMostMessages = 0;
+
+		auto itBegin = m_vtMessages.begin();
+		for (size_t nIdx = 0; nIdx <= m_vtPivots.size() && itBegin != m_vtMessages.end(); nIdx++)
+		{
+			auto itEnd = nIdx < m_vtPivots.size() ? std::lower_bound(itBegin, m_vtMessages.end(), m_vtPivots[nIdx], compareMessageKey) : m_vtMessages.end();
+
+			if (itEnd - itBegin > nMostMessages)
+			{
+				nChildIdx = nIdx;
+				nMostMessages = itEnd - itBegin;
+			}
+
+			itBegin = itEnd;
+		}
+
+		return nChildIdx;
+	}
+
+	// Takes the messages pending for the child at the given index out of the buffer
+#ifdef __TRACK_CACHE_FOOTPRINT__
+	inline void takeMessages(size_t nChildIdx, std::vector<Message>& vtMessages, int32_t& nMemoryFootprint)
+#else //__TRACK_CACHE_FOOTPRINT__
+	inline void takeMessages(size_t nChildIdx, std::vector<Message>& vtMessages)
+#endif //__TRACK_CACHE_FOOTPRINT__
+	{
+#ifdef __TRACK_CACHE_FOOTPRINT__
+		uint32_t nMessageContainerCapacity = m_vtMessages.capacity();
+#endif //__TRACK_CACHE_FOOTPRINT__
+
+		auto itBegin = nChildIdx > 0 ? std::lower_bound(m_vtMessages.begin(), m_vtMessages.end(), m_vtPivots[nChildIdx - 1], compareMessageKey) : m_vtMessages.begin();
+		auto itEnd = nChildIdx < m_vtPivots.size() ? std::lower_bound(itBegin, m_vtMessages.end(), m_vtPivots[nChildIdx], compareMessageKey) : m_vtMessages.end();
+
+		vtMessages.assign(itBegin, itEnd);
+		m_vtMessages.erase(itBegin, itEnd);
+
+#ifdef __TRACK_CACHE_FOOTPRINT__
+		if (nMessageContainerCapacity != m_vtMessages.capacity())
+		{
+			nMemoryFootprint -= nMessageContainerCapacity * sizeof(Message);
+			nMemoryFootprint += m_vtMessages.capacity() * sizeof(Message);
+		}
+#endif //__TRACK_CACHE_FOOTPRINT__
+	}
+
+	// Gets the bounds of the keys of the child at the given index from those of the node, std::nullopt stands for a side that is not bounded.
+	inline void getChildBounds(size_t nIdx, const std::optional<KeyType>& keyLower, const std::optional<KeyType>& keyUpper, std::optional<KeyType>& keyChildLower, std::optional<KeyType>& keyChildUpper) const
+	{
+		keyChildLower = nIdx > 0 ? std::optional<KeyType>(m_vtPivots[nIdx - 1]) : keyLower;
+		keyChildUpper = nIdx < m_vtPivots.size() ? std::optional<KeyType>(m_vtPivots[nIdx]) : keyUpper;
+	}
+
+	// Detaches the children that hold no keys but those in [keyBegin, keyEnd) and drops the messages in the range, the node itself is expected
+	// to straddle an end of it (see getChildBounds for the bounds). The detached children are appended to vtDetached and the indexes of the ones
+	// left that straddle an end (two at most) to vtStraddling. The containers keep their capacity.
+	inline void removeRange(const KeyType& keyBegin, const KeyType& keyEnd, const std::optional<KeyType>& keyLower, const std::optional<KeyType>& keyUpper, std::vector<ObjectUIDType>& vtDetached, std::vector<size_t>& vtStraddling)
+	{
+		// The children that overlap the range and, among them, the run that lies within it.
+		size_t nFirstIdx = getChildNodeIdx(keyBegin);
+		size_t nLastIdx = std::distance(m_vtPivots.begin(), std::lower_bound(m_vtPivots.begin(), m_vtPivots.end(), keyEnd));
+
+		size_t nBeginIdx = keyLower && !(*keyLower < keyBegin) ? 0 : std::distance(m_vtPivots.begin(), std::lower_bound(m_vtPivots.begin(), m_vtPivots.end(), keyBegin)) + 1;
+		size_t nEndIdx = keyUpper && !(keyEnd < *keyUpper) ? m_vtChildren.size() : std::distance(m_vtPivots.begin(), std::upper_bound(m_vtPivots.begin(), m_vtPivots.end(), keyEnd));
+
+		size_t nDetached = nBeginIdx < nEndIdx ? nEndIdx - nBeginIdx : 0;
+
+		if (nDetached > 0)
+		{
+			vtDetached.insert(vtDetached.end(), m_vtChildren.begin() + nBeginIdx, m_vtChildren.begin() + nEndIdx);
+			m_vtChildren.erase(m_vtChildren.begin() + nBeginIdx, m_vtChildren.begin() + nEndIdx);
+
+			// The pivot after the run is kept, the child before it takes over its keys (none), unless there is none before it.
+			size_t nPivotIdx = nBeginIdx > 0 ? nBeginIdx - 1 : 0;
+			m_vtPivots.erase(m_vtPivots.begin() + nPivotIdx, m_vtPivots.begin() + nPivotIdx + nDetached);
+		}
+
+		if (nFirstIdx < nBeginIdx || nFirstIdx >= nEndIdx)
+		{
+			vtStraddling.push_back(nFirstIdx);
+		}
+
+		if (nLastIdx != nFirstIdx && nLastIdx >= nEndIdx)
+		{
+			vtStraddling.push_back(nLastIdx - nDetached);
+		}
+
+		if constexpr (MESSAGE_BUFFER_CAPACITY > 0)
+		{
+			auto itBegin = std::lower_bound(m_vtMessages.begin(), m_vtMessages.end(), keyBegin, compareMessageKey);
+			auto itEnd = std::lower_bound(itBegin, m_vtMessages.end(), keyEnd, compareMessageKey);
+
+			m_vtMessages.erase(itBegin, itEnd);
+		}
+	}
+
+private:
+	// Moves the messages in the range to the buffer of the sibling, to where their keys go there
+#ifdef __TRACK_CACHE_FOOTPRINT__
+	inline void moveMessages(MessageIterator itBegin, MessageIterator itEnd, SelfType& oSibling, int32_t& nMemoryFootprint)
+#else //__TRACK_CACHE_FOOTPRINT__
+	inline void moveMessages(MessageIterator itBegin, MessageIterator itEnd, SelfType& oSibling)
+#endif //__TRACK_CACHE_FOOTPRINT__
+	{
+		if (itBegin == itEnd)
+		{
+			return;
+		}
+
+#ifdef __TRACK_CACHE_FOOTPRINT__
+		uint32_t nMessageContainerCapacity = m_vtMessages.capacity();
+		uint32_t nSiblingMessageContainerCapacity = oSibling.m_vtMessages.capacity();
+#endif //__TRACK_CACHE_FOOTPRINT__
+
+		auto itPosition = std::lower_bound(oSibling.m_vtMessages.begin(), oSibling.m_vtMessages.end(), (*itBegin).m_key, compareMessageKey);
+		oSibling.m_vtMessages.insert(itPosition, itBegin, itEnd);
+
+		m_vtMessages.erase(itBegin, itEnd);
+
+#ifdef __TRACK_CACHE_FOOTPRINT__
+		if (nMessageContainerCapacity != m_vtMessages.capacity())
+		{
+			nMemoryFootprint -= nMessageContainerCapacity * sizeof(Message);
+			nMemoryFootprint += m_vtMessages.capacity() * sizeof(Message);
+		}
+
+		if (nSiblingMessageContainerCapacity != oSibling.m_vtMessages.capacity())
+		{
+			nMemoryFootprint -= nSiblingMessageContainerCapacity * sizeof(Message);
+			nMemoryFootprint += oSibling.m_vtMessages.capacity() * sizeof(Message);
+		}
+#endif //__TRACK_CACHE_FOOTPRINT__
+	}
+
 public:
 #ifdef __TRACK_CACHE_FOOTPRINT__
 	inline ErrorCode insert(const KeyType& pivotKey, const ObjectUIDType& uidSibling, int32_t& nMemoryFootprint)
@@ -403,10 +928,7 @@ public:
 		m_vtChildren.insert(m_vtChildren.begin() + nChildIdx + 1, uidSibling);
 
 #ifdef __TRACK_CACHE_FOOTPRINT__
-		if constexpr (std::is_trivial<KeyType>::value &&
-			std::is_standard_layout<KeyType>::value &&
-			std::is_trivial<ValueType>::value &&
-			std::is_standard_layout<ValueType>::value)
+		if constexpr (POD_PIVOTS || SLOTTED_PIVOTS)
 		{
 			if (nPivotContainerCapacity != m_vtPivots.capacity())
 			{
@@ -422,12 +944,7 @@ public:
 		}
 		else
 		{
-			static_assert(
-				std::is_trivial<KeyType>::value &&
-				std::is_standard_layout<KeyType>::value &&
-				std::is_trivial<ValueType>::value &&
-				std::is_standard_layout<ValueType>::value,
-				"Non-POD type is provided. Kindly provide functionality to calculate size.");
+			static_assert(POD_PIVOTS || SLOTTED_PIVOTS, "Non-POD type is provided. Kindly provide functionality to calculate size.");
 		}
 #endif //__TRACK_CACHE_FOOTPRINT__
 
@@ -764,11 +1281,21 @@ public:
 		m_vtPivots.resize(nMid);
 		m_vtChildren.resize(nMid + 1);
 
+		if constexpr (MESSAGE_BUFFER_CAPACITY > 0)
+		{
+			// The messages for the keys the sibling has taken over go along with them.
+			std::shared_ptr<SelfType> ptrSiblingNode = std::get<std::shared_ptr<SelfType>>(ptrSibling->getInnerData());
+			auto itBegin = std::lower_bound(m_vtMessages.begin(), m_vtMessages.end(), pivotKeyForParent, compareMessageKey);
+
 #ifdef __TRACK_CACHE_FOOTPRINT__
-		if constexpr (std::is_trivial<KeyType>::value &&
-			std::is_standard_layout<KeyType>::value &&
-			std::is_trivial<ValueType>::value &&
-			std::is_standard_layout<ValueType>::value)
+			moveMessages(itBegin, m_vtMessages.end(), *ptrSiblingNode, nMemoryFootprint);
+#else //__TRACK_CACHE_FOOTPRINT__
+			moveMessages(itBegin, m_vtMessages.end(), *ptrSiblingNode);
+#endif //__TRACK_CACHE_FOOTPRINT__
+		}
+
+#ifdef __TRACK_CACHE_FOOTPRINT__
+		if constexpr (POD_PIVOTS || SLOTTED_PIVOTS)
 		{
 			if (nPivotContainerCapacity != m_vtPivots.capacity())
 			{
@@ -784,12 +1311,7 @@ public:
 		}
 		else
 		{
-			static_assert(
-				std::is_trivial<KeyType>::value &&
-				std::is_standard_layout<KeyType>::value &&
-				std::is_trivial<ValueType>::value &&
-				std::is_standard_layout<ValueType>::value,
-				"Non-POD type is provided. Kindly provide functionality to calculate size.");
+			static_assert(POD_PIVOTS || SLOTTED_PIVOTS, "Non-POD type is provided. Kindly provide functionality to calculate size.");
 		}
 #endif //__TRACK_CACHE_FOOTPRINT__
 
@@ -823,11 +1345,20 @@ public:
 
 		pivotKeyForParent = key;
 
+		if constexpr (MESSAGE_BUFFER_CAPACITY > 0)
+		{
+			// The sibling's messages from the new separator on are for the child that has been moved over.
+			auto itBegin = std::lower_bound(ptrLHSSibling->m_vtMessages.begin(), ptrLHSSibling->m_vtMessages.end(), key, compareMessageKey);
+
 #ifdef __TRACK_CACHE_FOOTPRINT__
-		if constexpr (std::is_trivial<KeyType>::value &&
-			std::is_standard_layout<KeyType>::value &&
-			std::is_trivial<ValueType>::value &&
-			std::is_standard_layout<ValueType>::value)
+			ptrLHSSibling->moveMessages(itBegin, ptrLHSSibling->m_vtMessages.end(), *this, nMemoryFootprint);
+#else //__TRACK_CACHE_FOOTPRINT__
+			ptrLHSSibling->moveMessages(itBegin, ptrLHSSibling->m_vtMessages.end(), *this);
+#endif //__TRACK_CACHE_FOOTPRINT__
+		}
+
+#ifdef __TRACK_CACHE_FOOTPRINT__
+		if constexpr (POD_PIVOTS || SLOTTED_PIVOTS)
 		{
 			if (nPivotContainerCapacity != m_vtPivots.capacity())
 			{
@@ -855,12 +1386,7 @@ public:
 		}
 		else
 		{
-			static_assert(
-				std::is_trivial<KeyType>::value &&
-				std::is_standard_layout<KeyType>::value &&
-				std::is_trivial<ValueType>::value &&
-				std::is_standard_layout<ValueType>::value,
-				"Non-POD type is provided. Kindly provide functionality to calculate size.");
+			static_assert(POD_PIVOTS || SLOTTED_PIVOTS, "Non-POD type is provided. Kindly provide functionality to calculate size.");
 		}
 #endif //__TRACK_CACHE_FOOTPRINT__
 	}
@@ -892,11 +1418,20 @@ public:
 
 		pivotKeyForParent = key;
 
+		if constexpr (MESSAGE_BUFFER_CAPACITY > 0)
+		{
+			// The sibling's messages below the new separator are for the child that has been moved over.
+			auto itEnd = std::lower_bound(ptrRHSSibling->m_vtMessages.begin(), ptrRHSSibling->m_vtMessages.end(), key, compareMessageKey);
+
 #ifdef __TRACK_CACHE_FOOTPRINT__
-		if constexpr (std::is_trivial<KeyType>::value &&
-			std::is_standard_layout<KeyType>::value &&
-			std::is_trivial<ValueType>::value &&
-			std::is_standard_layout<ValueType>::value)
+			ptrRHSSibling->moveMessages(ptrRHSSibling->m_vtMessages.begin(), itEnd, *this, nMemoryFootprint);
+#else //__TRACK_CACHE_FOOTPRINT__
+			ptrRHSSibling->moveMessages(ptrRHSSibling->m_vtMessages.begin(), itEnd, *this);
+#endif //__TRACK_CACHE_FOOTPRINT__
+		}
+
+#ifdef __TRACK_CACHE_FOOTPRINT__
+		if constexpr (POD_PIVOTS || SLOTTED_PIVOTS)
 		{
 			if (nPivotContainerCapacity != m_vtPivots.capacity())
 			{
@@ -924,12 +1459,7 @@ public:
 		}
 		else
 		{
-			static_assert(
-				std::is_trivial<KeyType>::value &&
-				std::is_standard_layout<KeyType>::value &&
-				std::is_trivial<ValueType>::value &&
-				std::is_standard_layout<ValueType>::value,
-				"Non-POD type is provided. Kindly provide functionality to calculate size.");
+			static_assert(POD_PIVOTS || SLOTTED_PIVOTS, "Non-POD type is provided. Kindly provide functionality to calculate size.");
 		}
 #endif //__TRACK_CACHE_FOOTPRINT__
 	}
@@ -949,11 +1479,17 @@ public:
 		m_vtPivots.insert(m_vtPivots.end(), ptrSibling->m_vtPivots.begin(), ptrSibling->m_vtPivots.end());
 		m_vtChildren.insert(m_vtChildren.end(), ptrSibling->m_vtChildren.begin(), ptrSibling->m_vtChildren.end());
 
+		if constexpr (MESSAGE_BUFFER_CAPACITY > 0)
+		{
 #ifdef __TRACK_CACHE_FOOTPRINT__
-		if constexpr (std::is_trivial<KeyType>::value &&
-			std::is_standard_layout<KeyType>::value &&
-			std::is_trivial<ValueType>::value &&
-			std::is_standard_layout<ValueType>::value)
+			ptrSibling->moveMessages(ptrSibling->m_vtMessages.begin(), ptrSibling->m_vtMessages.end(), *this, nMemoryFootprint);
+#else //__TRACK_CACHE_FOOTPRINT__
+			ptrSibling->moveMessages(ptrSibling->m_vtMessages.begin(), ptrSibling->m_vtMessages.end(), *this);
+#endif //__TRACK_CACHE_FOOTPRINT__
+		}
+
+#ifdef __TRACK_CACHE_FOOTPRINT__
+		if constexpr (POD_PIVOTS || SLOTTED_PIVOTS)
 		{
 			if (nPivotContainerCapacity != m_vtPivots.capacity())
 			{
@@ -969,12 +1505,7 @@ public:
 		}
 		else
 		{
-			static_assert(
-				std::is_trivial<KeyType>::value &&
-				std::is_standard_layout<KeyType>::value &&
-				std::is_trivial<ValueType>::value &&
-				std::is_standard_layout<ValueType>::value,
-				"Non-POD type is provided. Kindly provide functionality to calculate size.");
+			static_assert(POD_PIVOTS || SLOTTED_PIVOTS, "Non-POD type is provided. Kindly provide functionality to calculate size.");
 		}
 #endif //__TRACK_CACHE_FOOTPRINT__
 	}
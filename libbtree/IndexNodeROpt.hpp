@@ -12,6 +12,7 @@
 #include <fstream>
 #include <assert.h>
 #include "ErrorCodes.h"
+#include "NodeHeader.h"
 
 #ifdef _MSC_VER
 #define PACKED_STRUCT __pragma(pack(push, 1))
@@ -21,12 +22,11 @@
 #define END_PACKED_STRUCT _Pragma("pack(pop)")
 #endif
 
-#define MICROSEC_CHECK_FOR_FREQUENT_REQUESTS_TO_MEMORY 100
-#define ACCESSED_FREQUENCY_AS_PER_THE_TIME_CHECK 10
+#include "PromotionPolicy.hpp"
 
 using namespace std;
 
-template <typename KeyType, typename ValueType, typename ObjectUIDType, typename DataNodeType, uint8_t TYPE_UID>
+template <typename KeyType, typename ValueType, typename ObjectUIDType, typename DataNodeType, uint8_t TYPE_UID, typename PromotionPolicy = FrequencyPromotionPolicy>
 class IndexNodeROpt
 {
 private:
@@ -35,17 +35,11 @@ PACKED_STRUCT
 	struct RAWDATA
 	{
 		uint8_t nUID;
-		uint16_t nTotalPivots;
+		uint32_t nTotalPivots;
 		const KeyType* ptrPivots;
 		const ObjectUIDType* ptrChildren;
 
-		uint8_t nCounter;
-
-#ifdef _MSC_VER
-		std::chrono::time_point<std::chrono::steady_clock> tLastAccessTime;
-#else
-		std::chrono::time_point<std::chrono::system_clock> tLastAccessTime;
-#endif
+		typename PromotionPolicy::AccessState oAccess;
 
 		~RAWDATA()
 		{
@@ -59,12 +53,9 @@ PACKED_STRUCT
 		RAWDATA(const char* szData)
 		{
 			nUID = szData[0];
-			nTotalPivots = *reinterpret_cast<const uint16_t*>(&szData[1]);
-			ptrPivots = reinterpret_cast<const KeyType*>(szData + sizeof(uint8_t) + sizeof(uint16_t));
-			ptrChildren = reinterpret_cast<const ObjectUIDType*>(szData + sizeof(uint8_t) + sizeof(uint16_t) + (nTotalPivots * sizeof(KeyType)));
-
-			nCounter = 0;
-			tLastAccessTime = std::chrono::high_resolution_clock::now();
+			nTotalPivots = NodeHeader::read(szData);
+			ptrPivots = reinterpret_cast<const KeyType*>(szData + sizeof(NodeHeader));
+			ptrChildren = reinterpret_cast<const ObjectUIDType*>(szData + sizeof(NodeHeader) + (nTotalPivots * sizeof(KeyType)));
 		}
 	};
 END_PACKED_STRUCT
@@ -73,8 +64,10 @@ public:
 	// Static UID to identify the type of the node
 	static const uint8_t UID = TYPE_UID;
 
+	typedef PromotionPolicy PromotionPolicyType;
+
 private:
-	typedef IndexNodeROpt<KeyType, ValueType, ObjectUIDType, DataNodeType, UID> SelfType;
+	typedef IndexNodeROpt<KeyType, ValueType, ObjectUIDType, DataNodeType, UID, PromotionPolicy> SelfType;
 
 	typedef std::vector<KeyType>::const_iterator KeyTypeIterator;
 	typedef std::vector<ObjectUIDType>::const_iterator CacheKeyTypeIterator;
@@ -85,6 +78,14 @@ private:
 	std::vector<ObjectUIDType> m_vtChildren;
 
 	RAWDATA* m_ptrRawData = nullptr;
+
+	// The bytes reserved in the promotion budget, once promoted on the read path.
+	uint32_t m_nPromotedBytes = 0;
+
+#ifdef __TRACK_CACHE_FOOTPRINT__
+	// The footprint gained by a promotion on the read path, yet to be reported to the cache.
+	std::atomic<int32_t> m_nUnreportedFootprint = 0;
+#endif //__TRACK_CACHE_FOOTPRINT__
 public:
 	// Destructor: Clears pivot and child vectors
 	~IndexNodeROpt()
@@ -94,6 +95,11 @@ public:
 
 		delete m_ptrRawData;
 		m_ptrRawData = nullptr;
+
+		if (m_nPromotedBytes > 0)
+		{
+			PromotionPolicy::onDemote(m_nPromotedBytes);
+		}
 	}
 
 	// Default constructor
@@ -148,8 +154,7 @@ public:
 			std::is_trivial<typename ObjectUIDType::NodeUID>::value &&
 			std::is_standard_layout<typename ObjectUIDType::NodeUID>::value)
 		{
-			uint16_t nPivotCount;
-			fs.read(reinterpret_cast<char*>(&nPivotCount), sizeof(uint16_t));
+			uint32_t nPivotCount = NodeHeader::read(fs);
 
 			m_vtPivots.resize(nPivotCount);
 			m_vtChildren.resize(nPivotCount + 1);
@@ -237,15 +242,13 @@ public:
 		{
 			uidObjectType = SelfType::UID;
 
-			uint16_t nPivotCount = m_vtPivots.size();
+			uint32_t nPivotCount = m_vtPivots.size();
 
-			nDataSize = sizeof(uint8_t)					// UID
-				+ sizeof(uint16_t)						// Total keys
+			nDataSize = sizeof(NodeHeader)				// UID, version and total keys
 				+ (nPivotCount * sizeof(KeyType))			// Size of all keys
 				+ ((nPivotCount + 1) * sizeof(typename ObjectUIDType::NodeUID));	// Size of all values
 
-			fs.write(reinterpret_cast<const char*>(&uidObjectType), sizeof(uint8_t));
-			fs.write(reinterpret_cast<const char*>(&nPivotCount), sizeof(uint16_t));
+			NodeHeader::write(fs, uidObjectType, nPivotCount);
 			fs.write(reinterpret_cast<const char*>(m_vtPivots.data()), nPivotCount * sizeof(KeyType));
 			fs.write(reinterpret_cast<const char*>(m_vtChildren.data()), (nPivotCount + 1) * sizeof(typename ObjectUIDType::NodeUID));	// fix it!
 
@@ -269,6 +272,15 @@ public:
 
 	// Serializes the node's data into a char buffer
 	inline void serialize(char*& szBuffer, uint8_t& uidObjectType, uint32_t& nBufferSize) const
+	{
+		szBuffer = new char[getSize() + 1];
+		memset(szBuffer, 0, getSize() + 1);
+
+		writeToBuffer(szBuffer, uidObjectType, nBufferSize);
+	}
+
+	// Writes the node's data into a buffer of getSize() bytes, e.g. straight into a mapped region
+	inline void writeToBuffer(char* szBuffer, uint8_t& uidObjectType, uint32_t& nBufferSize) const
 	{
 		assert(m_ptrRawData == nullptr);
 
@@ -279,22 +291,15 @@ public:
 		{
 			uidObjectType = UID;
 
-			uint16_t nPivotCount = m_vtPivots.size();
+			uint32_t nPivotCount = m_vtPivots.size();
 
-			nBufferSize = sizeof(uint8_t)				// UID
-				+ sizeof(uint16_t)						// Total keys
+			nBufferSize = sizeof(NodeHeader)			// UID, version and total keys
 				+ (nPivotCount * sizeof(KeyType))			// Size of all keys
 				+ ( (nPivotCount +1)* sizeof(typename ObjectUIDType::NodeUID));	// Size of all values
 
-			szBuffer = new char[nBufferSize + 1];
-			memset(szBuffer, 0, nBufferSize + 1);
-
 			size_t nOffset = 0;
-			memcpy(szBuffer, &uidObjectType, sizeof(uint8_t));
-			nOffset += sizeof(uint8_t);
-
-			memcpy(szBuffer + nOffset, &nPivotCount, sizeof(uint16_t));
-			nOffset += sizeof(uint16_t);
+			NodeHeader::write(szBuffer, uidObjectType, nPivotCount);
+			nOffset += sizeof(NodeHeader);
 
 			size_t nKeysSize = nPivotCount * sizeof(KeyType);
 			memcpy(szBuffer + nOffset, m_vtPivots.data(), nKeysSize);
@@ -338,25 +343,32 @@ public:
 		if (m_ptrRawData == nullptr)
 			return false;
 
-		auto now = std::chrono::high_resolution_clock::now();
-		auto duration = now - m_ptrRawData->tLastAccessTime;
-
-		if (std::chrono::duration_cast<std::chrono::microseconds>(duration).count() < MICROSEC_CHECK_FOR_FREQUENT_REQUESTS_TO_MEMORY)
+		if (PromotionPolicy::onAccess(m_ptrRawData->oAccess))
 		{
-			m_ptrRawData->nCounter++;
-
-			if (m_ptrRawData->nCounter >= ACCESSED_FREQUENCY_AS_PER_THE_TIME_CHECK)
+			uint32_t nBytes = m_ptrRawData->nTotalPivots * sizeof(KeyType) + (m_ptrRawData->nTotalPivots + 1) * sizeof(ObjectUIDType);
+			if (PromotionPolicy::tryPromote(m_ptrRawData->oAccess, nBytes))
 			{
+				m_nPromotedBytes = nBytes;
+
+#ifdef __TRACK_CACHE_FOOTPRINT__
+				m_nUnreportedFootprint += moveDataToDRAM();
+#else //__TRACK_CACHE_FOOTPRINT__
 				moveDataToDRAM();
+#endif //__TRACK_CACHE_FOOTPRINT__
 				return false;
 			}
 		}
 
-		m_ptrRawData->nCounter = 0; // reset counter if more than 100 nanoseconds have passed		
-		m_ptrRawData->tLastAccessTime = now;
 		return true;
 	}
 	
+#ifdef __TRACK_CACHE_FOOTPRINT__
+	inline int32_t takeUnreportedFootprint()
+	{
+		return m_nUnreportedFootprint.exchange(0);
+	}
+#endif //__TRACK_CACHE_FOOTPRINT__
+
 	// Returns the number of keys (pivots) in the node
 	inline size_t getKeysCount() const
 	{
@@ -469,8 +481,7 @@ public:
 			std::is_standard_layout<ValueType>::value)
 		{
 			return 
-				sizeof(uint8_t)
-				+ sizeof(int16_t)
+				sizeof(NodeHeader)
 				+ (m_vtPivots.size() * sizeof(KeyType))
 				+ (m_vtChildren.size() * sizeof(typename ObjectUIDType::NodeUID));
 		}
@@ -531,8 +542,8 @@ public:
 #endif //__TRACK_CACHE_FOOTPRINT__
 	}
 
-	template <typename CacheObjectType>
-	bool updateChildrenUIDs(std::unordered_map<ObjectUIDType, std::pair<std::optional<ObjectUIDType>, std::shared_ptr<CacheObjectType>>>& mpUIDUpdates)
+	template <typename UIDUpdatesMapType>
+	bool updateChildrenUIDs(UIDUpdatesMapType& mpUIDUpdates)
 	{
 		bool bDirty = false;
 
@@ -543,11 +554,13 @@ public:
 
 		for (auto it = m_vtChildren.begin(), itend = m_vtChildren.end(); it != itend; it++)
 		{
-			if (mpUIDUpdates.find(*it) != mpUIDUpdates.end())
+			// Skip the entries whose flush (or relocation) is still in progress.
+			auto itUpdate = mpUIDUpdates.find(*it);
+			if (itUpdate != mpUIDUpdates.end() && (*itUpdate).second.first != std::nullopt)
 			{
 				ObjectUIDType uidTemp = *it;
 
-				*it = *(mpUIDUpdates[*it].first);
+				*it = *((*itUpdate).second.first);
 
 				mpUIDUpdates.erase(uidTemp);
 
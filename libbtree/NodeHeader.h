@@ -0,0 +1,108 @@
+#pragma once
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <stdexcept>
+#include <cstddef>
+
+#include "CRC32C.h"
+
+// The version of the layout the nodes are serialized in, a node written in any other one is refused on load.
+#define NODE_FORMAT_VERSION 2
+
+// Leads every serialized node. The count is that of the entries of a leaf or of the pivots of an index node, it and the sizes and the
+// offsets that follow it are 32-bit, i.e. a node is bound by the blocks it is given rather than by its format.
+// The checksum covers the whole of the node but itself, it and the size are filled in by seal once the node is serialized.
+struct NodeHeader
+{
+	uint8_t m_nUID;
+	uint8_t m_nVersion;
+	uint16_t m_nReserved;
+	uint32_t m_nCount;
+	uint32_t m_nChecksum;
+	uint32_t m_nSize;	// Of the node, the header included.
+
+	static inline void write(char* szBuffer, uint8_t nUID, uint32_t nCount)
+	{
+		NodeHeader stHeader = { nUID, NODE_FORMAT_VERSION, 0, nCount, 0, 0 };
+		memcpy(szBuffer, &stHeader, sizeof(NodeHeader));
+	}
+
+	static inline void write(std::fstream& fs, uint8_t nUID, uint32_t nCount)
+	{
+		NodeHeader stHeader = { nUID, NODE_FORMAT_VERSION, 0, nCount, 0, 0 };
+		fs.write(reinterpret_cast<const char*>(&stHeader), sizeof(NodeHeader));
+	}
+
+	// Returns the count.
+	static inline uint32_t read(const char* szBuffer)
+	{
+		NodeHeader stHeader;
+		memcpy(&stHeader, szBuffer, sizeof(NodeHeader));
+
+		validate(stHeader);
+
+		return stHeader.m_nCount;
+	}
+
+	// The UID is read off the stream by the marshaller, the rest of the header follows. Returns the count.
+	static inline uint32_t read(std::fstream& fs)
+	{
+		NodeHeader stHeader;
+		fs.read(reinterpret_cast<char*>(&stHeader) + sizeof(uint8_t), sizeof(NodeHeader) - sizeof(uint8_t));
+
+		validate(stHeader);
+
+		return stHeader.m_nCount;
+	}
+
+	// The buffer holds a node of nSize bytes.
+	static inline void seal(char* szBuffer, size_t nSize)
+	{
+		uint32_t nNodeSize = nSize;
+		memcpy(szBuffer + offsetof(NodeHeader, m_nSize), &nNodeSize, sizeof(uint32_t));
+
+		uint32_t nChecksum = getChecksum(szBuffer, nSize);
+		memcpy(szBuffer + offsetof(NodeHeader, m_nChecksum), &nChecksum, sizeof(uint32_t));
+	}
+
+	// The buffer is of nAvailable bytes, the node may take fewer of them.
+	static inline bool verify(const char* szBuffer, size_t nAvailable)
+	{
+		if (nAvailable < sizeof(NodeHeader))
+		{
+			return false;
+		}
+
+		NodeHeader stHeader;
+		memcpy(&stHeader, szBuffer, sizeof(NodeHeader));
+
+		if (stHeader.m_nSize < sizeof(NodeHeader) || stHeader.m_nSize > nAvailable)
+		{
+			return false;
+		}
+
+		return stHeader.m_nChecksum == getChecksum(szBuffer, stHeader.m_nSize);
+	}
+
+private:
+	static inline uint32_t getChecksum(const char* szBuffer, size_t nSize)
+	{
+		constexpr size_t nSkipTo = offsetof(NodeHeader, m_nChecksum) + sizeof(uint32_t);
+
+		uint32_t nChecksum = CRC32C::compute(szBuffer, offsetof(NodeHeader, m_nChecksum));
+		return CRC32C::compute(szBuffer + nSkipTo, nSize - nSkipTo, nChecksum);
+	}
+
+	static inline void validate(const NodeHeader& stHeader)
+	{
+		if (stHeader.m_nVersion != NODE_FORMAT_VERSION)
+		{
+			std::cout << "Critical State: The node is of an unsupported format version (" << static_cast<int>(stHeader.m_nVersion) << ")." << std::endl;
+			throw new std::logic_error(".....");   // TODO: critical log.
+		}
+	}
+};
+
+static_assert(sizeof(NodeHeader) == 16, "The header is to keep the data that follows it 8-byte aligned.");
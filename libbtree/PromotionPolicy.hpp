@@ -0,0 +1,236 @@
+#pragma once
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <limits>
+#include <algorithm>
+
+#ifdef _MSC_VER
+#include <intrin.h>
+#elif defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif //_MSC_VER
+
+#ifdef _MSC_VER
+#define PACKED_STRUCT __pragma(pack(push, 1))
+#define END_PACKED_STRUCT __pragma(pack(pop))
+#else
+#define PACKED_STRUCT _Pragma("pack(push, 1)")
+#define END_PACKED_STRUCT _Pragma("pack(pop)")
+#endif
+
+// Decides when a node that reads its data in place (DataNodeROpt, IndexNodeROpt) copies it to DRAM.
+// A node is promoted once it is accessed ACCESS_THRESHOLD times within WINDOW_MICROSEC of the first access of the window,
+// provided the bytes promoted so far fit in the budget. The promotions on the read path are not reported to the cache,
+// therefore, with __TRACK_CACHE_FOOTPRINT__ the budget is a share of the cache's capacity (see BPlusStore's constructor).
+
+#define PROMOTION_POLICY_WINDOW_MICROSEC 100
+#define PROMOTION_POLICY_ACCESS_THRESHOLD 10
+#define PROMOTION_POLICY_BUDGET_RATIO 0.25
+
+struct PromotionPolicyConfig
+{
+	uint32_t m_nWindowMicroSec;
+	uint8_t m_nAccessThreshold;
+	double m_dBudgetRatio;	// Of the cache's capacity.
+
+	static PromotionPolicyConfig defaults()
+	{
+		return { PROMOTION_POLICY_WINDOW_MICROSEC, PROMOTION_POLICY_ACCESS_THRESHOLD, PROMOTION_POLICY_BUDGET_RATIO };
+	}
+};
+
+struct PromotionStats
+{
+	uint64_t m_nPromotions;
+	uint64_t m_nDeniedPromotions;	// Due to the budget.
+	uint64_t m_nDemotions;			// Promoted nodes that have left the cache.
+	int64_t m_nPromotedBytes;		// Held by the promoted nodes that are still in the cache.
+};
+
+// The time stamp counter where there is one, it is an order of magnitude cheaper than querying the clock.
+class AccessClock
+{
+public:
+	static inline uint64_t now()
+	{
+#if defined(_MSC_VER) || defined(__x86_64__) || defined(__i386__)
+		return __rdtsc();
+#else
+		return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+#endif
+	}
+
+	static uint64_t getTicksPerMicroSec()
+	{
+		static const uint64_t nTicks = calibrate();
+		return nTicks;
+	}
+
+private:
+	static uint64_t calibrate()
+	{
+#if defined(_MSC_VER) || defined(__x86_64__) || defined(__i386__)
+		auto tsBegin = std::chrono::steady_clock::now();
+		uint64_t nBegin = now();
+
+		while (std::chrono::steady_clock::now() - tsBegin < std::chrono::milliseconds(1));
+
+		uint64_t nTicks = now() - nBegin;
+		uint64_t nMicroSec = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - tsBegin).count();
+
+		return std::max<uint64_t>(1, nTicks / std::max<uint64_t>(1, nMicroSec));
+#else
+		return 1000;
+#endif
+	}
+};
+
+class FrequencyPromotionPolicy
+{
+public:
+PACKED_STRUCT
+	struct AccessState
+	{
+		uint64_t m_nWindowBegin = 0;
+		uint8_t m_nCounter = 0;
+	};
+END_PACKED_STRUCT
+
+private:
+	struct State
+	{
+		std::atomic<uint64_t> m_nWindowTicks = PROMOTION_POLICY_WINDOW_MICROSEC * AccessClock::getTicksPerMicroSec();
+		std::atomic<uint8_t> m_nAccessThreshold = PROMOTION_POLICY_ACCESS_THRESHOLD;
+		std::atomic<double> m_dBudgetRatio = PROMOTION_POLICY_BUDGET_RATIO;
+		std::atomic<int64_t> m_nBudget = std::numeric_limits<int64_t>::max();	// Unbounded until a capacity is set.
+		std::atomic<size_t> m_nCacheCapacity = 0;
+
+		std::atomic<uint64_t> m_nPromotions = 0;
+		std::atomic<uint64_t> m_nDeniedPromotions = 0;
+		std::atomic<uint64_t> m_nDemotions = 0;
+		std::atomic<int64_t> m_nPromotedBytes = 0;
+	};
+
+	static State& getState()
+	{
+		static State oState;
+		return oState;
+	}
+
+public:
+	// Can be called at any time, the nodes already in the cache pick the thresholds up on their next access.
+	static void configure(const PromotionPolicyConfig& oConfig)
+	{
+		State& oState = getState();
+		oState.m_nWindowTicks = oConfig.m_nWindowMicroSec * AccessClock::getTicksPerMicroSec();
+		oState.m_nAccessThreshold = std::max<uint8_t>(1, oConfig.m_nAccessThreshold);
+		oState.m_dBudgetRatio = oConfig.m_dBudgetRatio;
+
+		if (oState.m_nCacheCapacity > 0)
+		{
+			oState.m_nBudget = (int64_t)(oState.m_nCacheCapacity * oState.m_dBudgetRatio);
+		}
+	}
+
+	static void setCacheCapacity(size_t nCapacity)
+	{
+		State& oState = getState();
+		oState.m_nCacheCapacity = nCapacity;
+		oState.m_nBudget = (int64_t)(nCapacity * oState.m_dBudgetRatio);
+	}
+
+	static PromotionStats getStats()
+	{
+		State& oState = getState();
+		return { oState.m_nPromotions, oState.m_nDeniedPromotions, oState.m_nDemotions, oState.m_nPromotedBytes };
+	}
+
+	static void resetStats()
+	{
+		State& oState = getState();
+		oState.m_nPromotions = 0;
+		oState.m_nDeniedPromotions = 0;
+		oState.m_nDemotions = 0;
+	}
+
+	// Returns true once the node is due for a promotion.
+	static inline bool onAccess(AccessState& oAccess)
+	{
+		uint64_t nNow = AccessClock::now();
+
+		if (nNow - oAccess.m_nWindowBegin < getState().m_nWindowTicks.load(std::memory_order_relaxed))
+		{
+			return ++oAccess.m_nCounter >= getState().m_nAccessThreshold.load(std::memory_order_relaxed);
+		}
+
+		oAccess.m_nWindowBegin = nNow;
+		oAccess.m_nCounter = 1;
+
+		return false;
+	}
+
+	// Reserves the bytes the promoted node is to hold, a denied node starts a new window.
+	static bool tryPromote(AccessState& oAccess, size_t nBytes)
+	{
+		State& oState = getState();
+
+		if (oState.m_nPromotedBytes.fetch_add(nBytes) + (int64_t)nBytes > oState.m_nBudget)
+		{
+			oState.m_nPromotedBytes -= nBytes;
+			oState.m_nDeniedPromotions++;
+
+			oAccess.m_nCounter = 0;
+			return false;
+		}
+
+		oState.m_nPromotions++;
+		return true;
+	}
+
+	static void onDemote(size_t nBytes)
+	{
+		getState().m_nPromotedBytes -= nBytes;
+		getState().m_nDemotions++;
+	}
+};
+
+// Always reads in place, the writes are the only ones to move the data to DRAM.
+class InPlacePromotionPolicy
+{
+public:
+	struct AccessState
+	{
+	};
+
+	static void configure(const PromotionPolicyConfig& oConfig)
+	{
+	}
+
+	static void setCacheCapacity(size_t nCapacity)
+	{
+	}
+
+	static PromotionStats getStats()
+	{
+		return { 0, 0, 0, 0 };
+	}
+
+	static void resetStats()
+	{
+	}
+
+	static inline bool onAccess(AccessState& oAccess)
+	{
+		return false;
+	}
+
+	static bool tryPromote(AccessState& oAccess, size_t nBytes)
+	{
+		return false;
+	}
+
+	static void onDemote(size_t nBytes)
+	{
+	}
+};
@@ -0,0 +1,121 @@
+#pragma once
+#include <cstdint>
+#include <cstring>
+#include <algorithm>
+#include <type_traits>
+
+// Tells the keys and values that are contiguous runs of bytes, e.g. std::string or std::vector<uint8_t>, apart from the fixed-size ones.
+template <typename T>
+inline constexpr bool IS_BYTE_STRING = requires(const T& field)
+{
+	field.data();
+	field.size();
+	requires sizeof(*field.data()) == 1;
+};
+
+// Lays a key or a value out in a slotted page, a byte string by its bytes (the length is kept in the slot) and any other type as is.
+// The byte strings are ordered as memcmp orders them, which is the order of std::string and std::vector<uint8_t>.
+template <typename T>
+struct SlottedField
+{
+	static_assert(IS_BYTE_STRING<T> || std::is_trivially_copyable<T>::value,
+		"Only the byte strings and the trivially copyable types can be kept in a slotted page.");
+
+	static inline uint32_t getSize(const T& field)
+	{
+		if constexpr (IS_BYTE_STRING<T>)
+		{
+			return field.size();
+		}
+		else
+		{
+			return sizeof(T);
+		}
+	}
+
+	static inline const char* getBytes(const T& field)
+	{
+		if constexpr (IS_BYTE_STRING<T>)
+		{
+			return reinterpret_cast<const char*>(field.data());
+		}
+		else
+		{
+			return reinterpret_cast<const char*>(&field);
+		}
+	}
+
+	static inline void write(char* szBuffer, const T& field)
+	{
+		if (getSize(field) > 0)
+		{
+			memcpy(szBuffer, getBytes(field), getSize(field));
+		}
+	}
+
+	static inline T read(const char* szBuffer, uint32_t nSize)
+	{
+		if constexpr (IS_BYTE_STRING<T>)
+		{
+			typedef std::remove_cvref_t<decltype(*std::declval<const T&>().data())> ElementType;
+
+			const ElementType* ptrBegin = reinterpret_cast<const ElementType*>(szBuffer);
+			return T(ptrBegin, ptrBegin + nSize);
+		}
+		else
+		{
+			T field;
+			memcpy(&field, szBuffer, sizeof(T));
+			return field;
+		}
+	}
+
+	// Compares the field kept in szBuffer with the given one, the result is negative, zero or positive like memcmp's.
+	static inline int compare(const char* szBuffer, uint32_t nSize, const T& field)
+	{
+		if constexpr (IS_BYTE_STRING<T>)
+		{
+			return compare(szBuffer, nSize, getBytes(field), field.size());
+		}
+		else
+		{
+			T stored = read(szBuffer, nSize);
+			return stored < field ? -1 : (field < stored ? 1 : 0);
+		}
+	}
+
+	// Compares two runs of bytes the way the byte strings are ordered.
+	static inline int compare(const char* szLHS, size_t nLHSSize, const char* szRHS, size_t nRHSSize)
+	{
+		size_t nCommon = std::min(nLHSSize, nRHSSize);
+
+		int nResult = nCommon > 0 ? memcmp(szLHS, szRHS, nCommon) : 0;
+		if (nResult != 0)
+		{
+			return nResult;
+		}
+
+		return nLHSSize < nRHSSize ? -1 : (nLHSSize > nRHSSize ? 1 : 0);
+	}
+
+	static inline size_t getCommonPrefixSize(const char* szLHS, size_t nLHSSize, const char* szRHS, size_t nRHSSize)
+	{
+		size_t nCommon = std::min(nLHSSize, nRHSSize);
+		return std::mismatch(szLHS, szLHS + nCommon, szRHS).first - szLHS;
+	}
+
+	// Returns the shortest field that is greater than lhs and not greater than rhs, given lhs < rhs, i.e. rhs truncated right after the
+	// first byte it differs from lhs in. A split pushes it up in place of rhs, as any separator between the two halves is as good as rhs.
+	static inline T getSeparator(const T& lhs, const T& rhs)
+	{
+		if constexpr (IS_BYTE_STRING<T>)
+		{
+			size_t nCommon = getCommonPrefixSize(getBytes(lhs), lhs.size(), getBytes(rhs), rhs.size());
+			return read(getBytes(rhs), std::min(nCommon + 1, rhs.size()));
+		}
+		else
+		{
+			return rhs;
+		}
+	}
+};
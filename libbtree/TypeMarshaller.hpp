@@ -1,8 +1,13 @@
 #pragma once
 #include <variant>
+#include <array>
+#include <algorithm>
 #include <typeinfo>
 #include <iostream>
 #include <fstream>
+#include <span>
+
+#include "NodeHeader.h"
 
 class TypeMarshaller
 {
@@ -23,45 +28,98 @@ public:
 			}, ptrObject);
 	}
 
+	template <typename... ValueCoreTypes>
+	static void writeToBuffer(char* szBuffer, const std::variant<std::shared_ptr<ValueCoreTypes>...>& ptrObject, uint8_t& uidObject, uint32_t& nBufferSize)
+	{
+		std::visit([&szBuffer, &uidObject, &nBufferSize](const auto& value) {
+			value->writeToBuffer(szBuffer, uidObject, nBufferSize);
+			}, ptrObject);
+	}
+
+	// Writes the object into the caller's span, i.e. a slice of the storage or of a batch buffer, in place of a buffer of its own.
+	// The object is sealed with its checksum, see verify.
+	template <typename... ValueCoreTypes>
+	static void serializeInto(std::span<char> spBuffer, const std::variant<std::shared_ptr<ValueCoreTypes>...>& ptrObject, uint8_t& uidObject, uint32_t& nBufferSize)
+	{
+		std::visit([&spBuffer, &uidObject, &nBufferSize](const auto& value) {
+#ifdef __VALIDITY_CHECK__
+			if (value->getSize() > spBuffer.size())
+			{
+				std::cout << "Critical State: The object does not fit in the span provided." << std::endl;
+				throw new std::logic_error(".....");   // TODO: critical log.
+			}
+#endif //__VALIDITY_CHECK__
+
+			value->writeToBuffer(spBuffer.data(), uidObject, nBufferSize);
+			}, ptrObject);
+
+		NodeHeader::seal(spBuffer.data(), nBufferSize);
+	}
+
+	// Whether the buffer (of nSize bytes) starts with an object as serializeInto sealed it.
+	static bool verify(const char* szBuffer, size_t nSize)
+	{
+		return NodeHeader::verify(szBuffer, nSize);
+	}
+
 	template <typename ObjectType, typename... ValueCoreTypes>
 	static void deserialize(std::fstream& fs, ObjectType& ptrObject)
 	{
-		using TypeA = typename NthType<0, ValueCoreTypes...>::type;
-		using TypeB = typename NthType<1, ValueCoreTypes...>::type;
+		static constexpr auto arrConstructors = getConstructors<ObjectType, std::fstream&, ValueCoreTypes...>();
 
 		uint8_t uidObjectType;
 		fs.read(reinterpret_cast<char*>(&uidObjectType), sizeof(uint8_t));
 
-		switch (uidObjectType)
+		if (arrConstructors[uidObjectType] == nullptr)
 		{
-		case TypeA::UID:
-			ptrObject = std::make_shared<TypeA>(fs);
-			break;
-		case TypeB::UID:
-			ptrObject = std::make_shared<TypeB>(fs);
-			break;
+			std::cout << "Deserialization request for Uknown UID." << std::endl;
+			throw new std::logic_error(".....");
 		}
+
+		arrConstructors[uidObjectType](fs, ptrObject);
 	}
 
 	template <typename ObjectType, typename... ValueCoreTypes>
 	static void deserialize(const char* szData, ObjectType& ptrObject)
 	{
-		using TypeA = typename NthType<0, ValueCoreTypes...>::type;
-		using TypeB = typename NthType<1, ValueCoreTypes...>::type;
+		static constexpr auto arrConstructors = getConstructors<ObjectType, const char*, ValueCoreTypes...>();
 
-		uint8_t uidObjectType;
+		uint8_t uidObjectType = static_cast<uint8_t>(szData[0]);
 
-		switch (szData[0])
+		if (arrConstructors[uidObjectType] == nullptr)
 		{
-		case TypeA::UID:
-			ptrObject = std::make_shared<TypeA>(szData);
-			break;
-		case TypeB::UID:
-			ptrObject = std::make_shared<TypeB>(szData);
-			break;
-		default:
 			std::cout << "Deserialization request for Uknown UID." << std::endl;
 			throw new std::logic_error(".....");
 		}
+
+		arrConstructors[uidObjectType](szData, ptrObject);
+	}
+
+private:
+	template <typename ObjectType, typename SourceType, typename ValueCoreType>
+	static void construct(SourceType source, ObjectType& ptrObject)
+	{
+		ptrObject = std::make_shared<ValueCoreType>(source);
+	}
+
+	template <typename... ValueCoreTypes>
+	static constexpr bool hasUniqueUIDs()
+	{
+		std::array<uint8_t, sizeof...(ValueCoreTypes)> arrUIDs{ static_cast<uint8_t>(ValueCoreTypes::UID)... };
+		std::sort(arrUIDs.begin(), arrUIDs.end());
+		return std::adjacent_find(arrUIDs.begin(), arrUIDs.end()) == arrUIDs.end();
+	}
+
+	// Builds the table that maps a UID to the constructor of its core type at compile time, the dispatch is then a single lookup
+	// regardless of the number of types an object can carry.
+	template <typename ObjectType, typename SourceType, typename... ValueCoreTypes>
+	static constexpr std::array<void(*)(SourceType, ObjectType&), 256> getConstructors()
+	{
+		static_assert(hasUniqueUIDs<ValueCoreTypes...>(), "The core types are to have unique UIDs.");
+
+		std::array<void(*)(SourceType, ObjectType&), 256> arrConstructors{};
+		((arrConstructors[static_cast<uint8_t>(ValueCoreTypes::UID)] = &construct<ObjectType, SourceType, ValueCoreTypes>), ...);
+
+		return arrConstructors;
 	}
 };
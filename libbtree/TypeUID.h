@@ -10,6 +10,8 @@ enum TYPE_UID
 	NVMRODATA_NODE_INT_INT = 5,
 	NVMROINDEX_NODE_INT_INT = 6,
 
+	BEPSILON_INDEX_NODE_INT_INT = 7,
+
 	DATANODEOPT_INT_INT = 100,
 	INDEXNODEOPT_INT_INT = 101,
 };
\ No newline at end of file
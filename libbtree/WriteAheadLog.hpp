@@ -0,0 +1,423 @@
+#pragma once
+#include <iostream>
+#include <string>
+#include <vector>
+#include <fstream>
+#include <cstring>
+#include <chrono>
+#include <algorithm>
+#include <filesystem>
+#include <type_traits>
+#include <stdexcept>
+#include <fcntl.h>
+
+#ifdef _MSC_VER
+#include <io.h>
+#else //_MSC_VER
+#include <unistd.h>
+#endif //_MSC_VER
+
+#ifdef __CONCURRENT__
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#endif //__CONCURRENT__
+
+#include "ErrorCodes.h"
+
+using namespace std::chrono_literals;
+
+#define WAL_DEFAULT_COMMIT_INTERVAL 2ms
+#define WAL_DEFAULT_COMMIT_BYTES (64 * 1024)
+
+// Logs the mutations of the tree and makes them durable in groups, a single fsync covers all the records appended since the last one.
+// The records are appended once the mutation is applied to the tree, the writer waits for the group to commit before returning to its caller.
+template <typename KeyType, typename ValueType>
+class WriteAheadLog
+{
+public:
+	enum Operation : uint8_t
+	{
+		Insert = 1,
+		Remove,
+		Update,		// The key holds the value from then on, whether or not it existed before.
+		RemoveRange	// The keys from the key up to the one in the payload, the latter excluded.
+	};
+
+private:
+	// The value, or the end of the range for RemoveRange.
+	static constexpr size_t PAYLOAD_SIZE = std::max(sizeof(KeyType), sizeof(ValueType));
+
+	// LSN, operation, key, payload and then a checksum over them, so that a torn tail can be told apart from a complete record.
+	static constexpr size_t RECORD_SIZE = sizeof(uint64_t) + sizeof(uint8_t) + sizeof(KeyType) + PAYLOAD_SIZE + sizeof(uint32_t);
+
+	std::string m_stFilename;
+	int m_nFile;
+
+	std::chrono::microseconds m_tsCommitInterval;
+	size_t m_nCommitBytes;
+
+	std::vector<char> m_vtBuffer;
+
+	uint64_t m_nNextLSN;
+	uint64_t m_nDurableLSN;
+
+#ifdef __CONCURRENT__
+	bool m_bStop;
+	std::thread m_threadCommit;
+
+	std::mutex m_mtxLog;
+	std::mutex m_mtxFile;	// Held for the duration of a write and the sync that follows it.
+
+	std::condition_variable m_cvCommit;
+	std::condition_variable m_cvDurable;
+#endif //__CONCURRENT__
+
+public:
+	~WriteAheadLog()
+	{
+#ifdef __CONCURRENT__
+		{
+			std::unique_lock<std::mutex> lock(m_mtxLog);
+			m_bStop = true;
+		}
+
+		m_cvCommit.notify_all();
+		m_threadCommit.join();
+#else //__CONCURRENT__
+		commit();
+#endif //__CONCURRENT__
+
+		closeFile(m_nFile);
+	}
+
+	WriteAheadLog(const std::string& stFilename, std::chrono::microseconds tsCommitInterval, size_t nCommitBytes)
+		: m_stFilename(stFilename)
+		, m_nFile(-1)
+		, m_tsCommitInterval(tsCommitInterval)
+		, m_nCommitBytes(nCommitBytes)
+		, m_nNextLSN(1)
+		, m_nDurableLSN(0)
+	{
+		// The records are of a fixed size, hence, the variable-length keys and values (see DataNodeSlotted) cannot be logged as yet.
+		static_assert(std::is_trivially_copyable<KeyType>::value && std::is_trivially_copyable<ValueType>::value);
+
+		m_nFile = openFile(m_stFilename);
+
+		m_vtBuffer.reserve(m_nCommitBytes + RECORD_SIZE);
+
+#ifdef __CONCURRENT__
+		m_bStop = false;
+		m_threadCommit = std::thread(handlerCommit, this);
+#endif //__CONCURRENT__
+	}
+
+public:
+	uint64_t append(Operation nOperation, const KeyType& key, const ValueType& value)
+	{
+		return append(nOperation, key, &value, sizeof(ValueType));
+	}
+
+	uint64_t appendRange(const KeyType& keyBegin, const KeyType& keyEnd)
+	{
+		return append(RemoveRange, keyBegin, &keyEnd, sizeof(KeyType));
+	}
+
+private:
+	uint64_t append(Operation nOperation, const KeyType& key, const void* ptrPayload, size_t nPayloadSize)
+	{
+#ifdef __CONCURRENT__
+		std::unique_lock<std::mutex> lock(m_mtxLog);
+#endif //__CONCURRENT__
+
+		uint64_t nLSN = m_nNextLSN++;
+
+		size_t nOffset = m_vtBuffer.size();
+		m_vtBuffer.resize(nOffset + RECORD_SIZE, 0);
+
+		char* szRecord = m_vtBuffer.data() + nOffset;
+		memcpy(szRecord, &nLSN, sizeof(uint64_t));
+		memcpy(szRecord + sizeof(uint64_t), &nOperation, sizeof(uint8_t));
+		memcpy(szRecord + sizeof(uint64_t) + sizeof(uint8_t), &key, sizeof(KeyType));
+		memcpy(szRecord + sizeof(uint64_t) + sizeof(uint8_t) + sizeof(KeyType), ptrPayload, nPayloadSize);
+
+		uint32_t nChecksum = getChecksum(szRecord, RECORD_SIZE - sizeof(uint32_t));
+		memcpy(szRecord + RECORD_SIZE - sizeof(uint32_t), &nChecksum, sizeof(uint32_t));
+
+#ifdef __CONCURRENT__
+		if (m_vtBuffer.size() >= m_nCommitBytes)
+		{
+			m_cvCommit.notify_one();
+		}
+#endif //__CONCURRENT__
+
+		return nLSN;
+	}
+
+public:
+	// Blocks until the record has been synced along with the rest of its group.
+	void waitForCommit(uint64_t nLSN)
+	{
+#ifdef __CONCURRENT__
+		std::unique_lock<std::mutex> lock(m_mtxLog);
+		m_cvDurable.wait(lock, [this, nLSN] { return m_nDurableLSN >= nLSN; });
+#else //__CONCURRENT__
+		if (m_nDurableLSN < nLSN)
+		{
+			commit();
+		}
+#endif //__CONCURRENT__
+	}
+
+	uint64_t getLastLSN()
+	{
+#ifdef __CONCURRENT__
+		std::unique_lock<std::mutex> lock(m_mtxLog);
+#endif //__CONCURRENT__
+
+		return m_nNextLSN - 1;
+	}
+
+	// Applies the records that come after nAfterLSN, the LSNs continue from the last complete record. fnApply is given both readings of the
+	// payload, the value and the end of the range, the operation tells which one applies.
+	// A torn record at the tail (and whatever follows it) is cut off so that the new records are not appended after it.
+	template <typename ApplyFn>
+	ErrorCode replay(uint64_t nAfterLSN, ApplyFn fnApply)
+	{
+#ifdef __CONCURRENT__
+		std::unique_lock<std::mutex> lock(m_mtxLog);
+		std::unique_lock<std::mutex> lock_file(m_mtxFile);
+#endif //__CONCURRENT__
+
+		std::ifstream fsLog(m_stFilename.c_str(), std::ios::binary);
+
+		size_t nValidBytes = 0;
+		uint64_t nLastLSN = nAfterLSN;
+
+		char szRecord[RECORD_SIZE];
+		while (fsLog.read(szRecord, RECORD_SIZE))
+		{
+			uint32_t nChecksum = 0;
+			memcpy(&nChecksum, szRecord + RECORD_SIZE - sizeof(uint32_t), sizeof(uint32_t));
+
+			if (nChecksum != getChecksum(szRecord, RECORD_SIZE - sizeof(uint32_t)))
+			{
+				break;
+			}
+
+			uint64_t nLSN = 0;
+			uint8_t nOperation = 0;
+			KeyType key, keyEnd;
+			ValueType value;
+
+			memcpy(&nLSN, szRecord, sizeof(uint64_t));
+			memcpy(&nOperation, szRecord + sizeof(uint64_t), sizeof(uint8_t));
+			memcpy(&key, szRecord + sizeof(uint64_t) + sizeof(uint8_t), sizeof(KeyType));
+			memcpy(&value, szRecord + sizeof(uint64_t) + sizeof(uint8_t) + sizeof(KeyType), sizeof(ValueType));
+			memcpy(&keyEnd, szRecord + sizeof(uint64_t) + sizeof(uint8_t) + sizeof(KeyType), sizeof(KeyType));
+
+			nValidBytes += RECORD_SIZE;
+
+			if (nLSN <= nAfterLSN)
+			{
+				continue;
+			}
+
+			ErrorCode ecResult = fnApply(static_cast<Operation>(nOperation), key, value, keyEnd);
+			if (ecResult != ErrorCode::Success)
+			{
+				return ecResult;
+			}
+
+			nLastLSN = std::max(nLastLSN, nLSN);
+		}
+
+		fsLog.close();
+
+		if (nValidBytes < std::filesystem::file_size(m_stFilename))
+		{
+			std::filesystem::resize_file(m_stFilename, nValidBytes);
+		}
+
+		m_nNextLSN = std::max(m_nNextLSN, nLastLSN + 1);
+		m_nDurableLSN = std::max(m_nDurableLSN, nLastLSN);
+
+		return ErrorCode::Success;
+	}
+
+	// Drops the records up to nLSN, they are expected to be part of a checkpoint by now.
+	void truncate(uint64_t nLSN)
+	{
+#ifdef __CONCURRENT__
+		std::unique_lock<std::mutex> lock_file(m_mtxFile);
+#endif //__CONCURRENT__
+
+		std::vector<char> vtRemaining;
+
+		std::ifstream fsLog(m_stFilename.c_str(), std::ios::binary);
+
+		char szRecord[RECORD_SIZE];
+		while (fsLog.read(szRecord, RECORD_SIZE))
+		{
+			uint64_t nRecordLSN = 0;
+			memcpy(&nRecordLSN, szRecord, sizeof(uint64_t));
+
+			if (nRecordLSN > nLSN)
+			{
+				vtRemaining.insert(vtRemaining.end(), szRecord, szRecord + RECORD_SIZE);
+			}
+		}
+
+		fsLog.close();
+
+		// The remaining records are written aside and swapped in, a crash in between leaves either of the two complete logs.
+		std::string stTempFilename = m_stFilename + ".tmp";
+		std::filesystem::remove(stTempFilename);
+
+		int nTempFile = openFile(stTempFilename);
+		writeFile(nTempFile, vtRemaining.data(), vtRemaining.size());
+		syncFile(nTempFile);
+		closeFile(nTempFile);
+
+		closeFile(m_nFile);
+		std::filesystem::rename(stTempFilename, m_stFilename);
+		m_nFile = openFile(m_stFilename);
+	}
+
+private:
+	// Expects m_mtxLog to be held, it is released for the duration of the write.
+#ifdef __CONCURRENT__
+	void commit(std::unique_lock<std::mutex>& lock)
+#else //__CONCURRENT__
+	void commit()
+#endif //__CONCURRENT__
+	{
+		if (m_vtBuffer.size() == 0)
+		{
+			return;
+		}
+
+		std::vector<char> vtBuffer;
+		vtBuffer.reserve(m_nCommitBytes + RECORD_SIZE);
+		vtBuffer.swap(m_vtBuffer);
+
+		uint64_t nLSN = m_nNextLSN - 1;
+
+#ifdef __CONCURRENT__
+		// The file lock is taken before the log lock is released, therefore, the groups reach the file in the LSN order.
+		std::unique_lock<std::mutex> lock_file(m_mtxFile);
+		lock.unlock();
+#endif //__CONCURRENT__
+
+		writeFile(m_nFile, vtBuffer.data(), vtBuffer.size());
+		syncFile(m_nFile);
+
+#ifdef __CONCURRENT__
+		lock_file.unlock();
+		lock.lock();
+#endif //__CONCURRENT__
+
+		m_nDurableLSN = std::max(m_nDurableLSN, nLSN);
+
+#ifdef __CONCURRENT__
+		m_cvDurable.notify_all();
+#endif //__CONCURRENT__
+	}
+
+#ifdef __CONCURRENT__
+	static void handlerCommit(WriteAheadLog* ptrSelf)
+	{
+		std::unique_lock<std::mutex> lock(ptrSelf->m_mtxLog);
+
+		do
+		{
+			ptrSelf->m_cvCommit.wait_for(lock, ptrSelf->m_tsCommitInterval, [ptrSelf] { return ptrSelf->m_bStop || ptrSelf->m_vtBuffer.size() >= ptrSelf->m_nCommitBytes; });
+
+			ptrSelf->commit(lock);
+
+		} while (!ptrSelf->m_bStop);
+
+		// The records appended while the last group was being synced.
+		ptrSelf->commit(lock);
+	}
+#endif //__CONCURRENT__
+
+	// FNV-1a, it only has to catch a partially written record.
+	static uint32_t getChecksum(const char* szData, size_t nLength)
+	{
+		uint32_t nHash = 2166136261u;
+		for (size_t idx = 0; idx < nLength; idx++)
+		{
+			nHash = (nHash ^ (uint8_t)szData[idx]) * 16777619u;
+		}
+
+		return nHash;
+	}
+
+	static int openFile(const std::string& stFilename)
+	{
+#ifdef _MSC_VER
+		int nFile = _open(stFilename.c_str(), _O_WRONLY | _O_CREAT | _O_APPEND | _O_BINARY, _S_IREAD | _S_IWRITE);
+#else //_MSC_VER
+		int nFile = open(stFilename.c_str(), O_WRONLY | O_CREAT | O_APPEND, 0644);
+#endif //_MSC_VER
+
+		if (nFile < 0)
+		{
+			std::cout << "Critical State: Failed to open the write-ahead log." << std::endl;
+			throw new std::logic_error(".....");   // TODO: critical log.
+		}
+
+		return nFile;
+	}
+
+	static void writeFile(int nFile, const char* szData, size_t nLength)
+	{
+		while (nLength > 0)
+		{
+#ifdef _MSC_VER
+			int nWritten = _write(nFile, szData, (unsigned int)nLength);
+#else //_MSC_VER
+			ssize_t nWritten = write(nFile, szData, nLength);
+#endif //_MSC_VER
+
+			if (nWritten <= 0)
+			{
+				std::cout << "Critical State: Failed to write to the write-ahead log." << std::endl;
+				throw new std::logic_error(".....");   // TODO: critical log.
+			}
+
+			szData += nWritten;
+			nLength -= nWritten;
+		}
+	}
+
+	static void syncFile(int nFile)
+	{
+#ifdef _MSC_VER
+		int nResult = _commit(nFile);
+#else //_MSC_VER
+		int nResult = fdatasync(nFile);
+#endif //_MSC_VER
+
+		if (nResult != 0)
+		{
+			std::cout << "Critical State: Failed to sync the write-ahead log." << std::endl;
+			throw new std::logic_error(".....");   // TODO: critical log.
+		}
+	}
+
+	static void closeFile(int nFile)
+	{
+		if (nFile < 0)
+		{
+			return;
+		}
+
+#ifdef _MSC_VER
+		_close(nFile);
+#else //_MSC_VER
+		close(nFile);
+#endif //_MSC_VER
+	}
+};
@@ -4,12 +4,32 @@
 #include <fcntl.h>
 #include <cstdlib>
 #include <cstring>
+#include <cstddef>
 #include <fstream>
 #include <variant>
 #include <cmath>
+#include <map>
+#include <numeric>
+#include <algorithm>
+#include <filesystem>
+#include <span>
+
+#ifdef _MSC_VER
+#include <io.h>
+#else //_MSC_VER
+#include <unistd.h>
+#endif //_MSC_VER
 
 #include "IFlushCallback.h"
 
+#define COMPACTION_REGION_BLOCKS 1024
+#define COMPACTION_MAX_LIVE_RATIO 0.5
+
+#define SUPERBLOCK_MAGIC 0x4244484e45444c48	// "HLDENHDB"
+#define SUPERBLOCK_FORMAT_VERSION 3
+#define SUPERBLOCK_SIZE 4096
+#define SUPERBLOCK_SLOTS 2
+
 template<
 	typename ICallback,
 	typename KeyType,
@@ -26,6 +46,26 @@ public:
 	typedef ValueType<CoreTypesMarshaller, ValueCoreTypes...> ObjectType;
 
 private:
+	// Kept at the beginning of the file, the live objects' list (the allocation state) is written after the last node of a checkpoint.
+	// Checkpoints alternate between the slots, so a torn superblock write leaves the previous checkpoint intact.
+	struct Superblock
+	{
+		uint64_t m_nMagic;
+		uint32_t m_nFormatVersion;
+		uint32_t m_nChecksum;
+		uint64_t m_nSequence;
+		uint32_t m_nDegree;
+		uint32_t m_nReserved;
+		uint64_t m_nBlockSize;
+		uint64_t m_nNextBlock;
+		uint64_t m_nLiveObjectsOffset;
+		uint64_t m_nLiveObjectsCount;
+		uint64_t m_nCheckpointLSN;	// The last log record that is reflected by this state.
+		ObjectUIDType m_uidRoot;
+	};
+
+	static_assert(sizeof(Superblock) <= SUPERBLOCK_SIZE);
+
 	size_t m_nFileSize;
 	size_t m_nBlockSize;
 
@@ -33,11 +73,32 @@ private:
 	std::fstream m_fsStorage;
 
 	size_t m_nNextBlock;
+	size_t m_nSuperblockBlocks;
+
+	// Zero until the first checkpoint, there is nothing to preserve until then.
+	uint64_t m_nCheckpointSequence;
+
+	// The blocks released since the last checkpoint may still be referred by it, they are reused only once the next checkpoint is durable.
+	std::vector<ObjectUIDType> m_vtReleasedSinceCheckpoint;
+	size_t m_nCheckpointListBlock;
+	size_t m_nCheckpointListBlocks;
 
 	ICallback* m_ptrCallback;
 
 	std::vector<bool> m_vtAllocationTable;
 
+	// Live objects ordered by their first block, and the number of live blocks per compaction region.
+	std::map<size_t, ObjectUIDType> m_mpLiveObjects;
+	std::vector<uint32_t> m_vtRegionLiveBlocks;
+
+	// Reused by the flushes, the objects are serialized into it and written out in one go, and by the loads.
+	std::vector<char> m_vtBatchBuffer;
+
+#ifdef __LAZY_CHECKSUM_VERIFICATION__
+	// Indexed by the first block of an object, set once the object has been verified and cleared when the blocks are written anew.
+	std::vector<bool> m_vtVerifiedBlocks;
+#endif //__LAZY_CHECKSUM_VERIFICATION__
+
 #ifdef __CONCURRENT__
 	bool m_bStopFlush;
 	std::thread m_threadBatchFlush;
@@ -65,14 +126,29 @@ public:
 		, m_nBlockSize(nBlockSize)
 		, m_stFilename(stFilename)
 		, m_nNextBlock(0)
+		, m_nSuperblockBlocks((SUPERBLOCK_SLOTS * SUPERBLOCK_SIZE + nBlockSize - 1) / nBlockSize)
+		, m_nCheckpointSequence(0)
+		, m_nCheckpointListBlock(0)
+		, m_nCheckpointListBlocks(0)
 		, m_ptrCallback(NULL)
 	{
 		m_vtAllocationTable.resize(nFileSize/nBlockSize, false);
+		m_vtRegionLiveBlocks.resize(m_vtAllocationTable.size() / COMPACTION_REGION_BLOCKS + 1, 0);
 
-		//m_fsStorage.rdbuf()->pubsetbuf(0, 0);
-		m_fsStorage.open(stFilename.c_str(), std::ios::out | std::ios::binary);
-		m_fsStorage.close();
+		// The first blocks are reserved for the superblock.
+		for (; m_nNextBlock < m_nSuperblockBlocks; m_nNextBlock++)
+		{
+			m_vtAllocationTable[m_nNextBlock] = true;
+		}
 
+		// The existing contents are left as they are, a store can be reopened (see open) with the same file.
+		if (!std::filesystem::exists(stFilename))
+		{
+			m_fsStorage.open(stFilename.c_str(), std::ios::out | std::ios::binary);
+			m_fsStorage.close();
+		}
+
+		//m_fsStorage.rdbuf()->pubsetbuf(0, 0);
 		m_fsStorage.open(stFilename.c_str(), std::ios::out | std::ios::binary | std::ios::in);
 		m_fsStorage.seekp(0);
 		m_fsStorage.seekg(0);
@@ -122,9 +198,25 @@ public:
 		std::unique_lock<std::shared_mutex> lock_file_storage(m_mtxStorage);
 #endif //__CONCURRENT__
 
+		size_t nObjectSize = uidObject.getPersistentObjectSize();
+		if (m_vtBatchBuffer.size() < nObjectSize)
+		{
+			m_vtBatchBuffer.resize(nObjectSize);
+		}
+
+		// Read in one go, the checksum is to be verified before anything is made of the bytes.
 		m_fsStorage.seekg(uidObject.getPersistentPointerValue());
-		std::shared_ptr<ObjectType> ptrObject = std::make_shared<ObjectType>(m_fsStorage);
-		//m_fsStorage.read(szBuffer, uidObject.m_uid.FATPOINTER.m_ptrFile.m_nSize);
+		m_fsStorage.read(m_vtBatchBuffer.data(), nObjectSize);
+
+		if (!m_fsStorage.good())
+		{
+			std::cout << "Critical State: Failed to read the object from the storage." << std::endl;
+			throw new std::logic_error(".....");   // TODO: critical log.
+		}
+
+		verifyObject(uidObject);
+
+		std::shared_ptr<ObjectType> ptrObject = std::make_shared<ObjectType>(m_vtBatchBuffer.data());
 
 #ifdef __CONCURRENT__
 		lock_file_storage.unlock();
@@ -137,18 +229,48 @@ public:
 		return ptrObject;
 	}
 
-	CacheErrorCode remove(const ObjectUIDType& ptrKey)
+	CacheErrorCode remove(const ObjectUIDType& uidObject)
 	{
+#ifdef __CONCURRENT__
+		std::unique_lock<std::shared_mutex> lock_file_storage(m_mtxStorage);
+#endif //__CONCURRENT__
+
+		releaseBlocks(uidObject);
+
 		return CacheErrorCode::Success;
 	}
 
+	CacheErrorCode remove(const std::vector<ObjectUIDType>& vtUIDs)
+	{
+#ifdef __CONCURRENT__
+		std::unique_lock<std::shared_mutex> lock_file_storage(m_mtxStorage);
+#endif //__CONCURRENT__
+
+		for (auto itUID = vtUIDs.begin(); itUID != vtUIDs.end(); itUID++)
+		{
+			releaseBlocks(*itUID);
+		}
+
+		return CacheErrorCode::Success;
+	}
+
+	// Whether the object is still stored under the UID, i.e. it has neither been rewritten elsewhere nor removed since.
+	bool isLive(const ObjectUIDType& uidObject) const
+	{
+#ifdef __CONCURRENT__
+		std::shared_lock<std::shared_mutex> lock_file_storage(m_mtxStorage);
+#endif //__CONCURRENT__
+
+		auto it = m_mpLiveObjects.find(uidObject.getPersistentPointerValue() / m_nBlockSize);
+		return it != m_mpLiveObjects.end() && (*it).second == uidObject;
+	}
+
 	CacheErrorCode addObject(ObjectUIDType uidObject, std::shared_ptr<ObjectType> ptrObject, ObjectUIDType& uidUpdated)
 	{
 		uint32_t nBufferSize = 0;
 		uint8_t uidObjectType = 0;
 		
-		//char* szBuffer = NULL;
-		//ptrObject->serialize(szBuffer, uidObjectType, nBufferSize);
+		size_t nObjectSize = ptrObject->getSize();
 
 		size_t nOffset = m_nNextBlock * m_nBlockSize;
 
@@ -156,9 +278,15 @@ public:
 		std::unique_lock<std::shared_mutex> lock_file_storage(m_mtxStorage);
 #endif //__CONCURRENT__
 
+		if (m_vtBatchBuffer.size() < nObjectSize)
+		{
+			m_vtBatchBuffer.resize(nObjectSize);
+		}
+
+		ptrObject->serializeInto(std::span<char>(m_vtBatchBuffer.data(), nObjectSize), uidObjectType, nBufferSize);
+
 		m_fsStorage.seekp(nOffset);
-		ptrObject->serialize(m_fsStorage, uidObjectType, nBufferSize);
-		//m_fsStorage.write(szBuffer, nBufferSize);
+		m_fsStorage.write(m_vtBatchBuffer.data(), nBufferSize);
 		m_fsStorage.flush();	// how about flushing after enough bytes are written?
 
 		//size_t nNextBlockOld = m_nNextBlock;
@@ -169,14 +297,17 @@ public:
 		//}
 		m_nNextBlock += std::ceil(nBufferSize / (float)m_nBlockSize);;
 
+		ObjectUIDType::createAddressFromFileOffset(uidUpdated, uidObject.getObjectType(), nOffset, nBufferSize);
+
+		releaseBlocks(uidObject);
+		allocateBlocks(uidUpdated);
+
 #ifdef __CONCURRENT__
 		lock_file_storage.unlock();
 #endif //__CONCURRENT__
 
 		//delete[] szBuffer;
 
-		ObjectUIDType::createAddressFromFileOffset(uidUpdated, uidObject.getObjectType(), nOffset, nBufferSize);
-
 		return CacheErrorCode::Success;
 	}
 
@@ -186,27 +317,534 @@ public:
 		std::unique_lock<std::shared_mutex> lock_file_storage(m_mtxStorage);
 #endif //__CONCURRENT__
 
-		for (auto it = vtObjects.begin(); it != vtObjects.end(); it++)
+		// prepareFlush lays the batch out in consecutive blocks, hence, the objects are serialized side by side into the batch buffer
+		// and each run of them is written with a single call. A gap between two objects (should there ever be one) starts a new run.
+		std::vector<size_t> vtOrder(vtObjects.size());
+		std::iota(vtOrder.begin(), vtOrder.end(), 0);
+		std::sort(vtOrder.begin(), vtOrder.end(), [&vtObjects](size_t nLHS, size_t nRHS) {
+			return (*vtObjects[nLHS].second.first).getPersistentPointerValue() < (*vtObjects[nRHS].second.first).getPersistentPointerValue();
+			});
+
+		size_t idx = 0;
+		while (idx < vtOrder.size())
 		{
-				m_fsStorage.seekp((*(*it).second.first).getPersistentPointerValue());
-				//m_fsStorage.write( vtBuffer[idx], (*(m_vtObjects[idx].uidDetails.uidObject_Updated)).m_uid.FATPOINTER.m_ptrFile.m_nSize); //2
+			size_t nRunBegin = (*vtObjects[vtOrder[idx]].second.first).getPersistentPointerValue();
+			size_t nRunEnd = nRunBegin;
+
+			size_t nRunLast = idx;
+			for (; nRunLast < vtOrder.size() && (*vtObjects[vtOrder[nRunLast]].second.first).getPersistentPointerValue() == nRunEnd; nRunLast++)
+			{
+				nRunEnd += getRequiredBlocks(*vtObjects[vtOrder[nRunLast]].second.first) * m_nBlockSize;
+			}
+
+			if (m_vtBatchBuffer.size() < nRunEnd - nRunBegin)
+			{
+				m_vtBatchBuffer.resize(nRunEnd - nRunBegin);
+			}
+
+			for (; idx < nRunLast; idx++)
+			{
+				auto& object = vtObjects[vtOrder[idx]];
 
 				uint32_t nBufferSize = 0;
 				uint8_t uidObjectType = 0;
 
-				(*it).second.second->serialize(m_fsStorage, uidObjectType, nBufferSize);
+				size_t nOffset = (*object.second.first).getPersistentPointerValue() - nRunBegin;
+				size_t nObjectSize = (*object.second.first).getPersistentObjectSize();
+
+				object.second.second->serializeInto(std::span<char>(m_vtBatchBuffer.data() + nOffset, nObjectSize), uidObjectType, nBufferSize);
+
+				// The rest of the last block is cleared, the bytes left over from an earlier batch are not to reach the file.
+				memset(m_vtBatchBuffer.data() + nOffset + nBufferSize, 0, getRequiredBlocks(*object.second.first) * m_nBlockSize - nBufferSize);
+
+				releaseBlocks(object.first);
+				allocateBlocks(*object.second.first);
+			}
+
+			m_fsStorage.seekp(nRunBegin);
+			m_fsStorage.write(m_vtBatchBuffer.data(), nRunEnd - nRunBegin);
+		}
+		m_fsStorage.flush();
+
+		// Relocated objects are written below the tail, therefore, the tail should never move backwards here.
+		m_nNextBlock = std::max(m_nNextBlock, nNewOffset);
+
+		return CacheErrorCode::Success;
+	}
+
+	// Picks the region closest to the tail (and below nRegion) that is either sparse or can be absorbed by the holes below it.
+	// Returns the live objects of the region and updates nRegion to the region picked.
+	bool getRelocationCandidates(std::vector<ObjectUIDType>& vtCandidates, size_t& nRegion)
+	{
+#ifdef __CONCURRENT__
+		std::shared_lock<std::shared_mutex> lock_file_storage(m_mtxStorage);
+#endif //__CONCURRENT__
+
+		size_t nTailRegion = std::min(std::min(m_nNextBlock / COMPACTION_REGION_BLOCKS, m_vtRegionLiveBlocks.size() - 1) + 1, nRegion);
+		size_t nLiveBlocksBelow = std::accumulate(m_vtRegionLiveBlocks.begin(), m_vtRegionLiveBlocks.begin() + nTailRegion, (size_t)0);
+
+		for (nRegion = nTailRegion; nRegion-- > 0; )
+		{
+			nLiveBlocksBelow -= m_vtRegionLiveBlocks[nRegion];
+
+			if (m_vtRegionLiveBlocks[nRegion] == 0)
+			{
+				continue;
+			}
+
+			// A dense region is still worth moving if the holes below it can absorb it, since that lets the file shrink.
+			size_t nFreeBlocksBelow = nRegion * COMPACTION_REGION_BLOCKS - nLiveBlocksBelow;
+			if (m_vtRegionLiveBlocks[nRegion] > COMPACTION_REGION_BLOCKS * COMPACTION_MAX_LIVE_RATIO && m_vtRegionLiveBlocks[nRegion] > nFreeBlocksBelow)
+			{
+				continue;
+			}
+
+			auto it = m_mpLiveObjects.lower_bound(nRegion * COMPACTION_REGION_BLOCKS);
+
+			// The preceding object may spill over into this region.
+			if (it != m_mpLiveObjects.begin() && std::prev(it)->first + getRequiredBlocks(std::prev(it)->second) > nRegion * COMPACTION_REGION_BLOCKS)
+			{
+				it--;
+			}
 
-				//vtUIDUpdates.push_back(std::move(m_vtObjects[idx].uidDetails));
+			auto itend = m_mpLiveObjects.lower_bound((nRegion + 1) * COMPACTION_REGION_BLOCKS);
 
-				//delete[] vtBuffer[idx];
+			for (; it != itend; it++)
+			{
+				vtCandidates.push_back((*it).second);
+			}
+
+			return true;
 		}
+
+		return false;
+	}
+
+	// Finds the lowest run of nMaxBlocks free blocks below nLimitBlock that does not overlap any object in vtReserved.
+	// If there is no such run then the longest one is returned.
+	bool getFreeExtent(size_t nMaxBlocks, size_t nLimitBlock, const std::vector<ObjectUIDType>& vtReserved, size_t& nBlock, size_t& nBlocks)
+	{
+#ifdef __CONCURRENT__
+		std::shared_lock<std::shared_mutex> lock_file_storage(m_mtxStorage);
+#endif //__CONCURRENT__
+
+		std::vector<std::pair<size_t, size_t>> vtReservedRanges;
+		for (auto it = vtReserved.begin(); it != vtReserved.end(); it++)
+		{
+			if ((*it).getMediaType() != ObjectUIDType::File)
+			{
+				continue;
+			}
+
+			size_t nBegin = (*it).getPersistentPointerValue() / m_nBlockSize;
+			vtReservedRanges.push_back(std::make_pair(nBegin, nBegin + getRequiredBlocks(*it)));
+		}
+		std::sort(vtReservedRanges.begin(), vtReservedRanges.end());
+
+		size_t nRunStart = 0, nRunLength = 0;
+		auto itReserved = vtReservedRanges.begin();
+
+		nBlocks = 0;
+
+		for (size_t idx = 0; idx < nLimitBlock && idx < m_vtAllocationTable.size(); idx++)
+		{
+			while (itReserved != vtReservedRanges.end() && (*itReserved).second <= idx)
+			{
+				itReserved++;
+			}
+
+			if (m_vtAllocationTable[idx] || (itReserved != vtReservedRanges.end() && (*itReserved).first <= idx))
+			{
+				nRunLength = 0;
+				continue;
+			}
+
+			if (nRunLength++ == 0)
+			{
+				nRunStart = idx;
+			}
+
+			if (nRunLength > nBlocks)
+			{
+				nBlock = nRunStart;
+				nBlocks = nRunLength;
+
+				if (nBlocks == nMaxBlocks)
+				{
+					break;
+				}
+			}
+		}
+
+		return nBlocks > 0;
+	}
+
+	// Moves the tail back to the end of the last live (or reserved) object and shrinks the file accordingly.
+	void truncate(const std::vector<ObjectUIDType>& vtReserved)
+	{
+#ifdef __CONCURRENT__
+		std::unique_lock<std::shared_mutex> lock_file_storage(m_mtxStorage);
+#endif //__CONCURRENT__
+
+		size_t nEnd = m_nSuperblockBlocks;
+		if (m_mpLiveObjects.size() > 0)
+		{
+			nEnd = std::max(nEnd, (*m_mpLiveObjects.rbegin()).first + getRequiredBlocks((*m_mpLiveObjects.rbegin()).second));
+		}
+
+		for (auto it = vtReserved.begin(); it != vtReserved.end(); it++)
+		{
+			if ((*it).getMediaType() == ObjectUIDType::File)
+			{
+				nEnd = std::max(nEnd, (*it).getPersistentPointerValue() / m_nBlockSize + getRequiredBlocks(*it));
+			}
+		}
+
+		// Nor can the last checkpoint lose any of its blocks.
+		for (auto it = m_vtReleasedSinceCheckpoint.begin(); it != m_vtReleasedSinceCheckpoint.end(); it++)
+		{
+			nEnd = std::max(nEnd, (*it).getPersistentPointerValue() / m_nBlockSize + getRequiredBlocks(*it));
+		}
+		nEnd = std::max(nEnd, m_nCheckpointListBlock + m_nCheckpointListBlocks);
+
+		if (nEnd >= m_nNextBlock)
+		{
+			return;
+		}
+
 		m_fsStorage.flush();
+		std::filesystem::resize_file(m_stFilename, nEnd * m_nBlockSize);
+
+		m_nNextBlock = nEnd;
+	}
 
-		m_nNextBlock = nNewOffset;
+	// Writes the live objects' list at the tail and then the superblock that refers to it into the slot not used by the last checkpoint.
+	// The nodes must have been flushed beforehand, uidRoot is expected to be a persistent address.
+	// Everything the superblock refers to is synced before it is written, and the superblock itself is synced before returning.
+	CacheErrorCode persistSuperblock(const ObjectUIDType& uidRoot, uint32_t nDegree, uint64_t nCheckpointLSN)
+	{
+#ifdef __CONCURRENT__
+		std::unique_lock<std::shared_mutex> lock_file_storage(m_mtxStorage);
+#endif //__CONCURRENT__
+
+		if (uidRoot.getMediaType() != ObjectUIDType::File)
+		{
+			return CacheErrorCode::Error;
+		}
+
+		Superblock stSuperblock;
+		memset(&stSuperblock, 0, sizeof(Superblock));
+
+		stSuperblock.m_nMagic = SUPERBLOCK_MAGIC;
+		stSuperblock.m_nFormatVersion = SUPERBLOCK_FORMAT_VERSION;
+		stSuperblock.m_nSequence = m_nCheckpointSequence + 1;
+		stSuperblock.m_nDegree = nDegree;
+		stSuperblock.m_nBlockSize = m_nBlockSize;
+		stSuperblock.m_nLiveObjectsOffset = m_nNextBlock * m_nBlockSize;
+		stSuperblock.m_nLiveObjectsCount = m_mpLiveObjects.size();
+		stSuperblock.m_nCheckpointLSN = nCheckpointLSN;
+		stSuperblock.m_uidRoot = uidRoot;
+
+		m_fsStorage.seekp(stSuperblock.m_nLiveObjectsOffset);
+		for (auto it = m_mpLiveObjects.begin(); it != m_mpLiveObjects.end(); it++)
+		{
+			m_fsStorage.write(reinterpret_cast<const char*>(&(*it).second), sizeof(ObjectUIDType));
+		}
+
+		// The list is not a live object, its blocks are held only for as long as this checkpoint is the last one.
+		size_t nListBlock = m_nNextBlock;
+		size_t nListBlocks = (stSuperblock.m_nLiveObjectsCount * sizeof(ObjectUIDType) + m_nBlockSize - 1) / m_nBlockSize;
+
+		m_nNextBlock += nListBlocks;
+		stSuperblock.m_nNextBlock = m_nNextBlock;
+		stSuperblock.m_nChecksum = getChecksum(stSuperblock);
+
+		syncFile();
+
+		m_fsStorage.seekp((stSuperblock.m_nSequence % SUPERBLOCK_SLOTS) * SUPERBLOCK_SIZE);
+		m_fsStorage.write(reinterpret_cast<const char*>(&stSuperblock), sizeof(Superblock));
+
+		syncFile();
+
+		m_nCheckpointSequence = stSuperblock.m_nSequence;
+
+		// The previous checkpoint is no longer reachable, so neither are the blocks released after it.
+		for (auto it = m_vtReleasedSinceCheckpoint.begin(); it != m_vtReleasedSinceCheckpoint.end(); it++)
+		{
+			markBlocks((*it).getPersistentPointerValue() / m_nBlockSize, getRequiredBlocks(*it), false);
+		}
+		m_vtReleasedSinceCheckpoint.clear();
+
+		markBlocks(m_nCheckpointListBlock, m_nCheckpointListBlocks, false);
+		markBlocks(nListBlock, nListBlocks, true);
+
+		m_nCheckpointListBlock = nListBlock;
+		m_nCheckpointListBlocks = nListBlocks;
+
+		return CacheErrorCode::Success;
+	}
+
+	// Switches to an existing file and restores the allocation state from its superblock, the nodes are not read.
+	CacheErrorCode open(const std::string& stFilename, ObjectUIDType& uidRoot, uint32_t& nDegree, uint64_t& nCheckpointLSN)
+	{
+#ifdef __CONCURRENT__
+		std::unique_lock<std::shared_mutex> lock_file_storage(m_mtxStorage);
+#endif //__CONCURRENT__
+
+		if (!std::filesystem::exists(stFilename))
+		{
+			return CacheErrorCode::KeyDoesNotExist;
+		}
+
+		std::fstream fsStorage(stFilename.c_str(), std::ios::out | std::ios::binary | std::ios::in);
+
+		// The most recent of the slots that were written completely.
+		Superblock stSuperblock;
+		memset(&stSuperblock, 0, sizeof(Superblock));
+
+		bool bFormatMismatch = false;
+		for (size_t nSlot = 0; nSlot < SUPERBLOCK_SLOTS; nSlot++)
+		{
+			Superblock stSlot;
+			memset(&stSlot, 0, sizeof(Superblock));
+
+			fsStorage.seekg(nSlot * SUPERBLOCK_SIZE);
+			fsStorage.read(reinterpret_cast<char*>(&stSlot), sizeof(Superblock));
+
+			if (!fsStorage.good())
+			{
+				fsStorage.clear();
+				continue;
+			}
+
+			if (stSlot.m_nMagic != SUPERBLOCK_MAGIC)
+			{
+				continue;
+			}
+
+			if (stSlot.m_nFormatVersion != SUPERBLOCK_FORMAT_VERSION)
+			{
+				bFormatMismatch = true;
+				continue;
+			}
+
+			if (stSlot.m_nChecksum != getChecksum(stSlot) || stSlot.m_nSequence <= stSuperblock.m_nSequence)
+			{
+				continue;
+			}
+
+			stSuperblock = stSlot;
+		}
+
+		if (stSuperblock.m_nSequence == 0)
+		{
+			return bFormatMismatch ? CacheErrorCode::Error : CacheErrorCode::KeyDoesNotExist;
+		}
+
+		if (stSuperblock.m_nBlockSize != m_nBlockSize)
+		{
+			return CacheErrorCode::Error;
+		}
+
+		std::vector<ObjectUIDType> vtLiveObjects(stSuperblock.m_nLiveObjectsCount);
+		fsStorage.seekg(stSuperblock.m_nLiveObjectsOffset);
+		fsStorage.read(reinterpret_cast<char*>(vtLiveObjects.data()), vtLiveObjects.size() * sizeof(ObjectUIDType));
+
+		if (!fsStorage.good())
+		{
+			return CacheErrorCode::Error;
+		}
+
+		m_fsStorage.close();
+		m_fsStorage = std::move(fsStorage);
+		m_stFilename = stFilename;
+
+		m_mpLiveObjects.clear();
+		std::fill(m_vtAllocationTable.begin(), m_vtAllocationTable.end(), false);
+
+#ifdef __LAZY_CHECKSUM_VERIFICATION__
+		m_vtVerifiedBlocks.clear();
+#endif //__LAZY_CHECKSUM_VERIFICATION__
+		std::fill(m_vtRegionLiveBlocks.begin(), m_vtRegionLiveBlocks.end(), 0);
+
+		for (size_t idx = 0; idx < m_nSuperblockBlocks; idx++)
+		{
+			m_vtAllocationTable[idx] = true;
+		}
+
+		for (auto it = vtLiveObjects.begin(); it != vtLiveObjects.end(); it++)
+		{
+			allocateBlocks(*it);
+		}
+
+		m_nNextBlock = stSuperblock.m_nNextBlock;
+
+		m_nCheckpointSequence = stSuperblock.m_nSequence;
+		m_vtReleasedSinceCheckpoint.clear();
+
+		m_nCheckpointListBlock = stSuperblock.m_nLiveObjectsOffset / m_nBlockSize;
+		m_nCheckpointListBlocks = (stSuperblock.m_nLiveObjectsCount * sizeof(ObjectUIDType) + m_nBlockSize - 1) / m_nBlockSize;
+		markBlocks(m_nCheckpointListBlock, m_nCheckpointListBlocks, true);
+
+		uidRoot = stSuperblock.m_uidRoot;
+		nDegree = stSuperblock.m_nDegree;
+		nCheckpointLSN = stSuperblock.m_nCheckpointLSN;
 
 		return CacheErrorCode::Success;
 	}
 
+	inline size_t getLiveBlocksCount() const
+	{
+		return std::accumulate(m_vtRegionLiveBlocks.begin(), m_vtRegionLiveBlocks.end(), (size_t)0);
+	}
+
+private:
+	inline size_t getRequiredBlocks(const ObjectUIDType& uidObject) const
+	{
+		return (uidObject.getPersistentObjectSize() + m_nBlockSize - 1) / m_nBlockSize;
+	}
+
+	// The object is expected in the batch buffer. With __LAZY_CHECKSUM_VERIFICATION__ an object is verified only the first time it is
+	// loaded after being written (or after the store is opened), the loads that follow its eviction take it as it is.
+	inline void verifyObject(const ObjectUIDType& uidObject)
+	{
+#ifdef __LAZY_CHECKSUM_VERIFICATION__
+		size_t nBlock = uidObject.getPersistentPointerValue() / m_nBlockSize;
+		if (nBlock < m_vtVerifiedBlocks.size() && m_vtVerifiedBlocks[nBlock])
+		{
+			return;
+		}
+#endif //__LAZY_CHECKSUM_VERIFICATION__
+
+		if (!CoreTypesMarshaller::verify(m_vtBatchBuffer.data(), uidObject.getPersistentObjectSize()))
+		{
+			std::cout << "Critical State: The object at offset " << uidObject.getPersistentPointerValue() << " failed the checksum verification." << std::endl;
+			throw new std::logic_error(".....");   // TODO: critical log.
+		}
+
+#ifdef __LAZY_CHECKSUM_VERIFICATION__
+		if (nBlock >= m_vtVerifiedBlocks.size())
+		{
+			m_vtVerifiedBlocks.resize(std::max(nBlock + 1, m_vtAllocationTable.size()), false);
+		}
+
+		m_vtVerifiedBlocks[nBlock] = true;
+#endif //__LAZY_CHECKSUM_VERIFICATION__
+	}
+
+	static uint32_t getChecksum(const Superblock& stSuperblock)
+	{
+		// Copied bytewise, a member-wise copy need not preserve the padding that is part of the checksum.
+		uint8_t ptrData[sizeof(Superblock)];
+		memcpy(ptrData, &stSuperblock, sizeof(Superblock));
+		memset(ptrData + offsetof(Superblock, m_nChecksum), 0, sizeof(uint32_t));
+
+		// FNV-1a, it only has to catch a partially written superblock.
+		uint32_t nHash = 2166136261u;
+		for (size_t idx = 0; idx < sizeof(Superblock); idx++)
+		{
+			nHash = (nHash ^ ptrData[idx]) * 16777619u;
+		}
+
+		return nHash;
+	}
+
+	// fstream has no means to sync, a second descriptor to the same file serves the purpose.
+	void syncFile()
+	{
+		m_fsStorage.flush();
+
+#ifdef _MSC_VER
+		int nFile = _open(m_stFilename.c_str(), _O_RDWR | _O_BINARY);
+		int nResult = nFile < 0 ? -1 : _commit(nFile);
+#else //_MSC_VER
+		int nFile = ::open(m_stFilename.c_str(), O_RDONLY);
+		int nResult = nFile < 0 ? -1 : fsync(nFile);
+#endif //_MSC_VER
+
+		if (nFile >= 0)
+		{
+#ifdef _MSC_VER
+			_close(nFile);
+#else //_MSC_VER
+			::close(nFile);
+#endif //_MSC_VER
+		}
+
+		if (!m_fsStorage.good() || nResult != 0)
+		{
+			std::cout << "Critical State: Failed to sync the storage file." << std::endl;
+			throw new std::logic_error(".....");   // TODO: critical log.
+		}
+	}
+
+	void markBlocks(size_t nBlock, size_t nBlocks, bool bAllocated)
+	{
+		if (nBlock + nBlocks > m_vtAllocationTable.size())
+		{
+			m_vtAllocationTable.resize(nBlock + nBlocks, false);
+			m_vtRegionLiveBlocks.resize(m_vtAllocationTable.size() / COMPACTION_REGION_BLOCKS + 1, 0);
+		}
+
+		std::fill(m_vtAllocationTable.begin() + nBlock, m_vtAllocationTable.begin() + nBlock + nBlocks, bAllocated);
+	}
+
+	void allocateBlocks(const ObjectUIDType& uidObject)
+	{
+		size_t nBlock = uidObject.getPersistentPointerValue() / m_nBlockSize;
+		size_t nBlocks = getRequiredBlocks(uidObject);
+
+		markBlocks(nBlock, nBlocks, true);
+
+#ifdef __LAZY_CHECKSUM_VERIFICATION__
+		if (nBlock < m_vtVerifiedBlocks.size())
+		{
+			m_vtVerifiedBlocks[nBlock] = false;
+		}
+#endif //__LAZY_CHECKSUM_VERIFICATION__
+
+		for (size_t idx = nBlock; idx < nBlock + nBlocks; idx++)
+		{
+			m_vtRegionLiveBlocks[idx / COMPACTION_REGION_BLOCKS]++;
+		}
+
+		m_mpLiveObjects[nBlock] = uidObject;
+	}
+
+	void releaseBlocks(const ObjectUIDType& uidObject)
+	{
+		if (uidObject.getMediaType() != ObjectUIDType::File)
+		{
+			return;
+		}
+
+		size_t nBlock = uidObject.getPersistentPointerValue() / m_nBlockSize;
+
+		auto it = m_mpLiveObjects.find(nBlock);
+		if (it == m_mpLiveObjects.end() || !((*it).second == uidObject))
+		{
+			return;
+		}
+
+		for (size_t idx = nBlock, idxend = nBlock + getRequiredBlocks(uidObject); idx < idxend; idx++)
+		{
+			m_vtRegionLiveBlocks[idx / COMPACTION_REGION_BLOCKS]--;
+		}
+
+		if (m_nCheckpointSequence == 0)
+		{
+			markBlocks(nBlock, getRequiredBlocks(uidObject), false);
+		}
+		else
+		{
+			m_vtReleasedSinceCheckpoint.push_back(uidObject);
+		}
+
+		m_mpLiveObjects.erase(it);
+	}
+
+public:
+
 #ifdef __CONCURRENT__
 	void performBatchFlush()
 	{
@@ -0,0 +1,112 @@
+#pragma once
+#include <cstdint>
+#include <cstddef>
+#include <vector>
+#include <algorithm>
+
+// A count-min sketch of 4-bit counters, it estimates how often a key has been accessed recently (see LRUCache's admission).
+// The counters are halved once the number of increments reaches SAMPLE_FACTOR times the width of a row, therefore,
+// the estimates favour the recent accesses and a key that was hot a while ago eventually loses its advantage.
+// The hash is expected to be well mixed (see ObjectFatUID::gethash), each row derives its own index from it.
+
+#define FREQUENCY_SKETCH_DEPTH 4
+#define FREQUENCY_SKETCH_MIN_WIDTH 64
+#define FREQUENCY_SKETCH_MAX_COUNT 15
+#define FREQUENCY_SKETCH_SAMPLE_FACTOR 10
+
+class FrequencySketch
+{
+private:
+	static constexpr uint64_t SEEDS[FREQUENCY_SKETCH_DEPTH] = { 0xc3a5c85c97cb3127ULL, 0xb492b66fbe98f273ULL, 0x9ae16a3b2f90404fULL, 0xcbf29ce484222325ULL };
+
+	// FREQUENCY_SKETCH_DEPTH rows of m_nWidth counters each, 16 counters to a word.
+	std::vector<uint64_t> m_vtTable;
+	size_t m_nWidth;
+
+	size_t m_nSampleSize;
+	size_t m_nAdditions;
+
+public:
+	FrequencySketch()
+		: m_nWidth(0)
+		, m_nSampleSize(0)
+		, m_nAdditions(0)
+	{
+		ensureCapacity(FREQUENCY_SKETCH_MIN_WIDTH);
+	}
+
+	// Widens the rows to (at least) the number of the keys tracked, the counts gathered so far are dropped.
+	void ensureCapacity(size_t nEntries)
+	{
+		if (nEntries <= m_nWidth)
+		{
+			return;
+		}
+
+		size_t nWidth = FREQUENCY_SKETCH_MIN_WIDTH;
+		while (nWidth < nEntries)
+		{
+			nWidth <<= 1;
+		}
+
+		m_nWidth = nWidth;
+		m_vtTable.assign(FREQUENCY_SKETCH_DEPTH * m_nWidth / 16, 0);
+
+		m_nSampleSize = m_nWidth * FREQUENCY_SKETCH_SAMPLE_FACTOR;
+		m_nAdditions = 0;
+	}
+
+	void increment(uint64_t nHash)
+	{
+		bool bAdded = false;
+
+		for (size_t nRow = 0; nRow < FREQUENCY_SKETCH_DEPTH; nRow++)
+		{
+			size_t nIdx = getIndex(nHash, nRow);
+			size_t nShift = (nIdx & 15) << 2;
+
+			if (((m_vtTable[nIdx >> 4] >> nShift) & 0xF) < FREQUENCY_SKETCH_MAX_COUNT)
+			{
+				m_vtTable[nIdx >> 4] += (1ULL << nShift);
+				bAdded = true;
+			}
+		}
+
+		if (bAdded && ++m_nAdditions >= m_nSampleSize)
+		{
+			age();
+		}
+	}
+
+	uint8_t estimate(uint64_t nHash) const
+	{
+		uint8_t nCount = FREQUENCY_SKETCH_MAX_COUNT;
+
+		for (size_t nRow = 0; nRow < FREQUENCY_SKETCH_DEPTH; nRow++)
+		{
+			size_t nIdx = getIndex(nHash, nRow);
+			nCount = std::min<uint8_t>(nCount, (m_vtTable[nIdx >> 4] >> ((nIdx & 15) << 2)) & 0xF);
+		}
+
+		return nCount;
+	}
+
+private:
+	inline size_t getIndex(uint64_t nHash, size_t nRow) const
+	{
+		uint64_t nValue = (nHash ^ SEEDS[nRow]) * 0x9e3779b97f4a7c15ULL;
+		nValue ^= nValue >> 32;
+
+		return nRow * m_nWidth + (nValue & (m_nWidth - 1));
+	}
+
+	void age()
+	{
+		for (uint64_t& nWord : m_vtTable)
+		{
+			nWord = (nWord >> 1) & 0x7777777777777777ULL;
+		}
+
+		m_nAdditions /= 2;
+	}
+};
@@ -1,18 +1,26 @@
 #pragma once
 #include <unordered_map>
+#include <unordered_set>
 #include "CacheErrorCodes.h"
 #include <optional>
+#include "OpenAddressingMap.hpp"
+
+// The UIDs the objects have been moved to (and the objects themselves until they are), keyed by their previous UIDs.
+template <typename ObjectUIDType, typename ObjectType>
+using UIDUpdatesMap = OpenAddressingMap<ObjectUIDType, std::pair<std::optional<ObjectUIDType>, std::shared_ptr<ObjectType>>>;
 
 template <typename ObjectUIDType, typename ObjectType>
 class IFlushCallback
 {
 public:
 	virtual void applyExistingUpdates(std::shared_ptr<ObjectType> ptrObject
-		, std::unordered_map<ObjectUIDType, std::pair<std::optional<ObjectUIDType>, std::shared_ptr<ObjectType>>>& mpUIDUpdates) = 0;
+		, UIDUpdatesMap<ObjectUIDType, ObjectType>& mpUIDUpdates) = 0;
 
 	virtual void applyExistingUpdates(std::vector<std::pair<ObjectUIDType, std::pair<std::optional<ObjectUIDType>, std::shared_ptr<ObjectType>>>>& vtObjects
-		, std::unordered_map<ObjectUIDType, std::pair<std::optional<ObjectUIDType>, std::shared_ptr<ObjectType>>>& mpUIDUpdates) = 0;
+		, UIDUpdatesMap<ObjectUIDType, ObjectType>& mpUIDUpdates) = 0;
+
+	virtual void excludeUnflushableObjects(std::vector<std::pair<ObjectUIDType, std::pair<std::optional<ObjectUIDType>, std::shared_ptr<ObjectType>>>>& vtObjects) = 0;
 
 	virtual void prepareFlush(std::vector<std::pair<ObjectUIDType, std::pair<std::optional<ObjectUIDType>, std::shared_ptr<ObjectType>>>>& vtObjects
-		, size_t nOffset, size_t& nNewOffset, size_t nBlockSize, ObjectUIDType::StorageMedia nMediaType) = 0;
+		, size_t nOffset, size_t& nNewOffset, size_t nBlockSize, ObjectUIDType::StorageMedia nMediaType, std::unordered_set<ObjectUIDType>& stRelinkedUIDs) = 0;
 };
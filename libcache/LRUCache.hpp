@@ -4,20 +4,50 @@
 #include <shared_mutex>
 #include <syncstream>
 #include <thread>
+#include <algorithm>
 #include <variant>
 #include <typeinfo>
 #include <unordered_map>
+#include <unordered_set>
+#include <limits>
 #include <queue>
+#include <deque>
 #include  <algorithm>
 #include <tuple>
 #include <condition_variable>
+#include <fstream>
+#include <filesystem>
 #include <assert.h>
 #include "IFlushCallback.h"
 #include "VariadicNthType.h"
+#include "FrequencySketch.hpp"
 
 #define FLUSH_COUNT 100
 #define MIN_CACHE_FOOTPRINT 1024 * 1024	// Safe check!
 
+// The objects read from the storage wait in a window (a share of the resident objects) before they are admitted (see admitWindowCandidates).
+#define ADMISSION_WINDOW_PERCENT 1
+#define ADMISSION_WINDOW_MIN_SIZE 16
+
+// The index nodes of the top levels can be kept out of the LRU list (see setPinningPolicy), the budget is a share of the capacity.
+#define PINNING_ALL_LEVELS 0xFF
+#define PINNING_DEFAULT_BUDGET_RATIO 0.25
+#define PINNING_BUDGET_SLACK_RATIO 0.125	// How far the splits may take the pinned nodes over the budget before they are unpinned.
+
+// The objects the tree expects to be accessed next are read in the background (see prefetch), the requests beyond the queue's size are dropped.
+#define PREFETCH_QUEUE_SIZE 64
+
+// The UIDs of the resident objects can be saved to a sidecar file and read back after a restart (see saveWarmUpList and warmUp).
+#define WARMUP_LIST_MAGIC 0x5055574d52414857	// "HWARMUWP"
+
+// The writers are paced once the dirty objects take more than the capacity, the delay grows with how far they are into the slack (see throttle).
+#define DIRTY_PACING_SLACK_RATIO 0.25
+#define DIRTY_PACING_MAX_DELAY 1ms
+#define DIRTY_PACING_MAX_ROUNDS 100
+
+// The eviction skips the objects in use at the tail, as many as this before it gives up for the round (see flushItemsToStorage).
+#define EVICTION_MAX_SKIPPED 64
+
 using namespace std::chrono_literals;
 
 template <typename ICallback, typename StorageType>
@@ -31,6 +61,9 @@ public:
 	typedef std::shared_ptr<ObjectType> ObjectTypePtr;
 
 private:
+	// The first core type is the leaf (see BPlusStore).
+	static constexpr uint8_t LEAF_UID = std::tuple_element<0, typename ObjectType::ValueCoreTypesTuple>::type::UID;
+
 	struct Item
 	{
 	public:
@@ -39,9 +72,23 @@ private:
 		std::shared_ptr<Item> m_ptrPrev;
 		std::shared_ptr<Item> m_ptrNext;
 
+		// Set while the item is in m_mpObjects under m_uidSelf, it is what a swizzled reference is validated against.
+		bool m_bResident;
+
+		// A pinned item is resident but not part of the LRU list, m_nLevel is its depth in the tree as of when it was pinned.
+		bool m_bPinned;
+		uint8_t m_nLevel;
+
+		// Set while the item is accounted in m_nDirtyCount (see trackDirty).
+		bool m_bDirtyCounted;
+
 		Item(const ObjectUIDType& uidObject, const ObjectTypePtr ptrObject)
 			: m_ptrNext(nullptr)
 			, m_ptrPrev(nullptr)
+			, m_bResident(false)
+			, m_bPinned(false)
+			, m_nLevel(0)
+			, m_bDirtyCounted(false)
 		{
 			m_uidSelf = uidObject;
 			m_ptrObject = ptrObject;
@@ -64,8 +111,23 @@ private:
 
 	int64_t m_nCacheFootprint;
 	int64_t m_nCacheCapacity;
-	std::unordered_map<ObjectUIDType, std::shared_ptr<Item>> m_mpObjects;
-	std::unordered_map<ObjectUIDType, std::pair<std::optional<ObjectUIDType>, ObjectTypePtr>> m_mpUIDUpdates;
+
+	// The number of resident objects that have been modified since they were last written, as of their last access.
+	size_t m_nDirtyCount;
+	OpenAddressingMap<ObjectUIDType, std::shared_ptr<Item>> m_mpObjects;
+	UIDUpdatesMap<ObjectUIDType, ObjectType> m_mpUIDUpdates;
+
+	// The access frequencies and the objects read from the storage that are yet to be admitted, oldest first.
+	FrequencySketch m_oSketch;
+	std::queue<std::weak_ptr<Item>> m_qWindow;
+
+	// The index nodes above m_nPinnedLevels are pinned as long as they fit in m_dPinningBudgetRatio of the capacity.
+	uint8_t m_nPinnedLevels;
+	double m_dPinningBudgetRatio;
+	size_t m_nPinnedCount;
+#ifdef __TRACK_CACHE_FOOTPRINT__
+	int64_t m_nPinnedFootprint;
+#endif //__TRACK_CACHE_FOOTPRINT__
 
 #ifdef __CONCURRENT__
 	bool m_bStop;
@@ -76,13 +138,28 @@ private:
 
 	mutable std::shared_mutex m_mtxCache;
 	mutable std::shared_mutex m_mtxStorage;
+
+	// The UIDs waiting to be read ahead, oldest first.
+	std::thread m_threadPrefetch;
+	std::mutex m_mtxPrefetch;
+	std::condition_variable m_cvPrefetch;
+	std::deque<ObjectUIDType> m_dqPrefetch;
 #endif //__CONCURRENT__
 
+	std::recursive_mutex m_mtxCompaction;
+
 public:
 	~LRUCache()
 	{
 #ifdef __CONCURRENT__
-		m_bStop = true;
+		{
+			std::unique_lock<std::mutex> lock_prefetch(m_mtxPrefetch);
+			m_bStop = true;
+		}
+
+		m_cvPrefetch.notify_all();
+		m_threadPrefetch.join();
+
 		m_threadCacheFlush.join();
 #endif //__CONCURRENT__
 
@@ -102,8 +179,15 @@ public:
 	LRUCache(size_t nCapacity, StorageArgs... args)
 		: m_nCacheCapacity(nCapacity)
 		, m_nCacheFootprint(0)
+		, m_nDirtyCount(0)
 		, m_ptrHead(nullptr)
 		, m_ptrTail(nullptr)
+		, m_nPinnedLevels(0)
+		, m_dPinningBudgetRatio(PINNING_DEFAULT_BUDGET_RATIO)
+		, m_nPinnedCount(0)
+#ifdef __TRACK_CACHE_FOOTPRINT__
+		, m_nPinnedFootprint(0)
+#endif //__TRACK_CACHE_FOOTPRINT__
 	{
 #ifdef __TRACK_CACHE_FOOTPRINT__
 		m_nCacheCapacity = m_nCacheCapacity < MIN_CACHE_FOOTPRINT ? MIN_CACHE_FOOTPRINT : m_nCacheCapacity;
@@ -114,6 +198,7 @@ public:
 #ifdef __CONCURRENT__
 		m_bStop = false;
 		m_threadCacheFlush = std::thread(handlerCacheFlush, this);
+		m_threadPrefetch = std::thread(handlerPrefetch, this);
 #endif //__CONCURRENT__
 	}
 
@@ -147,28 +232,85 @@ public:
 		std::unique_lock<std::shared_mutex> lock_cache(m_mtxCache);
 #endif //__CONCURRENT__
 
-		auto it = m_mpObjects.find(uidObject);
-		if (it != m_mpObjects.end()) 
+		if (drop(uidObject))
 		{
+			m_ptrStorage->remove(uidObject);
+			return CacheErrorCode::Success;
+		}
 
-#ifdef __TRACK_CACHE_FOOTPRINT__
-			m_nCacheFootprint -= (*it).second->m_ptrObject->getMemoryFootprint();
+		m_ptrStorage->remove(uidObject);
 
-			assert(m_nCacheFootprint >= 0);
-#endif //__TRACK_CACHE_FOOTPRINT__
+		return CacheErrorCode::KeyDoesNotExist;
+	}
 
-			removeFromLRU((*it).second);
-			m_mpObjects.erase(((*it).first));
-			
-			// TODO:
-			// m_ptrStorage->remove(uidObject);
-			return CacheErrorCode::Success;
+	// Removes the objects of a detached subtree in one go, their UIDs are the ones their parents last knew, hence they are first followed
+	// to the current ones alike getObject does. The storage releases the blocks under a single lock where it supports it.
+	CacheErrorCode remove(const std::vector<ObjectUIDType>& vtUIDs)
+	{
+		std::vector<ObjectUIDType> vtCurrentUIDs;
+		vtCurrentUIDs.reserve(vtUIDs.size());
+
+		{
+#ifdef __CONCURRENT__
+			std::unique_lock<std::shared_mutex> lock_storage(m_mtxStorage);
+#endif //__CONCURRENT__
+
+			for (auto itUID = vtUIDs.begin(); itUID != vtUIDs.end(); itUID++)
+			{
+				ObjectUIDType uidTemp = *itUID;
+
+				while (m_mpUIDUpdates.find(uidTemp) != m_mpUIDUpdates.end())
+				{
+#ifdef __CONCURRENT__
+					m_cvUIDUpdates.wait(lock_storage, [&]
+						{
+							auto it = m_mpUIDUpdates.find(uidTemp);
+							return it == m_mpUIDUpdates.end() || (*it).second.first != std::nullopt;
+						});
+
+					if (m_mpUIDUpdates.find(uidTemp) == m_mpUIDUpdates.end())
+					{
+						continue;
+					}
+#endif //__CONCURRENT__
+
+					std::optional<ObjectUIDType> uidUpdated = m_mpUIDUpdates[uidTemp].first;
+
+#ifdef __VALIDITY_CHECK__
+					assert(uidUpdated != std::nullopt);
+#endif //__VALIDITY_CHECK__
+
+					// No parent is left to pick the update up.
+					m_mpUIDUpdates.erase(uidTemp);
+					uidTemp = *uidUpdated;
+				}
+
+				vtCurrentUIDs.push_back(uidTemp);
+			}
 		}
 
-		// TODO:
-		// m_ptrStorage->remove(uidObject);
+#ifdef __CONCURRENT__
+		std::unique_lock<std::shared_mutex> lock_cache(m_mtxCache);
+#endif //__CONCURRENT__
+
+		for (auto itUID = vtCurrentUIDs.begin(); itUID != vtCurrentUIDs.end(); itUID++)
+		{
+			drop(*itUID);
+		}
 
-		return CacheErrorCode::KeyDoesNotExist;
+		if constexpr (requires { m_ptrStorage->remove(vtCurrentUIDs); })
+		{
+			m_ptrStorage->remove(vtCurrentUIDs);
+		}
+		else
+		{
+			for (auto itUID = vtCurrentUIDs.begin(); itUID != vtCurrentUIDs.end(); itUID++)
+			{
+				m_ptrStorage->remove(*itUID);
+			}
+		}
+
+		return CacheErrorCode::Success;
 	}
 
 	CacheErrorCode getObject(const ObjectUIDType& uidObject, ObjectTypePtr& ptrObject, std::optional<ObjectUIDType>& uidUpdated)
@@ -193,20 +335,30 @@ public:
 
 		ObjectUIDType uidTemp = uidObject;
 
-		if (m_mpUIDUpdates.find(uidObject) != m_mpUIDUpdates.end())
+		// An object relocated by the compactor may have been moved again before its parent picked up the first update.
+		while (m_mpUIDUpdates.find(uidTemp) != m_mpUIDUpdates.end())
 		{
 #ifdef __CONCURRENT__
-			std::optional< ObjectUIDType >& _condition = m_mpUIDUpdates[uidObject].first;
-			m_cvUIDUpdates.wait(lock_storage, [&_condition] { return _condition != std::nullopt; });			
+			// The entries move around as the map changes, the predicate looks the key up afresh.
+			m_cvUIDUpdates.wait(lock_storage, [&]
+				{
+					auto it = m_mpUIDUpdates.find(uidTemp);
+					return it == m_mpUIDUpdates.end() || (*it).second.first != std::nullopt;
+				});
+
+			if (m_mpUIDUpdates.find(uidTemp) == m_mpUIDUpdates.end())
+			{
+				continue;
+			}
 #endif //__CONCURRENT__
 
-			uidUpdated = m_mpUIDUpdates[uidObject].first;
+			uidUpdated = m_mpUIDUpdates[uidTemp].first;
 
 #ifdef __VALIDITY_CHECK__
 			assert(uidUpdated != std::nullopt);
 #endif //__VALIDITY_CHECK__
 
-			m_mpUIDUpdates.erase(uidObject);
+			m_mpUIDUpdates.erase(uidTemp);
 			uidTemp = *uidUpdated;
 		}
 
@@ -214,6 +366,27 @@ public:
 		lock_storage.unlock();
 #endif //__CONCURRENT__
 
+		// The objects relocated by the compactor stay resident under their new UIDs.
+		if (uidUpdated != std::nullopt)
+		{
+#ifdef __CONCURRENT__
+			lock_cache.lock();
+#endif //__CONCURRENT__
+
+			if (m_mpObjects.find(uidTemp) != m_mpObjects.end())
+			{
+				std::shared_ptr<Item> ptrItem = m_mpObjects[uidTemp];
+				moveToFront(ptrItem);
+				ptrObject = ptrItem->m_ptrObject;
+
+				return CacheErrorCode::Success;
+			}
+
+#ifdef __CONCURRENT__
+			lock_cache.unlock();
+#endif //__CONCURRENT__
+		}
+
 		ptrObject = m_ptrStorage->getObject(uidTemp);
 
 		if (ptrObject != nullptr)
@@ -223,23 +396,14 @@ public:
 #ifdef __CONCURRENT__
 			std::unique_lock<std::shared_mutex> re_lock_cache(m_mtxCache);
 
+			// The prefetcher may have read the object in the meantime (see prefetch), the resident copy is the one to use.
 			if (m_mpObjects.find(uidTemp) != m_mpObjects.end())
 			{
-				std::cout << "Some other thread has also accessed the object." << std::endl;
-				throw new std::logic_error("...");
-/*
-#ifdef __TRACK_CACHE_FOOTPRINT__
-				m_nCacheFootprint -= m_mpObjects[uidTemp]->m_ptrObject->getMemoryFootprint();
-
-				assert(m_nCacheFootprint >= 0);
-
-				m_nCacheFootprint += ptrObject->getMemoryFootprint();
-#endif //__TRACK_CACHE_FOOTPRINT__
-
-				std::shared_ptr<Item> ptrItem = m_mpObjects[uidTemp];
+				ptrItem = m_mpObjects[uidTemp];
 				moveToFront(ptrItem);
+				ptrObject = ptrItem->m_ptrObject;
+
 				return CacheErrorCode::Success;
-*/
 			}
 #endif //__CONCURRENT__
 
@@ -248,6 +412,8 @@ public:
 #endif //__TRACK_CACHE_FOOTPRINT__
 
 			m_mpObjects[ptrItem->m_uidSelf] = ptrItem;
+			ptrItem->m_bResident = true;
+			m_qWindow.push(ptrItem);
 
 			if (!m_ptrHead)
 			{
@@ -271,23 +437,138 @@ public:
 		return CacheErrorCode::Error;
 	}
 
-	// This method reorders the recently access objects. 
+	// Resolves a child through the reference its parent keeps next to the child's UID (see IndexNode::getSwizzledChildAt).
+	// While the object stays resident under the same UID the lookup in m_mpObjects is skipped, and so is the LRU update, which is
+	// left to the reorder that follows every operation. Otherwise the object is looked up as usual and the reference is (re)swizzled.
+	CacheErrorCode getObject(const ObjectUIDType& uidObject, std::weak_ptr<void>& wptrSwizzled, ObjectTypePtr& ptrObject, std::optional<ObjectUIDType>& uidUpdated)
+	{
+		{
+#ifdef __CONCURRENT__
+			// The items leave m_mpObjects under the exclusive lock only.
+			std::shared_lock<std::shared_mutex> lock_cache(m_mtxCache);
+#endif //__CONCURRENT__
+
+			std::shared_ptr<Item> ptrItem = std::static_pointer_cast<Item>(wptrSwizzled.lock());
+			if (ptrItem != nullptr && ptrItem->m_bResident && ptrItem->m_uidSelf == uidObject)
+			{
+				ptrObject = ptrItem->m_ptrObject;
+				return CacheErrorCode::Success;
+			}
+		}
+
+		CacheErrorCode ecResult = getObject(uidObject, ptrObject, uidUpdated);
+		if (ecResult != CacheErrorCode::Success)
+		{
+			return ecResult;
+		}
+
+#ifdef __CONCURRENT__
+		std::shared_lock<std::shared_mutex> lock_cache(m_mtxCache);
+#endif //__CONCURRENT__
+
+		auto it = m_mpObjects.find(uidUpdated != std::nullopt ? *uidUpdated : uidObject);
+		if (it != m_mpObjects.end() && (*it).second->m_ptrObject == ptrObject)
+		{
+			wptrSwizzled = (*it).second;
+		}
+
+		return ecResult;
+	}
+
+#ifdef __CONCURRENT__
+	// Queues the objects to be read ahead by the prefetcher (see handlerPrefetch), the caller need not wait for the reads.
+	// The ones that are resident by the time they are read are skipped, and so are the ones that are no longer stored under the UIDs.
+	void prefetch(const std::vector<ObjectUIDType>& vtUIDs)
+	{
+		{
+			std::unique_lock<std::mutex> lock_prefetch(m_mtxPrefetch);
+
+			for (auto it = vtUIDs.begin(); it != vtUIDs.end() && m_dqPrefetch.size() < PREFETCH_QUEUE_SIZE; it++)
+			{
+				m_dqPrefetch.push_back(*it);
+			}
+		}
+
+		m_cvPrefetch.notify_one();
+	}
+
+	// Delays a writer in proportion to how far the dirty objects are over the capacity, similar to the dirty ratio of a page cache.
+	// The eviction has to write the dirty objects before it can drop them, hence the writers are slowed down to the pace it keeps up with.
+	// Past DIRTY_PACING_SLACK_RATIO over the capacity the writer waits for the eviction, for at most DIRTY_PACING_MAX_ROUNDS delays.
+	void throttle()
+	{
+		for (size_t nRound = 0; nRound < DIRTY_PACING_MAX_ROUNDS; nRound++)
+		{
+			double dOvershoot = 0;
+
+			{
+				std::shared_lock<std::shared_mutex> lock_cache(m_mtxCache);
+				dOvershoot = (double)((int64_t)getDirtyFootprint() - m_nCacheCapacity) / (m_nCacheCapacity * DIRTY_PACING_SLACK_RATIO);
+			}
+
+			if (dOvershoot <= 0)
+			{
+				return;
+			}
+
+			if (dOvershoot < 1)
+			{
+				std::this_thread::sleep_for(std::chrono::duration_cast<std::chrono::microseconds>(DIRTY_PACING_MAX_DELAY * dOvershoot));
+				return;
+			}
+
+			std::this_thread::sleep_for(DIRTY_PACING_MAX_DELAY);
+		}
+	}
+#endif //__CONCURRENT__
+
+	// This method reorders the recently access objects.
 	// It is necessary to ensure that the objects are flushed in order otherwise a child object (data node) may preceed its parent (internal node).
-	CacheErrorCode reorder(std::vector<std::pair<ObjectUIDType, ObjectTypePtr>>& vt, bool bEnsure = true)
+	// An access path starts at the root and the siblings added by a split (or a merge) follow their counterparts with a null object,
+	// the nodes along it are pinned (see updatePins). Any other list, e.g. a level order walk, is to be passed with bAccessPath unset.
+	CacheErrorCode reorder(std::vector<std::pair<ObjectUIDType, ObjectTypePtr>>& vt, bool bEnsure = true, bool bAccessPath = true)
 	{
 		// TODO: Need optimization.
 #ifdef __CONCURRENT__
 		std::unique_lock<std::shared_mutex> lock_cache(m_mtxCache);
 #endif //__CONCURRENT__
 
+		m_oSketch.ensureCapacity(m_mpObjects.size());
+
+		if (bAccessPath && (m_nPinnedLevels > 0 || m_nPinnedCount > 0))
+		{
+			updatePins(vt);
+		}
+
 		while (vt.size() > 0)
 		{
 			std::pair<ObjectUIDType, ObjectTypePtr> prNode = vt.back();
 
+			std::shared_ptr<Item> ptrItem = nullptr;
+
+#ifdef __TRACK_CACHE_FOOTPRINT__
+			// The accessed objects are still referenced here, therefore, none of them could have been evicted in the meantime.
+			if (prNode.second != nullptr)
+			{
+				m_nCacheFootprint += prNode.second->takeUnreportedFootprint();
+			}
+#endif //__TRACK_CACHE_FOOTPRINT__
+
 			if (m_mpObjects.find(prNode.first) != m_mpObjects.end())
 			{
-				std::shared_ptr<Item> ptrItem = m_mpObjects[prNode.first];
+				ptrItem = m_mpObjects[prNode.first];
 				moveToFront(ptrItem);	//TODO: How about passing whole list together and re-arrange the list?
+				m_oSketch.increment(std::hash<ObjectUIDType>()(ptrItem->m_uidSelf));
+				trackDirty(ptrItem);
+			}
+			else if (findRelocatedItem(prNode.first, ptrItem))
+			{
+				if (ptrItem != nullptr)
+				{
+					moveToFront(ptrItem);
+					m_oSketch.increment(std::hash<ObjectUIDType>()(ptrItem->m_uidSelf));
+					trackDirty(ptrItem);
+				}
 			}
 			else
 			{
@@ -317,10 +598,22 @@ public:
 		{
 			std::pair<ObjectUIDType, ObjectTypePtr> prObject = vtObjects.back();
 
+			std::shared_ptr<Item> ptrItem = nullptr;
+
 			if (m_mpObjects.find(prObject.first) != m_mpObjects.end())
 			{
 				vtItems.emplace_back(m_mpObjects[prObject.first]);
 			}
+			else if (findRelocatedItem(prObject.first, ptrItem))
+			{
+				_test--;
+
+				if (ptrItem != nullptr)
+				{
+					vtItems.emplace_back(ptrItem);
+					_test++;
+				}
+			}
 
 			vtObjects.pop_back();
 		}
@@ -329,9 +622,20 @@ public:
 		{
 			assert(_test == vtItems.size());
 		}
+
+		m_oSketch.ensureCapacity(m_mpObjects.size());
+		for (const std::shared_ptr<Item>& ptrItem : vtItems)
+		{
+			m_oSketch.increment(std::hash<ObjectUIDType>()(ptrItem->m_uidSelf));
+			trackDirty(ptrItem);
+		}
+
+		// The pinned objects are not part of the list.
+		std::erase_if(vtItems, [](const std::shared_ptr<Item>& ptrItem) { return ptrItem->m_bPinned; });
+
 		if (vtItems.size() > 1)
 			moveToFront(vtItems);
-		else
+		else if (vtItems.size() == 1)
 			moveToFront(vtItems[0]);
 
 		return CacheErrorCode::Success;
@@ -484,6 +788,8 @@ public:
 		else
 		{
 			m_mpObjects[ptrItem->m_uidSelf] = ptrItem;
+			ptrItem->m_bResident = true;
+			trackDirty(ptrItem);
 
 #ifdef __TRACK_CACHE_FOOTPRINT__
 			m_nCacheFootprint += ptrStorageObject->getMemoryFootprint();
@@ -536,6 +842,8 @@ public:
 		else
 		{
 			m_mpObjects[ptrItem->m_uidSelf] = ptrItem;
+			ptrItem->m_bResident = true;
+			trackDirty(ptrItem);
 
 #ifdef __TRACK_CACHE_FOOTPRINT__
 			m_nCacheFootprint += ptrStorageObject->getMemoryFootprint();
@@ -587,6 +895,8 @@ public:
 		else
 		{
 			m_mpObjects[&ptrItem->m_uidSelf] = ptrItem;
+			ptrItem->m_bResident = true;
+			trackDirty(ptrItem);
 
 #ifdef __TRACK_CACHE_FOOTPRINT__
 			m_nCacheFootprint += ptrStorageObject->getMemoryFootprint();
@@ -614,6 +924,10 @@ public:
 
 	void getCacheState(size_t& nObjectsLinkedList, size_t& nObjectsInMap)
 	{
+#ifdef __CONCURRENT__
+		std::unique_lock<std::shared_mutex> lock_cache(m_mtxCache);
+#endif //__CONCURRENT__
+
 		nObjectsLinkedList = 0;
 		std::shared_ptr<Item> ptrItem = m_ptrHead;
 
@@ -623,83 +937,1061 @@ public:
 			ptrItem = ptrItem->m_ptrNext;
 		} 
 
-		nObjectsInMap = m_mpObjects.size();
+		// The pinned objects are linked back as soon as they are unpinned.
+		nObjectsLinkedList += m_nPinnedCount;
+
+		nObjectsInMap = m_mpObjects.size();
+	}
+
+	// The dirty objects as of their last access, nDirtyFootprint is in the unit of the capacity, i.e. an estimate from the average footprint when it is tracked.
+	void getDirtyState(size_t& nDirtyObjects, size_t& nDirtyFootprint)
+	{
+#ifdef __CONCURRENT__
+		std::shared_lock<std::shared_mutex> lock_cache(m_mtxCache);
+#endif //__CONCURRENT__
+
+		nDirtyObjects = m_nDirtyCount;
+		nDirtyFootprint = getDirtyFootprint();
+	}
+
+	size_t getCapacity() const
+	{
+		return m_nCacheCapacity;
+	}
+
+	// Keeps the index nodes of the top nLevels levels (PINNING_ALL_LEVELS for all of them) resident and out of the LRU list, as long as
+	// they take at most dBudgetRatio of the capacity. A pinned node is not relinked on a hit, therefore, a lookup reads at most the leaf.
+	// The nodes are pinned as the operations access them, the ones pinned so far are unpinned here. Zero levels disables the pinning.
+	void setPinningPolicy(uint8_t nLevels, double dBudgetRatio = PINNING_DEFAULT_BUDGET_RATIO)
+	{
+#ifdef __CONCURRENT__
+		std::unique_lock<std::shared_mutex> lock_cache(m_mtxCache);
+#endif //__CONCURRENT__
+
+		unpinAll();
+
+		m_nPinnedLevels = nLevels;
+		m_dPinningBudgetRatio = std::clamp(dBudgetRatio, 0.0, 1.0);
+	}
+
+	// Relinks the children of the object that have been flushed (or relocated) since it was loaded.
+	void applyExistingUpdates(ObjectTypePtr ptrObject)
+	{
+#ifdef __CONCURRENT__
+		std::unique_lock<std::shared_mutex> lock_storage(m_mtxStorage);
+#endif //__CONCURRENT__
+
+		if (m_mpUIDUpdates.size() > 0)
+		{
+			m_ptrCallback->applyExistingUpdates(ptrObject, m_mpUIDUpdates);
+		}
+	}
+
+	void getStorageState(size_t& nUsedBlocks, size_t& nLiveBlocks)
+	{
+		nUsedBlocks = m_ptrStorage->getNextAvailableBlockOffset();
+		nLiveBlocks = m_ptrStorage->getLiveBlocksCount();
+	}
+
+	CacheErrorCode flush()
+	{
+		flushDataItemsToStorage();
+		//presistCurrentCacheState();
+
+		return CacheErrorCode::Success;
+	}
+
+	// Writes the dirty objects that are not in use to new locations (copy-on-write), the objects stay resident under their new UIDs.
+	// The blocks they occupied are not reused until the next checkpoint, therefore, the last checkpoint remains intact on the storage.
+	// Returns the number of objects written.
+	size_t writeBackDirtyItems()
+	{
+		std::unique_lock<std::recursive_mutex> lock_compaction(m_mtxCompaction);
+
+		std::vector<std::pair<ObjectUIDType, std::pair<std::optional<ObjectUIDType>, std::shared_ptr<ObjectType>>>> vtObjects;
+		std::unordered_map<ObjectUIDType, std::shared_ptr<Item>> mpItems;
+
+#ifdef __CONCURRENT__
+		std::unique_lock<std::shared_mutex> lock_cache(m_mtxCache);
+		std::unique_lock<std::shared_mutex> lock_storage(m_mtxStorage);
+#endif //__CONCURRENT__
+
+		// The objects in use are left out, the parents that are not part of the batch pick up the new UIDs the usual way.
+		for (auto itObject = m_mpObjects.begin(); itObject != m_mpObjects.end(); itObject++)
+		{
+			if ((*itObject).second->m_ptrObject.use_count() > 1 || !(*itObject).second->m_ptrObject->tryLockObject())
+			{
+				continue;
+			}
+
+			if (m_mpUIDUpdates.size() > 0)
+			{
+				m_ptrCallback->applyExistingUpdates((*itObject).second->m_ptrObject, m_mpUIDUpdates);
+			}
+
+			(*itObject).second->m_ptrObject->unlockObject();
+
+			mpItems[(*itObject).first] = (*itObject).second;
+			vtObjects.push_back(std::make_pair((*itObject).first, std::make_pair(std::nullopt, (*itObject).second->m_ptrObject)));
+		}
+
+		// A parent can't be written ahead of a new child that is still in use.
+		m_ptrCallback->excludeUnflushableObjects(vtObjects);
+
+		size_t nNewOffset = 0;
+		std::unordered_set<ObjectUIDType> stRelinkedUIDs;
+		m_ptrCallback->prepareFlush(vtObjects, m_ptrStorage->getNextAvailableBlockOffset(), nNewOffset, m_ptrStorage->getBlockSize(), m_ptrStorage->getStorageType(), stRelinkedUIDs);
+
+		if (vtObjects.size() == 0)
+		{
+			return 0;
+		}
+
+		// Readers of the objects being written wait on m_cvUIDUpdates until the new UIDs are available.
+		for (auto itObject = vtObjects.begin(); itObject != vtObjects.end(); itObject++)
+		{
+			if (m_mpUIDUpdates.find((*itObject).first) != m_mpUIDUpdates.end())
+			{
+				std::cout << "Critical State: Can't proceed with the writeBackDirtyItems operations as object already exists in Updates' list." << std::endl;
+				throw new std::logic_error(".....");   // TODO: critical log.
+			}
+
+			mpItems[(*itObject).first]->m_bResident = false;
+			m_mpObjects.erase((*itObject).first);
+			m_mpUIDUpdates[(*itObject).first] = std::make_pair(std::nullopt, nullptr);
+		}
+
+#ifdef __CONCURRENT__
+		lock_storage.unlock();
+		lock_cache.unlock();
+#endif //__CONCURRENT__
+
+		m_ptrStorage->addObjects(vtObjects, nNewOffset);
+
+#ifdef __CONCURRENT__
+		std::unique_lock<std::shared_mutex> relock_cache(m_mtxCache);
+		std::unique_lock<std::shared_mutex> relock_storage(m_mtxStorage);
+#endif //__CONCURRENT__
+
+		for (auto itObject = vtObjects.begin(); itObject != vtObjects.end(); itObject++)
+		{
+			(*itObject).second.second->setDirtyFlag(false);
+
+			std::shared_ptr<Item> ptrItem = mpItems[(*itObject).first];
+			untrackDirty(ptrItem);
+
+			ptrItem->m_uidSelf = *(*itObject).second.first;
+			m_mpObjects[ptrItem->m_uidSelf] = ptrItem;
+			ptrItem->m_bResident = true;
+
+			if (stRelinkedUIDs.find((*itObject).first) != stRelinkedUIDs.end())
+			{
+				m_mpUIDUpdates.erase((*itObject).first);
+				continue;
+			}
+
+			m_mpUIDUpdates[(*itObject).first] = std::make_pair((*itObject).second.first, nullptr);
+		}
+
+#ifdef __CONCURRENT__
+		relock_storage.unlock();
+		relock_cache.unlock();
+
+		m_cvUIDUpdates.notify_all();
+#endif //__CONCURRENT__
+
+		return vtObjects.size();
+	}
+
+	// Waits until none of the objects is referred outside the cache, i.e. the operations that are already past the root are done.
+	void waitUntilReleased()
+	{
+		while (true)
+		{
+#ifdef __CONCURRENT__
+			std::unique_lock<std::shared_mutex> lock_cache(m_mtxCache);
+#endif //__CONCURRENT__
+
+			if (std::all_of(m_mpObjects.begin(), m_mpObjects.end(), [](const auto& item) { return item.second->m_ptrObject.use_count() == 1; }))
+			{
+				return;
+			}
+
+#ifdef __CONCURRENT__
+			lock_cache.unlock();
+#endif //__CONCURRENT__
+
+			std::this_thread::yield();
+		}
+	}
+
+	// Writes the dirty objects and persists the superblock, uidRoot is updated to the persistent address of the root.
+	// The caller must ensure that no object is in use (see waitUntilReleased), the objects stay resident.
+	// Returns KeyDoesNotExist if the storage still has objects that are referred by their old UIDs, the caller is expected to relink them and retry.
+	CacheErrorCode checkpoint(ObjectUIDType& uidRoot, uint32_t nDegree, uint64_t nCheckpointLSN)
+	{
+		// Holding it across the flush keeps the compactor from publishing new relocations until the superblock is written.
+		std::unique_lock<std::recursive_mutex> lock_compaction(m_mtxCompaction);
+
+		writeBackDirtyItems();
+
+#ifdef __CONCURRENT__
+		std::unique_lock<std::shared_mutex> lock_cache(m_mtxCache);
+		std::unique_lock<std::shared_mutex> lock_storage(m_mtxStorage);
+#endif //__CONCURRENT__
+
+		for (auto itObject = m_mpObjects.begin(); itObject != m_mpObjects.end(); itObject++)
+		{
+			if ((*itObject).second->m_ptrObject->getDirtyFlag())
+			{
+				std::cout << "Critical State: Can't proceed with the checkpoint operations as an object is in use." << std::endl;
+				throw new std::logic_error(".....");   // TODO: critical log.
+			}
+		}
+
+#ifdef __CONCURRENT__
+		lock_cache.unlock();
+#endif //__CONCURRENT__
+
+		while (m_mpUIDUpdates.find(uidRoot) != m_mpUIDUpdates.end())
+		{
+			std::optional<ObjectUIDType> uidUpdated = m_mpUIDUpdates[uidRoot].first;
+			m_mpUIDUpdates.erase(uidRoot);
+			uidRoot = *uidUpdated;
+		}
+
+		if (m_mpUIDUpdates.size() > 0)
+		{
+			return CacheErrorCode::KeyDoesNotExist;
+		}
+
+#ifdef __CONCURRENT__
+		lock_storage.unlock();
+#endif //__CONCURRENT__
+
+		return m_ptrStorage->persistSuperblock(uidRoot, nDegree, nCheckpointLSN);
+	}
+
+	CacheErrorCode open(const std::string& stFilename, ObjectUIDType& uidRoot, uint32_t& nDegree, uint64_t& nCheckpointLSN)
+	{
+		return m_ptrStorage->open(stFilename, uidRoot, nDegree, nCheckpointLSN);
+	}
+
+	// Writes the UIDs of the resident objects to a sidecar file, the pinned ones first and then the list from the head, i.e. the most recently used first.
+	// Meant to be called right after a checkpoint, when every resident object is clean and stored where the superblock refers to it, uidRoot tags the list.
+	CacheErrorCode saveWarmUpList(const std::string& stFilename, const ObjectUIDType& uidRoot)
+	{
+		std::vector<ObjectUIDType> vtUIDs;
+
+		{
+#ifdef __CONCURRENT__
+			std::shared_lock<std::shared_mutex> lock_cache(m_mtxCache);
+#endif //__CONCURRENT__
+
+			vtUIDs.reserve(m_mpObjects.size());
+
+			for (auto itObject = m_mpObjects.begin(); itObject != m_mpObjects.end(); itObject++)
+			{
+				if ((*itObject).second->m_bPinned)
+				{
+					vtUIDs.push_back((*itObject).first);
+				}
+			}
+
+			for (std::shared_ptr<Item> ptrItem = m_ptrHead; ptrItem != nullptr; ptrItem = ptrItem->m_ptrNext)
+			{
+				vtUIDs.push_back(ptrItem->m_uidSelf);
+			}
+		}
+
+		// The objects that are not on the storage (yet) can't be read back.
+		vtUIDs.erase(std::remove_if(vtUIDs.begin(), vtUIDs.end(), [](const ObjectUIDType& uid) { return uid.getMediaType() < ObjectUIDType::PMem; }), vtUIDs.end());
+
+		// The list is written aside and then renamed, a crash in between leaves the previous one intact.
+		std::string stTempFilename = stFilename + ".tmp";
+
+		std::ofstream fsList(stTempFilename.c_str(), std::ios::out | std::ios::binary | std::ios::trunc);
+		if (!fsList.is_open())
+		{
+			return CacheErrorCode::Error;
+		}
+
+		uint64_t nMagic = WARMUP_LIST_MAGIC;
+		uint64_t nCount = vtUIDs.size();
+
+		fsList.write(reinterpret_cast<const char*>(&nMagic), sizeof(uint64_t));
+		fsList.write(reinterpret_cast<const char*>(&uidRoot), sizeof(ObjectUIDType));
+		fsList.write(reinterpret_cast<const char*>(&nCount), sizeof(uint64_t));
+		fsList.write(reinterpret_cast<const char*>(vtUIDs.data()), nCount * sizeof(ObjectUIDType));
+		fsList.close();
+
+		if (fsList.fail())
+		{
+			return CacheErrorCode::Error;
+		}
+
+		std::error_code ec;
+		std::filesystem::rename(stTempFilename, stFilename, ec);
+
+		return ec ? CacheErrorCode::Error : CacheErrorCode::Success;
+	}
+
+	// Reads the objects listed in the sidecar file (see saveWarmUpList) with nThreads readers and links them in the same order, as many as fit.
+	// The list is ignored unless it was saved along uidRoot, the objects that have been rewritten (or removed) since are skipped.
+	// Returns the number of objects read.
+	size_t warmUp(const std::string& stFilename, const ObjectUIDType& uidRoot, size_t nThreads)
+	{
+		std::ifstream fsList(stFilename.c_str(), std::ios::in | std::ios::binary);
+		if (!fsList.is_open())
+		{
+			return 0;
+		}
+
+		uint64_t nMagic = 0;
+		ObjectUIDType uidListRoot;
+		uint64_t nCount = 0;
+
+		fsList.read(reinterpret_cast<char*>(&nMagic), sizeof(uint64_t));
+		fsList.read(reinterpret_cast<char*>(&uidListRoot), sizeof(ObjectUIDType));
+		fsList.read(reinterpret_cast<char*>(&nCount), sizeof(uint64_t));
+
+		if (!fsList.good() || nMagic != WARMUP_LIST_MAGIC || uidListRoot != uidRoot)
+		{
+			return 0;
+		}
+
+#ifndef __TRACK_CACHE_FOOTPRINT__
+		nCount = std::min<uint64_t>(nCount, m_nCacheCapacity);
+#endif //__TRACK_CACHE_FOOTPRINT__
+
+		std::vector<ObjectUIDType> vtUIDs(nCount);
+		fsList.read(reinterpret_cast<char*>(vtUIDs.data()), nCount * sizeof(ObjectUIDType));
+
+		if (!fsList.good())
+		{
+			return 0;
+		}
+
+		// Keeps the prefetcher and the writers from moving the objects while they are read.
+		std::unique_lock<std::recursive_mutex> lock_compaction(m_mtxCompaction);
+
+		{
+#ifdef __CONCURRENT__
+			std::shared_lock<std::shared_mutex> lock_cache(m_mtxCache);
+#endif //__CONCURRENT__
+
+			vtUIDs.erase(std::remove_if(vtUIDs.begin(), vtUIDs.end(), [&](const ObjectUIDType& uid)
+				{
+					if constexpr (requires { m_ptrStorage->isLive(uid); })
+					{
+						if (!m_ptrStorage->isLive(uid))
+						{
+							return true;
+						}
+					}
+
+					return m_mpObjects.find(uid) != m_mpObjects.end();
+				}), vtUIDs.end());
+		}
+
+		std::vector<ObjectTypePtr> vtObjects(vtUIDs.size());
+
+		auto fnRead = [&](size_t nFirst, size_t nStep)
+			{
+				for (size_t nIdx = nFirst; nIdx < vtUIDs.size(); nIdx += nStep)
+				{
+					vtObjects[nIdx] = m_ptrStorage->getObject(vtUIDs[nIdx]);
+				}
+			};
+
+#ifdef __CONCURRENT__
+		nThreads = std::clamp<size_t>(nThreads, 1, std::max<size_t>(vtUIDs.size(), 1));
+
+		std::vector<std::thread> vtThreads;
+		for (size_t nThread = 0; nThread < nThreads; nThread++)
+		{
+			vtThreads.emplace_back(fnRead, nThread, nThreads);
+		}
+
+		for (std::thread& thread : vtThreads)
+		{
+			thread.join();
+		}
+#else //__CONCURRENT__
+		fnRead(0, 1);
+#endif //__CONCURRENT__
+
+#ifdef __CONCURRENT__
+		std::unique_lock<std::shared_mutex> lock_cache(m_mtxCache);
+#endif //__CONCURRENT__
+
+		// The most recently used prefix that fits is linked, the last one first so that the list ends up in the saved order.
+		size_t nFitting = 0;
+#ifdef __TRACK_CACHE_FOOTPRINT__
+		int64_t nFootprint = m_nCacheFootprint;
+		while (nFitting < vtObjects.size() && vtObjects[nFitting] != nullptr && nFootprint + (int64_t)vtObjects[nFitting]->getMemoryFootprint() <= m_nCacheCapacity)
+		{
+			nFootprint += vtObjects[nFitting++]->getMemoryFootprint();
+		}
+#else //__TRACK_CACHE_FOOTPRINT__
+		while (nFitting < vtObjects.size() && vtObjects[nFitting] != nullptr && m_mpObjects.size() + nFitting < (size_t)m_nCacheCapacity)
+		{
+			nFitting++;
+		}
+#endif //__TRACK_CACHE_FOOTPRINT__
+
+		size_t nLinked = 0;
+		for (size_t nIdx = nFitting; nIdx-- > 0; )
+		{
+			if (m_mpObjects.find(vtUIDs[nIdx]) != m_mpObjects.end())
+			{
+				continue;
+			}
+
+			std::shared_ptr<Item> ptrItem = std::make_shared<Item>(vtUIDs[nIdx], vtObjects[nIdx]);
+
+#ifdef __TRACK_CACHE_FOOTPRINT__
+			m_nCacheFootprint += vtObjects[nIdx]->getMemoryFootprint();
+#endif //__TRACK_CACHE_FOOTPRINT__
+
+			m_mpObjects[vtUIDs[nIdx]] = ptrItem;
+			ptrItem->m_bResident = true;
+
+			linkAtFront(ptrItem);
+			nLinked++;
+		}
+
+		return nLinked;
+	}
+
+	// Relocates the live objects of the sparsest storage region into the lowest free extent and then truncates the tail.
+	// The relocations are published through m_mpUIDUpdates, therefore, the parents pick up the new UIDs the same way as for a regular flush.
+	// Returns the number of bytes read and written.
+	size_t compact(size_t nIOBudget)
+	{
+		std::unique_lock<std::recursive_mutex> lock_compaction(m_mtxCompaction);
+
+		std::vector<std::pair<ObjectUIDType, std::pair<std::optional<ObjectUIDType>, std::shared_ptr<ObjectType>>>> vtObjects;
+		std::vector<std::shared_ptr<Item>> vtItems;	// Resident counterparts of vtObjects (nullptr if the object is not in the cache).
+		std::vector<ObjectUIDType> vtReserved;
+
+		size_t nBlocks = 0;
+		size_t nBlockSize = m_ptrStorage->getBlockSize();
+
+#ifdef __CONCURRENT__
+		std::unique_lock<std::shared_mutex> lock_cache(m_mtxCache);
+		std::unique_lock<std::shared_mutex> lock_storage(m_mtxStorage);
+#endif //__CONCURRENT__
+
+		// Hand over the pending updates to the cached parents first, otherwise the superseded blocks stay reserved until the parents get flushed.
+		for (auto itObject = m_mpObjects.begin(); itObject != m_mpObjects.end() && m_mpUIDUpdates.size() > 0; itObject++)
+		{
+			if (!(*itObject).second->m_ptrObject->tryLockObject())
+			{
+				continue;
+			}
+
+			m_ptrCallback->applyExistingUpdates((*itObject).second->m_ptrObject, m_mpUIDUpdates);
+
+			(*itObject).second->m_ptrObject->unlockObject();
+		}
+
+		// The UIDs in the Updates' list are still referred by their parents, therefore, their blocks can't be reused yet.
+		for (auto itUpdate = m_mpUIDUpdates.begin(); itUpdate != m_mpUIDUpdates.end(); itUpdate++)
+		{
+			vtReserved.push_back((*itUpdate).first);
+		}
+
+		// Move on to the next region if none of the objects in the current one can be relocated at the moment.
+		size_t nRegion = std::numeric_limits<size_t>::max();
+		size_t nBytes = 0;
+		std::vector<ObjectUIDType> vtCandidates;
+		while (vtObjects.size() == 0 && m_ptrStorage->getRelocationCandidates(vtCandidates, nRegion))
+		{
+			for (auto itCandidate = vtCandidates.begin(); itCandidate != vtCandidates.end(); itCandidate++)
+			{
+				if (m_mpUIDUpdates.find(*itCandidate) != m_mpUIDUpdates.end())
+				{
+					continue;
+				}
+
+				auto itItem = m_mpObjects.find(*itCandidate);
+
+				// The resident objects need not be read back, the rest cost a read and a write.
+				size_t nCost = (*itCandidate).getPersistentObjectSize() * (itItem != m_mpObjects.end() ? 1 : 2);
+				if (nBytes + nCost > nIOBudget)
+				{
+					break;
+				}
+
+				if (itItem != m_mpObjects.end())
+				{
+					// The dirty objects are moved by the regular flush and the ones in use are left for the next round.
+					if ((*itItem).second->m_ptrObject->getDirtyFlag() || (*itItem).second->m_ptrObject.use_count() > 1)
+					{
+						continue;
+					}
+
+					vtItems.push_back((*itItem).second);
+					vtObjects.push_back(std::make_pair(*itCandidate, std::make_pair(std::nullopt, (*itItem).second->m_ptrObject)));
+				}
+				else
+				{
+					vtItems.push_back(nullptr);
+					vtObjects.push_back(std::make_pair(*itCandidate, std::make_pair(std::nullopt, nullptr)));
+				}
+
+				nBytes += nCost;
+				nBlocks += ((*itCandidate).getPersistentObjectSize() + nBlockSize - 1) / nBlockSize;
+			}
+
+			vtCandidates.clear();
+		}
+
+		size_t nBlock = 0, nFreeBlocks = 0;
+		if (vtObjects.size() == 0 || !m_ptrStorage->getFreeExtent(nBlocks, vtObjects.front().first.getPersistentPointerValue() / nBlockSize, vtReserved, nBlock, nFreeBlocks))
+		{
+			m_ptrStorage->truncate(vtReserved);
+			return 0;
+		}
+
+		// Relocate only as many objects as the extent can hold.
+		nBlocks = 0;
+		for (size_t idx = 0; idx < vtObjects.size(); idx++)
+		{
+			size_t nRequiredBlocks = (vtObjects[idx].first.getPersistentObjectSize() + nBlockSize - 1) / nBlockSize;
+			if (nBlocks + nRequiredBlocks > nFreeBlocks)
+			{
+				vtObjects.resize(idx);
+				vtItems.resize(idx);
+				break;
+			}
+
+			nBlocks += nRequiredBlocks;
+		}
+
+		// Readers of the objects being relocated wait on m_cvUIDUpdates until the new UIDs are available.
+		for (size_t idx = 0; idx < vtObjects.size(); idx++)
+		{
+			if (vtItems[idx] != nullptr)
+			{
+				vtItems[idx]->m_bResident = false;
+				m_mpObjects.erase(vtObjects[idx].first);
+			}
+
+			m_mpUIDUpdates[vtObjects[idx].first] = std::make_pair(std::nullopt, nullptr);
+		}
+
+#ifdef __CONCURRENT__
+		lock_storage.unlock();
+		lock_cache.unlock();
+#endif //__CONCURRENT__
+
+		nBytes = 0;
+		for (size_t idx = 0; idx < vtObjects.size(); idx++)
+		{
+			if (vtItems[idx] == nullptr)
+			{
+				vtObjects[idx].second.second = m_ptrStorage->getObject(vtObjects[idx].first);
+				nBytes += vtObjects[idx].first.getPersistentObjectSize();
+			}
+
+			vtObjects[idx].second.second->setDirtyFlag(true);
+			nBytes += vtObjects[idx].first.getPersistentObjectSize();
+		}
+
+		// The objects are relocated within the medium they are on, a tiered storage need not be writing to the same one (see TieredStorage).
+		size_t nNewOffset = 0;
+		std::unordered_set<ObjectUIDType> stRelinkedUIDs;
+		m_ptrCallback->prepareFlush(vtObjects, nBlock, nNewOffset, nBlockSize, static_cast<typename ObjectUIDType::StorageMedia>(vtObjects.front().first.getMediaType()), stRelinkedUIDs);
+
+		if (vtObjects.size() != vtItems.size() || nNewOffset > nBlock + nBlocks)
+		{
+			std::cout << "Critical State: Relocated objects do not fit in the extent reserved for them." << std::endl;
+			throw new std::logic_error(".....");   // TODO: critical log.
+		}
+
+		m_ptrStorage->addObjects(vtObjects, nNewOffset);
+
+#ifdef __CONCURRENT__
+		std::unique_lock<std::shared_mutex> relock_cache(m_mtxCache);
+		std::unique_lock<std::shared_mutex> relock_storage(m_mtxStorage);
+#endif //__CONCURRENT__
+
+		for (size_t idx = 0; idx < vtObjects.size(); idx++)
+		{
+			vtObjects[idx].second.second->setDirtyFlag(false);
+
+			// The resident objects stay in the cache under their new UIDs.
+			if (vtItems[idx] != nullptr)
+			{
+				vtItems[idx]->m_uidSelf = *vtObjects[idx].second.first;
+				m_mpObjects[vtItems[idx]->m_uidSelf] = vtItems[idx];
+				vtItems[idx]->m_bResident = true;
+				untrackDirty(vtItems[idx]);
+			}
+
+			// The relinked objects are not referred by their old UIDs anymore.
+			if (stRelinkedUIDs.find(vtObjects[idx].first) != stRelinkedUIDs.end())
+			{
+				m_mpUIDUpdates.erase(vtObjects[idx].first);
+				continue;
+			}
+
+			// The object itself is not retained here, it is either resident or can be read from its new location.
+			m_mpUIDUpdates[vtObjects[idx].first] = std::make_pair(vtObjects[idx].second.first, nullptr);
+		}
+
+		vtReserved.clear();
+		for (auto itUpdate = m_mpUIDUpdates.begin(); itUpdate != m_mpUIDUpdates.end(); itUpdate++)
+		{
+			vtReserved.push_back((*itUpdate).first);
+		}
+
+		m_ptrStorage->truncate(vtReserved);
+
+#ifdef __CONCURRENT__
+		relock_storage.unlock();
+		relock_cache.unlock();
+
+		m_cvUIDUpdates.notify_all();
+#endif //__CONCURRENT__
+
+		return nBytes;
+	}
+
+	// Moves the coldest leaves of a tiered storage's fast tier to its slow tier, reads and writes at most nIOBudget bytes (see TieredStorage).
+	// The resident objects are left out, being in the cache they are anything but cold.
+	// The new UIDs are published through m_mpUIDUpdates the same way as for the compaction.
+	// Returns the number of bytes read and written.
+	size_t demote(size_t nIOBudget)
+	{
+		std::unique_lock<std::recursive_mutex> lock_compaction(m_mtxCompaction);
+
+		std::vector<std::pair<ObjectUIDType, std::pair<std::optional<ObjectUIDType>, std::shared_ptr<ObjectType>>>> vtObjects;
+		std::vector<ObjectUIDType> vtCandidates;
+
+#ifdef __CONCURRENT__
+		std::unique_lock<std::shared_mutex> lock_cache(m_mtxCache);
+		std::unique_lock<std::shared_mutex> lock_storage(m_mtxStorage);
+#endif //__CONCURRENT__
+
+		if (!m_ptrStorage->getDemotionCandidates(vtCandidates))
+		{
+			return 0;
+		}
+
+		size_t nBytes = 0;
+		for (auto itCandidate = vtCandidates.begin(); itCandidate != vtCandidates.end(); itCandidate++)
+		{
+			if (m_mpUIDUpdates.find(*itCandidate) != m_mpUIDUpdates.end() || m_mpObjects.find(*itCandidate) != m_mpObjects.end())
+			{
+				continue;
+			}
+
+			size_t nCost = (*itCandidate).getPersistentObjectSize() * 2;
+			if (nBytes + nCost > nIOBudget)
+			{
+				break;
+			}
+
+			vtObjects.push_back(std::make_pair(*itCandidate, std::make_pair(std::nullopt, nullptr)));
+			nBytes += nCost;
+		}
+
+		if (vtObjects.size() == 0)
+		{
+			return 0;
+		}
+
+		// Readers of the objects being demoted wait on m_cvUIDUpdates until the new UIDs are available.
+		for (size_t idx = 0; idx < vtObjects.size(); idx++)
+		{
+			m_mpUIDUpdates[vtObjects[idx].first] = std::make_pair(std::nullopt, nullptr);
+		}
+
+#ifdef __CONCURRENT__
+		lock_storage.unlock();
+		lock_cache.unlock();
+#endif //__CONCURRENT__
+
+		for (size_t idx = 0; idx < vtObjects.size(); idx++)
+		{
+			vtObjects[idx].second.second = m_ptrStorage->getObject(vtObjects[idx].first);
+			vtObjects[idx].second.second->setDirtyFlag(true);
+		}
+
+		// The leaves have no children to relink, prepareFlush only assigns them the slow tier's UIDs.
+		size_t nNewOffset = 0;
+		std::unordered_set<ObjectUIDType> stRelinkedUIDs;
+		m_ptrCallback->prepareFlush(vtObjects, m_ptrStorage->getDemotionOffset(), nNewOffset, m_ptrStorage->getBlockSize(), m_ptrStorage->getDemotionStorageType(), stRelinkedUIDs);
+
+		m_ptrStorage->addDemotedObjects(vtObjects, nNewOffset);
+
+#ifdef __CONCURRENT__
+		std::unique_lock<std::shared_mutex> relock_storage(m_mtxStorage);
+#endif //__CONCURRENT__
+
+		for (size_t idx = 0; idx < vtObjects.size(); idx++)
+		{
+			vtObjects[idx].second.second->setDirtyFlag(false);
+
+			m_mpUIDUpdates[vtObjects[idx].first] = std::make_pair(vtObjects[idx].second.first, nullptr);
+		}
+
+#ifdef __CONCURRENT__
+		relock_storage.unlock();
+
+		m_cvUIDUpdates.notify_all();
+#endif //__CONCURRENT__
+
+		return nBytes;
+	}
+
+private:
+	void moveToTail(std::shared_ptr<Item> tail, std::shared_ptr<Item> nodeToMove) 
+	{
+		if (tail == nullptr || nodeToMove == nullptr)
+		{
+			return;
+		}
+
+		if (nodeToMove->m_ptrPrev != nullptr)
+		{
+			nodeToMove->m_ptrPrev->m_ptrNext = nodeToMove->m_ptrNext;
+		}
+		else
+		{
+			tail = nodeToMove->m_ptrNext;
+		}
+
+		if (nodeToMove->m_ptrNext != nullptr)
+		{
+			nodeToMove->m_ptrNext->m_ptrPrev = nodeToMove->m_ptrPrev;
+		}
+
+		if (tail != nullptr) 
+		{
+			tail->m_ptrNext = nodeToMove;
+			nodeToMove->m_ptrPrev = tail;
+			nodeToMove->m_ptrNext = nullptr;
+			tail = nodeToMove;
+		}
+		else 
+		{
+			tail = nodeToMove;
+		}
+	}
+
+	void interchangeWithTail(std::shared_ptr<Item> currentNode) {
+		if (currentNode == nullptr || currentNode == m_ptrTail) 
+		{
+			return;
+		}
+
+		if (currentNode->m_ptrPrev) 
+		{
+			currentNode->m_ptrPrev->m_ptrNext = currentNode->m_ptrNext;
+		}
+		else 
+		{
+			m_ptrHead = currentNode->m_ptrNext;
+		}
+
+		if (currentNode->m_ptrNext) 
+		{
+			currentNode->m_ptrNext->m_ptrPrev = currentNode->m_ptrPrev;
+		}
+
+		currentNode->m_ptrPrev = m_ptrTail;
+		currentNode->m_ptrNext = nullptr;
+
+		m_ptrTail->m_ptrNext = currentNode;
+
+		m_ptrTail = currentNode;
+	}
+
+	// W-TinyLFU style admission: the objects read from the storage are kept until the window overflows, then its oldest
+	// one (the candidate) is weighed against the object next in line for eviction (the victim). A candidate that has not been
+	// accessed more often than the victim is moved to the tail, i.e. it is the one to go, therefore, the leaves pulled in by a
+	// sweep leave the cache ahead of the hot objects. The eviction itself is left to flushItemsToStorage, as are the dirty
+	// objects' writes. The index nodes are always admitted as their children, which must be flushed first, follow them in the list.
+	// The objects created by the tree do not go through the window, a new sibling is linked to its parent only later in a split.
+	inline void admitWindowCandidates(bool bFull)
+	{
+		size_t nWindowSize = std::max<size_t>(ADMISSION_WINDOW_MIN_SIZE, m_mpObjects.size() * ADMISSION_WINDOW_PERCENT / 100);
+
+		while (m_qWindow.size() > nWindowSize)
+		{
+			std::shared_ptr<Item> ptrCandidate = m_qWindow.front().lock();
+			m_qWindow.pop();
+
+			if (!bFull || ptrCandidate == nullptr || !ptrCandidate->m_bResident || ptrCandidate == m_ptrTail)
+			{
+				continue;
+			}
+
+			// An object in use is being accessed, and moving it to the tail would hold up the eviction.
+			if (ptrCandidate->m_uidSelf.getObjectType() != LEAF_UID || ptrCandidate->m_ptrObject.use_count() > 1)
+			{
+				continue;
+			}
+
+			if (m_oSketch.estimate(std::hash<ObjectUIDType>()(ptrCandidate->m_uidSelf)) > m_oSketch.estimate(std::hash<ObjectUIDType>()(m_ptrTail->m_uidSelf)))
+			{
+				continue;
+			}
+
+			interchangeWithTail(ptrCandidate);
+		}
+	}
+
+	// Pins the index nodes along an access path, root first. The pinned nodes are kept closed upwards, i.e. a node is pinned only if its
+	// parent is, otherwise the parent could be evicted (and written) ahead of a child that has never been written. The root and the siblings
+	// of the pinned nodes (a split moves the children there) are pinned regardless of the budget for the same reason. Should a pinned node
+	// still turn up under a parent that is not pinned, or the splits take the pinned nodes too far over the budget, the pinning restarts
+	// from the top.
+	inline void updatePins(const std::vector<std::pair<ObjectUIDType, ObjectTypePtr>>& vt)
+	{
+#ifdef __TRACK_CACHE_FOOTPRINT__
+		if (m_nPinnedFootprint > m_nCacheCapacity * m_dPinningBudgetRatio * (1 + PINNING_BUDGET_SLACK_RATIO))
+#else //__TRACK_CACHE_FOOTPRINT__
+		if (m_nPinnedCount > m_nCacheCapacity * m_dPinningBudgetRatio * (1 + PINNING_BUDGET_SLACK_RATIO))
+#endif //__TRACK_CACHE_FOOTPRINT__
+		{
+			unpinAll();
+		}
+
+		bool bParentPinned = true;
+		size_t nLevel = 0;
+
+		for (auto itNode = vt.begin(); itNode != vt.end(); itNode++)
+		{
+			auto itObject = m_mpObjects.find((*itNode).first);
+			if (itObject == m_mpObjects.end())
+			{
+				// Being written or relocated, the rest of the path is left as it is.
+				return;
+			}
+
+			std::shared_ptr<Item> ptrItem = (*itObject).second;
+
+			// A sibling follows its counterpart, the path carries on below the counterpart.
+			if ((*itNode).second == nullptr)
+			{
+				if (nLevel > 0 && bParentPinned && !ptrItem->m_bPinned)
+				{
+					pinIfEligible(ptrItem, nLevel - 1, true);
+				}
+
+				continue;
+			}
+
+			if (bParentPinned && nLevel < m_nPinnedLevels)
+			{
+				pinIfEligible(ptrItem, nLevel, nLevel == 0);
+			}
+			else if (ptrItem->m_bPinned)
+			{
+				unpinAll();
+				return;
+			}
+
+			bParentPinned = ptrItem->m_bPinned;
+			nLevel++;
+		}
+	}
+
+	// Takes an index node out of the LRU list if it is on one of the pinned levels and the budget allows (or bOverBudget is set).
+	inline void pinIfEligible(std::shared_ptr<Item> ptrItem, size_t nLevel, bool bOverBudget)
+	{
+		if (ptrItem->m_bPinned || nLevel >= m_nPinnedLevels || !ptrItem->m_ptrObject->isIndexNode())
+		{
+			return;
+		}
+
+#ifdef __TRACK_CACHE_FOOTPRINT__
+		int64_t nFootprint = ptrItem->m_ptrObject->getMemoryFootprint();
+		if (!bOverBudget && m_nPinnedFootprint + nFootprint > m_nCacheCapacity * m_dPinningBudgetRatio)
+		{
+			return;
+		}
+
+		m_nPinnedFootprint += nFootprint;
+#else //__TRACK_CACHE_FOOTPRINT__
+		if (!bOverBudget && m_nPinnedCount + 1 > m_nCacheCapacity * m_dPinningBudgetRatio)
+		{
+			return;
+		}
+#endif //__TRACK_CACHE_FOOTPRINT__
+
+		removeFromLRU(ptrItem);
+
+		ptrItem->m_ptrPrev = nullptr;
+		ptrItem->m_ptrNext = nullptr;
+		ptrItem->m_bPinned = true;
+		ptrItem->m_nLevel = static_cast<uint8_t>(nLevel);
+
+		m_nPinnedCount++;
 	}
 
-	CacheErrorCode flush()
+	// Only the accounting, the caller decides where the item goes.
+	inline void unpin(std::shared_ptr<Item> ptrItem)
 	{
-		flushDataItemsToStorage();
-		//presistCurrentCacheState();
+		ptrItem->m_bPinned = false;
+		m_nPinnedCount--;
 
-		return CacheErrorCode::Success;
+#ifdef __TRACK_CACHE_FOOTPRINT__
+		// The footprint may have changed since the item was pinned.
+		m_nPinnedFootprint = std::max<int64_t>(0, m_nPinnedFootprint - ptrItem->m_ptrObject->getMemoryFootprint());
+#endif //__TRACK_CACHE_FOOTPRINT__
 	}
 
-private:
-	void moveToTail(std::shared_ptr<Item> tail, std::shared_ptr<Item> nodeToMove) 
+	// Links the pinned items back at the head, the deeper levels first so that the parents precede their children.
+	// The methods that walk the whole list (e.g. flushAllItemsToStorage) expect every resident object to be on it.
+	inline void unpinAll()
 	{
-		if (tail == nullptr || nodeToMove == nullptr)
+		if (m_nPinnedCount == 0)
 		{
 			return;
 		}
 
-		if (nodeToMove->m_ptrPrev != nullptr)
+		std::vector<std::shared_ptr<Item>> vtPinned;
+		for (auto itObject = m_mpObjects.begin(); itObject != m_mpObjects.end(); itObject++)
 		{
-			nodeToMove->m_ptrPrev->m_ptrNext = nodeToMove->m_ptrNext;
+			if ((*itObject).second->m_bPinned)
+			{
+				vtPinned.push_back((*itObject).second);
+			}
 		}
-		else
+
+		std::stable_sort(vtPinned.begin(), vtPinned.end(), [](const std::shared_ptr<Item>& lhs, const std::shared_ptr<Item>& rhs) { return lhs->m_nLevel > rhs->m_nLevel; });
+
+		for (const std::shared_ptr<Item>& ptrItem : vtPinned)
 		{
-			tail = nodeToMove->m_ptrNext;
+			unpin(ptrItem);
+			linkAtFront(ptrItem);
 		}
 
-		if (nodeToMove->m_ptrNext != nullptr)
+#ifdef __TRACK_CACHE_FOOTPRINT__
+		m_nPinnedFootprint = 0;
+#endif //__TRACK_CACHE_FOOTPRINT__
+	}
+
+	// Takes the object out of the cache, if it is resident, the storage is left to the caller. Expects m_mtxCache to be held.
+	inline bool drop(const ObjectUIDType& uidObject)
+	{
+		auto it = m_mpObjects.find(uidObject);
+		if (it == m_mpObjects.end())
 		{
-			nodeToMove->m_ptrNext->m_ptrPrev = nodeToMove->m_ptrPrev;
+			return false;
 		}
 
-		if (tail != nullptr) 
+#ifdef __TRACK_CACHE_FOOTPRINT__
+		m_nCacheFootprint -= (*it).second->m_ptrObject->getMemoryFootprint();
+
+		assert(m_nCacheFootprint >= 0);
+#endif //__TRACK_CACHE_FOOTPRINT__
+
+		if ((*it).second->m_bPinned)
 		{
-			tail->m_ptrNext = nodeToMove;
-			nodeToMove->m_ptrPrev = tail;
-			nodeToMove->m_ptrNext = nullptr;
-			tail = nodeToMove;
+			unpin((*it).second);
 		}
-		else 
+		else
 		{
-			tail = nodeToMove;
+			removeFromLRU((*it).second);
 		}
+
+		untrackDirty((*it).second);
+
+		(*it).second->m_bResident = false;
+		m_mpObjects.erase(((*it).first));
+
+		return true;
 	}
 
-	void interchangeWithTail(std::shared_ptr<Item> currentNode) {
-		if (currentNode == nullptr || currentNode == m_ptrTail) 
+	// Accounts the item in m_nDirtyCount if its object has been modified, the objects are checked as they are accessed (see reorder).
+	inline void trackDirty(std::shared_ptr<Item> ptrItem)
+	{
+		if (!ptrItem->m_bDirtyCounted && ptrItem->m_ptrObject->getDirtyFlag())
 		{
-			return;
+			ptrItem->m_bDirtyCounted = true;
+			m_nDirtyCount++;
 		}
+	}
 
-		if (currentNode->m_ptrPrev) 
+	// Takes the item out of m_nDirtyCount once its object is written (or the item leaves the cache).
+	inline void untrackDirty(std::shared_ptr<Item> ptrItem)
+	{
+		if (ptrItem->m_bDirtyCounted)
 		{
-			currentNode->m_ptrPrev->m_ptrNext = currentNode->m_ptrNext;
+			ptrItem->m_bDirtyCounted = false;
+			m_nDirtyCount--;
 		}
-		else 
+	}
+
+	inline size_t getDirtyFootprint() const
+	{
+#ifdef __TRACK_CACHE_FOOTPRINT__
+		return m_mpObjects.size() > 0 ? m_nDirtyCount * (m_nCacheFootprint / m_mpObjects.size()) : 0;
+#else //__TRACK_CACHE_FOOTPRINT__
+		return m_nDirtyCount;
+#endif //__TRACK_CACHE_FOOTPRINT__
+	}
+
+	// Links an item that is not on the list at its head.
+	inline void linkAtFront(std::shared_ptr<Item> ptrItem)
+	{
+		if (!m_ptrHead)
 		{
-			m_ptrHead = currentNode->m_ptrNext;
+			m_ptrHead = ptrItem;
+			m_ptrTail = ptrItem;
+		}
+		else
+		{
+			moveToFront(ptrItem);
 		}
+	}
 
-		if (currentNode->m_ptrNext) 
+	// The objects written (or relocated) while they were not in use stay resident under their new UIDs, the callers may still refer to them by the old ones.
+	// Returns false if the UID is not in the Updates' list, ptrItem is left null if the object is either being written or not resident.
+	bool findRelocatedItem(const ObjectUIDType& uidObject, std::shared_ptr<Item>& ptrItem)
+	{
+#ifdef __CONCURRENT__
+		std::unique_lock<std::shared_mutex> lock_storage(m_mtxStorage);
+#endif //__CONCURRENT__
+
+		auto itUpdate = m_mpUIDUpdates.find(uidObject);
+		if (itUpdate == m_mpUIDUpdates.end())
 		{
-			currentNode->m_ptrNext->m_ptrPrev = currentNode->m_ptrPrev;
+			return false;
 		}
 
-		currentNode->m_ptrPrev = m_ptrTail;
-		currentNode->m_ptrNext = nullptr;
+		while (itUpdate != m_mpUIDUpdates.end())
+		{
+			if ((*itUpdate).second.first == std::nullopt)
+			{
+				return true;
+			}
 
-		m_ptrTail->m_ptrNext = currentNode;
+			ObjectUIDType uidUpdated = *(*itUpdate).second.first;
 
-		m_ptrTail = currentNode;
+			auto itItem = m_mpObjects.find(uidUpdated);
+			if (itItem != m_mpObjects.end())
+			{
+				ptrItem = (*itItem).second;
+				return true;
+			}
+
+			itUpdate = m_mpUIDUpdates.find(uidUpdated);
+		}
+
+		return true;
 	}
 
 	inline void moveToFront(std::shared_ptr<Item> ptrItem)
 	{
-		if (ptrItem == m_ptrHead)
+		if (ptrItem == m_ptrHead || ptrItem->m_bPinned)
 		{
 			return;
 		}
@@ -830,88 +2122,107 @@ private:
 
 	inline void flushItemsToStorage()
 	{
+		// The compactor may truncate the tail, therefore, it must not run while a batch is being appended.
+		std::unique_lock<std::recursive_mutex> lock_compaction(m_mtxCompaction);
+
 #ifdef __CONCURRENT__
 		std::vector<std::pair<ObjectUIDType, std::pair<std::optional<ObjectUIDType>, std::shared_ptr<ObjectType>>>> vtObjects;
 
 		std::unique_lock<std::shared_mutex> lock_cache(m_mtxCache);
 
 #ifdef __TRACK_CACHE_FOOTPRINT__
+		admitWindowCandidates(m_nCacheFootprint > m_nCacheCapacity);
+
 		if (m_nCacheFootprint <= m_nCacheCapacity)
 			return;
 
-		while( m_nCacheFootprint >= m_nCacheCapacity)
+		int64_t nExcess = m_nCacheFootprint - m_nCacheCapacity + 1;
 #else //__TRACK_CACHE_FOOTPRINT__
+		admitWindowCandidates(m_mpObjects.size() > m_nCacheCapacity);
+
 		if (m_mpObjects.size() <= m_nCacheCapacity)
 			return;
 
-		size_t nFlushCount = m_mpObjects.size() - m_nCacheCapacity;
-		for (size_t idx = 0; idx < nFlushCount; idx++)
+		int64_t nExcess = m_mpObjects.size() - m_nCacheCapacity;
 #endif //__TRACK_CACHE_FOOTPRINT__
+
+		// The objects in use are skipped rather than ending the round, an operation that holds the tail would otherwise let the footprint grow unbounded.
+		// The pinned objects are not part of the list, they may well account for the rest of the footprint.
+		std::vector<std::shared_ptr<Item>> vtItems;
+		size_t nSkipped = 0;
+
+		for (std::shared_ptr<Item> ptrItem = m_ptrTail; ptrItem != nullptr && nExcess > 0; ptrItem = ptrItem->m_ptrPrev)
 		{
-			//std::cout << "..going to flush.." << std::endl;
-			if (m_ptrTail->m_ptrObject.use_count() > 1)
+			bool bInUse = ptrItem->m_ptrObject.use_count() > 1 || !ptrItem->m_ptrObject->tryLockObject();
+			if (bInUse)
 			{
-				/* Info: 
-				 * Should proceed with the preceeding one?
-				 * But since each operation reorders the items at the end, therefore, the prceeding items would be in use as well!
-				 */
-				break; 
-			}
+				if (++nSkipped > EVICTION_MAX_SKIPPED)
+				{
+					break;
+				}
 
-			// Check if the object is in use
-			if (!m_ptrTail->m_ptrObject->tryLockObject())
-			{
-				/* Info:
-				 * Should proceed with the preceeding one?
-				 * But since each operation reorders the items at the end, therefore, the prceeding items would be in use as well!
-				 */
-				break;
-			}
-			else
-			{
-				m_ptrTail->m_ptrObject->unlockObject();
+				continue;
 			}
 
-			std::shared_ptr<Item> ptrItemToFlush = m_ptrTail;
+			ptrItem->m_ptrObject->unlockObject();
 
-			vtObjects.push_back(std::make_pair(ptrItemToFlush->m_uidSelf, std::make_pair(std::nullopt, ptrItemToFlush->m_ptrObject)));
+			vtItems.push_back(ptrItem);
+			vtObjects.push_back(std::make_pair(ptrItem->m_uidSelf, std::make_pair(std::nullopt, ptrItem->m_ptrObject)));
 
 #ifdef __TRACK_CACHE_FOOTPRINT__
-			m_nCacheFootprint -= ptrItemToFlush->m_ptrObject->getMemoryFootprint();
+			nExcess -= ptrItem->m_ptrObject->getMemoryFootprint();
+#else //__TRACK_CACHE_FOOTPRINT__
+			nExcess--;
 #endif //__TRACK_CACHE_FOOTPRINT__
+		}
 
-			m_mpObjects.erase(ptrItemToFlush->m_uidSelf);
+		std::unique_lock<std::shared_mutex> lock_storage(m_mtxStorage);
 
-			m_ptrTail = ptrItemToFlush->m_ptrPrev;
+		if (m_mpUIDUpdates.size() > 0)
+		{
+			m_ptrCallback->applyExistingUpdates(vtObjects, m_mpUIDUpdates);
+		}
 
-			ptrItemToFlush->m_ptrPrev = nullptr;
-			ptrItemToFlush->m_ptrNext = nullptr;
+		// A parent can't be written ahead of a new child that is still in use, the skipped objects may well be such children.
+		m_ptrCallback->excludeUnflushableObjects(vtObjects);
 
-			if (m_ptrTail)
-			{
-				m_ptrTail->m_ptrNext = nullptr;
-			}
-			else
+		std::unordered_set<ObjectUIDType> stEvictedUIDs;
+		for (auto itObject = vtObjects.begin(); itObject != vtObjects.end(); itObject++)
+		{
+			stEvictedUIDs.insert((*itObject).first);
+		}
+
+		for (std::shared_ptr<Item>& ptrItemToFlush : vtItems)
+		{
+			if (stEvictedUIDs.find(ptrItemToFlush->m_uidSelf) == stEvictedUIDs.end())
 			{
-				m_ptrHead = nullptr;
+				continue;
 			}
 
-			ptrItemToFlush.reset();
-		}
+#ifdef __TRACK_CACHE_FOOTPRINT__
+			m_nCacheFootprint -= ptrItemToFlush->m_ptrObject->getMemoryFootprint();
+#endif //__TRACK_CACHE_FOOTPRINT__
 
-		std::unique_lock<std::shared_mutex> lock_storage(m_mtxStorage);
+			untrackDirty(ptrItemToFlush);
 
-		lock_cache.unlock();
+			ptrItemToFlush->m_bResident = false;
+			m_mpObjects.erase(ptrItemToFlush->m_uidSelf);
 
-		if (m_mpUIDUpdates.size() > 0)
-		{
-			m_ptrCallback->applyExistingUpdates(vtObjects, m_mpUIDUpdates);
+			removeFromLRU(ptrItemToFlush);
+
+			ptrItemToFlush->m_ptrPrev = nullptr;
+			ptrItemToFlush->m_ptrNext = nullptr;
 		}
 
+		vtItems.clear();
+
+		lock_cache.unlock();
+
 		// TODO: ensure that no other thread should touch the storage related params..
 		size_t nNewOffset = 0;
 
-		m_ptrCallback->prepareFlush(vtObjects, m_ptrStorage->getNextAvailableBlockOffset(), nNewOffset, m_ptrStorage->getBlockSize(), m_ptrStorage->getStorageType());
+		std::unordered_set<ObjectUIDType> stRelinkedUIDs;
+		m_ptrCallback->prepareFlush(vtObjects, m_ptrStorage->getNextAvailableBlockOffset(), nNewOffset, m_ptrStorage->getBlockSize(), m_ptrStorage->getStorageType(), stRelinkedUIDs);
 
 		//m_ptrCallback->prepareFlush(vtObjects, nPos, m_ptrStorage->getBlockSize(), m_ptrStorage->getMediaType());
 		
@@ -923,6 +2234,12 @@ private:
 				throw new std::logic_error(".....");   // TODO: critical log.
 			}
 
+			// Nothing refers to the old UIDs of the relinked objects anymore.
+			if (stRelinkedUIDs.find((*itObject).first) != stRelinkedUIDs.end())
+			{
+				continue;
+			}
+
 			if (m_mpUIDUpdates.find((*itObject).first) != m_mpUIDUpdates.end())
 			{
 				std::cout << "Critical State: Can't proceed with the flushItemsToStorage operations as object already exists in Updates' list." << std::endl;
@@ -940,6 +2257,11 @@ private:
 
 		for (auto itObject = vtObjects.begin(); itObject != vtObjects.end(); itObject++)
 		{
+			if (stRelinkedUIDs.find((*itObject).first) != stRelinkedUIDs.end())
+			{
+				continue;
+			}
+
 			if (m_mpUIDUpdates.find((*itObject).first) == m_mpUIDUpdates.end())
 			{
 				std::cout << "Critical State: (flushItemsToStorage) Object with similar key does not exists in the Updates' list." << std::endl;
@@ -954,8 +2276,16 @@ private:
 
 		vtObjects.clear();
 #else //__CONCURRENT__
+		admitWindowCandidates(m_mpObjects.size() > m_nCacheCapacity);
+
 		while (m_mpObjects.size() > m_nCacheCapacity)
 		{
+			// The pinned objects are not part of the list.
+			if (m_ptrTail == nullptr)
+			{
+				break;
+			}
+
 			if (m_ptrTail->m_ptrObject.use_count() > 1)
 			{
 				/* Info:
@@ -989,6 +2319,9 @@ private:
 				m_mpUIDUpdates[m_ptrTail->m_uidSelf] = std::make_pair(uidUpdated, m_ptrTail->m_ptrObject);
 			}
 
+			untrackDirty(m_ptrTail);
+
+			m_ptrTail->m_bResident = false;
 			m_mpObjects.erase(m_ptrTail->m_uidSelf);
 
 			std::shared_ptr<Item> ptrTemp = m_ptrTail;
@@ -1011,12 +2344,17 @@ private:
 
 	inline void flushAllItemsToStorage()
 	{
+		// The compactor may truncate the tail, therefore, it must not run while a batch is being appended.
+		std::unique_lock<std::recursive_mutex> lock_compaction(m_mtxCompaction);
+
 		std::vector<std::pair<ObjectUIDType, std::pair<std::optional<ObjectUIDType>, std::shared_ptr<ObjectType>>>> vtObjects;
 
 #ifdef __CONCURRENT__
 		std::unique_lock<std::shared_mutex> lock_cache(m_mtxCache);
 #endif //__CONCURRENT__
 
+		unpinAll();
+
 		for (uint32_t idx = 0, idxend = m_mpObjects.size(); idx < idxend; idx++)
 		{
 			if (m_ptrTail->m_ptrObject.use_count() > 1)
@@ -1043,6 +2381,9 @@ private:
 			m_nCacheFootprint -= ptrItemToFlush->m_ptrObject->getMemoryFootprint();
 #endif //__TRACK_CACHE_FOOTPRINT__
 
+			untrackDirty(ptrItemToFlush);
+
+			ptrItemToFlush->m_bResident = false;
 			m_mpObjects.erase(ptrItemToFlush->m_uidSelf);
 
 			m_ptrTail = ptrItemToFlush->m_ptrPrev;
@@ -1076,7 +2417,8 @@ private:
 		// TODO: ensure that no other thread should touch the storage related params..
 		size_t nNewOffset = 0;
 
-		m_ptrCallback->prepareFlush(vtObjects, m_ptrStorage->getNextAvailableBlockOffset(), nNewOffset, m_ptrStorage->getBlockSize(), m_ptrStorage->getStorageType());
+		std::unordered_set<ObjectUIDType> stRelinkedUIDs;
+		m_ptrCallback->prepareFlush(vtObjects, m_ptrStorage->getNextAvailableBlockOffset(), nNewOffset, m_ptrStorage->getBlockSize(), m_ptrStorage->getStorageType(), stRelinkedUIDs);
 
 		//m_ptrCallback->prepareFlush(vtObjects, nPos, m_ptrStorage->getBlockSize(), m_ptrStorage->getMediaType());
 
@@ -1088,6 +2430,12 @@ private:
 				throw new std::logic_error(".....");   // TODO: critical log.
 			}
 
+			// Nothing refers to the old UIDs of the relinked objects anymore.
+			if (stRelinkedUIDs.find((*itObject).first) != stRelinkedUIDs.end())
+			{
+				continue;
+			}
+
 			if (m_mpUIDUpdates.find((*itObject).first) != m_mpUIDUpdates.end())
 			{
 				std::cout << "Critical State: Can't proceed with the flushAllItemsToStorage operations as object already exists in Updates' list." << std::endl;
@@ -1109,6 +2457,11 @@ private:
 
 		for (auto itObject = vtObjects.begin(); itObject != vtObjects.end(); itObject++)
 		{
+			if (stRelinkedUIDs.find((*itObject).first) != stRelinkedUIDs.end())
+			{
+				continue;
+			}
+
 			if (m_mpUIDUpdates.find((*itObject).first) == m_mpUIDUpdates.end())
 			{
 				std::cout << "Critical State: Can't proceed with the flushAllItemsToStorage operations as object does not exists in Updates' list." << std::endl;
@@ -1129,12 +2482,17 @@ private:
 
 	inline void flushDataItemsToStorage()
 	{
+		// The compactor may truncate the tail, therefore, it must not run while a batch is being appended.
+		std::unique_lock<std::recursive_mutex> lock_compaction(m_mtxCompaction);
+
 		std::vector<std::pair<ObjectUIDType, std::pair<std::optional<ObjectUIDType>, std::shared_ptr<ObjectType>>>> vtObjects;
 
 #ifdef __CONCURRENT__
 		std::unique_lock<std::shared_mutex> lock_cache(m_mtxCache);
 #endif //__CONCURRENT__
 
+		unpinAll();
+
 		std::shared_ptr<Item> ptrItemToFlush = m_ptrTail;
 
 		for (uint32_t idx = 0, idxend = m_mpObjects.size(); idx < idxend; idx++)
@@ -1171,6 +2529,9 @@ private:
 			{
 				std::shared_ptr<Item> ptrTemp = ptrItemToFlush->m_ptrPrev;
 
+				untrackDirty(ptrItemToFlush);
+
+				ptrItemToFlush->m_bResident = false;
 				m_mpObjects.erase(ptrItemToFlush->m_uidSelf);
 
 				if (m_ptrTail == ptrItemToFlush)
@@ -1218,7 +2579,8 @@ private:
 		// TODO: ensure that no other thread should touch the storage related params..
 		size_t nNewOffset = 0;
 
-		m_ptrCallback->prepareFlush(vtObjects, m_ptrStorage->getNextAvailableBlockOffset(), nNewOffset, m_ptrStorage->getBlockSize(), m_ptrStorage->getStorageType());
+		std::unordered_set<ObjectUIDType> stRelinkedUIDs;
+		m_ptrCallback->prepareFlush(vtObjects, m_ptrStorage->getNextAvailableBlockOffset(), nNewOffset, m_ptrStorage->getBlockSize(), m_ptrStorage->getStorageType(), stRelinkedUIDs);
 
 		//m_ptrCallback->prepareFlush(vtObjects, nPos, m_ptrStorage->getBlockSize(), m_ptrStorage->getMediaType());
 
@@ -1230,6 +2592,12 @@ private:
 				throw new std::logic_error(".....");   // TODO: critical log.
 			}
 
+			// Nothing refers to the old UIDs of the relinked objects anymore.
+			if (stRelinkedUIDs.find((*itObject).first) != stRelinkedUIDs.end())
+			{
+				continue;
+			}
+
 			if (m_mpUIDUpdates.find((*itObject).first) != m_mpUIDUpdates.end())
 			{
 				std::cout << "Critical State: Can't proceed with the flushDataItemsToStorage operations as object already exists in Updates' list." << std::endl;
@@ -1251,6 +2619,11 @@ private:
 
 		for (auto itObject = vtObjects.begin(); itObject != vtObjects.end(); itObject++)
 		{
+			if (stRelinkedUIDs.find((*itObject).first) != stRelinkedUIDs.end())
+			{
+				continue;
+			}
+
 			if (m_mpUIDUpdates.find((*itObject).first) == m_mpUIDUpdates.end())
 			{
 				std::cout << "Critical State: Can't proceed with the flushDataItemsToStorage operations as object does not exists in Updates' list." << std::endl;
@@ -1276,6 +2649,8 @@ private:
 
 		std::unique_lock<std::shared_mutex> lock_cache(m_mtxCache);
 
+		unpinAll();
+
 		std::shared_ptr<Item> ptrItemToFlush = m_ptrTail;
 
 		for (uint32_t idx = 0, idxend = m_mpObjects.size(); idx < idxend; idx++)
@@ -1319,7 +2694,8 @@ private:
 
 		// TODO: ensure that no other thread should touch the storage related params..
 		size_t nNewOffset = 0;
-		m_ptrCallback->prepareFlush(vtObjects, m_ptrStorage->getNextAvailableBlockOffset(), nNewOffset, m_ptrStorage->getBlockSize(), m_ptrStorage->getStorageType());
+		std::unordered_set<ObjectUIDType> stRelinkedUIDs;
+		m_ptrCallback->prepareFlush(vtObjects, m_ptrStorage->getNextAvailableBlockOffset(), nNewOffset, m_ptrStorage->getBlockSize(), m_ptrStorage->getStorageType(), stRelinkedUIDs);
 
 		//m_ptrCallback->prepareFlush(vtObjects, nPos, m_ptrStorage->getBlockSize(), m_ptrStorage->getMediaType());
 
@@ -1358,6 +2734,8 @@ private:
 
 		vtObjects.clear();
 #else //__CONCURRENT__
+		unpinAll();
+
 		while (m_mpObjects.size() > m_nCacheCapacity)
 		{
 			if (m_ptrTail->m_ptrObject.use_count() > 1)
@@ -1393,6 +2771,9 @@ private:
 				m_mpUIDUpdates[m_ptrTail->m_uidSelf] = std::make_pair(uidUpdated, m_ptrTail->m_ptrObject);
 			}
 
+			untrackDirty(m_ptrTail);
+
+			m_ptrTail->m_bResident = false;
 			m_mpObjects.erase(m_ptrTail->m_uidSelf);
 
 			std::shared_ptr<Item> ptrTemp = m_ptrTail;
@@ -1425,22 +2806,120 @@ private:
 
 		} while (!ptrSelf->m_bStop);
 	}
+
+	static void handlerPrefetch(SelfType* ptrSelf)
+	{
+		std::unique_lock<std::mutex> lock_prefetch(ptrSelf->m_mtxPrefetch);
+
+		do
+		{
+			ptrSelf->m_cvPrefetch.wait(lock_prefetch, [&] { return ptrSelf->m_bStop || ptrSelf->m_dqPrefetch.size() > 0; });
+
+			if (ptrSelf->m_bStop)
+			{
+				break;
+			}
+
+			ObjectUIDType uidObject = ptrSelf->m_dqPrefetch.front();
+			ptrSelf->m_dqPrefetch.pop_front();
+
+			lock_prefetch.unlock();
+
+			ptrSelf->prefetchObject(uidObject);
+
+			lock_prefetch.lock();
+
+		} while (!ptrSelf->m_bStop);
+	}
+
+	// Reads an object ahead of its access and links it at the head, it then waits in the window like any other object read from the storage.
+	// The writers that move (or free) the objects hold the compaction lock, therefore, the object stays where its UID points while it is read.
+	// The removals do not, but they release the objects under the cache's lock, under which the object is checked again before it is linked.
+	void prefetchObject(const ObjectUIDType& uidObject)
+	{
+		std::unique_lock<std::recursive_mutex> lock_compaction(m_mtxCompaction);
+
+		{
+			std::shared_lock<std::shared_mutex> lock_cache(m_mtxCache);
+
+			if (m_mpObjects.find(uidObject) != m_mpObjects.end())
+			{
+				return;
+			}
+		}
+
+		{
+			// The object has been written elsewhere (or relocated) and its parent is yet to pick up the new UID.
+			std::shared_lock<std::shared_mutex> lock_storage(m_mtxStorage);
+
+			if (m_mpUIDUpdates.find(uidObject) != m_mpUIDUpdates.end())
+			{
+				return;
+			}
+		}
+
+		// The storages that never reuse the space need no check, an object that is no longer referred to is simply evicted in time.
+		if constexpr (requires { m_ptrStorage->isLive(uidObject); })
+		{
+			if (!m_ptrStorage->isLive(uidObject))
+			{
+				return;
+			}
+		}
+
+		ObjectTypePtr ptrObject = m_ptrStorage->getObject(uidObject);
+		if (ptrObject == nullptr)
+		{
+			return;
+		}
+
+		std::unique_lock<std::shared_mutex> lock_cache(m_mtxCache);
+
+		if (m_mpObjects.find(uidObject) != m_mpObjects.end())
+		{
+			return;
+		}
+
+		if constexpr (requires { m_ptrStorage->isLive(uidObject); })
+		{
+			if (!m_ptrStorage->isLive(uidObject))
+			{
+				return;
+			}
+		}
+
+		std::shared_ptr<Item> ptrItem = std::make_shared<Item>(uidObject, ptrObject);
+
+#ifdef __TRACK_CACHE_FOOTPRINT__
+		m_nCacheFootprint += ptrObject->getMemoryFootprint();
+#endif //__TRACK_CACHE_FOOTPRINT__
+
+		m_mpObjects[uidObject] = ptrItem;
+		ptrItem->m_bResident = true;
+		m_qWindow.push(ptrItem);
+
+		linkAtFront(ptrItem);
+	}
 #endif //__CONCURRENT__
 
 #ifdef __TREE_WITH_CACHE__
 public:
 	void applyExistingUpdates(std::vector<std::pair<ObjectUIDType, std::pair<std::optional<ObjectUIDType>, std::shared_ptr<ObjectType>>>>& vtNodes
-		, std::unordered_map<ObjectUIDType, std::pair<std::optional<ObjectUIDType>, std::shared_ptr<ObjectType>>>& mpUpdatedUIDs)
+		, UIDUpdatesMap<ObjectUIDType, ObjectType>& mpUpdatedUIDs)
 	{
 	}
 
 	void applyExistingUpdates(std::shared_ptr<ObjectType> ptrObject
-		, std::unordered_map<ObjectUIDType, std::pair<std::optional<ObjectUIDType>, std::shared_ptr<ObjectType>>>& mpUpdatedUIDs)
+		, UIDUpdatesMap<ObjectUIDType, ObjectType>& mpUpdatedUIDs)
+	{
+	}
+
+	void excludeUnflushableObjects(std::vector<std::pair<ObjectUIDType, std::pair<std::optional<ObjectUIDType>, std::shared_ptr<ObjectType>>>>& vtNodes)
 	{
 	}
 
 	void prepareFlush(std::vector<std::pair<ObjectUIDType, std::pair<std::optional<ObjectUIDType>, std::shared_ptr<ObjectType>>>>& vtNodes
-		, size_t nOffset, size_t& nNewOffset, size_t nBlockSize, ObjectUIDType::StorageMedia nMediaType)
+		, size_t nOffset, size_t& nNewOffset, size_t nBlockSize, ObjectUIDType::StorageMedia nMediaType, std::unordered_set<ObjectUIDType>& stRelinkedUIDs)
 	{
 	}
 #endif //__TREE_WITH_CACHE__
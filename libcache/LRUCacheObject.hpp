@@ -9,17 +9,19 @@
 
 #include <iostream>
 #include <fstream>
+#include <span>
 
 #include "ErrorCodes.h"
 
+// The index nodes are the ones with children.
 template <typename T>
-size_t doesCoreObjectContainIndex(const std::shared_ptr<T>& source) {
-	return source->isIndexNode();
+bool doesCoreObjectContainIndex(const std::shared_ptr<T>& source) {
+	return requires { source->getChildAt(0); };
 }
 
 template <typename... Types>
-size_t doesVariantContainIndex(std::variant<std::shared_ptr<Types>...>& source) {
-	return std::visit([](const auto& ptr) -> size_t {
+bool doesVariantContainIndex(std::variant<std::shared_ptr<Types>...>& source) {
+	return std::visit([](const auto& ptr) -> bool {
 		return doesCoreObjectContainIndex(ptr);
 		}, source);
 }
@@ -36,6 +38,35 @@ size_t getVariantMemoryFootprint(std::variant<std::shared_ptr<Types>...>& source
 		}, source);
 }
 
+template <typename T>
+size_t getCoreObjectSize(const std::shared_ptr<T>& source) {
+	return source->getSize();
+}
+
+template <typename... Types>
+size_t getVariantSize(const std::variant<std::shared_ptr<Types>...>& source) {
+	return std::visit([](const auto& ptr) -> size_t {
+		return getCoreObjectSize(ptr);
+		}, source);
+}
+
+template <typename T>
+int32_t takeCoreObjectUnreportedFootprint(const std::shared_ptr<T>& source) {
+	if constexpr (requires { source->takeUnreportedFootprint(); })
+	{
+		return source->takeUnreportedFootprint();
+	}
+
+	return 0;
+}
+
+template <typename... Types>
+int32_t takeVariantUnreportedFootprint(std::variant<std::shared_ptr<Types>...>& source) {
+	return std::visit([](const auto& ptr) -> int32_t {
+		return takeCoreObjectUnreportedFootprint(ptr);
+		}, source);
+}
+
 template <typename T>
 std::shared_ptr<T> cloneSharedPtr(const std::shared_ptr<T>& source) {
 	return source ? std::make_shared<T>(*source) : nullptr;
@@ -111,6 +142,18 @@ public:
 		CoreTypesMarshaller::template serialize<ValueCoreTypes...>(szBuffer, m_objData, uidObject, nBufferSize);
 	}
 
+	// The buffer is expected to hold the serialized object, see the getSize of the core types.
+	inline void writeToBuffer(char* szBuffer, uint8_t& uidObject, uint32_t& nBufferSize)
+	{
+		CoreTypesMarshaller::template writeToBuffer<ValueCoreTypes...>(szBuffer, m_objData, uidObject, nBufferSize);
+	}
+
+	// The span is sized by the caller, see prepareFlush, the object is written into it without an intermediate copy.
+	inline void serializeInto(std::span<char> spBuffer, uint8_t& uidObject, uint32_t& nBufferSize)
+	{
+		CoreTypesMarshaller::template serializeInto<ValueCoreTypes...>(spBuffer, m_objData, uidObject, nBufferSize);
+	}
+
 	inline bool getDirtyFlag() const 
 	{
 		return m_bDirty;
@@ -141,13 +184,25 @@ public:
 		m_mtx.unlock();
 	}
 
+	// The number of bytes the object takes once serialized.
+	inline size_t getSize() const
+	{
+		return getVariantSize(m_objData);
+	}
+
 	inline size_t getMemoryFootprint()
 	{
 		return sizeof(*this) + getVariantMemoryFootprint(m_objData);
 	}
 
+	// The footprint the object has gained outside of the tree's writes, e.g. when a node is promoted to DRAM on a read.
+	inline int32_t takeUnreportedFootprint()
+	{
+		return takeVariantUnreportedFootprint(m_objData);
+	}
+
 	inline bool isIndexNode()
 	{
-		return sizeof(*this) + doesVariantContainIndex(m_objData);
+		return doesVariantContainIndex(m_objData);
 	}
 };
\ No newline at end of file
@@ -152,39 +152,38 @@ public:
 		return std::memcmp(this, &rhs, sizeof(NodeUID)) < 0;
 	}
 
+	// The fields are folded into 64 bits and mixed with MurmurHash3's finalizer, every bit of the result depends on every
+	// bit of the fat pointer. The open-addressing maps (OpenAddressingMap.hpp) take the slot from the low bits of the hash
+	// and a fragment from its high bits, the offsets alone (multiples of the block size) would cluster in both.
+	static inline uint64_t mix(uint64_t nValue)
+	{
+		nValue ^= nValue >> 33;
+		nValue *= 0xff51afd7ed558ccdULL;
+		nValue ^= nValue >> 33;
+		nValue *= 0xc4ceb9fe1a85ec53ULL;
+		nValue ^= nValue >> 33;
+		return nValue;
+	}
+
 	size_t gethash() const
 	{
-		size_t hashValue = 0;
-		hashValue ^= std::hash<uint8_t>()(m_uid.m_nType);
-		hashValue ^= std::hash<uint8_t>()(m_uid.m_nMediaType);
+		uint64_t hashValue = ((uint64_t)m_uid.m_nType << 8) | m_uid.m_nMediaType;
 
 		switch (m_uid.m_nMediaType)
 		{
 		case ObjectFatUID::StorageMedia::None:
 			break;
 		case ObjectFatUID::StorageMedia::Volatile:
-			hashValue ^= std::hash<uintptr_t>()(m_uid.FATPOINTER.m_ptrVolatile);
-			break;
 		case ObjectFatUID::StorageMedia::DRAM:
-			hashValue ^= std::hash<uintptr_t>()(m_uid.FATPOINTER.m_ptrVolatile);
+			hashValue = mix(m_uid.FATPOINTER.m_ptrVolatile) ^ hashValue;
 			break;
-                case ObjectFatUID::StorageMedia::PMem:
-			{
-                        size_t offsetHash = std::hash<size_t>()(m_uid.FATPOINTER.m_ptrFile.m_nOffset);
-                        size_t sizeHash = std::hash<uint32_t>()(m_uid.FATPOINTER.m_ptrFile.m_nSize);
-                        hashValue ^= offsetHash ^ (sizeHash + 0x9e3779b9 + (offsetHash << 6) + (offsetHash >> 2));
-			}
-                        break;
+		case ObjectFatUID::StorageMedia::PMem:
 		case ObjectFatUID::StorageMedia::File:
-			{
-			size_t offsetHash = std::hash<size_t>()(m_uid.FATPOINTER.m_ptrFile.m_nOffset);
-			size_t sizeHash = std::hash<uint32_t>()(m_uid.FATPOINTER.m_ptrFile.m_nSize);
-			hashValue ^= offsetHash ^ (sizeHash + 0x9e3779b9 + (offsetHash << 6) + (offsetHash >> 2));
-			}
+			hashValue = mix(m_uid.FATPOINTER.m_ptrFile.m_nOffset) ^ ((uint64_t)m_uid.FATPOINTER.m_ptrFile.m_nSize << 16) ^ hashValue;
 			break;
 		}
 
-		return hashValue;
+		return (size_t)mix(hashValue);
 	}
 
 public:
@@ -0,0 +1,398 @@
+#pragma once
+#include <cstdint>
+#include <cstddef>
+#include <memory>
+#include <utility>
+#include <iterator>
+#include <functional>
+
+// An open-addressing hash map with Robin Hood probing and backward-shift deletion, it backs the cache's index of the
+// resident objects and its list of UID updates. The entries live in a single flat array, therefore, there is no allocation
+// per entry, and as each slot carries a fragment of the hash next to its probe distance, a miss rarely touches a key.
+// The hash is expected to be well mixed (see ObjectFatUID::gethash), the home slot is taken from its low bits.
+//
+// Unlike std::unordered_map, an insertion or an erase may move the other entries around, i.e. neither the references nor
+// the iterators are stable across modifications of the map.
+
+#define OPEN_ADDRESSING_MAP_MIN_CAPACITY 16
+#define OPEN_ADDRESSING_MAP_MAX_LOAD_PERCENT 80
+#define OPEN_ADDRESSING_MAP_MAX_DISTANCE 0xFF
+
+template <typename KeyType, typename ValueType, typename Hash = std::hash<KeyType>, typename KeyEqual = std::equal_to<KeyType>>
+class OpenAddressingMap
+{
+public:
+	typedef std::pair<KeyType, ValueType> value_type;
+
+private:
+	typedef OpenAddressingMap<KeyType, ValueType, Hash, KeyEqual> SelfType;
+
+	// Zero marks an empty slot, otherwise the low byte holds the distance from the home slot plus one and the rest a fragment of the hash.
+	std::unique_ptr<uint32_t[]> m_ptrMeta;
+	value_type* m_ptrSlots;
+
+	size_t m_nCapacity;
+	size_t m_nSize;
+
+	std::allocator<value_type> m_oAllocator;
+
+public:
+	template <bool bConst>
+	class Iterator
+	{
+		friend class OpenAddressingMap;
+
+	public:
+		typedef std::forward_iterator_tag iterator_category;
+		typedef typename SelfType::value_type value_type;
+		typedef std::ptrdiff_t difference_type;
+		typedef std::conditional_t<bConst, const value_type*, value_type*> pointer;
+		typedef std::conditional_t<bConst, const value_type&, value_type&> reference;
+
+	private:
+		std::conditional_t<bConst, const SelfType*, SelfType*> m_ptrMap;
+		size_t m_nIdx;
+
+		Iterator(std::conditional_t<bConst, const SelfType*, SelfType*> ptrMap, size_t nIdx)
+			: m_ptrMap(ptrMap)
+			, m_nIdx(nIdx)
+		{
+			while (m_nIdx < m_ptrMap->m_nCapacity && m_ptrMap->m_ptrMeta[m_nIdx] == 0)
+			{
+				m_nIdx++;
+			}
+		}
+
+	public:
+		Iterator()
+			: m_ptrMap(nullptr)
+			, m_nIdx(0)
+		{
+		}
+
+		operator Iterator<true>() const
+		{
+			return Iterator<true>(m_ptrMap, m_nIdx);
+		}
+
+		inline reference operator*() const
+		{
+			return m_ptrMap->m_ptrSlots[m_nIdx];
+		}
+
+		inline pointer operator->() const
+		{
+			return &m_ptrMap->m_ptrSlots[m_nIdx];
+		}
+
+		inline Iterator& operator++()
+		{
+			do
+			{
+				m_nIdx++;
+			} while (m_nIdx < m_ptrMap->m_nCapacity && m_ptrMap->m_ptrMeta[m_nIdx] == 0);
+
+			return *this;
+		}
+
+		inline Iterator operator++(int)
+		{
+			Iterator itTemp = *this;
+			++(*this);
+			return itTemp;
+		}
+
+		inline bool operator==(const Iterator& rhs) const
+		{
+			return m_nIdx == rhs.m_nIdx;
+		}
+
+		inline bool operator!=(const Iterator& rhs) const
+		{
+			return m_nIdx != rhs.m_nIdx;
+		}
+	};
+
+	typedef Iterator<false> iterator;
+	typedef Iterator<true> const_iterator;
+
+public:
+	~OpenAddressingMap()
+	{
+		clear();
+
+		if (m_ptrSlots != nullptr)
+		{
+			m_oAllocator.deallocate(m_ptrSlots, m_nCapacity);
+			m_ptrSlots = nullptr;
+		}
+	}
+
+	OpenAddressingMap()
+		: m_ptrSlots(nullptr)
+		, m_nCapacity(0)
+		, m_nSize(0)
+	{
+	}
+
+	OpenAddressingMap(const OpenAddressingMap&) = delete;
+	OpenAddressingMap& operator=(const OpenAddressingMap&) = delete;
+
+public:
+	inline size_t size() const
+	{
+		return m_nSize;
+	}
+
+	inline bool empty() const
+	{
+		return m_nSize == 0;
+	}
+
+	inline iterator begin()
+	{
+		return iterator(this, 0);
+	}
+
+	inline iterator end()
+	{
+		return iterator(this, m_nCapacity);
+	}
+
+	inline const_iterator begin() const
+	{
+		return const_iterator(this, 0);
+	}
+
+	inline const_iterator end() const
+	{
+		return const_iterator(this, m_nCapacity);
+	}
+
+	inline iterator find(const KeyType& key)
+	{
+		return iterator(this, findIdx(key));
+	}
+
+	inline const_iterator find(const KeyType& key) const
+	{
+		return const_iterator(this, findIdx(key));
+	}
+
+	inline size_t count(const KeyType& key) const
+	{
+		return findIdx(key) != m_nCapacity ? 1 : 0;
+	}
+
+	ValueType& operator[](const KeyType& key)
+	{
+		size_t nIdx = findIdx(key);
+		if (nIdx != m_nCapacity)
+		{
+			return m_ptrSlots[nIdx].second;
+		}
+
+		// The insertion may reallocate the slots.
+		nIdx = insertIdx(value_type(key, ValueType()));
+		return m_ptrSlots[nIdx].second;
+	}
+
+	size_t erase(const KeyType& key)
+	{
+		size_t nIdx = findIdx(key);
+		if (nIdx == m_nCapacity)
+		{
+			return 0;
+		}
+
+		// The key may well be the one in the slot, it is not to be accessed past this point.
+		eraseIdx(nIdx);
+		return 1;
+	}
+
+	void clear()
+	{
+		for (size_t nIdx = 0; nIdx < m_nCapacity; nIdx++)
+		{
+			if (m_ptrMeta[nIdx] != 0)
+			{
+				std::destroy_at(&m_ptrSlots[nIdx]);
+				m_ptrMeta[nIdx] = 0;
+			}
+		}
+
+		m_nSize = 0;
+	}
+
+	void reserve(size_t nCount)
+	{
+		size_t nCapacity = m_nCapacity == 0 ? OPEN_ADDRESSING_MAP_MIN_CAPACITY : m_nCapacity;
+		while (nCount * 100 > nCapacity * OPEN_ADDRESSING_MAP_MAX_LOAD_PERCENT)
+		{
+			nCapacity *= 2;
+		}
+
+		if (nCapacity != m_nCapacity)
+		{
+			rehash(nCapacity);
+		}
+	}
+
+private:
+	static inline uint32_t getFragment(size_t nHash)
+	{
+		return (uint32_t)((uint64_t)nHash >> 40) << 8;
+	}
+
+	inline size_t findIdx(const KeyType& key) const
+	{
+		if (m_nSize == 0)
+		{
+			return m_nCapacity;
+		}
+
+		size_t nHash = Hash()(key);
+		size_t nMask = m_nCapacity - 1;
+		size_t nIdx = nHash & nMask;
+
+		// The entries along a probe sequence are ordered by their distance, the lookup stops at the first one closer to its home slot.
+		uint32_t nExpected = getFragment(nHash) | 1;
+		while (true)
+		{
+			uint32_t nMeta = m_ptrMeta[nIdx];
+			if ((nMeta & 0xFF) < (nExpected & 0xFF))
+			{
+				return m_nCapacity;
+			}
+
+			if (nMeta == nExpected && KeyEqual()(m_ptrSlots[nIdx].first, key))
+			{
+				return nIdx;
+			}
+
+			if ((nExpected & 0xFF) == OPEN_ADDRESSING_MAP_MAX_DISTANCE)
+			{
+				return m_nCapacity;
+			}
+
+			nExpected++;
+			nIdx = (nIdx + 1) & nMask;
+		}
+	}
+
+	// Inserts an entry whose key is not in the map yet and returns the slot it ends up in.
+	size_t insertIdx(value_type&& value)
+	{
+		if ((m_nSize + 1) * 100 > m_nCapacity * OPEN_ADDRESSING_MAP_MAX_LOAD_PERCENT)
+		{
+			rehash(m_nCapacity == 0 ? OPEN_ADDRESSING_MAP_MIN_CAPACITY : m_nCapacity * 2);
+		}
+
+		while (true)
+		{
+			size_t nHash = Hash()(value.first);
+			size_t nMask = m_nCapacity - 1;
+			size_t nIdx = nHash & nMask;
+
+			uint32_t nMeta = getFragment(nHash) | 1;
+			while ((nMeta & 0xFF) < OPEN_ADDRESSING_MAP_MAX_DISTANCE && m_ptrMeta[nIdx] != 0 && (m_ptrMeta[nIdx] & 0xFF) >= (nMeta & 0xFF))
+			{
+				nMeta++;
+				nIdx = (nIdx + 1) & nMask;
+			}
+
+			// A probe sequence this long means the table is too crowded around the home slot.
+			if ((nMeta & 0xFF) == OPEN_ADDRESSING_MAP_MAX_DISTANCE)
+			{
+				rehash(m_nCapacity * 2);
+				continue;
+			}
+
+			size_t nResultIdx = nIdx;
+
+			// The entry takes the slot of the first one that is closer to its home, which is then carried further, and so on.
+			while (m_ptrMeta[nIdx] != 0)
+			{
+				if ((m_ptrMeta[nIdx] & 0xFF) < (nMeta & 0xFF))
+				{
+					std::swap(value, m_ptrSlots[nIdx]);
+					std::swap(nMeta, m_ptrMeta[nIdx]);
+				}
+
+				nMeta++;
+				nIdx = (nIdx + 1) & nMask;
+
+				if ((nMeta & 0xFF) == OPEN_ADDRESSING_MAP_MAX_DISTANCE)
+				{
+					// The entry carried at this point is not the new one, it is placed by the rehash.
+					size_t nCapacity = m_nCapacity * 2;
+					KeyType key = m_ptrSlots[nResultIdx].first;
+
+					rehash(nCapacity, &value);
+
+					return findIdx(key);
+				}
+			}
+
+			std::construct_at(&m_ptrSlots[nIdx], std::move(value));
+			m_ptrMeta[nIdx] = nMeta;
+			m_nSize++;
+
+			return nResultIdx;
+		}
+	}
+
+	void eraseIdx(size_t nIdx)
+	{
+		size_t nMask = m_nCapacity - 1;
+
+		std::destroy_at(&m_ptrSlots[nIdx]);
+		m_ptrMeta[nIdx] = 0;
+		m_nSize--;
+
+		// The followers that are away from their home slots move a slot back.
+		size_t nNextIdx = (nIdx + 1) & nMask;
+		while ((m_ptrMeta[nNextIdx] & 0xFF) > 1)
+		{
+			std::construct_at(&m_ptrSlots[nIdx], std::move(m_ptrSlots[nNextIdx]));
+			std::destroy_at(&m_ptrSlots[nNextIdx]);
+
+			m_ptrMeta[nIdx] = m_ptrMeta[nNextIdx] - 1;
+			m_ptrMeta[nNextIdx] = 0;
+
+			nIdx = nNextIdx;
+			nNextIdx = (nIdx + 1) & nMask;
+		}
+	}
+
+	void rehash(size_t nCapacity, value_type* ptrPending = nullptr)
+	{
+		std::unique_ptr<uint32_t[]> ptrMeta = std::move(m_ptrMeta);
+		value_type* ptrSlots = m_ptrSlots;
+		size_t nOldCapacity = m_nCapacity;
+
+		m_ptrMeta = std::make_unique<uint32_t[]>(nCapacity);
+		m_ptrSlots = m_oAllocator.allocate(nCapacity);
+		m_nCapacity = nCapacity;
+		m_nSize = 0;
+
+		for (size_t nIdx = 0; nIdx < nOldCapacity; nIdx++)
+		{
+			if (ptrMeta[nIdx] != 0)
+			{
+				insertIdx(std::move(ptrSlots[nIdx]));
+				std::destroy_at(&ptrSlots[nIdx]);
+			}
+		}
+
+		if (ptrPending != nullptr)
+		{
+			insertIdx(std::move(*ptrPending));
+		}
+
+		if (ptrSlots != nullptr)
+		{
+			m_oAllocator.deallocate(ptrSlots, nOldCapacity);
+		}
+	}
+};
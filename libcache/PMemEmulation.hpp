@@ -0,0 +1,290 @@
+#pragma once
+#include <iostream>
+#include <atomic>
+#include <chrono>
+#include <cstring>
+#include <cstdint>
+#include <algorithm>
+#include <stdexcept>
+#include <fcntl.h>
+
+#ifndef _MSC_VER
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#endif //_MSC_VER
+
+// Stands in for libpmem (built with __PMEM_EMULATION__) so that the PMem code paths can be exercised on any file, e.g. on tmpfs.
+// The file is mapped with mmap and a drain syncs the ranges flushed since the previous one with msync.
+// The media is modelled by the latency and the bandwidth below, the time it would have taken is either injected or only accounted.
+
+#define PMEM_FILE_CREATE	(1 << 0)
+#define PMEM_FILE_EXCL		(1 << 1)
+
+#define PMEM_F_MEM_NOFLUSH	(1U << 5)
+
+#define PMEM_EMULATION_CACHE_LINE 64
+
+struct PMemLatencyModel
+{
+	uint32_t m_nReadLatencyNs;
+	uint32_t m_nWriteLatencyNs;		// Paid once per drain, i.e. once the flushed lines are to reach the persistence domain.
+	uint32_t m_nReadBandwidthMBps;	// Zero for unlimited.
+	uint32_t m_nWriteBandwidthMBps;	// Zero for unlimited.
+
+	// DRAM-like, nothing is added to the cost of the mapping itself.
+	static PMemLatencyModel none()
+	{
+		return { 0, 0, 0, 0 };
+	}
+
+	// A single first-generation Optane DIMM in App Direct mode.
+	static PMemLatencyModel optane()
+	{
+		return { 305, 94, 6600, 2300 };
+	}
+};
+
+struct PMemEmulationStats
+{
+	uint64_t m_nBytesRead;
+	uint64_t m_nBytesFlushed;
+	uint64_t m_nDrains;
+	uint64_t m_nMediaTimeNs;	// The time the accesses would have taken on the modelled media.
+};
+
+class PMemEmulation
+{
+	struct State
+	{
+		PMemLatencyModel m_oModel = PMemLatencyModel::none();
+		bool m_bInjectLatency = false;
+
+		std::atomic<uint64_t> m_nBytesRead = 0;
+		std::atomic<uint64_t> m_nBytesFlushed = 0;
+		std::atomic<uint64_t> m_nDrains = 0;
+		std::atomic<uint64_t> m_nMediaTimeNs = 0;
+	};
+
+	// The ranges flushed by the calling thread that are yet to be drained.
+	struct PendingRange
+	{
+		uintptr_t m_nBegin = UINTPTR_MAX;
+		uintptr_t m_nEnd = 0;
+	};
+
+	static State& getState()
+	{
+		static State oState;
+		return oState;
+	}
+
+	static PendingRange& getPendingRange()
+	{
+		static thread_local PendingRange oRange;
+		return oRange;
+	}
+
+	static void charge(uint64_t nTimeNs)
+	{
+		State& oState = getState();
+		oState.m_nMediaTimeNs += nTimeNs;
+
+		if (!oState.m_bInjectLatency || nTimeNs == 0)
+		{
+			return;
+		}
+
+		// Spinning, as the sleep granularity is far coarser than the latencies modelled.
+		auto tsEnd = std::chrono::steady_clock::now() + std::chrono::nanoseconds(nTimeNs);
+		while (std::chrono::steady_clock::now() < tsEnd);
+	}
+
+	static uint64_t getTransferTime(size_t nLength, uint32_t nBandwidthMBps)
+	{
+		// One MB/s is one byte per microsecond.
+		return nBandwidthMBps == 0 ? 0 : (uint64_t)nLength * 1000 / nBandwidthMBps;
+	}
+
+public:
+	// Applies to the whole process, it is meant to be set before the stores are created.
+	// With bInjectLatency unset the media time is only accounted (see getStats), which projects the cost without slowing the run down.
+	static void configure(const PMemLatencyModel& oModel, bool bInjectLatency)
+	{
+		getState().m_oModel = oModel;
+		getState().m_bInjectLatency = bInjectLatency;
+	}
+
+	static PMemEmulationStats getStats()
+	{
+		State& oState = getState();
+		return { oState.m_nBytesRead, oState.m_nBytesFlushed, oState.m_nDrains, oState.m_nMediaTimeNs };
+	}
+
+	static void resetStats()
+	{
+		State& oState = getState();
+		oState.m_nBytesRead = 0;
+		oState.m_nBytesFlushed = 0;
+		oState.m_nDrains = 0;
+		oState.m_nMediaTimeNs = 0;
+	}
+
+	// The mapping is read in place, therefore, it is for the storage to tell when an object is faulted in.
+	static void read(size_t nLength)
+	{
+		getState().m_nBytesRead += nLength;
+		charge(getState().m_oModel.m_nReadLatencyNs + getTransferTime(nLength, getState().m_oModel.m_nReadBandwidthMBps));
+	}
+
+	static void flush(const void* hMemory, size_t nLength)
+	{
+		PendingRange& oRange = getPendingRange();
+		oRange.m_nBegin = std::min(oRange.m_nBegin, reinterpret_cast<uintptr_t>(hMemory));
+		oRange.m_nEnd = std::max(oRange.m_nEnd, reinterpret_cast<uintptr_t>(hMemory) + nLength);
+
+		// The media is written in whole lines.
+		size_t nLines = (reinterpret_cast<uintptr_t>(hMemory) % PMEM_EMULATION_CACHE_LINE + nLength + PMEM_EMULATION_CACHE_LINE - 1) / PMEM_EMULATION_CACHE_LINE;
+
+		getState().m_nBytesFlushed += nLines * PMEM_EMULATION_CACHE_LINE;
+		charge(getTransferTime(nLines * PMEM_EMULATION_CACHE_LINE, getState().m_oModel.m_nWriteBandwidthMBps));
+	}
+
+	static int drain()
+	{
+		PendingRange& oRange = getPendingRange();
+
+		int nResult = 0;
+		if (oRange.m_nEnd > oRange.m_nBegin)
+		{
+			nResult = msync(oRange.m_nBegin, oRange.m_nEnd - oRange.m_nBegin);
+		}
+
+		oRange = PendingRange();
+
+		getState().m_nDrains++;
+		charge(getState().m_oModel.m_nWriteLatencyNs);
+
+		return nResult;
+	}
+
+	static int msync(uintptr_t nBegin, size_t nLength)
+	{
+#ifndef _MSC_VER
+		uintptr_t nPageSize = sysconf(_SC_PAGESIZE);
+		uintptr_t nPageBegin = nBegin & ~(nPageSize - 1);
+
+		return ::msync(reinterpret_cast<void*>(nPageBegin), nLength + (nBegin - nPageBegin), MS_SYNC);
+#else //_MSC_VER
+		return 0;
+#endif //_MSC_VER
+	}
+};
+
+#ifndef _MSC_VER
+// The subset of libpmem that PMemStorage relies on.
+inline void* pmem_map_file(const char* szPath, size_t nLength, int nFlags, mode_t nMode, size_t* ptrMappedLen, int* ptrIsPMem)
+{
+	int nOpenFlags = O_RDWR;
+	if (nFlags & PMEM_FILE_CREATE)
+	{
+		nOpenFlags |= O_CREAT;
+	}
+	if (nFlags & PMEM_FILE_EXCL)
+	{
+		nOpenFlags |= O_EXCL;
+	}
+
+	int nFile = open(szPath, nOpenFlags, nMode);
+	if (nFile < 0)
+	{
+		return NULL;
+	}
+
+	if (nFlags & PMEM_FILE_CREATE)
+	{
+		if (ftruncate(nFile, nLength) != 0)
+		{
+			close(nFile);
+			return NULL;
+		}
+	}
+	else
+	{
+		struct stat stFile;
+		if (fstat(nFile, &stFile) != 0)
+		{
+			close(nFile);
+			return NULL;
+		}
+
+		nLength = stFile.st_size;
+	}
+
+	void* hMemory = mmap(NULL, nLength, PROT_READ | PROT_WRITE, MAP_SHARED, nFile, 0);
+	close(nFile);
+
+	if (hMemory == MAP_FAILED)
+	{
+		return NULL;
+	}
+
+	*ptrMappedLen = nLength;
+
+	// Reported as PMem so that the flush-and-drain path is the one taken.
+	*ptrIsPMem = 1;
+
+	return hMemory;
+}
+
+inline int pmem_unmap(void* hMemory, size_t nLength)
+{
+	return munmap(hMemory, nLength);
+}
+
+inline void pmem_flush(const void* hMemory, size_t nLength)
+{
+	PMemEmulation::flush(hMemory, nLength);
+}
+
+inline void pmem_drain()
+{
+	if (PMemEmulation::drain() != 0)
+	{
+		std::cout << "Critical State: Failed to sync the emulated PMem." << std::endl;
+		throw new std::logic_error(".....");   // TODO: critical log.
+	}
+}
+
+inline void pmem_persist(const void* hMemory, size_t nLength)
+{
+	pmem_flush(hMemory, nLength);
+	pmem_drain();
+}
+
+inline int pmem_msync(const void* hMemory, size_t nLength)
+{
+	PMemEmulation::flush(hMemory, nLength);
+	return PMemEmulation::drain();
+}
+
+inline void* pmem_memcpy_persist(void* hDest, const void* hSrc, size_t nLength)
+{
+	memcpy(hDest, hSrc, nLength);
+	pmem_persist(hDest, nLength);
+
+	return hDest;
+}
+
+inline void* pmem_memcpy(void* hDest, const void* hSrc, size_t nLength, unsigned int nFlags)
+{
+	memcpy(hDest, hSrc, nLength);
+
+	if (!(nFlags & PMEM_F_MEM_NOFLUSH))
+	{
+		pmem_persist(hDest, nLength);
+	}
+
+	return hDest;
+}
+#endif //_MSC_VER
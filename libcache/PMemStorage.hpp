@@ -7,10 +7,16 @@
 #include <fstream>
 #include <variant>
 #include <cmath>
+#include <algorithm>
+#include <span>
 
+#ifdef __PMEM_EMULATION__
+#include "PMemEmulation.hpp"
+#else //__PMEM_EMULATION__
 #ifndef _MSC_VER
 #include <libpmem.h>
 #endif //_MSC_VER
+#endif //__PMEM_EMULATION__
 
 template<
 	typename ICallback,
@@ -66,6 +72,36 @@ class PMemStorage
 		return true;
 	}
 
+	// Writes the range back from the CPU caches without waiting for it, a batch of objects is fenced once (see drainMMapFile).
+	void flushMMapFile(const void* hMemory, size_t nLen)
+	{
+#ifndef _MSC_VER
+		if (nIsPMem)
+		{
+			pmem_flush(hMemory, nLen);
+		}
+#endif //_MSC_VER
+	}
+
+	// Waits for the preceding flushes. The mapping is not on PMem if the file is not, in which case the range is synced instead.
+	bool drainMMapFile(const void* hMemory, size_t nLen)
+	{
+#ifndef _MSC_VER
+		if (nIsPMem)
+		{
+			pmem_drain();
+			return true;
+		}
+
+		if (pmem_msync(hMemory, nLen) != 0)
+		{
+			return false;
+		}
+#endif //_MSC_VER
+
+		return true;
+	}
+
 	bool readMMapFile(const void* hMemory, char* szBuf, size_t nLen)
 	{
 #ifndef _MSC_VER
@@ -195,6 +231,9 @@ public:
 	{
 		//if(uidObject.getMediaType() != 3)
 		//std::cout << "----------------------------------------------------->> " << static_cast<int>(uidObject.getMediaType()) << "," << uidObject.getPersistentPointerValue() << std::endl;
+#ifdef __PMEM_EMULATION__
+		PMemEmulation::read(uidObject.getPersistentObjectSize());
+#endif //__PMEM_EMULATION__
 		return std::make_shared<ObjectType>((char*)m_hMemory + uidObject.getPersistentPointerValue());
 
 		/*
@@ -234,18 +273,18 @@ public:
 		uint32_t nBufferSize = 0;
 		uint8_t uidObjectType = 0;
 
-		char* szBuffer = NULL;
-		ptrObject->serialize(szBuffer, uidObjectType, nBufferSize);
-
-		size_t nOffset = m_nNextBlock * m_nBlockSize;
-
 #ifdef __CONCURRENT__
 		std::unique_lock<std::shared_mutex> lock_storage(m_mtxStorage);
 #endif //__CONCURRENT__
 
-#ifndef _MSC_VER
-		if (!writeMMapFile(m_hMemory + nOffset, szBuffer, nBufferSize))
-#endif //_MSC_VER
+		size_t nOffset = m_nNextBlock * m_nBlockSize;
+		char* szTarget = reinterpret_cast<char*>(m_hMemory) + nOffset;
+
+		// Serialized straight into the mapping, there is no intermediate buffer to copy from.
+		ptrObject->serializeInto(std::span<char>(szTarget, m_nMappedLen - nOffset), uidObjectType, nBufferSize);
+		flushMMapFile(szTarget, nBufferSize);
+
+		if (!drainMMapFile(szTarget, nBufferSize))
 		{
 			std::cout << "Critical State: Failed to write object to PMemStorage." << std::endl;
 			throw new std::logic_error(".....");   // TODO: critical log.
@@ -257,8 +296,6 @@ public:
 		lock_storage.unlock();
 #endif //__CONCURRENT__
 
-		delete[] szBuffer;
-
 		ObjectUIDType::createAddressFromPMemOffset(uidUpdated, uidObject.getObjectType(), nOffset, nBufferSize);
 
 		return CacheErrorCode::Success;
@@ -313,23 +350,35 @@ public:
 		std::unique_lock<std::shared_mutex> lock_file_storage(m_mtxStorage);
 #endif //__CONCURRENT__
 
+		// The batch is contiguous, it spans from the lowest to the highest offset written.
+		size_t nBatchBegin = m_nMappedLen;
+		size_t nBatchEnd = 0;
+
 		for (auto it = vtObjects.begin(); it != vtObjects.end(); it++)
 		{
 			uint32_t nBufferSize = 0;
 			uint8_t uidObjectType = 0;
 
-			char* szBuffer = NULL; //2
-			(*it).second.second->serialize(szBuffer, uidObjectType, nBufferSize);
-			
-#ifndef _MSC_VER
-			if (!writeMMapFile(m_hMemory + (*(*it).second.first).getPersistentPointerValue(), szBuffer, nBufferSize))
-#endif //_MSC_VER
+			size_t nOffset = (*(*it).second.first).getPersistentPointerValue();
+			if (nOffset + (*(*it).second.first).getPersistentObjectSize() > m_nMappedLen)
 			{
 				std::cout << "Critical State: Failed to write objects to PMemStorage." << std::endl;
 				throw new std::logic_error(".....");   // TODO: critical log.
 			}
 
-			delete[] szBuffer;
+			// Each object is only flushed, the whole batch waits for a single drain below.
+			char* szTarget = reinterpret_cast<char*>(m_hMemory) + nOffset;
+			(*it).second.second->serializeInto(std::span<char>(szTarget, (*(*it).second.first).getPersistentObjectSize()), uidObjectType, nBufferSize);
+			flushMMapFile(szTarget, nBufferSize);
+
+			nBatchBegin = std::min(nBatchBegin, nOffset);
+			nBatchEnd = std::max(nBatchEnd, nOffset + nBufferSize);
+		}
+
+		if (nBatchEnd > nBatchBegin && !drainMMapFile(reinterpret_cast<char*>(m_hMemory) + nBatchBegin, nBatchEnd - nBatchBegin))
+		{
+			std::cout << "Critical State: Failed to write objects to PMemStorage." << std::endl;
+			throw new std::logic_error(".....");   // TODO: critical log.
 		}
 
 		m_nNextBlock = nNewOffset;
@@ -7,6 +7,7 @@
 #include <variant>
 #include <typeinfo>
 #include <unordered_map>
+#include <unordered_set>
 #include <queue>
 #include  <algorithm>
 #include <tuple>
@@ -203,17 +204,21 @@ private:
 #ifdef __TREE_WITH_CACHE__
 public:
 	void applyExistingUpdates(std::vector<std::pair<ObjectUIDType, std::pair<std::optional<ObjectUIDType>, std::shared_ptr<ObjectType>>>>& vtNodes
-		, std::unordered_map<ObjectUIDType, std::pair<std::optional<ObjectUIDType>, std::shared_ptr<ObjectType>>>& mpUpdatedUIDs)
+		, UIDUpdatesMap<ObjectUIDType, ObjectType>& mpUpdatedUIDs)
 	{
 	}
 
 	void applyExistingUpdates(std::shared_ptr<ObjectType> ptrObject
-		, std::unordered_map<ObjectUIDType, std::pair<std::optional<ObjectUIDType>, std::shared_ptr<ObjectType>>>& mpUpdatedUIDs)
+		, UIDUpdatesMap<ObjectUIDType, ObjectType>& mpUpdatedUIDs)
+	{
+	}
+
+	void excludeUnflushableObjects(std::vector<std::pair<ObjectUIDType, std::pair<std::optional<ObjectUIDType>, std::shared_ptr<ObjectType>>>>& vtNodes)
 	{
 	}
 
 	void prepareFlush(std::vector<std::pair<ObjectUIDType, std::pair<std::optional<ObjectUIDType>, std::shared_ptr<ObjectType>>>>& vtNodes
-		, size_t nOffset, size_t& nNewOffset, size_t nBlockSize, ObjectUIDType::StorageMedia nMediaType)
+		, size_t nOffset, size_t& nNewOffset, size_t nBlockSize, ObjectUIDType::StorageMedia nMediaType, std::unordered_set<ObjectUIDType>& stRelinkedUIDs)
 	{
 	}
 #endif //__TREE_WITH_CACHE__
@@ -8,6 +8,7 @@
 #include <typeinfo>
 #include <iostream>
 #include <fstream>
+#include <span>
 #include "CacheErrorCodes.h"
 
 
@@ -60,6 +61,18 @@ public:
 		CoreTypesMarshaller::template serialize<ValueCoreTypes...>(szBuffer, m_objData, uidObject, nBufferSize);
 	}
 
+	// The buffer is expected to hold the serialized object, see the getSize of the core types.
+	inline void writeToBuffer(char* szBuffer, uint8_t& uidObject, uint32_t& nBufferSize)
+	{
+		CoreTypesMarshaller::template writeToBuffer<ValueCoreTypes...>(szBuffer, m_objData, uidObject, nBufferSize);
+	}
+
+	// The span is sized by the caller, see prepareFlush, the object is written into it without an intermediate copy.
+	inline void serializeInto(std::span<char> spBuffer, uint8_t& uidObject, uint32_t& nBufferSize)
+	{
+		CoreTypesMarshaller::template serializeInto<ValueCoreTypes...>(spBuffer, m_objData, uidObject, nBufferSize);
+	}
+
 	inline bool getDirtyFlag() const 
 	{
 		return m_bDirty;
@@ -97,6 +110,6 @@ public:
 
 	inline bool isIndexNode()
 	{
-		return sizeof(*this) + doesVariantContainIndex(m_objData);
+		return doesVariantContainIndex(m_objData);
 	}
 };
\ No newline at end of file
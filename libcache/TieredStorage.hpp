@@ -0,0 +1,536 @@
+#pragma once
+#include <memory>
+#include <iostream>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+#include <map>
+#include <unordered_map>
+#include <algorithm>
+#include <type_traits>
+#include <tuple>
+
+#include "IFlushCallback.h"
+
+#define TIERED_STORAGE_REGION_BLOCKS 1024
+#define TIERED_STORAGE_HEADROOM_RATIO 0.25	// The share of the fast tier kept free at its tail, the batches go to the slow tier once it is used up.
+#define TIERED_STORAGE_DEMOTION_HIGH_RATIO 0.75	// The demotions start once the live objects take up this share of the fast tier...
+#define TIERED_STORAGE_DEMOTION_LOW_RATIO 0.5	// ... and go on until they are down to this share.
+#define TIERED_STORAGE_PROMOTION_READS 2	// The reads after which a leaf on the slow tier is written back to the fast tier.
+#define TIERED_STORAGE_MAX_TRACKED_READS 1024 * 1024
+
+// Places the nodes on a fast tier (VolatileStorage or PMemStorage) and a slow tier (FileStorage), the media bits of the UIDs tell them apart.
+// Everything the cache writes lands on the fast tier, the leaves that are read the least are demoted to the slow tier later on (see LRUCache::demote)
+// and the ones that are read repeatedly from the slow tier are written back to the fast tier once they are evicted.
+// The index nodes are never demoted. The space freed on the fast tier is reclaimed by the compaction (see LRUCache::compact).
+// Both tiers use the same block size. Checkpoints are not supported as the fast tier need not be persistent.
+template <typename FastStorageType, typename SlowStorageType>
+class TieredStorage
+{
+	typedef TieredStorage<FastStorageType, SlowStorageType> SelfType;
+
+public:
+	typedef typename FastStorageType::ObjectUIDType ObjectUIDType;
+	typedef typename FastStorageType::ObjectType ObjectType;
+
+	static_assert(std::is_same_v<ObjectUIDType, typename SlowStorageType::ObjectUIDType>);
+	static_assert(std::is_same_v<ObjectType, typename SlowStorageType::ObjectType>);
+
+private:
+	// The first core type is the leaf (see BPlusStore).
+	static constexpr uint8_t LEAF_UID = std::tuple_element<0, typename ObjectType::ValueCoreTypesTuple>::type::UID;
+
+	std::unique_ptr<FastStorageType> m_ptrFastStorage;
+	std::unique_ptr<SlowStorageType> m_ptrSlowStorage;
+
+	size_t m_nBlockSize;
+
+	// The fast tier's allocation state, its own tail is not used as the relocations are written below the tail.
+	size_t m_nNextBlock;
+	size_t m_nLiveBlocks;
+	std::vector<bool> m_vtAllocationTable;
+	std::map<size_t, ObjectUIDType> m_mpLiveObjects;
+
+	// The reads of the objects on the fast tier and the recent reads of the ones on the slow tier, halved (or dropped) at every demotion pass.
+	std::unordered_map<ObjectUIDType, uint32_t> m_mpFastTierReads;
+	std::unordered_map<ObjectUIDType, uint32_t> m_mpSlowTierReads;
+
+	bool m_bFastTierFull;
+	bool m_bDemoting;
+
+#ifdef __CONCURRENT__
+	mutable std::shared_mutex m_mtxStorage;
+#endif //__CONCURRENT__
+
+public:
+	~TieredStorage()
+	{
+	}
+
+	TieredStorage(size_t nBlockSize, size_t nFastStorageSize, const std::string& stFastFilename, size_t nSlowStorageSize, const std::string& stSlowFilename)
+		: m_nBlockSize(nBlockSize)
+		, m_nNextBlock(0)
+		, m_nLiveBlocks(0)
+		, m_bFastTierFull(false)
+		, m_bDemoting(false)
+	{
+		// VolatileStorage takes no file.
+		if constexpr (std::is_constructible_v<FastStorageType, size_t, size_t, const std::string&>)
+		{
+			m_ptrFastStorage = std::make_unique<FastStorageType>(nBlockSize, nFastStorageSize, stFastFilename);
+		}
+		else
+		{
+			m_ptrFastStorage = std::make_unique<FastStorageType>(nBlockSize, nFastStorageSize);
+		}
+
+		m_ptrSlowStorage = std::make_unique<SlowStorageType>(nBlockSize, nSlowStorageSize, stSlowFilename);
+
+		m_vtAllocationTable.resize(nFastStorageSize / nBlockSize, false);
+	}
+
+public:
+	// Both are about the tier that the next batch is written to.
+	inline size_t getNextAvailableBlockOffset()
+	{
+#ifdef __CONCURRENT__
+		std::shared_lock<std::shared_mutex> lock_storage(m_mtxStorage);
+#endif //__CONCURRENT__
+
+		return m_bFastTierFull ? m_ptrSlowStorage->getNextAvailableBlockOffset() : m_nNextBlock;
+	}
+
+	inline ObjectUIDType::StorageMedia getStorageType()
+	{
+#ifdef __CONCURRENT__
+		std::shared_lock<std::shared_mutex> lock_storage(m_mtxStorage);
+#endif //__CONCURRENT__
+
+		return m_bFastTierFull ? m_ptrSlowStorage->getStorageType() : m_ptrFastStorage->getStorageType();
+	}
+
+	inline size_t getBlockSize() const
+	{
+		return m_nBlockSize;
+	}
+
+	// The demoted objects are appended to the slow tier.
+	inline size_t getDemotionOffset()
+	{
+		return m_ptrSlowStorage->getNextAvailableBlockOffset();
+	}
+
+	inline ObjectUIDType::StorageMedia getDemotionStorageType()
+	{
+		return m_ptrSlowStorage->getStorageType();
+	}
+
+	// The live blocks on the fast tier.
+	inline size_t getLiveBlocksCount() const
+	{
+#ifdef __CONCURRENT__
+		std::shared_lock<std::shared_mutex> lock_storage(m_mtxStorage);
+#endif //__CONCURRENT__
+
+		return m_nLiveBlocks;
+	}
+
+public:
+	template <typename ICallback, typename... InitArgs>
+	CacheErrorCode init(ICallback* ptrCallback, InitArgs... args)
+	{
+		CacheErrorCode errCode = m_ptrFastStorage->init(ptrCallback, args...);
+		if (errCode != CacheErrorCode::Success)
+		{
+			return errCode;
+		}
+
+		return m_ptrSlowStorage->init(ptrCallback, args...);
+	}
+
+	std::shared_ptr<ObjectType> getObject(const ObjectUIDType& uidObject)
+	{
+		if (isOnFastTier(uidObject))
+		{
+			{
+#ifdef __CONCURRENT__
+				std::unique_lock<std::shared_mutex> lock_storage(m_mtxStorage);
+#endif //__CONCURRENT__
+
+				auto it = m_mpFastTierReads.find(uidObject);
+				if (it != m_mpFastTierReads.end())
+				{
+					(*it).second++;
+				}
+			}
+
+			return m_ptrFastStorage->getObject(uidObject);
+		}
+
+		std::shared_ptr<ObjectType> ptrObject = m_ptrSlowStorage->getObject(uidObject);
+
+		if (ptrObject == nullptr || uidObject.getObjectType() != LEAF_UID)
+		{
+			return ptrObject;
+		}
+
+#ifdef __CONCURRENT__
+		std::unique_lock<std::shared_mutex> lock_storage(m_mtxStorage);
+#endif //__CONCURRENT__
+
+		if (m_mpSlowTierReads.size() >= TIERED_STORAGE_MAX_TRACKED_READS)
+		{
+			m_mpSlowTierReads.clear();
+		}
+
+		// A dirty object is written to the fast tier when it is evicted from the cache.
+		if (++m_mpSlowTierReads[uidObject] >= TIERED_STORAGE_PROMOTION_READS && !m_bFastTierFull && !m_bDemoting)
+		{
+			m_mpSlowTierReads.erase(uidObject);
+			ptrObject->setDirtyFlag(true);
+		}
+
+		return ptrObject;
+	}
+
+	CacheErrorCode remove(const ObjectUIDType& uidObject)
+	{
+		if (isOnFastTier(uidObject))
+		{
+#ifdef __CONCURRENT__
+			std::unique_lock<std::shared_mutex> lock_storage(m_mtxStorage);
+#endif //__CONCURRENT__
+
+			releaseBlocks(uidObject);
+
+			return m_ptrFastStorage->remove(uidObject);
+		}
+
+		return m_ptrSlowStorage->remove(uidObject);
+	}
+
+	// Whether the object is still stored under the UID (see FileStorage::isLive).
+	bool isLive(const ObjectUIDType& uidObject) const
+	{
+		if (isOnFastTier(uidObject))
+		{
+#ifdef __CONCURRENT__
+			std::shared_lock<std::shared_mutex> lock_storage(m_mtxStorage);
+#endif //__CONCURRENT__
+
+			auto it = m_mpLiveObjects.find(uidObject.getPersistentPointerValue() / m_nBlockSize);
+			return it != m_mpLiveObjects.end() && (*it).second == uidObject;
+		}
+
+		return m_ptrSlowStorage->isLive(uidObject);
+	}
+
+	CacheErrorCode addObject(const ObjectUIDType& uidObject, std::shared_ptr<ObjectType> ptrObject, ObjectUIDType& uidUpdated)
+	{
+		std::vector<std::pair<ObjectUIDType, std::pair<std::optional<ObjectUIDType>, std::shared_ptr<ObjectType>>>> vtObjects;
+
+		size_t nOffset = getNextAvailableBlockOffset();
+		size_t nSize = ptrObject->getSize();
+
+		ObjectUIDType::createAddressFromArgs(uidUpdated, getStorageType(), uidObject.getObjectType(), nOffset * m_nBlockSize, nSize);
+
+		vtObjects.push_back(std::make_pair(uidObject, std::make_pair(uidUpdated, ptrObject)));
+
+		return addObjects(vtObjects, nOffset + (nSize + m_nBlockSize - 1) / m_nBlockSize);
+	}
+
+	// The batch goes to the tier that its UIDs were created for (see getStorageType).
+	CacheErrorCode addObjects(std::vector<std::pair<ObjectUIDType, std::pair<std::optional<ObjectUIDType>, std::shared_ptr<ObjectType>>>>& vtObjects, size_t nNewOffset)
+	{
+		if (vtObjects.size() == 0)
+		{
+			return CacheErrorCode::Success;
+		}
+
+		if (!isOnFastTier(*vtObjects.front().second.first))
+		{
+			return addObjectsToSlowTier(vtObjects, nNewOffset);
+		}
+
+#ifdef __CONCURRENT__
+		std::unique_lock<std::shared_mutex> lock_storage(m_mtxStorage);
+#endif //__CONCURRENT__
+
+		if (nNewOffset > m_vtAllocationTable.size())
+		{
+			std::cout << "Critical State: The batch does not fit in the fast tier." << std::endl;
+			throw new std::logic_error(".....");   // TODO: critical log.
+		}
+
+		// The relocations are written below the tail, therefore, the tail should never move backwards here.
+		m_nNextBlock = std::max(m_nNextBlock, nNewOffset);
+
+		CacheErrorCode errCode = m_ptrFastStorage->addObjects(vtObjects, m_nNextBlock);
+		if (errCode != CacheErrorCode::Success)
+		{
+			return errCode;
+		}
+
+		for (auto it = vtObjects.begin(); it != vtObjects.end(); it++)
+		{
+			if (isOnFastTier((*it).first))
+			{
+				releaseBlocks((*it).first);
+			}
+			else
+			{
+				m_ptrSlowStorage->remove((*it).first);
+			}
+
+			allocateBlocks(*(*it).second.first);
+		}
+
+		m_bFastTierFull = m_nNextBlock > m_vtAllocationTable.size() * (1 - TIERED_STORAGE_HEADROOM_RATIO);
+
+		return CacheErrorCode::Success;
+	}
+
+	// Writes the objects picked by getDemotionCandidates to the slow tier and frees their blocks on the fast tier.
+	CacheErrorCode addDemotedObjects(std::vector<std::pair<ObjectUIDType, std::pair<std::optional<ObjectUIDType>, std::shared_ptr<ObjectType>>>>& vtObjects, size_t nNewOffset)
+	{
+		return addObjectsToSlowTier(vtObjects, nNewOffset);
+	}
+
+	// Returns the leaves on the fast tier that have been read the least, as many as it takes to bring the live objects down to the low watermark.
+	// Nothing is returned until the high watermark is crossed.
+	bool getDemotionCandidates(std::vector<ObjectUIDType>& vtCandidates)
+	{
+#ifdef __CONCURRENT__
+		std::unique_lock<std::shared_mutex> lock_storage(m_mtxStorage);
+#endif //__CONCURRENT__
+
+		size_t nHighWatermark = m_vtAllocationTable.size() * TIERED_STORAGE_DEMOTION_HIGH_RATIO;
+		size_t nLowWatermark = m_vtAllocationTable.size() * TIERED_STORAGE_DEMOTION_LOW_RATIO;
+
+		m_bDemoting = m_nLiveBlocks > (m_bDemoting ? nLowWatermark : nHighWatermark);
+		if (!m_bDemoting)
+		{
+			return false;
+		}
+
+		std::vector<std::pair<uint32_t, ObjectUIDType>> vtLeaves;
+		for (auto it = m_mpFastTierReads.begin(); it != m_mpFastTierReads.end(); it++)
+		{
+			if ((*it).first.getObjectType() == LEAF_UID)
+			{
+				vtLeaves.push_back(std::make_pair((*it).second, (*it).first));
+			}
+
+			// Aged, otherwise a leaf that was hot once would never leave the fast tier.
+			(*it).second /= 2;
+		}
+
+		m_mpSlowTierReads.clear();
+
+		std::sort(vtLeaves.begin(), vtLeaves.end(), [](const auto& lhs, const auto& rhs) { return lhs.first < rhs.first; });
+
+		size_t nBlocks = 0;
+		for (auto it = vtLeaves.begin(); it != vtLeaves.end() && m_nLiveBlocks > nLowWatermark + nBlocks; it++)
+		{
+			vtCandidates.push_back((*it).second);
+			nBlocks += getRequiredBlocks((*it).second);
+		}
+
+		return vtCandidates.size() > 0;
+	}
+
+	// The compaction works on the fast tier only, it picks the live objects of the region closest to the tail (and below nRegion)
+	// if the holes below the region can absorb them.
+	bool getRelocationCandidates(std::vector<ObjectUIDType>& vtCandidates, size_t& nRegion)
+	{
+#ifdef __CONCURRENT__
+		std::shared_lock<std::shared_mutex> lock_storage(m_mtxStorage);
+#endif //__CONCURRENT__
+
+		size_t nLiveBlocksBelow = m_nLiveBlocks;
+
+		auto itEnd = m_mpLiveObjects.end();
+		for (nRegion = std::min((m_nNextBlock + TIERED_STORAGE_REGION_BLOCKS - 1) / TIERED_STORAGE_REGION_BLOCKS, nRegion); nRegion-- > 0; )
+		{
+			auto it = m_mpLiveObjects.lower_bound(nRegion * TIERED_STORAGE_REGION_BLOCKS);
+
+			size_t nRegionBlocks = 0;
+			for (auto itObject = it; itObject != itEnd; itObject++)
+			{
+				nRegionBlocks += getRequiredBlocks((*itObject).second);
+			}
+
+			nLiveBlocksBelow -= nRegionBlocks;
+
+			if (nRegionBlocks == 0 || nRegionBlocks > nRegion * TIERED_STORAGE_REGION_BLOCKS - nLiveBlocksBelow)
+			{
+				itEnd = it;
+				continue;
+			}
+
+			for (; it != itEnd; it++)
+			{
+				vtCandidates.push_back((*it).second);
+			}
+
+			return true;
+		}
+
+		return false;
+	}
+
+	// Finds the lowest run of nMaxBlocks free blocks on the fast tier below nLimitBlock that does not overlap any object in vtReserved.
+	// If there is no such run then the longest one is returned.
+	bool getFreeExtent(size_t nMaxBlocks, size_t nLimitBlock, const std::vector<ObjectUIDType>& vtReserved, size_t& nBlock, size_t& nBlocks)
+	{
+#ifdef __CONCURRENT__
+		std::shared_lock<std::shared_mutex> lock_storage(m_mtxStorage);
+#endif //__CONCURRENT__
+
+		std::vector<bool> vtReservedBlocks(std::min(nLimitBlock, m_vtAllocationTable.size()), false);
+		for (auto it = vtReserved.begin(); it != vtReserved.end(); it++)
+		{
+			if (!isOnFastTier(*it))
+			{
+				continue;
+			}
+
+			size_t nBegin = (*it).getPersistentPointerValue() / m_nBlockSize;
+			for (size_t idx = nBegin, idxend = std::min(nBegin + getRequiredBlocks(*it), vtReservedBlocks.size()); idx < idxend; idx++)
+			{
+				vtReservedBlocks[idx] = true;
+			}
+		}
+
+		size_t nRunStart = 0, nRunLength = 0;
+
+		nBlocks = 0;
+
+		for (size_t idx = 0; idx < vtReservedBlocks.size(); idx++)
+		{
+			if (m_vtAllocationTable[idx] || vtReservedBlocks[idx])
+			{
+				nRunLength = 0;
+				continue;
+			}
+
+			if (nRunLength++ == 0)
+			{
+				nRunStart = idx;
+			}
+
+			if (nRunLength > nBlocks)
+			{
+				nBlock = nRunStart;
+				nBlocks = nRunLength;
+
+				if (nBlocks == nMaxBlocks)
+				{
+					break;
+				}
+			}
+		}
+
+		return nBlocks > 0;
+	}
+
+	// Moves the fast tier's tail back to the end of its last live (or reserved) object.
+	void truncate(const std::vector<ObjectUIDType>& vtReserved)
+	{
+#ifdef __CONCURRENT__
+		std::unique_lock<std::shared_mutex> lock_storage(m_mtxStorage);
+#endif //__CONCURRENT__
+
+		size_t nEnd = 0;
+		if (m_mpLiveObjects.size() > 0)
+		{
+			nEnd = (*m_mpLiveObjects.rbegin()).first + getRequiredBlocks((*m_mpLiveObjects.rbegin()).second);
+		}
+
+		for (auto it = vtReserved.begin(); it != vtReserved.end(); it++)
+		{
+			if (isOnFastTier(*it))
+			{
+				nEnd = std::max(nEnd, (*it).getPersistentPointerValue() / m_nBlockSize + getRequiredBlocks(*it));
+			}
+		}
+
+		m_nNextBlock = std::min(m_nNextBlock, nEnd);
+
+		m_bFastTierFull = m_nNextBlock > m_vtAllocationTable.size() * (1 - TIERED_STORAGE_HEADROOM_RATIO);
+	}
+
+private:
+	inline bool isOnFastTier(const ObjectUIDType& uidObject) const
+	{
+		return uidObject.getMediaType() == m_ptrFastStorage->getStorageType();
+	}
+
+	inline size_t getRequiredBlocks(const ObjectUIDType& uidObject) const
+	{
+		return (uidObject.getPersistentObjectSize() + m_nBlockSize - 1) / m_nBlockSize;
+	}
+
+	CacheErrorCode addObjectsToSlowTier(std::vector<std::pair<ObjectUIDType, std::pair<std::optional<ObjectUIDType>, std::shared_ptr<ObjectType>>>>& vtObjects, size_t nNewOffset)
+	{
+		// The slow tier releases the objects that were on it, the rest are released here.
+		CacheErrorCode errCode = m_ptrSlowStorage->addObjects(vtObjects, nNewOffset);
+		if (errCode != CacheErrorCode::Success)
+		{
+			return errCode;
+		}
+
+#ifdef __CONCURRENT__
+		std::unique_lock<std::shared_mutex> lock_storage(m_mtxStorage);
+#endif //__CONCURRENT__
+
+		for (auto it = vtObjects.begin(); it != vtObjects.end(); it++)
+		{
+			if (isOnFastTier((*it).first))
+			{
+				releaseBlocks((*it).first);
+			}
+		}
+
+		return CacheErrorCode::Success;
+	}
+
+	void allocateBlocks(const ObjectUIDType& uidObject)
+	{
+		size_t nBlock = uidObject.getPersistentPointerValue() / m_nBlockSize;
+		size_t nBlocks = getRequiredBlocks(uidObject);
+
+		for (size_t idx = nBlock; idx < nBlock + nBlocks; idx++)
+		{
+			m_vtAllocationTable[idx] = true;
+		}
+
+		m_nLiveBlocks += nBlocks;
+
+		m_mpLiveObjects[nBlock] = uidObject;
+		m_mpFastTierReads[uidObject] = 0;
+	}
+
+	void releaseBlocks(const ObjectUIDType& uidObject)
+	{
+		size_t nBlock = uidObject.getPersistentPointerValue() / m_nBlockSize;
+
+		auto it = m_mpLiveObjects.find(nBlock);
+		if (it == m_mpLiveObjects.end() || !((*it).second == uidObject))
+		{
+			return;
+		}
+
+		size_t nBlocks = getRequiredBlocks(uidObject);
+
+		for (size_t idx = nBlock; idx < nBlock + nBlocks; idx++)
+		{
+			m_vtAllocationTable[idx] = false;
+		}
+
+		m_nLiveBlocks -= nBlocks;
+
+		m_mpLiveObjects.erase(it);
+		m_mpFastTierReads.erase(uidObject);
+	}
+};
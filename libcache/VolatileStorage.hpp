@@ -7,6 +7,7 @@
 #include <fstream>
 #include <variant>
 #include <cmath>
+#include <span>
 
 #include "ErrorCodes.h"
 #include "IFlushCallback.h"
@@ -108,16 +109,21 @@ public:
 		uint32_t nBufferSize = 0;
 		uint8_t uidObjectType = 0;
 
-		char* szBuffer = NULL;
-		ptrObject->serialize(szBuffer, uidObjectType, nBufferSize);
-
-		size_t nOffset = m_nNextBlock * m_nBlockSize;
+		size_t nObjectSize = ptrObject->getSize();
 
 #ifdef __CONCURRENT__
 		std::unique_lock<std::shared_mutex> lock_storage(m_mtxStorage);
 #endif //__CONCURRENT__
 
-		memcpy(m_szStorage + nOffset, szBuffer, nBufferSize);
+		size_t nOffset = m_nNextBlock * m_nBlockSize;
+		if (nOffset + nObjectSize > m_nStorageSize)
+		{
+			std::cout << "Critical State: Failed to write object to VolatileStorage." << std::endl;
+			throw new std::logic_error(".....");   // TODO: critical log.
+		}
+
+		// Serialized straight into the storage, there is no intermediate buffer to copy from.
+		ptrObject->serializeInto(std::span<char>(m_szStorage + nOffset, nObjectSize), uidObjectType, nBufferSize);
 
 		//m_nNextBlock += std::ceil((nBufferSize + sizeof(uint8_t)) / (float)m_nBlockSize);;
 		m_nNextBlock += std::ceil(nBufferSize / (float)m_nBlockSize);
@@ -126,8 +132,6 @@ public:
 		lock_storage.unlock();
 #endif //__CONCURRENT__
 
-		delete[] szBuffer;
-
 		ObjectUIDType::createAddressFromFileOffset(uidUpdated, uidObject.getObjectType(), nOffset, nBufferSize);
 
 		return CacheErrorCode::Success;
@@ -144,11 +148,16 @@ public:
 			uint32_t nBufferSize = 0;
 			uint8_t uidObjectType = 0;
 
-			char* szBuffer = NULL;
-			(*it).second.second->serialize(szBuffer, uidObjectType, nBufferSize);
-			memcpy(m_szStorage + (*(*it).second.first).getPersistentPointerValue(), szBuffer, nBufferSize);
+			// prepareFlush has sized and placed the object already, it is written into its slot as is.
+			size_t nOffset = (*(*it).second.first).getPersistentPointerValue();
+			size_t nObjectSize = (*(*it).second.first).getPersistentObjectSize();
+			if (nOffset + nObjectSize > m_nStorageSize)
+			{
+				std::cout << "Critical State: Failed to write objects to VolatileStorage." << std::endl;
+				throw new std::logic_error(".....");   // TODO: critical log.
+			}
 
-			delete[] szBuffer;
+			(*it).second.second->serializeInto(std::span<char>(m_szStorage + nOffset, nObjectSize), uidObjectType, nBufferSize);
 		}
 
 		m_nNextBlock = nNewOffset;
@@ -334,6 +334,388 @@ namespace BPlusStore_LRUCache_FileStorage_Suite
         }
     }
 
+    TEST_P(BPlusStore_LRUCache_FileStorage_Suite_1, Compaction_v1)
+    {
+        // The second pass rewrites every flushed node, therefore, their first copies become garbage.
+        for (int nCntr = 0; nCntr < nTotalRecords; nCntr = nCntr + 2)
+        {
+            ErrorCode ec = m_ptrTree->insert(nCntr, nCntr);
+            assert(ec == ErrorCode::Success);
+        }
+
+        m_ptrTree->flush();
+
+        for (int nCntr = 1; nCntr < nTotalRecords; nCntr = nCntr + 2)
+        {
+            ErrorCode ec = m_ptrTree->insert(nCntr, nCntr);
+            assert(ec == ErrorCode::Success);
+        }
+
+        m_ptrTree->flush();
+
+        size_t nUsedBlocks = 0, nLiveBlocks = 0, nUsedBlocksBefore = 0;
+        m_ptrTree->getStorageState(nUsedBlocksBefore, nLiveBlocks);
+
+        // The parents dirtied by the relocations are flushed to the tail, a few rounds move them down as well.
+        for (int nRound = 0; nRound < 3; nRound++)
+        {
+            while (m_ptrTree->compact(64 * 1024) > 0);
+
+            m_ptrTree->flush();
+        }
+
+        while (m_ptrTree->compact(64 * 1024) > 0);
+
+        m_ptrTree->getStorageState(nUsedBlocks, nLiveBlocks);
+        assert(nLiveBlocks <= nUsedBlocks);
+
+        // Regions are the unit of compaction, a file that fits in a single region is not shrunk.
+        if (nUsedBlocksBefore > COMPACTION_REGION_BLOCKS)
+        {
+            assert(nUsedBlocks < nUsedBlocksBefore);
+        }
+
+        for (int nCntr = 0; nCntr < nTotalRecords; nCntr++)
+        {
+            int nValue = 0;
+            ErrorCode ec = m_ptrTree->search(nCntr, nValue);
+
+            assert(nValue == nCntr && ec == ErrorCode::Success);
+        }
+    }
+
+    TEST_P(BPlusStore_LRUCache_FileStorage_Suite_1, Swizzled_Search_v1)
+    {
+        for (int nCntr = 0; nCntr < nTotalRecords; nCntr++)
+        {
+            ErrorCode ec = m_ptrTree->insert(nCntr, nCntr);
+            assert(ec == ErrorCode::Success);
+        }
+
+        // Every pass runs on the references left by the previous one, which the flush and the compaction turn stale.
+        for (int nPass = 0; nPass < 4; nPass++)
+        {
+            for (int nCntr = 0; nCntr < nTotalRecords; nCntr++)
+            {
+                int nValue = 0;
+                ErrorCode ec = m_ptrTree->search(nCntr, nValue);
+
+                assert(nValue == nCntr && ec == ErrorCode::Success);
+            }
+
+            if (nPass == 0)
+            {
+                m_ptrTree->flush();
+            }
+            else if (nPass == 1)
+            {
+                while (m_ptrTree->compact(64 * 1024) > 0);
+            }
+            else if (nPass == 2)
+            {
+                for (int nCntr = 1; nCntr < nTotalRecords; nCntr = nCntr + 2)
+                {
+                    ErrorCode ec = m_ptrTree->remove(nCntr);
+                    assert(ec == ErrorCode::Success);
+                }
+
+                for (int nCntr = 1; nCntr < nTotalRecords; nCntr = nCntr + 2)
+                {
+                    ErrorCode ec = m_ptrTree->insert(nCntr, nCntr);
+                    assert(ec == ErrorCode::Success);
+                }
+            }
+        }
+    }
+
+    TEST_P(BPlusStore_LRUCache_FileStorage_Suite_1, Pinned_Index_Nodes_v1)
+    {
+        m_ptrTree->setPinningPolicy(PINNING_ALL_LEVELS, PINNING_DEFAULT_BUDGET_RATIO);
+
+        for (int nCntr = 0; nCntr < nTotalRecords; nCntr++)
+        {
+            ErrorCode ec = m_ptrTree->insert(nCntr, nCntr);
+            assert(ec == ErrorCode::Success);
+        }
+
+        // The flush links the pinned nodes back, the searches that follow pin them again.
+        for (int nPass = 0; nPass < 3; nPass++)
+        {
+            for (int nCntr = 0; nCntr < nTotalRecords; nCntr++)
+            {
+                int nValue = 0;
+                ErrorCode ec = m_ptrTree->search(nCntr, nValue);
+
+                assert(nValue == nCntr && ec == ErrorCode::Success);
+            }
+
+            size_t nLRU = 0, nMap = 0;
+            m_ptrTree->getCacheState(nLRU, nMap);
+            assert(nLRU == nMap);
+
+            if (nPass == 0)
+            {
+                m_ptrTree->flush();
+            }
+            else if (nPass == 1)
+            {
+                // Only the root stays pinned.
+                m_ptrTree->setPinningPolicy(1, PINNING_DEFAULT_BUDGET_RATIO);
+
+                for (int nCntr = 0; nCntr < nTotalRecords; nCntr = nCntr + 2)
+                {
+                    ErrorCode ec = m_ptrTree->remove(nCntr);
+                    assert(ec == ErrorCode::Success);
+                }
+
+                for (int nCntr = 0; nCntr < nTotalRecords; nCntr = nCntr + 2)
+                {
+                    ErrorCode ec = m_ptrTree->insert(nCntr, nCntr);
+                    assert(ec == ErrorCode::Success);
+                }
+            }
+        }
+
+        ErrorCode ec = m_ptrTree->checkpoint();
+        assert(ec == ErrorCode::Success);
+    }
+
+    TEST_P(BPlusStore_LRUCache_FileStorage_Suite_1, Reopen_v1)
+    {
+        for (int nCntr = 0; nCntr < nTotalRecords; nCntr++)
+        {
+            ErrorCode ec = m_ptrTree->insert(nCntr, nCntr);
+            assert(ec == ErrorCode::Success);
+        }
+
+        ErrorCode ec = m_ptrTree->checkpoint();
+        assert(ec == ErrorCode::Success);
+
+        delete m_ptrTree;
+
+        m_ptrTree = new BPlusStoreType(nDegree, nCacheSize, nBlockSize, nStorageSize, fsTempFileStore.string());
+        ec = m_ptrTree->open(fsTempFileStore.string());
+        assert(ec == ErrorCode::Success);
+
+        for (int nCntr = 0; nCntr < nTotalRecords; nCntr++)
+        {
+            int nValue = 0;
+            ErrorCode ec = m_ptrTree->search(nCntr, nValue);
+
+            assert(nValue == nCntr && ec == ErrorCode::Success);
+        }
+
+        for (int nCntr = nTotalRecords; nCntr < nTotalRecords * 2; nCntr++)
+        {
+            ErrorCode ec = m_ptrTree->insert(nCntr, nCntr);
+            assert(ec == ErrorCode::Success);
+        }
+
+        for (int nCntr = 0; nCntr < nTotalRecords * 2; nCntr++)
+        {
+            int nValue = 0;
+            ErrorCode ec = m_ptrTree->search(nCntr, nValue);
+
+            assert(nValue == nCntr && ec == ErrorCode::Success);
+        }
+    }
+
+    TEST_P(BPlusStore_LRUCache_FileStorage_Suite_1, Reopen_TornSuperblock_v1)
+    {
+        for (int nCntr = 0; nCntr < nTotalRecords; nCntr++)
+        {
+            ErrorCode ec = m_ptrTree->insert(nCntr, nCntr);
+            assert(ec == ErrorCode::Success);
+        }
+
+        ErrorCode ec = m_ptrTree->checkpoint();
+        assert(ec == ErrorCode::Success);
+
+        for (int nCntr = nTotalRecords; nCntr < nTotalRecords * 2; nCntr++)
+        {
+            ErrorCode ec = m_ptrTree->insert(nCntr, nCntr);
+            assert(ec == ErrorCode::Success);
+        }
+
+        ec = m_ptrTree->checkpoint();
+        assert(ec == ErrorCode::Success);
+
+        delete m_ptrTree;
+
+        // The second checkpoint went into the first slot, a torn write there must leave the first checkpoint in effect.
+        {
+            std::fstream fsStorage(fsTempFileStore, std::ios::out | std::ios::binary | std::ios::in);
+            fsStorage.seekp(2 * sizeof(uint64_t));
+            fsStorage.write("torn", 4);
+        }
+
+        m_ptrTree = new BPlusStoreType(nDegree, nCacheSize, nBlockSize, nStorageSize, fsTempFileStore.string());
+        ec = m_ptrTree->open(fsTempFileStore.string());
+        assert(ec == ErrorCode::Success);
+
+        for (int nCntr = 0; nCntr < nTotalRecords * 2; nCntr++)
+        {
+            int nValue = 0;
+            ErrorCode ec = m_ptrTree->search(nCntr, nValue);
+
+            assert(nCntr < nTotalRecords ? (nValue == nCntr && ec == ErrorCode::Success) : ec == ErrorCode::KeyDoesNotExist);
+        }
+    }
+
+    TEST_P(BPlusStore_LRUCache_FileStorage_Suite_1, Reopen_CorruptedNode_v1)
+    {
+        for (int nCntr = 0; nCntr < nTotalRecords; nCntr++)
+        {
+            ErrorCode ec = m_ptrTree->insert(nCntr, nCntr);
+            assert(ec == ErrorCode::Success);
+        }
+
+        ErrorCode ec = m_ptrTree->checkpoint();
+        assert(ec == ErrorCode::Success);
+
+        delete m_ptrTree;
+
+        m_ptrTree = new BPlusStoreType(nDegree, nCacheSize, nBlockSize, nStorageSize, fsTempFileStore.string());
+        ec = m_ptrTree->open(fsTempFileStore.string());
+        assert(ec == ErrorCode::Success);
+
+        // A bit is flipped in every block past the superblocks, i.e. in every node, once the store has read its allocation state.
+        {
+            std::fstream fsStorage(fsTempFileStore, std::ios::out | std::ios::binary | std::ios::in);
+
+            size_t nFileSize = std::filesystem::file_size(fsTempFileStore);
+            size_t nFirstBlock = (SUPERBLOCK_SLOTS * SUPERBLOCK_SIZE + nBlockSize - 1) / nBlockSize;
+
+            for (size_t nOffset = nFirstBlock * nBlockSize + 12; nOffset < nFileSize; nOffset += nBlockSize)
+            {
+                char chByte = 0;
+                fsStorage.seekg(nOffset);
+                fsStorage.read(&chByte, 1);
+
+                chByte ^= 0x01;
+                fsStorage.seekp(nOffset);
+                fsStorage.write(&chByte, 1);
+            }
+        }
+
+        bool bDetected = false;
+        try
+        {
+            for (int nCntr = 0; nCntr < nTotalRecords; nCntr++)
+            {
+                int nValue = 0;
+                m_ptrTree->search(nCntr, nValue);
+            }
+        }
+        catch (std::logic_error* ex)
+        {
+            delete ex;
+            bDetected = true;
+        }
+
+        assert(bDetected);
+    }
+
+    TEST_P(BPlusStore_LRUCache_FileStorage_Suite_1, Reopen_WarmUp_v1)
+    {
+        std::string stWarmUpFile = fsTempFileStore.string() + ".warmup";
+
+        m_ptrTree->enableWarmUp(stWarmUpFile);
+
+        for (int nCntr = 0; nCntr < nTotalRecords; nCntr++)
+        {
+            ErrorCode ec = m_ptrTree->insert(nCntr, nCntr);
+            assert(ec == ErrorCode::Success);
+        }
+
+        ErrorCode ec = m_ptrTree->checkpoint();
+        assert(ec == ErrorCode::Success);
+
+        size_t nLRU = 0, nMap = 0;
+        m_ptrTree->getCacheState(nLRU, nMap);
+
+        delete m_ptrTree;
+
+        // The nodes listed at the checkpoint are resident before the first operation.
+        m_ptrTree = new BPlusStoreType(nDegree, nCacheSize, nBlockSize, nStorageSize, fsTempFileStore.string());
+        m_ptrTree->enableWarmUp(stWarmUpFile);
+
+        ec = m_ptrTree->open(fsTempFileStore.string());
+        assert(ec == ErrorCode::Success);
+
+        size_t nWarmLRU = 0, nWarmMap = 0;
+        m_ptrTree->getCacheState(nWarmLRU, nWarmMap);
+
+        assert(nWarmMap > 0 && nWarmMap <= nMap && nWarmLRU == nWarmMap);
+
+        for (int nCntr = 0; nCntr < nTotalRecords; nCntr++)
+        {
+            int nValue = 0;
+            ErrorCode ec = m_ptrTree->search(nCntr, nValue);
+
+            assert(nValue == nCntr && ec == ErrorCode::Success);
+        }
+
+        for (int nCntr = nTotalRecords; nCntr < nTotalRecords * 2; nCntr++)
+        {
+            ErrorCode ec = m_ptrTree->insert(nCntr, nCntr);
+            assert(ec == ErrorCode::Success);
+        }
+
+        for (int nCntr = 0; nCntr < nTotalRecords * 2; nCntr++)
+        {
+            int nValue = 0;
+            ErrorCode ec = m_ptrTree->search(nCntr, nValue);
+
+            assert(nValue == nCntr && ec == ErrorCode::Success);
+        }
+
+        std::filesystem::remove(stWarmUpFile);
+    }
+
+    TEST_P(BPlusStore_LRUCache_FileStorage_Suite_1, Upsert_v1)
+    {
+        std::vector<int> vtRandom(nTotalRecords);
+        std::iota(vtRandom.begin(), vtRandom.end(), 1);
+        std::random_device rd; // Obtain a random number from hardware
+        std::mt19937 eng(rd()); // Seed the generator
+
+        m_ptrTree->setMergeOperator([](const std::optional<int>& value, const int& operand)
+            {
+                return value.value_or(0) + operand;
+            });
+
+        // The first round creates the counters and the second one adds to them.
+        for (int nRound = 0; nRound < 2; nRound++)
+        {
+            std::shuffle(vtRandom.begin(), vtRandom.end(), eng);
+
+            for (int nCntr = 0; nCntr < nTotalRecords; nCntr++)
+            {
+                ErrorCode ec = m_ptrTree->merge(vtRandom[nCntr], vtRandom[nCntr]);
+                assert(ec == ErrorCode::Success);
+            }
+        }
+
+        for (int nCntr = 0; nCntr < nTotalRecords; nCntr++)
+        {
+            ErrorCode ec = m_ptrTree->upsert(vtRandom[nCntr], [](const std::optional<int>& value)
+                {
+                    assert(value.has_value());
+                    return -*value;
+                });
+            assert(ec == ErrorCode::Success);
+        }
+
+        for (int nCntr = 0; nCntr < nTotalRecords; nCntr++)
+        {
+            int nValue = 0;
+            ErrorCode ec = m_ptrTree->search(vtRandom[nCntr], nValue);
+
+            assert(nValue == -2 * vtRandom[nCntr] && ec == ErrorCode::Success);
+        }
+    }
+
     INSTANTIATE_TEST_CASE_P(
         TREE_WITH_KEY_AND_VAL_AS_INT32_AND_WITH_FILE_STORAGE,
         BPlusStore_LRUCache_FileStorage_Suite_1,
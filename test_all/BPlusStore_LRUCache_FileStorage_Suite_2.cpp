@@ -6,299 +6,246 @@
 #include <variant>
 #include <typeinfo>
 #include <type_traits>
+#include <fstream>
+#include <filesystem>
 
 #include "glog/logging.h"
 
 #include "LRUCache.hpp"
 #include "IndexNode.hpp"
-#include "DataNode.hpp"
+#include "DataNodeSlotted.hpp"
 #include "BPlusStore.hpp"
 #include "LRUCacheObject.hpp"
 #include "FileStorage.hpp"
 #include "TypeMarshaller.hpp"
-
 #include "TypeUID.h"
 #include "ObjectFatUID.h"
+#include "IFlushCallback.h"
+#include <set>
+#include <random>
+#include <numeric>
+
+#ifdef __TREE_WITH_CACHE__
+namespace BPlusStore_LRUCache_FileStorage_Suite
+{
+    typedef std::string KeyType;
+    typedef std::string ValueType;
+
+    typedef ObjectFatUID ObjectUIDType;
+
+    typedef DataNodeSlotted<KeyType, ValueType, ObjectUIDType, TYPE_UID::DATA_NODE_STRING_STRING > DataNodeType;
+    typedef IndexNode<KeyType, ValueType, ObjectUIDType, DataNodeType, TYPE_UID::INDEX_NODE_STRING_STRING > IndexNodeType;
+
+    typedef LRUCacheObject<TypeMarshaller, DataNodeType, IndexNodeType> ObjectType;
+    typedef IFlushCallback<ObjectUIDType, ObjectType> ICallback;
+
+    typedef BPlusStore<ICallback, KeyType, ValueType, LRUCache<ICallback, FileStorage<ICallback, ObjectUIDType, LRUCacheObject, TypeMarshaller, DataNodeType, IndexNodeType>>> BPlusStoreType;
+
+    class BPlusStore_LRUCache_FileStorage_Suite_2 : public ::testing::TestWithParam<std::tuple<size_t, size_t, size_t, size_t, size_t>>
+    {
+    protected:
+        void SetUp() override
+        {
+            std::tie(nDegree, nTotalRecords, nCacheSize, nBlockSize, nStorageSize) = GetParam();
+
+            m_ptrTree = new BPlusStoreType(nDegree, nCacheSize, nBlockSize, nStorageSize, fsTempFileStore.string());
+            m_ptrTree->init<DataNodeType>();
+        }
+
+        void TearDown() override
+        {
+            delete m_ptrTree;
+            std::filesystem::remove(fsTempFileStore);
+        }
+
+        // The keys run from 14 to 53 bytes, the numbers are zero-padded so that the keys sort as the numbers do.
+        static std::string getKey(int nKey)
+        {
+            std::string stNumber = std::to_string(nKey);
+            return "key:" + std::string(10 - stNumber.size(), '0') + stNumber + std::string(nKey % 40, 'x');
+        }
+
+        static std::string getValue(int nKey)
+        {
+            return "value:" + std::to_string(nKey);
+        }
+
+        BPlusStoreType* m_ptrTree = nullptr;
+
+        size_t nDegree;
+        size_t nTotalRecords;
+        size_t nCacheSize;
+        size_t nBlockSize;
+        size_t nStorageSize;
+
+#ifdef _MSC_VER
+        std::filesystem::path fsTempFileStore = std::filesystem::temp_directory_path() / "tempfilestore.hdb";
+#else //_MSC_VER
+        std::filesystem::path fsTempFileStore = "/mnt/tmpfs/filestore.hdb";
+#endif //_MSC_VER
+    };
+
+    TEST_P(BPlusStore_LRUCache_FileStorage_Suite_2, Bulk_Search_v1)
+    {
+        std::vector<int> vtRandom(nTotalRecords);
+        std::iota(vtRandom.begin(), vtRandom.end(), 1);
+        std::random_device rd; // Obtain a random number from hardware
+        std::mt19937 eng(rd()); // Seed the generator
+        std::shuffle(vtRandom.begin(), vtRandom.end(), eng);
+
+        for (int nCntr = 0; nCntr < nTotalRecords; nCntr++)
+        {
+            ErrorCode ec = m_ptrTree->insert(getKey(vtRandom[nCntr]), getValue(vtRandom[nCntr]));
+            assert(ec == ErrorCode::Success);
+        }
+
+        for (int nCntr = 0; nCntr < nTotalRecords; nCntr++)
+        {
+            std::string stValue;
+            ErrorCode ec = m_ptrTree->search(getKey(vtRandom[nCntr]), stValue);
+
+            assert(stValue == getValue(vtRandom[nCntr]) && ec == ErrorCode::Success);
+        }
+
+        std::string stValue;
+        ErrorCode ec = m_ptrTree->search(getKey(0), stValue);
+        assert(ec == ErrorCode::KeyDoesNotExist);
+    }
+
+    TEST_P(BPlusStore_LRUCache_FileStorage_Suite_2, Bulk_Delete_v1)
+    {
+        std::vector<int> vtRandom(nTotalRecords);
+        std::iota(vtRandom.begin(), vtRandom.end(), 1);
+        std::random_device rd; // Obtain a random number from hardware
+        std::mt19937 eng(rd()); // Seed the generator
+        std::shuffle(vtRandom.begin(), vtRandom.end(), eng);
+
+        for (int nCntr = 0; nCntr < nTotalRecords; nCntr++)
+        {
+            ErrorCode ec = m_ptrTree->insert(getKey(vtRandom[nCntr]), getValue(vtRandom[nCntr]));
+            assert(ec == ErrorCode::Success);
+        }
+
+        std::shuffle(vtRandom.begin(), vtRandom.end(), eng);
+
+        // The removals leave dead bytes behind in the leaves, the remaining entries are to survive their compaction.
+        for (int nCntr = 0; nCntr < nTotalRecords / 2; nCntr++)
+        {
+            ErrorCode ec = m_ptrTree->remove(getKey(vtRandom[nCntr]));
+            assert(ec == ErrorCode::Success);
+        }
+
+        for (int nCntr = 0; nCntr < nTotalRecords; nCntr++)
+        {
+            std::string stValue;
+            ErrorCode ec = m_ptrTree->search(getKey(vtRandom[nCntr]), stValue);
+
+            if (nCntr < nTotalRecords / 2)
+            {
+                assert(ec == ErrorCode::KeyDoesNotExist);
+            }
+            else
+            {
+                assert(stValue == getValue(vtRandom[nCntr]) && ec == ErrorCode::Success);
+            }
+        }
+    }
+
+    TEST_P(BPlusStore_LRUCache_FileStorage_Suite_2, Reopen_v1)
+    {
+        for (int nCntr = 0; nCntr < nTotalRecords; nCntr++)
+        {
+            ErrorCode ec = m_ptrTree->insert(getKey(nCntr), getValue(nCntr));
+            assert(ec == ErrorCode::Success);
+        }
+
+        ErrorCode ec = m_ptrTree->checkpoint();
+        assert(ec == ErrorCode::Success);
+
+        delete m_ptrTree;
+
+        m_ptrTree = new BPlusStoreType(nDegree, nCacheSize, nBlockSize, nStorageSize, fsTempFileStore.string());
+        ec = m_ptrTree->open(fsTempFileStore.string());
+        assert(ec == ErrorCode::Success);
+
+        for (int nCntr = 0; nCntr < nTotalRecords; nCntr++)
+        {
+            std::string stValue;
+            ErrorCode ec = m_ptrTree->search(getKey(nCntr), stValue);
+
+            assert(stValue == getValue(nCntr) && ec == ErrorCode::Success);
+        }
+    }
+
+    TEST_P(BPlusStore_LRUCache_FileStorage_Suite_2, Shared_Prefix_v1)
+    {
+        // The leaves of the first tenant share a long prefix, the keys of the second one cut it back wherever they land.
+        for (int nCntr = 0; nCntr < nTotalRecords; nCntr++)
+        {
+            ErrorCode ec = m_ptrTree->insert("tenant/0001/" + getKey(nCntr), getValue(nCntr));
+            assert(ec == ErrorCode::Success);
+        }
+
+        for (int nCntr = 0; nCntr < nTotalRecords; nCntr = nCntr + 10)
+        {
+            ErrorCode ec = m_ptrTree->insert("tenant/0002/" + getKey(nCntr), getValue(nCntr));
+            assert(ec == ErrorCode::Success);
+
+            ec = m_ptrTree->insert("tenant/0001/" + std::to_string(nCntr), getValue(nCntr));
+            assert(ec == ErrorCode::Success);
+        }
+
+        for (int nCntr = 0; nCntr < nTotalRecords; nCntr = nCntr + 3)
+        {
+            ErrorCode ec = m_ptrTree->remove("tenant/0001/" + getKey(nCntr));
+            assert(ec == ErrorCode::Success);
+        }
+
+        ErrorCode ec = m_ptrTree->checkpoint();
+        assert(ec == ErrorCode::Success);
+
+        delete m_ptrTree;
+
+        m_ptrTree = new BPlusStoreType(nDegree, nCacheSize, nBlockSize, nStorageSize, fsTempFileStore.string());
+        ec = m_ptrTree->open(fsTempFileStore.string());
+        assert(ec == ErrorCode::Success);
+
+        for (int nCntr = 0; nCntr < nTotalRecords; nCntr++)
+        {
+            std::string stValue;
+            ErrorCode ec = m_ptrTree->search("tenant/0001/" + getKey(nCntr), stValue);
+
+            if (nCntr % 3 == 0)
+            {
+                assert(ec == ErrorCode::KeyDoesNotExist);
+            }
+            else
+            {
+                assert(stValue == getValue(nCntr) && ec == ErrorCode::Success);
+            }
+
+            ErrorCode ecSecond = m_ptrTree->search("tenant/0002/" + getKey(nCntr), stValue);
+            assert(nCntr % 10 != 0 || (stValue == getValue(nCntr) && ecSecond == ErrorCode::Success));
+            assert(nCntr % 10 == 0 || ecSecond == ErrorCode::KeyDoesNotExist);
+
+            ErrorCode ecShort = m_ptrTree->search("tenant/0001/" + std::to_string(nCntr), stValue);
+            assert(nCntr % 10 != 0 || (stValue == getValue(nCntr) && ecShort == ErrorCode::Success));
+            assert(nCntr % 10 == 0 || ecShort == ErrorCode::KeyDoesNotExist);
+        }
+    }
+
+    INSTANTIATE_TEST_CASE_P(
+        TREE_WITH_KEY_AND_VAL_AS_STRING_AND_WITH_FILE_STORAGE,
+        BPlusStore_LRUCache_FileStorage_Suite_2,
+        ::testing::Values(
+            std::make_tuple(3, 10000, 100, 64, 4ULL * 1024 * 1024 * 1024),
+            std::make_tuple(4, 10000, 100, 64, 4ULL * 1024 * 1024 * 1024),
+            std::make_tuple(5, 10000, 100, 128, 4ULL * 1024 * 1024 * 1024),
+            std::make_tuple(8, 10000, 100, 128, 4ULL * 1024 * 1024 * 1024),
+            std::make_tuple(16, 10000, 100, 256, 4ULL * 1024 * 1024 * 1024),
+            std::make_tuple(64, 10000, 100, 256, 4ULL * 1024 * 1024 * 1024),
+            std::make_tuple(256, 10000, 100, 256, 10ULL * 1024 * 1024 * 1024)
+        ));
 
-//#ifdef __TREE_WITH_CACHE__
-//namespace BPlusStore_LRUCache_FileStorage_Suite
-//{
-//    class BPlusStore_LRUCache_FileStorage_Suite_2 : public ::testing::TestWithParam<std::tuple<int, int, int, int, int, int, string>>
-//    {
-//    protected:
-//        typedef string KeyType;
-//        typedef string ValueType;
-//        typedef ObjectFatUID ObjectUIDType;
-//        
-//        typedef DataNode<KeyType, ValueType, ObjectUIDType, TYPE_UID::DATA_NODE_STRING_STRING> DataNodeType;
-//        typedef IndexNode<KeyType, ValueType, ObjectUIDType, TYPE_UID::INDEX_NODE_STRING_STRING> IndexNodeType;
-//
-//        typedef LRUCacheObject<TypeMarshaller, DataNodeType, IndexNodeType> ObjectType;
-//        typedef IFlushCallback<ObjectUIDType, ObjectType> ICallback;
-//
-//        typedef BPlusStore<ICallback, KeyType, ValueType, LRUCache<ICallback, FileStorage<ICallback, ObjectUIDType, LRUCacheObject, TypeMarshaller, DataNodeType, IndexNodeType>>> BPlusStoreType;
-//
-//        BPlusStoreType* m_ptrTree;
-//
-//        void SetUp() override
-//        {
-//            std::tie(nDegree, nBegin_BulkInsert, nEnd_BulkInsert, nCacheSize, nBlockSize, nFileSize, stFileName) = GetParam();
-//
-//            //m_ptrTree = new BPlusStoreType(3);
-//            //m_ptrTree->template init<DataNodeType>();
-//        }
-//
-//        void TearDown() override {
-//            //delete m_ptrTree;
-//        }
-//
-//        int nDegree;
-//        int nBegin_BulkInsert;
-//        int nEnd_BulkInsert;
-//        int nCacheSize;
-//        int nBlockSize;
-//        int nFileSize;
-//        string stFileName;
-//    };
-//
-//    TEST_P(BPlusStore_LRUCache_FileStorage_Suite_2, Bulk_Insert_v1) {
-//
-//        BPlusStoreType* ptrTree = new BPlusStoreType(nDegree, nCacheSize, nBlockSize, nFileSize, stFileName);
-//        ptrTree->template init<DataNodeType>();
-//
-//        for (size_t nCntr = nBegin_BulkInsert; nCntr <= nEnd_BulkInsert; nCntr++)
-//        {
-//            ptrTree->insert(to_string(nCntr), to_string(nCntr));
-//        }
-//
-//        delete ptrTree;
-//    }
-//
-//    TEST_P(BPlusStore_LRUCache_FileStorage_Suite_2, Bulk_Insert_v2) {
-//
-//        BPlusStoreType* ptrTree = new BPlusStoreType(nDegree, nCacheSize, nBlockSize, nFileSize, stFileName);
-//        ptrTree->template init<DataNodeType>();
-//
-//        for (size_t nCntr = nBegin_BulkInsert; nCntr <= nEnd_BulkInsert; nCntr = nCntr + 2)
-//        {
-//            ptrTree->insert(to_string(nCntr), to_string(nCntr));
-//        }
-//
-//        for (size_t nCntr = nBegin_BulkInsert + 1; nCntr <= nEnd_BulkInsert; nCntr = nCntr + 2)
-//        {
-//            ptrTree->insert(to_string(nCntr), to_string(nCntr));
-//        }
-//
-//        delete ptrTree;
-//    }
-//
-//    TEST_P(BPlusStore_LRUCache_FileStorage_Suite_2, Bulk_Insert_v3) {
-//
-//        BPlusStoreType* ptrTree = new BPlusStoreType(nDegree, nCacheSize, nBlockSize, nFileSize, stFileName);
-//        ptrTree->template init<DataNodeType>();
-//
-//        for (int nCntr = nEnd_BulkInsert; nCntr >= nBegin_BulkInsert; nCntr--)
-//        {
-//            ptrTree->insert(to_string(nCntr), to_string(nCntr));
-//        }
-//
-//        delete ptrTree;
-//    }
-//
-//    TEST_P(BPlusStore_LRUCache_FileStorage_Suite_2, Bulk_Search_v1) {
-//
-//        BPlusStoreType* ptrTree = new BPlusStoreType(nDegree, nCacheSize, nBlockSize, nFileSize, stFileName);
-//        ptrTree->template init<DataNodeType>();
-//
-//        for (size_t nCntr = nBegin_BulkInsert; nCntr <= nEnd_BulkInsert; nCntr++)
-//        {
-//            ptrTree->insert(to_string(nCntr), to_string(nCntr));
-//        }
-//
-//        for (size_t nCntr = nBegin_BulkInsert; nCntr <= nEnd_BulkInsert; nCntr++)
-//        {
-//            string nValue;
-//            ErrorCode code = ptrTree->search(to_string(nCntr), nValue);
-//
-//            ASSERT_EQ(nValue, to_string(nCntr));
-//        }
-//
-//        delete ptrTree;
-//    }
-//
-//    TEST_P(BPlusStore_LRUCache_FileStorage_Suite_2, Bulk_Search_v2) {
-//
-//        BPlusStoreType* ptrTree = new BPlusStoreType(nDegree, nCacheSize, nBlockSize, nFileSize, stFileName);
-//        ptrTree->template init<DataNodeType>();
-//
-//        for (size_t nCntr = nBegin_BulkInsert; nCntr <= nEnd_BulkInsert; nCntr = nCntr + 2)
-//        {
-//            ptrTree->insert(to_string(nCntr), to_string(nCntr));
-//        }
-//
-//        for (size_t nCntr = nBegin_BulkInsert + 1; nCntr <= nEnd_BulkInsert; nCntr = nCntr + 2)
-//        {
-//            ptrTree->insert(to_string(nCntr), to_string(nCntr));
-//        }
-//
-//        for (size_t nCntr = nBegin_BulkInsert; nCntr <= nEnd_BulkInsert; nCntr++)
-//        {
-//            string nValue;
-//            ErrorCode code = ptrTree->search(to_string(nCntr), nValue);
-//
-//            ASSERT_EQ(nValue, to_string(nCntr));
-//        }
-//
-//        delete ptrTree;
-//    }
-//
-//    TEST_P(BPlusStore_LRUCache_FileStorage_Suite_2, Bulk_Search_v3) {
-//
-//        BPlusStoreType* ptrTree = new BPlusStoreType(nDegree, nCacheSize, nBlockSize, nFileSize, stFileName);
-//        ptrTree->template init<DataNodeType>();
-//
-//        for (int nCntr = nEnd_BulkInsert; nCntr >= nBegin_BulkInsert; nCntr--)
-//        {
-//            ptrTree->insert(to_string(nCntr), to_string(nCntr));
-//        }
-//
-//        for (size_t nCntr = nBegin_BulkInsert; nCntr <= nEnd_BulkInsert; nCntr++)
-//        {
-//            string nValue;
-//            ErrorCode code = ptrTree->search(to_string(nCntr), nValue);
-//
-//            ASSERT_EQ(nValue, to_string(nCntr));
-//        }
-//
-//        delete ptrTree;
-//    }
-//
-//    TEST_P(BPlusStore_LRUCache_FileStorage_Suite_2, Bulk_Delete_v1) {
-//
-//        BPlusStoreType* ptrTree = new BPlusStoreType(nDegree, nCacheSize, nBlockSize, nFileSize, stFileName);
-//        ptrTree->template init<DataNodeType>();
-//
-//        for (size_t nCntr = nBegin_BulkInsert; nCntr <= nEnd_BulkInsert; nCntr++)
-//        {
-//            ptrTree->insert(to_string(nCntr), to_string(nCntr));
-//        }
-//
-//        for (size_t nCntr = nBegin_BulkInsert; nCntr <= nEnd_BulkInsert; nCntr++)
-//        {
-//            string nValue;
-//            ErrorCode code = ptrTree->search(to_string(nCntr), nValue);
-//
-//            ASSERT_EQ(nValue, to_string(nCntr));
-//        }
-//
-//        for (size_t nCntr = nBegin_BulkInsert; nCntr <= nEnd_BulkInsert; nCntr++)
-//        {
-//            ErrorCode code = ptrTree->remove(to_string(nCntr));
-//
-//            ASSERT_EQ(code, ErrorCode::Success);
-//        }
-//
-//        for (size_t nCntr = nBegin_BulkInsert; nCntr <= nEnd_BulkInsert; nCntr++)
-//        {
-//            string nValue;
-//            ErrorCode code = ptrTree->search(to_string(nCntr), nValue);
-//
-//            ASSERT_EQ(code, ErrorCode::KeyDoesNotExist);
-//        }
-//
-//        delete ptrTree;
-//    }
-//
-//    TEST_P(BPlusStore_LRUCache_FileStorage_Suite_2, Bulk_Delete_v2) {
-//
-//        BPlusStoreType* ptrTree = new BPlusStoreType(nDegree, nCacheSize, nBlockSize, nFileSize, stFileName);
-//        ptrTree->template init<DataNodeType>();
-//
-//        for (size_t nCntr = nBegin_BulkInsert; nCntr <= nEnd_BulkInsert; nCntr = nCntr + 2)
-//        {
-//            ptrTree->insert(to_string(nCntr), to_string(nCntr));
-//        }
-//
-//        for (size_t nCntr = nBegin_BulkInsert + 1; nCntr <= nEnd_BulkInsert; nCntr = nCntr + 2)
-//        {
-//            ptrTree->insert(to_string(nCntr), to_string(nCntr));
-//        }
-//
-//        for (size_t nCntr = nBegin_BulkInsert; nCntr <= nEnd_BulkInsert; nCntr++)
-//        {
-//            string nValue;
-//            ErrorCode code = ptrTree->search(to_string(nCntr), nValue);
-//
-//            ASSERT_EQ(nValue, to_string(nCntr));
-//        }
-//
-//        for (size_t nCntr = nBegin_BulkInsert; nCntr <= nEnd_BulkInsert; nCntr++)
-//        {
-//            ErrorCode code = ptrTree->remove(to_string(nCntr));
-//
-//            ASSERT_EQ(code, ErrorCode::Success);
-//        }
-//
-//        for (size_t nCntr = nBegin_BulkInsert; nCntr <= nEnd_BulkInsert; nCntr++)
-//        {
-//            string  nValue;
-//            ErrorCode code = ptrTree->search(to_string(nCntr), nValue);
-//            ASSERT_EQ(code, ErrorCode::KeyDoesNotExist);
-//        }
-//
-//        delete ptrTree;
-//    }
-//
-//    TEST_P(BPlusStore_LRUCache_FileStorage_Suite_2, Bulk_Delete_v3) {
-//
-//        BPlusStoreType* ptrTree = new BPlusStoreType(nDegree, nCacheSize, nBlockSize, nFileSize, stFileName);
-//        ptrTree->template init<DataNodeType>();
-//
-//        for (int nCntr = nEnd_BulkInsert; nCntr >= nBegin_BulkInsert; nCntr--)
-//        {
-//            ptrTree->insert(to_string(nCntr), to_string(nCntr));
-//        }
-//
-//        for (size_t nCntr = nBegin_BulkInsert; nCntr <= nEnd_BulkInsert; nCntr++)
-//        {
-//            string nValue;
-//            ErrorCode code = ptrTree->search(to_string(nCntr), nValue);
-//
-//            ASSERT_EQ(nValue, to_string(nCntr));
-//        }
-//
-//        for (int nCntr = nEnd_BulkInsert; nCntr >= nBegin_BulkInsert; nCntr--)
-//        {
-//            ErrorCode code = ptrTree->remove(to_string(nCntr));
-//
-//            ASSERT_EQ(code, ErrorCode::Success);
-//        }
-//
-//        for (size_t nCntr = nBegin_BulkInsert; nCntr <= nEnd_BulkInsert; nCntr++)
-//        {
-//            string nValue;
-//            ErrorCode code = ptrTree->search(to_string(nCntr), nValue);
-//
-//            ASSERT_EQ(code, ErrorCode::KeyDoesNotExist);
-//        }
-//
-//
-//        delete ptrTree;
-//    }
-//
-//    INSTANTIATE_TEST_CASE_P(
-//        Bulk_Insert_Search_Delete,
-//        BPlusStore_LRUCache_FileStorage_Suite_2,
-//        ::testing::Values(
-//            std::make_tuple(3, 0, 99999, 100, 1024, 1024, ""),
-//            std::make_tuple(4, 0, 99999, 100, 1024, 1024, ""),
-//            std::make_tuple(5, 0, 99999, 100, 1024, 1024, ""),
-//            std::make_tuple(6, 0, 99999, 100, 1024, 1024, ""),
-//            std::make_tuple(7, 0, 99999, 100, 1024, 1024, ""),
-//            std::make_tuple(8, 0, 99999, 100, 1024, 1024, ""),
-//            std::make_tuple(15, 0, 199999, 100, 1024, 1024, ""),
-//            std::make_tuple(16, 0, 199999, 100, 1024, 1024, ""),
-//            std::make_tuple(32, 0, 199999, 100, 1024, 1024, ""),
-//            std::make_tuple(64, 0, 199999, 100, 1024, 1024, "")));
-//}
-//#endif //__TREE_WITH_CACHE__
\ No newline at end of file
+}
+#endif //__TREE_WITH_CACHE__
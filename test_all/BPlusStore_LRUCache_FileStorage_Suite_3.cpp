@@ -108,6 +108,15 @@ namespace BPlusStore_LRUCache_FileStorage_Suite
         }
     }
 
+    void merge_concurent(BPlusStoreType* ptrTree, int nRangeStart, int nRangeEnd)
+    {
+        for (int nCntr = nRangeStart; nCntr < nRangeEnd; nCntr++)
+        {
+            ErrorCode ec = ptrTree->merge(nCntr, 1);
+            assert(ec == ErrorCode::Success);
+        }
+    }
+
     void search_concurent(BPlusStoreType* ptrTree, int nRangeStart, int nRangeEnd)
     {
         for (size_t nCntr = nRangeStart; nCntr < nRangeEnd; nCntr++)
@@ -516,6 +525,251 @@ namespace BPlusStore_LRUCache_FileStorage_Suite
         }
     }
 
+    TEST_P(BPlusStore_LRUCache_FileStorage_Suite_3, WAL_Replay_v1)
+    {
+        std::filesystem::path fsTempLog = fsTempFileStore.string() + ".wal";
+
+        delete m_ptrTree;
+        std::filesystem::remove(fsTempFileStore);
+        std::filesystem::remove(fsTempLog);
+
+        m_ptrTree = new BPlusStoreType(nDegree, nCacheSize, nBlockSize, nStorageSize, fsTempFileStore.string());
+        m_ptrTree->enableWAL(fsTempLog.string(), 100us);
+        m_ptrTree->init<DataNodeType>();
+
+        int nTotal = nTotalRecords / nThreadCount;
+
+        // The first half goes into the checkpoint and the second half is only in the log.
+        for (int nHalf = 0; nHalf < 2; nHalf++)
+        {
+            std::vector<std::thread> vtThreads;
+
+            for (int nIdx = 0; nIdx < nThreadCount; nIdx++)
+            {
+                vtThreads.push_back(std::thread(insert_concurent, m_ptrTree, nIdx * nTotal + nHalf * nTotal / 2, nIdx * nTotal + (nHalf + 1) * nTotal / 2));
+            }
+
+            auto it = vtThreads.begin();
+            while (it != vtThreads.end())
+            {
+                (*it).join();
+                it++;
+            }
+
+            if (nHalf == 0)
+            {
+                ErrorCode ec = m_ptrTree->checkpoint();
+                assert(ec == ErrorCode::Success);
+            }
+        }
+
+        // The nodes written on the way out are not referred by the superblock, they are as good as lost.
+        delete m_ptrTree;
+
+        m_ptrTree = new BPlusStoreType(nDegree, nCacheSize, nBlockSize, nStorageSize, fsTempFileStore.string());
+        m_ptrTree->enableWAL(fsTempLog.string(), 100us);
+
+        ErrorCode ec = m_ptrTree->open(fsTempFileStore.string());
+        assert(ec == ErrorCode::Success);
+
+        search_concurent(m_ptrTree, 0, nTotal * nThreadCount);
+
+        std::filesystem::remove(fsTempLog);
+    }
+
+    TEST_P(BPlusStore_LRUCache_FileStorage_Suite_3, Upsert_Concurrent_v1)
+    {
+        std::filesystem::path fsTempLog = fsTempFileStore.string() + ".wal";
+
+        delete m_ptrTree;
+        std::filesystem::remove(fsTempFileStore);
+        std::filesystem::remove(fsTempLog);
+
+        m_ptrTree = new BPlusStoreType(nDegree, nCacheSize, nBlockSize, nStorageSize, fsTempFileStore.string());
+        m_ptrTree->enableWAL(fsTempLog.string(), 100us);
+        m_ptrTree->init<DataNodeType>();
+
+        auto fnAdd = [](const std::optional<int>& value, const int& operand)
+            {
+                return value.value_or(0) + operand;
+            };
+
+        m_ptrTree->setMergeOperator(fnAdd);
+
+        int nTotal = nTotalRecords / nThreadCount;
+
+        // Every thread counts every key, the first round goes into the checkpoint and the second one is only in the log.
+        for (int nRound = 0; nRound < 2; nRound++)
+        {
+            std::vector<std::thread> vtThreads;
+
+            for (int nIdx = 0; nIdx < nThreadCount; nIdx++)
+            {
+                vtThreads.push_back(std::thread(merge_concurent, m_ptrTree, 0, nTotal));
+            }
+
+            auto it = vtThreads.begin();
+            while (it != vtThreads.end())
+            {
+                (*it).join();
+                it++;
+            }
+
+            if (nRound == 0)
+            {
+                ErrorCode ec = m_ptrTree->checkpoint();
+                assert(ec == ErrorCode::Success);
+            }
+        }
+
+        delete m_ptrTree;
+
+        m_ptrTree = new BPlusStoreType(nDegree, nCacheSize, nBlockSize, nStorageSize, fsTempFileStore.string());
+        m_ptrTree->enableWAL(fsTempLog.string(), 100us);
+        m_ptrTree->setMergeOperator(fnAdd);
+
+        ErrorCode ec = m_ptrTree->open(fsTempFileStore.string());
+        assert(ec == ErrorCode::Success);
+
+        for (int nCntr = 0; nCntr < nTotal; nCntr++)
+        {
+            int nValue = 0;
+            ErrorCode ec = m_ptrTree->search(nCntr, nValue);
+
+            assert(nValue == 2 * nThreadCount && ec == ErrorCode::Success);
+        }
+
+        std::filesystem::remove(fsTempLog);
+    }
+
+    TEST_P(BPlusStore_LRUCache_FileStorage_Suite_3, Checkpoint_Concurrent_v1)
+    {
+        std::vector<std::thread> vtThreads;
+
+        int nTotal = nTotalRecords / nThreadCount;
+
+        for (int nIdx = 0; nIdx < nThreadCount; nIdx++)
+        {
+            vtThreads.push_back(std::thread(insert_concurent, m_ptrTree, nIdx * nTotal, (nIdx + 1) * nTotal));
+        }
+
+        // The checkpoints are taken while the writers are running.
+        std::atomic<bool> bDone = false;
+        std::thread threadCheckpoint([&]() {
+            while (!bDone)
+            {
+                ErrorCode ec = m_ptrTree->checkpoint();
+                assert(ec == ErrorCode::Success);
+
+                std::this_thread::sleep_for(1ms);
+            }
+        });
+
+        auto it = vtThreads.begin();
+        while (it != vtThreads.end())
+        {
+            (*it).join();
+            it++;
+        }
+
+        bDone = true;
+        threadCheckpoint.join();
+
+        ErrorCode ec = m_ptrTree->checkpoint();
+        assert(ec == ErrorCode::Success);
+
+        delete m_ptrTree;
+
+        m_ptrTree = new BPlusStoreType(nDegree, nCacheSize, nBlockSize, nStorageSize, fsTempFileStore.string());
+
+        ec = m_ptrTree->open(fsTempFileStore.string());
+        assert(ec == ErrorCode::Success);
+
+        search_concurent(m_ptrTree, 0, nTotal * nThreadCount);
+    }
+
+    TEST_P(BPlusStore_LRUCache_FileStorage_Suite_3, Dirty_Pacing_v1)
+    {
+        std::vector<std::thread> vtThreads;
+
+        int nTotal = nTotalRecords / nThreadCount;
+
+        for (int nIdx = 0; nIdx < nThreadCount; nIdx++)
+        {
+            vtThreads.push_back(std::thread(insert_concurent, m_ptrTree, nIdx * nTotal, (nIdx + 1) * nTotal));
+        }
+
+        auto it = vtThreads.begin();
+        while (it != vtThreads.end())
+        {
+            (*it).join();
+            it++;
+        }
+
+        size_t nDirtyObjects = 0, nDirtyFootprint = 0;
+        size_t nLRU = 0, nMap = 0;
+
+        m_ptrTree->getDirtyState(nDirtyObjects, nDirtyFootprint);
+        m_ptrTree->getCacheState(nLRU, nMap);
+
+        assert(nDirtyObjects > 0 && nDirtyObjects <= nMap);
+
+        // Every resident node is written by the checkpoint, none is left accounted as dirty.
+        ErrorCode ec = m_ptrTree->checkpoint();
+        assert(ec == ErrorCode::Success);
+
+        m_ptrTree->getDirtyState(nDirtyObjects, nDirtyFootprint);
+        assert(nDirtyObjects == 0 && nDirtyFootprint == 0);
+
+        search_concurent(m_ptrTree, 0, nTotal * nThreadCount);
+    }
+
+    TEST_P(BPlusStore_LRUCache_FileStorage_Suite_3, ReadAhead_Sequential_v1)
+    {
+        int nTotal = nTotalRecords / nThreadCount;
+
+        for (int nCntr = 0; nCntr < nTotal * nThreadCount; nCntr = nCntr + 2)
+        {
+            ErrorCode ec = m_ptrTree->insert(nCntr, nCntr);
+            assert(ec == ErrorCode::Success);
+        }
+
+        // The leaves are read back from the storage, ahead of the scan, while the writers split them.
+        m_ptrTree->flush();
+
+        std::vector<std::thread> vtThreads;
+
+        for (int nIdx = 0; nIdx < nThreadCount; nIdx++)
+        {
+            vtThreads.push_back(std::thread([&, nIdx]() {
+                for (int nCntr = nIdx * nTotal + 1; nCntr < (nIdx + 1) * nTotal; nCntr = nCntr + 2)
+                {
+                    ErrorCode ec = m_ptrTree->insert(nCntr, nCntr);
+                    assert(ec == ErrorCode::Success);
+                }
+            }));
+        }
+
+        for (int nCntr = 0; nCntr < nTotal * nThreadCount; nCntr = nCntr + 2)
+        {
+            int nValue = 0;
+            ErrorCode ec = m_ptrTree->search(nCntr, nValue);
+
+            assert(nValue == nCntr && ec == ErrorCode::Success);
+        }
+
+        auto it = vtThreads.begin();
+        while (it != vtThreads.end())
+        {
+            (*it).join();
+            it++;
+        }
+
+        m_ptrTree->flush();
+
+        search_concurent(m_ptrTree, 0, nTotal * nThreadCount);
+    }
+
 #ifdef __CONCURRENT__
     INSTANTIATE_TEST_CASE_P(
         THREADED_TREE_WITH_KEY_AND_VAL_AS_INT32_AND_WITH_TREE_STORAGE,
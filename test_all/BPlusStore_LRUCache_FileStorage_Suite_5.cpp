@@ -0,0 +1,324 @@
+#include "pch.h"
+#include <iostream>
+#include <vector>
+#include <string>
+#include <map>
+#include <variant>
+#include <typeinfo>
+#include <type_traits>
+#include <fstream>
+#include <filesystem>
+
+#include "glog/logging.h"
+
+#include "LRUCache.hpp"
+#include "IndexNode.hpp"
+#include "DataNode.hpp"
+#include "BPlusStore.hpp"
+#include "LRUCacheObject.hpp"
+#include "FileStorage.hpp"
+#include "TypeMarshaller.hpp"
+#include "TypeUID.h"
+#include "ObjectFatUID.h"
+#include "IFlushCallback.h"
+#include <set>
+#include <random>
+#include <numeric>
+
+#ifdef __TREE_WITH_CACHE__
+namespace BPlusStore_LRUCache_FileStorage_Suite
+{
+    typedef int KeyType;
+    typedef int ValueType;
+
+    typedef ObjectFatUID ObjectUIDType;
+
+    // The index nodes buffer up to 32 messages, i.e. the store is a Bε-tree.
+    typedef DataNode<KeyType, ValueType, ObjectUIDType, TYPE_UID::DATA_NODE_INT_INT > DataNodeType;
+    typedef IndexNode<KeyType, ValueType, ObjectUIDType, DataNodeType, TYPE_UID::BEPSILON_INDEX_NODE_INT_INT, 32 > IndexNodeType;
+
+    typedef LRUCacheObject<TypeMarshaller, DataNodeType, IndexNodeType> ObjectType;
+    typedef IFlushCallback<ObjectUIDType, ObjectType> ICallback;
+
+    typedef BPlusStore<ICallback, KeyType, ValueType, LRUCache<ICallback, FileStorage<ICallback, ObjectUIDType, LRUCacheObject, TypeMarshaller, DataNodeType, IndexNodeType>>> BPlusStoreType;
+
+    class BPlusStore_LRUCache_FileStorage_Suite_5 : public ::testing::TestWithParam<std::tuple<size_t, size_t, size_t, size_t, size_t>>
+    {
+    protected:
+        void SetUp() override
+        {
+            std::tie(nDegree, nTotalRecords, nCacheSize, nBlockSize, nStorageSize) = GetParam();
+
+            m_ptrTree = new BPlusStoreType(nDegree, nCacheSize, nBlockSize, nStorageSize, fsTempFileStore.string());
+            m_ptrTree->init<DataNodeType>();
+        }
+
+        void TearDown() override
+        {
+            delete m_ptrTree;
+            std::filesystem::remove(fsTempFileStore);
+        }
+
+        BPlusStoreType* m_ptrTree = nullptr;
+
+        size_t nDegree;
+        size_t nTotalRecords;
+        size_t nCacheSize;
+        size_t nBlockSize;
+        size_t nStorageSize;
+
+#ifdef _MSC_VER
+        std::filesystem::path fsTempFileStore = std::filesystem::temp_directory_path() / "tempfilestore.hdb";
+#else //_MSC_VER
+	std::filesystem::path fsTempFileStore = "/mnt/tmpfs/filestore.hdb";
+#endif //_MSC_VER
+    };
+
+    TEST_P(BPlusStore_LRUCache_FileStorage_Suite_5, Bulk_Search_v1)
+    {
+        std::vector<int> vtRandom(nTotalRecords);
+        std::iota(vtRandom.begin(), vtRandom.end(), 1);
+        std::random_device rd; // Obtain a random number from hardware
+        std::mt19937 eng(rd()); // Seed the generator
+        std::shuffle(vtRandom.begin(), vtRandom.end(), eng);
+
+        for (int nCntr = 0; nCntr < nTotalRecords; nCntr++)
+        {
+            ErrorCode ec = m_ptrTree->insert(vtRandom[nCntr], vtRandom[nCntr]);
+            assert(ec == ErrorCode::Success);
+        }
+
+        for (int nCntr = 0; nCntr < nTotalRecords; nCntr++)
+        {
+            int nValue = 0;
+            ErrorCode ec = m_ptrTree->search(vtRandom[nCntr], nValue);
+
+            assert(nValue == vtRandom[nCntr] && ec == ErrorCode::Success);
+        }
+
+        int nValue = 0;
+        ErrorCode ec = m_ptrTree->search(nTotalRecords + 1, nValue);
+        assert(ec == ErrorCode::KeyDoesNotExist);
+    }
+
+    TEST_P(BPlusStore_LRUCache_FileStorage_Suite_5, Bulk_Update_v1)
+    {
+        std::vector<int> vtRandom(nTotalRecords);
+        std::iota(vtRandom.begin(), vtRandom.end(), 1);
+        std::random_device rd; // Obtain a random number from hardware
+        std::mt19937 eng(rd()); // Seed the generator
+        std::shuffle(vtRandom.begin(), vtRandom.end(), eng);
+
+        for (int nCntr = 0; nCntr < nTotalRecords; nCntr++)
+        {
+            ErrorCode ec = m_ptrTree->insert(vtRandom[nCntr], vtRandom[nCntr]);
+            assert(ec == ErrorCode::Success);
+        }
+
+        // The inserts are blind, the later one replaces the value whether it is still buffered or already in the leaf.
+        std::shuffle(vtRandom.begin(), vtRandom.end(), eng);
+
+        for (int nCntr = 0; nCntr < nTotalRecords; nCntr++)
+        {
+            ErrorCode ec = m_ptrTree->insert(vtRandom[nCntr], -vtRandom[nCntr]);
+            assert(ec == ErrorCode::Success);
+        }
+
+        for (int nCntr = 0; nCntr < nTotalRecords; nCntr++)
+        {
+            int nValue = 0;
+            ErrorCode ec = m_ptrTree->search(vtRandom[nCntr], nValue);
+
+            assert(nValue == -vtRandom[nCntr] && ec == ErrorCode::Success);
+        }
+    }
+
+    TEST_P(BPlusStore_LRUCache_FileStorage_Suite_5, Bulk_Delete_v1)
+    {
+        std::vector<int> vtRandom(nTotalRecords);
+        std::iota(vtRandom.begin(), vtRandom.end(), 1);
+        std::random_device rd; // Obtain a random number from hardware
+        std::mt19937 eng(rd()); // Seed the generator
+        std::shuffle(vtRandom.begin(), vtRandom.end(), eng);
+
+        for (int nCntr = 0; nCntr < nTotalRecords; nCntr++)
+        {
+            ErrorCode ec = m_ptrTree->insert(vtRandom[nCntr], vtRandom[nCntr]);
+            assert(ec == ErrorCode::Success);
+        }
+
+        std::shuffle(vtRandom.begin(), vtRandom.end(), eng);
+
+        for (int nCntr = 0; nCntr < nTotalRecords / 2; nCntr++)
+        {
+            ErrorCode ec = m_ptrTree->remove(vtRandom[nCntr]);
+            assert(ec == ErrorCode::Success);
+        }
+
+        for (int nCntr = 0; nCntr < nTotalRecords; nCntr++)
+        {
+            int nValue = 0;
+            ErrorCode ec = m_ptrTree->search(vtRandom[nCntr], nValue);
+
+            if (nCntr < nTotalRecords / 2)
+            {
+                assert(ec == ErrorCode::KeyDoesNotExist);
+            }
+            else
+            {
+                assert(nValue == vtRandom[nCntr] && ec == ErrorCode::Success);
+            }
+        }
+    }
+
+    TEST_P(BPlusStore_LRUCache_FileStorage_Suite_5, Bulk_Delete_All_v1)
+    {
+        std::vector<int> vtRandom(nTotalRecords);
+        std::iota(vtRandom.begin(), vtRandom.end(), 1);
+        std::random_device rd; // Obtain a random number from hardware
+        std::mt19937 eng(rd()); // Seed the generator
+        std::shuffle(vtRandom.begin(), vtRandom.end(), eng);
+
+        for (int nCntr = 0; nCntr < nTotalRecords; nCntr++)
+        {
+            ErrorCode ec = m_ptrTree->insert(vtRandom[nCntr], vtRandom[nCntr]);
+            assert(ec == ErrorCode::Success);
+        }
+
+        // The tree is to shrink back as the removes reach the leaves, and to grow again.
+        for (int nRound = 0; nRound < 2; nRound++)
+        {
+            std::shuffle(vtRandom.begin(), vtRandom.end(), eng);
+
+            for (int nCntr = 0; nCntr < nTotalRecords; nCntr++)
+            {
+                ErrorCode ec = m_ptrTree->remove(vtRandom[nCntr]);
+                assert(ec == ErrorCode::Success);
+            }
+
+            for (int nCntr = 0; nCntr < nTotalRecords; nCntr++)
+            {
+                int nValue = 0;
+                ErrorCode ec = m_ptrTree->search(vtRandom[nCntr], nValue);
+                assert(ec == ErrorCode::KeyDoesNotExist);
+            }
+
+            for (int nCntr = 0; nCntr < nTotalRecords; nCntr++)
+            {
+                ErrorCode ec = m_ptrTree->insert(vtRandom[nCntr], vtRandom[nCntr] + nRound);
+                assert(ec == ErrorCode::Success);
+            }
+
+            for (int nCntr = 0; nCntr < nTotalRecords; nCntr++)
+            {
+                int nValue = 0;
+                ErrorCode ec = m_ptrTree->search(vtRandom[nCntr], nValue);
+                assert(nValue == vtRandom[nCntr] + nRound && ec == ErrorCode::Success);
+            }
+        }
+    }
+
+    TEST_P(BPlusStore_LRUCache_FileStorage_Suite_5, Reopen_v1)
+    {
+        std::vector<int> vtRandom(nTotalRecords);
+        std::iota(vtRandom.begin(), vtRandom.end(), 1);
+        std::random_device rd; // Obtain a random number from hardware
+        std::mt19937 eng(rd()); // Seed the generator
+        std::shuffle(vtRandom.begin(), vtRandom.end(), eng);
+
+        for (int nCntr = 0; nCntr < nTotalRecords; nCntr++)
+        {
+            ErrorCode ec = m_ptrTree->insert(vtRandom[nCntr], vtRandom[nCntr]);
+            assert(ec == ErrorCode::Success);
+        }
+
+        // Some of the removes are still buffered when the checkpoint is taken.
+        for (int nCntr = 0; nCntr < nTotalRecords / 4; nCntr++)
+        {
+            ErrorCode ec = m_ptrTree->remove(vtRandom[nCntr]);
+            assert(ec == ErrorCode::Success);
+        }
+
+        ErrorCode ec = m_ptrTree->checkpoint();
+        assert(ec == ErrorCode::Success);
+
+        delete m_ptrTree;
+
+        m_ptrTree = new BPlusStoreType(nDegree, nCacheSize, nBlockSize, nStorageSize, fsTempFileStore.string());
+        ec = m_ptrTree->open(fsTempFileStore.string());
+        assert(ec == ErrorCode::Success);
+
+        for (int nCntr = 0; nCntr < nTotalRecords; nCntr++)
+        {
+            int nValue = 0;
+            ErrorCode ec = m_ptrTree->search(vtRandom[nCntr], nValue);
+
+            if (nCntr < nTotalRecords / 4)
+            {
+                assert(ec == ErrorCode::KeyDoesNotExist);
+            }
+            else
+            {
+                assert(nValue == vtRandom[nCntr] && ec == ErrorCode::Success);
+            }
+        }
+    }
+
+    TEST_P(BPlusStore_LRUCache_FileStorage_Suite_5, Upsert_v1)
+    {
+        std::vector<int> vtRandom(nTotalRecords);
+        std::iota(vtRandom.begin(), vtRandom.end(), 1);
+        std::random_device rd; // Obtain a random number from hardware
+        std::mt19937 eng(rd()); // Seed the generator
+
+        m_ptrTree->setMergeOperator([](const std::optional<int>& value, const int& operand)
+            {
+                return value.value_or(0) + operand;
+            });
+
+        // The first round creates the counters and the second one adds to them.
+        for (int nRound = 0; nRound < 2; nRound++)
+        {
+            std::shuffle(vtRandom.begin(), vtRandom.end(), eng);
+
+            for (int nCntr = 0; nCntr < nTotalRecords; nCntr++)
+            {
+                ErrorCode ec = m_ptrTree->merge(vtRandom[nCntr], vtRandom[nCntr]);
+                assert(ec == ErrorCode::Success);
+            }
+        }
+
+        for (int nCntr = 0; nCntr < nTotalRecords; nCntr++)
+        {
+            ErrorCode ec = m_ptrTree->upsert(vtRandom[nCntr], [](const std::optional<int>& value)
+                {
+                    assert(value.has_value());
+                    return -*value;
+                });
+            assert(ec == ErrorCode::Success);
+        }
+
+        for (int nCntr = 0; nCntr < nTotalRecords; nCntr++)
+        {
+            int nValue = 0;
+            ErrorCode ec = m_ptrTree->search(vtRandom[nCntr], nValue);
+
+            assert(nValue == -2 * vtRandom[nCntr] && ec == ErrorCode::Success);
+        }
+    }
+
+    INSTANTIATE_TEST_CASE_P(
+        TREE_WITH_KEY_AND_VAL_AS_INT32_AND_WITH_BUFFERED_INDEX_NODES,
+        BPlusStore_LRUCache_FileStorage_Suite_5,
+        ::testing::Values(
+            std::make_tuple(3, 10000, 100, 64, 4ULL * 1024 * 1024 * 1024),
+            std::make_tuple(4, 10000, 100, 64, 4ULL * 1024 * 1024 * 1024),
+            std::make_tuple(8, 10000, 100, 128, 4ULL * 1024 * 1024 * 1024),
+            std::make_tuple(16, 10000, 100, 128, 4ULL * 1024 * 1024 * 1024),
+            std::make_tuple(64, 10000, 100, 256, 4ULL * 1024 * 1024 * 1024),
+            std::make_tuple(256, 10000, 100, 256, 10ULL * 1024 * 1024 * 1024),
+            std::make_tuple(1024, 10000, 100, 256, 10ULL * 1024 * 1024 * 1024)
+        ));
+
+}
+#endif //__TREE_WITH_CACHE__
@@ -8,6 +8,7 @@
 #include <type_traits>
 #include <fstream>
 #include <filesystem>
+#include <cstdlib>
 
 #include "glog/logging.h"
 
@@ -48,14 +49,18 @@ namespace BPlusStore_LRUCache_PMemStorage_Suite
         {
             std::tie(nDegree, nTotalRecords, nCacheSize, nBlockSize, nStorageSize) = GetParam();
 
-            m_ptrTree = new BPlusStoreType(nDegree, nCacheSize, nBlockSize, nStorageSize, "/mnt/tmpfs/datafile1");
+            // HALDENDB_PMEM_DIR points at a DAX mount when running on real PMem, otherwise any directory would do.
+            const char* szPMemDir = std::getenv("HALDENDB_PMEM_DIR");
+            fsTempFileStore = (szPMemDir != nullptr ? std::filesystem::path(szPMemDir) : std::filesystem::temp_directory_path()) / "pmemstore_suite_1.hdb";
+
+            m_ptrTree = new BPlusStoreType(nDegree, nCacheSize, nBlockSize, nStorageSize, fsTempFileStore.string());
             m_ptrTree->init<DataNodeType>();
         }
 
         void TearDown() override
         {
             delete m_ptrTree;
-            //std::filesystem::remove(fsTempFileStore);
+            std::filesystem::remove(fsTempFileStore);
         }
 
         BPlusStoreType* m_ptrTree = nullptr;
@@ -65,6 +70,8 @@ namespace BPlusStore_LRUCache_PMemStorage_Suite
         size_t nCacheSize;
         size_t nBlockSize;
         size_t nStorageSize;
+
+        std::filesystem::path fsTempFileStore;
     };
 
     TEST_P(BPlusStore_LRUCache_PMemStorage_Suite_1, Bulk_Insert_v1)
@@ -329,6 +336,38 @@ namespace BPlusStore_LRUCache_PMemStorage_Suite
     }
 
 #ifndef _MSC_VER
+#ifdef __PMEM_EMULATION__
+    TEST_P(BPlusStore_LRUCache_PMemStorage_Suite_1, Emulation_ProjectedCost_v1)
+    {
+        PMemEmulation::configure(PMemLatencyModel::optane(), false);
+        PMemEmulation::resetStats();
+
+        // The cache holds at least MIN_CACHE_FOOTPRINT bytes, enough records are inserted for the nodes to be evicted to the storage.
+        int nRecords = nTotalRecords * 20;
+
+        for (int nCntr = 0; nCntr < nRecords; nCntr++)
+        {
+            ErrorCode ec = m_ptrTree->insert(nCntr, nCntr);
+            assert(ec == ErrorCode::Success);
+        }
+
+        for (int nCntr = 0; nCntr < nRecords; nCntr++)
+        {
+            int nValue = 0;
+            ErrorCode ec = m_ptrTree->search(nCntr, nValue);
+
+            assert(nValue == nCntr && ec == ErrorCode::Success);
+        }
+
+        PMemEmulationStats oStats = PMemEmulation::getStats();
+
+        PMemEmulation::configure(PMemLatencyModel::none(), false);
+
+        assert(oStats.m_nDrains > 0 && oStats.m_nBytesFlushed > 0 && oStats.m_nBytesRead > 0);
+        assert(oStats.m_nMediaTimeNs >= oStats.m_nDrains * PMemLatencyModel::optane().m_nWriteLatencyNs);
+    }
+#endif //__PMEM_EMULATION__
+
     INSTANTIATE_TEST_CASE_P(
         TREE_WITH_KEY_AND_VAL_AS_INT32_AND_WITH_PMEM_STORAGE,
         BPlusStore_LRUCache_PMemStorage_Suite_1,
@@ -8,6 +8,7 @@
 #include <type_traits>
 #include <fstream>
 #include <filesystem>
+#include <cstdlib>
 
 #include "glog/logging.h"
 
@@ -47,14 +48,18 @@ namespace BPlusStore_LRUCache_PMemStorage_Suite
         {
             std::tie(nDegree, nTotalRecords, nCacheSize, nBlockSize, nStorageSize, nThreadCount) = GetParam();
 
-            m_ptrTree = new BPlusStoreType(nDegree, nCacheSize, nBlockSize, nStorageSize, "/mnt/tmpfs/datafile1");
+            // HALDENDB_PMEM_DIR points at a DAX mount when running on real PMem, otherwise any directory would do.
+            const char* szPMemDir = std::getenv("HALDENDB_PMEM_DIR");
+            fsTempFileStore = (szPMemDir != nullptr ? std::filesystem::path(szPMemDir) : std::filesystem::temp_directory_path()) / "pmemstore_suite_3.hdb";
+
+            m_ptrTree = new BPlusStoreType(nDegree, nCacheSize, nBlockSize, nStorageSize, fsTempFileStore.string());
             m_ptrTree->init<DataNodeType>();
         }
 
         void TearDown() override
         {
             delete m_ptrTree;
-            //std::filesystem::remove(fsTempFileStore);
+            std::filesystem::remove(fsTempFileStore);
         }
 
         BPlusStoreType* m_ptrTree;
@@ -66,13 +71,7 @@ namespace BPlusStore_LRUCache_PMemStorage_Suite
         size_t nStorageSize;
         size_t nThreadCount;
 
-#ifdef _MSC_VER
-        //std::filesystem::path fsTempFileStore = std::filesystem::temp_directory_path() / "tempfilestore.hdb";
-#else //_MSC_VER
-        //std::filesystem::path fsTempFileStore = "/mnt/tmpfs/filestore.hdb";
-#endif //_MSC_VER
-
-        //        std::filesystem::path fsTempFileStore = std::filesystem::temp_directory_path() / "tempfilestore.hdb";
+        std::filesystem::path fsTempFileStore;
     };
 
     void insert_concurent(BPlusStoreType* ptrTree, int nRangeStart, int nRangeEnd)
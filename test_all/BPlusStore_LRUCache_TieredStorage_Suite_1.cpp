@@ -0,0 +1,253 @@
+#include "pch.h"
+#include <iostream>
+#include <vector>
+#include <string>
+#include <map>
+#include <variant>
+#include <typeinfo>
+#include <type_traits>
+#include <fstream>
+#include <filesystem>
+
+#include "glog/logging.h"
+
+#include "LRUCache.hpp"
+#include "IndexNode.hpp"
+#include "DataNode.hpp"
+#include "BPlusStore.hpp"
+#include "LRUCacheObject.hpp"
+#include "VolatileStorage.hpp"
+#include "FileStorage.hpp"
+#include "TieredStorage.hpp"
+#include "TypeMarshaller.hpp"
+#include "TypeUID.h"
+#include "ObjectFatUID.h"
+#include "IFlushCallback.h"
+#include <set>
+#include <random>
+#include <numeric>
+
+#ifdef __TREE_WITH_CACHE__
+namespace BPlusStore_LRUCache_TieredStorage_Suite
+{
+    typedef int KeyType;
+    typedef int ValueType;
+
+    typedef ObjectFatUID ObjectUIDType;
+
+    typedef DataNode<KeyType, ValueType, ObjectUIDType, TYPE_UID::DATA_NODE_INT_INT > DataNodeType;
+    typedef IndexNode<KeyType, ValueType, ObjectUIDType, DataNodeType, TYPE_UID::INDEX_NODE_INT_INT > IndexNodeType;
+
+    typedef LRUCacheObject<TypeMarshaller, DataNodeType, IndexNodeType> ObjectType;
+    typedef IFlushCallback<ObjectUIDType, ObjectType> ICallback;
+
+    typedef VolatileStorage<ICallback, ObjectUIDType, LRUCacheObject, TypeMarshaller, DataNodeType, IndexNodeType> FastStorageType;
+    typedef FileStorage<ICallback, ObjectUIDType, LRUCacheObject, TypeMarshaller, DataNodeType, IndexNodeType> SlowStorageType;
+
+    typedef BPlusStore<ICallback, KeyType, ValueType, LRUCache<ICallback, TieredStorage<FastStorageType, SlowStorageType>>> BPlusStoreType;
+
+    class BPlusStore_LRUCache_TieredStorage_Suite_1 : public ::testing::TestWithParam<std::tuple<size_t, size_t, size_t, size_t, size_t, size_t>>
+    {
+    protected:
+        void SetUp() override
+        {
+            std::tie(nDegree, nTotalRecords, nCacheSize, nBlockSize, nFastStorageSize, nSlowStorageSize) = GetParam();
+
+            m_ptrTree = new BPlusStoreType(nDegree, nCacheSize, nBlockSize, nFastStorageSize, "", nSlowStorageSize, fsTempFileStore.string());
+            m_ptrTree->init<DataNodeType>();
+        }
+
+        void TearDown() override
+        {
+            delete m_ptrTree;
+            std::filesystem::remove(fsTempFileStore);
+        }
+
+        BPlusStoreType* m_ptrTree = nullptr;
+
+        size_t nDegree;
+        size_t nTotalRecords;
+        size_t nCacheSize;
+        size_t nBlockSize;
+        size_t nFastStorageSize;
+        size_t nSlowStorageSize;
+
+        std::filesystem::path fsTempFileStore = std::filesystem::temp_directory_path() / "tieredstore_suite_1.hdb";
+    };
+
+    TEST_P(BPlusStore_LRUCache_TieredStorage_Suite_1, Bulk_Search_v1)
+    {
+        for (int nCntr = 0; nCntr < nTotalRecords; nCntr++)
+        {
+            ErrorCode ec = m_ptrTree->insert(nCntr, nCntr);
+            assert(ec == ErrorCode::Success);
+        }
+
+        for (int nCntr = 0; nCntr < nTotalRecords; nCntr++)
+        {
+            int nValue = 0;
+            ErrorCode ec = m_ptrTree->search(nCntr, nValue);
+
+            assert(nCntr == nValue && ec == ErrorCode::Success);
+        }
+    }
+
+    TEST_P(BPlusStore_LRUCache_TieredStorage_Suite_1, Bulk_Search_v2)
+    {
+        std::vector<int> vtRandom(nTotalRecords);
+        std::iota(vtRandom.begin(), vtRandom.end(), 1);
+        std::random_device rd; // Obtain a random number from hardware
+        std::mt19937 eng(rd()); // Seed the generator
+        std::shuffle(vtRandom.begin(), vtRandom.end(), eng);
+
+        for (int nCntr = 0; nCntr < nTotalRecords; nCntr++)
+        {
+            ErrorCode ec = m_ptrTree->insert(vtRandom[nCntr], vtRandom[nCntr]);
+            assert(ec == ErrorCode::Success);
+        }
+
+        for (int nCntr = 0; nCntr < nTotalRecords; nCntr++)
+        {
+            int nValue = 0;
+            ErrorCode ec = m_ptrTree->search(vtRandom[nCntr], nValue);
+
+            assert(vtRandom[nCntr] == nValue && ec == ErrorCode::Success);
+        }
+    }
+
+    TEST_P(BPlusStore_LRUCache_TieredStorage_Suite_1, Bulk_Delete_v2)
+    {
+        std::vector<int> vtRandom(nTotalRecords);
+        std::iota(vtRandom.begin(), vtRandom.end(), 1);
+        std::random_device rd; // Obtain a random number from hardware
+        std::mt19937 eng(rd()); // Seed the generator
+        std::shuffle(vtRandom.begin(), vtRandom.end(), eng);
+
+        for (int nCntr = 0; nCntr < nTotalRecords; nCntr++)
+        {
+            ErrorCode ec = m_ptrTree->insert(vtRandom[nCntr], vtRandom[nCntr]);
+            assert(ec == ErrorCode::Success);
+        }
+
+        for (int nCntr = 0; nCntr < nTotalRecords; nCntr++)
+        {
+            ErrorCode ec = m_ptrTree->remove(vtRandom[nCntr]);
+            assert(ec == ErrorCode::Success);
+        }
+
+        for (int nCntr = 0; nCntr < nTotalRecords; nCntr++)
+        {
+            int nValue = 0;
+            ErrorCode ec = m_ptrTree->search(vtRandom[nCntr], nValue);
+
+            assert(ec == ErrorCode::KeyDoesNotExist);
+        }
+    }
+
+    TEST_P(BPlusStore_LRUCache_TieredStorage_Suite_1, Demotion_v1)
+    {
+        for (int nCntr = 0; nCntr < nTotalRecords; nCntr++)
+        {
+            ErrorCode ec = m_ptrTree->insert(nCntr, nCntr);
+            assert(ec == ErrorCode::Success);
+        }
+
+        m_ptrTree->flush();
+
+        size_t nUsedBlocks = 0, nLiveBlocks = 0, nLiveBlocksBefore = 0;
+        m_ptrTree->getStorageState(nUsedBlocks, nLiveBlocksBefore);
+
+        // Nothing is demoted until the live objects cross the high watermark.
+        size_t nBytes = 0, nDemotedBytes = 0;
+        while ((nBytes = m_ptrTree->demote(1024 * 1024)) > 0)
+        {
+            nDemotedBytes += nBytes;
+        }
+
+        m_ptrTree->getStorageState(nUsedBlocks, nLiveBlocks);
+
+        // The relocations dirty the parents, which are written to the tail in turn, therefore, the compaction is bounded here.
+        for (int nRound = 0; nRound < 16 && m_ptrTree->compact(1024 * 1024) > 0; nRound++);
+
+        if (nLiveBlocksBefore > nFastStorageSize / nBlockSize * TIERED_STORAGE_DEMOTION_HIGH_RATIO)
+        {
+            assert(nDemotedBytes > 0 && nLiveBlocks < nLiveBlocksBefore);
+        }
+
+        // The leaves read from the slow tier repeatedly are written back to the fast tier once evicted.
+        for (int nPass = 0; nPass < TIERED_STORAGE_PROMOTION_READS; nPass++)
+        {
+            for (int nCntr = 0; nCntr < nTotalRecords; nCntr++)
+            {
+                int nValue = 0;
+                ErrorCode ec = m_ptrTree->search(nCntr, nValue);
+
+                assert(nValue == nCntr && ec == ErrorCode::Success);
+            }
+        }
+
+        m_ptrTree->flush();
+
+        for (int nCntr = 0; nCntr < nTotalRecords; nCntr++)
+        {
+            int nValue = 0;
+            ErrorCode ec = m_ptrTree->search(nCntr, nValue);
+
+            assert(nValue == nCntr && ec == ErrorCode::Success);
+        }
+    }
+
+    TEST_P(BPlusStore_LRUCache_TieredStorage_Suite_1, Demotion_Background_v1)
+    {
+        std::vector<int> vtRandom(nTotalRecords);
+        std::iota(vtRandom.begin(), vtRandom.end(), 1);
+        std::random_device rd; // Obtain a random number from hardware
+        std::mt19937 eng(rd()); // Seed the generator
+        std::shuffle(vtRandom.begin(), vtRandom.end(), eng);
+
+        m_ptrTree->startDemotion(16 * 1024 * 1024);
+
+        for (int nCntr = 0; nCntr < nTotalRecords; nCntr++)
+        {
+            ErrorCode ec = m_ptrTree->insert(vtRandom[nCntr], vtRandom[nCntr]);
+            assert(ec == ErrorCode::Success);
+        }
+
+        for (int nCntr = 0; nCntr < nTotalRecords; nCntr++)
+        {
+            int nValue = 0;
+            ErrorCode ec = m_ptrTree->search(vtRandom[nCntr], nValue);
+
+            assert(vtRandom[nCntr] == nValue && ec == ErrorCode::Success);
+        }
+
+        for (int nCntr = 0; nCntr < nTotalRecords; nCntr = nCntr + 2)
+        {
+            ErrorCode ec = m_ptrTree->remove(vtRandom[nCntr]);
+            assert(ec == ErrorCode::Success);
+        }
+
+        m_ptrTree->stopDemotion();
+
+        for (int nCntr = 0; nCntr < nTotalRecords; nCntr++)
+        {
+            int nValue = 0;
+            ErrorCode ec = m_ptrTree->search(vtRandom[nCntr], nValue);
+
+            assert(nCntr % 2 == 0 ? ec == ErrorCode::KeyDoesNotExist : (vtRandom[nCntr] == nValue && ec == ErrorCode::Success));
+        }
+    }
+
+    INSTANTIATE_TEST_CASE_P(
+        TREE_WITH_KEY_AND_VAL_AS_INT32_AND_WITH_TIERED_STORAGE,
+        BPlusStore_LRUCache_TieredStorage_Suite_1,
+        ::testing::Values(
+            std::make_tuple(3, 100000, 100, 64, 2ULL * 1024 * 1024, 1ULL * 1024 * 1024 * 1024),
+            std::make_tuple(4, 100000, 100, 64, 2ULL * 1024 * 1024, 1ULL * 1024 * 1024 * 1024),
+            std::make_tuple(8, 100000, 100, 128, 2ULL * 1024 * 1024, 1ULL * 1024 * 1024 * 1024),
+            std::make_tuple(16, 100000, 100, 128, 2ULL * 1024 * 1024, 1ULL * 1024 * 1024 * 1024),
+            std::make_tuple(64, 100000, 100, 256, 2ULL * 1024 * 1024, 1ULL * 1024 * 1024 * 1024),
+            std::make_tuple(256, 100000, 100, 256, 2ULL * 1024 * 1024, 1ULL * 1024 * 1024 * 1024)
+        ));
+}
+#endif //__TREE_WITH_CACHE__